@@ -0,0 +1,415 @@
+#include "Adpcm.h"
+#include <algorithm>
+
+namespace {
+
+uint16_t ReadU16(const uint8_t *p) { return uint16_t(p[0] | (p[1] << 8)); }
+
+int16_t ReadS16(const uint8_t *p) { return int16_t(ReadU16(p)); }
+
+bool Fail(std::string *error, const char *message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+int32_t ClampSample(int32_t value) {
+  return std::clamp<int32_t>(value, INT16_MIN, INT16_MAX);
+}
+
+#pragma region IMA ADPCM
+
+constexpr int32_t kImaStepCount = 89;
+
+constexpr int16_t kImaSteps[kImaStepCount] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+constexpr int8_t kImaIndexAdjust[16] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                                        -1, -1, -1, -1, 2, 4, 6, 8};
+
+// ステップ位置とニブルから、足す差分と次のステップ位置を1回で引く表
+// 下位12ビットが次の行の先頭(ステップ位置×16)、残りが差分
+// 展開のたびに分岐してシフトを足し合わせずに済み、依存する読み込みも1つで済む
+constexpr int32_t kImaRowBits = 12;
+
+struct ImaTable {
+  int32_t entries[kImaStepCount * 16];
+};
+
+constexpr ImaTable MakeImaTable() {
+  ImaTable table{};
+  for (int32_t index = 0; index < kImaStepCount; ++index) {
+    const int32_t step = kImaSteps[index];
+    for (int32_t nibble = 0; nibble < 16; ++nibble) {
+      // Windowsのコーデックと同じ、シフトを足し合わせる方式
+      int32_t difference = step >> 3;
+      if (nibble & 4) {
+        difference += step;
+      }
+      if (nibble & 2) {
+        difference += step >> 1;
+      }
+      if (nibble & 1) {
+        difference += step >> 2;
+      }
+      if (nibble & 8) {
+        difference = -difference;
+      }
+      const int32_t next = std::clamp<int32_t>(
+          index + kImaIndexAdjust[nibble], 0, kImaStepCount - 1);
+      table.entries[index * 16 + nibble] =
+          difference * (1 << kImaRowBits) + next * 16;
+    }
+  }
+  return table;
+}
+
+constexpr ImaTable kImaTable = MakeImaTable();
+
+struct ImaState {
+  int32_t predictor = 0;
+  // ステップ位置×16(表の行の先頭)
+  int32_t row = 0;
+
+  int32_t GetIndex() const { return row / 16; }
+  void SetIndex(int32_t index) {
+    row = std::clamp<int32_t>(index, 0, kImaStepCount - 1) * 16;
+  }
+
+  int16_t Decode(uint32_t nibble) {
+    const int32_t entry = kImaTable.entries[row + int32_t(nibble)];
+    row = entry & ((1 << kImaRowBits) - 1);
+    predictor = ClampSample(predictor + (entry >> kImaRowBits));
+    return int16_t(predictor);
+  }
+
+  uint32_t Encode(int32_t sample) {
+    const int32_t step = kImaSteps[GetIndex()];
+    int32_t difference = sample - predictor;
+    uint32_t nibble = 0;
+    if (difference < 0) {
+      nibble = 8;
+      difference = -difference;
+    }
+    for (int32_t bit = 4, threshold = step; bit > 0;
+         bit >>= 1, threshold >>= 1) {
+      if (difference >= threshold) {
+        nibble |= uint32_t(bit);
+        difference -= threshold;
+      }
+    }
+    Decode(nibble);
+    return nibble;
+  }
+};
+
+uint32_t GetImaFrames(uint32_t channels, uint32_t blockBytes) {
+  // ヘッダのサンプル1つと、チャンネルごとに4バイト(8サンプル)ずつ
+  if (blockBytes < 4 * channels) {
+    return 0;
+  }
+  return (blockBytes - 4 * channels) / (4 * channels) * 8 + 1;
+}
+
+uint32_t DecodeImaBlock(const AdpcmFormat &format, const uint8_t *block,
+                        uint32_t blockBytes, int16_t *dst) {
+  const uint32_t channels = format.channels;
+  const uint32_t frames = std::min(GetImaFrames(channels, blockBytes),
+                                   format.samplesPerBlock);
+  if (frames == 0) {
+    return 0;
+  }
+
+  ImaState states[8];
+  ImaState *state = channels <= 8 ? states : nullptr;
+  std::vector<ImaState> manyStates;
+  if (state == nullptr) {
+    manyStates.resize(channels);
+    state = manyStates.data();
+  }
+  for (uint32_t channel = 0; channel < channels; ++channel) {
+    const uint8_t *header = block + 4 * channel;
+    state[channel].predictor = ReadS16(header);
+    state[channel].SetIndex(header[2]);
+    dst[channel] = int16_t(state[channel].predictor);
+  }
+
+  // チャンネルごとに4バイト(8サンプル)ずつ交互に並んでいる。下位ニブルが先
+  // 1サンプルごとに前の結果を待つので、チャンネルを交互に展開して
+  // 別々のチャンネルの計算を重ねる
+  const uint8_t *data = block + 4 * channels;
+  const uint32_t groups = (frames - 1) / 8;
+  for (uint32_t group = 0; group < groups; ++group) {
+    int16_t *out = dst + (1 + group * 8) * channels;
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+      const uint8_t *bytes = data + (group * channels + channel) * 4;
+      int16_t *channelOut = out + channel;
+      for (uint32_t i = 0; i < 4; ++i) {
+        channelOut[0] = state[channel].Decode(bytes[i] & 0x0F);
+        channelOut[channels] = state[channel].Decode(bytes[i] >> 4);
+        channelOut += channels * 2;
+      }
+    }
+  }
+  return frames;
+}
+
+#pragma endregion
+
+#pragma region MS ADPCM
+
+constexpr int32_t kMsAdaptation[16] = {230, 230, 230, 230, 307, 409, 512, 614,
+                                       768, 614, 512, 409, 307, 230, 230, 230};
+
+struct MsState {
+  int32_t coefficient1 = 0;
+  int32_t coefficient2 = 0;
+  int32_t delta = 0;
+  int32_t sample1 = 0;
+  int32_t sample2 = 0;
+
+  int16_t Decode(uint32_t nibble) {
+    const int32_t predicted =
+        (sample1 * coefficient1 + sample2 * coefficient2) >> 8;
+    // ニブルは符号付き4ビット
+    const int32_t signedNibble = int32_t(nibble ^ 8) - 8;
+    const int32_t sample = ClampSample(predicted + signedNibble * delta);
+    sample2 = sample1;
+    sample1 = sample;
+    // 壊れたデータでもあふれないよう、次の掛け算が収まる範囲に止める
+    delta = std::clamp((kMsAdaptation[nibble] * delta) >> 8, 16,
+                       INT32_MAX / 768);
+    return int16_t(sample);
+  }
+};
+
+uint32_t GetMsFrames(uint32_t channels, uint32_t blockBytes) {
+  // ヘッダの2サンプルと、1バイトに2サンプル
+  if (blockBytes < 7 * channels) {
+    return 0;
+  }
+  return (blockBytes - 7 * channels) * 2 / channels + 2;
+}
+
+uint32_t DecodeMsBlock(const AdpcmFormat &format, const uint8_t *block,
+                       uint32_t blockBytes, int16_t *dst) {
+  const uint32_t channels = format.channels;
+  const uint32_t frames =
+      std::min(GetMsFrames(channels, blockBytes), format.samplesPerBlock);
+  if (frames == 0) {
+    return 0;
+  }
+
+  // ヘッダは予測係数の番号、delta、1つ前、2つ前のサンプルの順に
+  // チャンネルの数ずつ並んでいる
+  MsState states[8];
+  MsState *state = channels <= 8 ? states : nullptr;
+  std::vector<MsState> manyStates;
+  if (state == nullptr) {
+    manyStates.resize(channels);
+    state = manyStates.data();
+  }
+  for (uint32_t channel = 0; channel < channels; ++channel) {
+    const uint32_t predictor =
+        std::min<uint32_t>(block[channel], format.coefficientCount - 1);
+    state[channel].coefficient1 = format.coefficients[predictor][0];
+    state[channel].coefficient2 = format.coefficients[predictor][1];
+    state[channel].delta = ReadS16(block + channels + channel * 2);
+    state[channel].sample1 = ReadS16(block + channels * 3 + channel * 2);
+    state[channel].sample2 = ReadS16(block + channels * 5 + channel * 2);
+    dst[channel] = int16_t(state[channel].sample2);
+    dst[channels + channel] = int16_t(state[channel].sample1);
+  }
+
+  // 以降は上位ニブルが先で、チャンネルが交互に並ぶ
+  const uint8_t *data = block + 7 * channels;
+  const uint32_t nibbles = (frames - 2) * channels;
+  int16_t *out = dst + 2 * channels;
+  if (channels == 1) {
+    for (uint32_t i = 0; i < nibbles; i += 2) {
+      out[i] = state[0].Decode(data[i / 2] >> 4);
+      out[i + 1] = state[0].Decode(data[i / 2] & 0x0F);
+    }
+  } else if (channels == 2) {
+    for (uint32_t i = 0; i < nibbles; i += 2) {
+      out[i] = state[0].Decode(data[i / 2] >> 4);
+      out[i + 1] = state[1].Decode(data[i / 2] & 0x0F);
+    }
+  } else {
+    for (uint32_t i = 0; i < nibbles; ++i) {
+      const uint8_t byte = data[i / 2];
+      out[i] = state[i % channels].Decode((i & 1) ? byte & 0x0F : byte >> 4);
+    }
+  }
+  return frames;
+}
+
+#pragma endregion
+
+} // namespace
+
+bool IsAdpcmFormatTag(uint16_t formatTag) {
+  return formatTag == kWaveFormatAdpcm || formatTag == kWaveFormatImaAdpcm;
+}
+
+bool ParseAdpcmFormat(const WaveFile &wave, AdpcmFormat &format,
+                      std::string *error) {
+  format = {};
+  const WaveFormat &wfx = wave.format;
+  if (!IsAdpcmFormatTag(wfx.formatTag)) {
+    return Fail(error, "not an ADPCM format");
+  }
+  if (wfx.bitsPerSample != 4) {
+    return Fail(error, "only 4-bit ADPCM is supported");
+  }
+  // cbSize(2) + wSamplesPerBlock(2)
+  if (wave.formatChunkSize < 20) {
+    return Fail(error, "ADPCM fmt chunk is too small");
+  }
+
+  format.formatTag = wfx.formatTag;
+  format.channels = wfx.channels;
+  format.blockAlign = wfx.blockAlign;
+  format.samplesPerBlock = ReadU16(wave.formatChunk + 18);
+
+  const uint32_t channels = wfx.channels;
+  uint32_t blockFrames = 0;
+  if (wfx.formatTag == kWaveFormatImaAdpcm) {
+    blockFrames = GetImaFrames(channels, wfx.blockAlign);
+  } else {
+    blockFrames = GetMsFrames(channels, wfx.blockAlign);
+
+    // wNumCoef(2) + 係数の組(普通は標準の7組)
+    uint32_t count = 0;
+    if (wave.formatChunkSize >= 22) {
+      count = ReadU16(wave.formatChunk + 20);
+    }
+    if (count == 0 || count > kMaxAdpcmCoefficients ||
+        wave.formatChunkSize < 22 + count * 4) {
+      return Fail(error, "invalid MS ADPCM coefficient table");
+    }
+    format.coefficientCount = count;
+    for (uint32_t i = 0; i < count; ++i) {
+      format.coefficients[i][0] = ReadS16(wave.formatChunk + 22 + i * 4);
+      format.coefficients[i][1] = ReadS16(wave.formatChunk + 24 + i * 4);
+    }
+  }
+  if (blockFrames == 0 || format.samplesPerBlock != blockFrames) {
+    return Fail(error, "inconsistent ADPCM block size");
+  }
+
+  // 最後のブロックは途中で終わっていることがある
+  const uint32_t blocks = wave.sampleBytes / wfx.blockAlign;
+  const uint32_t rest = wave.sampleBytes % wfx.blockAlign;
+  uint64_t frames = uint64_t(blocks) * format.samplesPerBlock;
+  if (rest != 0) {
+    frames += wfx.formatTag == kWaveFormatImaAdpcm
+                  ? GetImaFrames(channels, rest)
+                  : GetMsFrames(channels, rest);
+  }
+  if (wave.factSampleCount != 0) {
+    frames = std::min<uint64_t>(frames, wave.factSampleCount);
+  }
+  format.frameCount = uint32_t(std::min<uint64_t>(frames, UINT32_MAX));
+  return true;
+}
+
+uint32_t DecodeAdpcmBlock(const AdpcmFormat &format, const uint8_t *block,
+                          uint32_t blockBytes, int16_t *dst) {
+  blockBytes = std::min(blockBytes, format.blockAlign);
+  if (format.formatTag == kWaveFormatImaAdpcm) {
+    return DecodeImaBlock(format, block, blockBytes, dst);
+  }
+  if (format.formatTag == kWaveFormatAdpcm) {
+    return DecodeMsBlock(format, block, blockBytes, dst);
+  }
+  return 0;
+}
+
+std::vector<int16_t> DecodeAdpcm(const AdpcmFormat &format,
+                                 const uint8_t *data, size_t size) {
+  const size_t channels = format.channels;
+  std::vector<int16_t> samples(size_t(format.frameCount) * channels);
+  std::vector<int16_t> block(size_t(format.samplesPerBlock) * channels);
+
+  size_t written = 0;
+  for (size_t offset = 0; offset < size && written < format.frameCount;
+       offset += format.blockAlign) {
+    const uint32_t blockBytes =
+        uint32_t(std::min<size_t>(format.blockAlign, size - offset));
+    const size_t remaining = format.frameCount - written;
+    if (remaining >= format.samplesPerBlock) {
+      // 丸ごと入るブロックは直接書き込む
+      written += DecodeAdpcmBlock(format, data + offset, blockBytes,
+                                  samples.data() + written * channels);
+      continue;
+    }
+    const uint32_t frames =
+        DecodeAdpcmBlock(format, data + offset, blockBytes, block.data());
+    const size_t copied = std::min<size_t>(frames, remaining);
+    std::copy_n(block.begin(), copied * channels,
+                samples.begin() + written * channels);
+    written += copied;
+  }
+  samples.resize(written * channels);
+  return samples;
+}
+
+std::vector<uint8_t> EncodeImaAdpcm(const int16_t *samples,
+                                    uint32_t frameCount, uint16_t channels,
+                                    uint32_t samplesPerBlock,
+                                    AdpcmFormat &format) {
+  format = {};
+  format.formatTag = kWaveFormatImaAdpcm;
+  format.channels = channels;
+  format.samplesPerBlock = samplesPerBlock;
+  format.blockAlign = 4 * channels + (samplesPerBlock - 1) / 8 * 4 * channels;
+  format.frameCount = frameCount;
+
+  const uint32_t blocks = (frameCount + samplesPerBlock - 1) / samplesPerBlock;
+  std::vector<uint8_t> data(size_t(blocks) * format.blockAlign);
+  std::vector<ImaState> states(channels);
+  // 最後のブロックの足りない分は最後のサンプルを繰り返す
+  const auto sampleAt = [&](uint32_t frame, uint32_t channel) {
+    frame = std::min(frame, frameCount - 1);
+    return int32_t(samples[size_t(frame) * channels + channel]);
+  };
+
+  for (uint32_t blockIndex = 0; blockIndex < blocks; ++blockIndex) {
+    uint8_t *block = data.data() + size_t(blockIndex) * format.blockAlign;
+    const uint32_t first = blockIndex * samplesPerBlock;
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+      ImaState &state = states[channel];
+      // ブロックの最初のサンプルはそのまま書く。ステップ位置は前から引き継ぐ
+      state.predictor = sampleAt(first, channel);
+      uint8_t *header = block + 4 * channel;
+      header[0] = uint8_t(state.predictor);
+      header[1] = uint8_t(state.predictor >> 8);
+      header[2] = uint8_t(state.GetIndex());
+      header[3] = 0;
+
+      const uint32_t groups = (samplesPerBlock - 1) / 8;
+      for (uint32_t group = 0; group < groups; ++group) {
+        uint8_t *bytes =
+            block + 4 * channels + (group * channels + channel) * 4;
+        const uint32_t frame = first + 1 + group * 8;
+        for (uint32_t i = 0; i < 4; ++i) {
+          const uint32_t low = state.Encode(sampleAt(frame + i * 2, channel));
+          const uint32_t high =
+              state.Encode(sampleAt(frame + i * 2 + 1, channel));
+          bytes[i] = uint8_t(low | (high << 4));
+        }
+      }
+    }
+  }
+  return data;
+}
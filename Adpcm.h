@@ -0,0 +1,49 @@
+#pragma once
+#include "RiffReader.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// MS ADPCMのfmtに書ける係数の組の上限(標準は7組)
+constexpr uint32_t kMaxAdpcmCoefficients = 32;
+
+// ADPCMのWAVの形式。ブロック単位でしか展開できない
+struct AdpcmFormat {
+  // kWaveFormatAdpcmかkWaveFormatImaAdpcm。0なら圧縮されていない
+  uint16_t formatTag = 0;
+  uint16_t channels = 0;
+  uint32_t blockAlign = 0;
+  // 1ブロックを展開したときのフレーム数
+  uint32_t samplesPerBlock = 0;
+  // 全体のフレーム数(factチャンクがあればその値)
+  uint32_t frameCount = 0;
+  // MS ADPCMの予測係数
+  uint32_t coefficientCount = 0;
+  int16_t coefficients[kMaxAdpcmCoefficients][2] = {};
+
+  bool IsValid() const { return formatTag != 0; }
+};
+
+bool IsAdpcmFormatTag(uint16_t formatTag);
+
+// fmtの追加情報とdataの大きさから形式を読み取る
+bool ParseAdpcmFormat(const WaveFile &wave, AdpcmFormat &format,
+                      std::string *error = nullptr);
+
+// 1ブロックを16bitのLRLR...に展開し、展開したフレーム数を返す
+// 最後のブロックはblockAlignより短くてもよい
+// dstにはsamplesPerBlock×チャンネル数の大きさが要る
+uint32_t DecodeAdpcmBlock(const AdpcmFormat &format, const uint8_t *block,
+                          uint32_t blockBytes, int16_t *dst);
+
+// dataチャンク全体を展開する(frameCountフレーム分)
+std::vector<int16_t> DecodeAdpcm(const AdpcmFormat &format,
+                                 const uint8_t *data, size_t size);
+
+// samplesPerBlockは1+8の倍数。最後のブロックは最後のサンプルで埋める
+// formatにはWAVに書き出すための値が入る
+std::vector<uint8_t> EncodeImaAdpcm(const int16_t *samples,
+                                    uint32_t frameCount, uint16_t channels,
+                                    uint32_t samplesPerBlock,
+                                    AdpcmFormat &format);
@@ -0,0 +1,81 @@
+#include "AssetRegistry.h"
+#include <cctype>
+#include <filesystem>
+
+AssetRegistry &AssetRegistry::GetInstance() {
+  static AssetRegistry instance;
+  return instance;
+}
+
+std::string AssetRegistry::NormalizePath(const std::string &path) {
+  std::string normalized =
+      std::filesystem::path(path).lexically_normal().generic_string();
+#ifdef _WIN32
+  // Windowsのファイル名は大文字小文字を区別しない
+  for (char &c : normalized) {
+    c = char(std::tolower(static_cast<unsigned char>(c)));
+  }
+#endif
+  return normalized;
+}
+
+std::string AssetRegistry::MakeKey(AssetType type, const std::string &path) {
+  return std::to_string(int(type)) + ":" + NormalizePath(path);
+}
+
+void AssetRegistry::Invalidate(AssetType type, const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(MakeKey(type, path));
+  if (it != entries_.end() && !it->second.isLoading) {
+    // 使用量は古いアセットが解放されたときに減らす
+    entries_.erase(it);
+  }
+}
+
+size_t AssetRegistry::GetMemoryUsage(AssetType type) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memoryUsage_[size_t(type)];
+}
+
+size_t AssetRegistry::GetLoadedCount(AssetType type) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return loadedCount_[size_t(type)];
+}
+
+void AssetRegistry::OnLoaded(AssetType type, const std::string &key,
+                             uint64_t generation,
+                             const std::shared_ptr<const void> &asset,
+                             size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memoryUsage_[size_t(type)] += size;
+  loadedCount_[size_t(type)] += 1;
+
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.generation == generation) {
+    it->second.asset = asset;
+    it->second.isLoading = false;
+    it->second.loading = {};
+  }
+}
+
+void AssetRegistry::OnLoadFailed(const std::string &key,
+                                 uint64_t generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.generation == generation) {
+    entries_.erase(it);
+  }
+}
+
+void AssetRegistry::OnReleased(AssetType type, const std::string &key,
+                               uint64_t generation, size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memoryUsage_[size_t(type)] -= size;
+  loadedCount_[size_t(type)] -= 1;
+
+  // 読み直し済みなら新しい登録は残す
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.generation == generation) {
+    entries_.erase(it);
+  }
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// アセットの種類。メモリ使用量は種類ごとに集計する
+enum class AssetType { Model, Texture, Sound, Count };
+
+// 同じパスのアセットを一度だけ読み込み、参照カウント付きのハンドルで共有するクラス
+// 最後のハンドルが破棄されたときにアセットを解放して登録も消す
+class AssetRegistry {
+public:
+  template <typename T> using Handle = std::shared_ptr<const T>;
+
+  static AssetRegistry &GetInstance();
+
+  // 読み込み済みならそれを返し、なければloadで読み込んで登録する
+  // 別のスレッドが同じパスを読み込み中なら、その完了を待って同じものを返す
+  // loadがfalseを返したら登録せずにnullptrを返す(次のAcquireで読み直す)
+  // sizeOfはメモリ使用量の集計に、unloadは解放時の後始末に使う
+  template <typename T>
+  Handle<T> Acquire(AssetType type, const std::string &path,
+                    const std::function<bool(T &)> &load,
+                    const std::function<size_t(const T &)> &sizeOf,
+                    const std::function<void(T &)> &unload = nullptr);
+
+  // 登録だけを外す。次のAcquireで読み直される(ホットリロード用)
+  // 今あるハンドルは古いアセットを指したまま使える
+  void Invalidate(AssetType type, const std::string &path);
+
+  size_t GetMemoryUsage(AssetType type) const;
+  size_t GetLoadedCount(AssetType type) const;
+
+  // 同じファイルを指すパスが同じ文字列になるようにする
+  static std::string NormalizePath(const std::string &path);
+
+private:
+  AssetRegistry() = default;
+
+  struct Entry {
+    std::weak_ptr<const void> asset;
+    // 読み込み中の間だけ有効
+    std::shared_future<std::shared_ptr<const void>> loading;
+    bool isLoading = false;
+    // 読み直したときに古いアセットの解放で新しい登録を消さないための番号
+    uint64_t generation = 0;
+  };
+
+  static std::string MakeKey(AssetType type, const std::string &path);
+
+  void OnLoaded(AssetType type, const std::string &key, uint64_t generation,
+                const std::shared_ptr<const void> &asset, size_t size);
+  void OnLoadFailed(const std::string &key, uint64_t generation);
+  void OnReleased(AssetType type, const std::string &key, uint64_t generation,
+                  size_t size);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+  uint64_t nextGeneration_ = 1;
+
+  std::array<size_t, size_t(AssetType::Count)> memoryUsage_{};
+  std::array<size_t, size_t(AssetType::Count)> loadedCount_{};
+};
+
+template <typename T>
+AssetRegistry::Handle<T>
+AssetRegistry::Acquire(AssetType type, const std::string &path,
+                       const std::function<bool(T &)> &load,
+                       const std::function<size_t(const T &)> &sizeOf,
+                       const std::function<void(T &)> &unload) {
+  const std::string key = MakeKey(type, path);
+  std::promise<std::shared_ptr<const void>> promise;
+  uint64_t generation = 0;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Entry &entry = entries_[key];
+    if (std::shared_ptr<const void> asset = entry.asset.lock()) {
+      return std::static_pointer_cast<const T>(asset);
+    }
+    if (entry.isLoading) {
+      std::shared_future<std::shared_ptr<const void>> loading = entry.loading;
+      lock.unlock();
+      return std::static_pointer_cast<const T>(loading.get());
+    }
+    generation = nextGeneration_++;
+    entry.generation = generation;
+    entry.isLoading = true;
+    entry.loading = promise.get_future().share();
+  }
+
+  // 読み込みはロックの外で行う(別のアセットの読み込みを止めない)
+  Handle<T> handle;
+  try {
+    auto loaded = std::make_unique<T>();
+    if (!load(*loaded)) {
+      // 失敗は覚えておかない。待っていたスレッドにもnullptrを返す
+      OnLoadFailed(key, generation);
+      promise.set_value(nullptr);
+      return nullptr;
+    }
+    T *asset = loaded.release();
+    size_t size = sizeOf(*asset);
+    handle = Handle<T>(asset, [this, type, key, generation, size,
+                               unload](const T *releasedAsset) {
+      T *mutableAsset = const_cast<T *>(releasedAsset);
+      if (unload) {
+        unload(*mutableAsset);
+      }
+      delete mutableAsset;
+      OnReleased(type, key, generation, size);
+    });
+    OnLoaded(type, key, generation, handle, size);
+  } catch (...) {
+    OnLoadFailed(key, generation);
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+
+  promise.set_value(handle);
+  return handle;
+}
@@ -0,0 +1,247 @@
+#include "AudioMixKernels.h"
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#define AUDIO_MIX_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clangは関数ごとにAVXを許可する。MSVCは指定しなくても使える
+#if defined(AUDIO_MIX_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AUDIO_MIX_TARGET_AVX __attribute__((target("avx")))
+#else
+#define AUDIO_MIX_TARGET_AVX
+#endif
+
+namespace {
+
+#pragma region スカラー
+
+void MixRampedScalar(const float *src, float *dst, size_t count,
+                     float gainStart, float gainEnd) {
+  const float step = count > 0 ? (gainEnd - gainStart) / float(count) : 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    dst[i] += src[i] * (gainStart + step * float(i));
+  }
+}
+
+void InterleaveStereoScalar(const float *left, const float *right, float *dst,
+                            size_t count, float gain) {
+  for (size_t i = 0; i < count; ++i) {
+    dst[i * 2] = std::clamp(left[i] * gain, -1.0f, 1.0f);
+    dst[i * 2 + 1] = std::clamp(right[i] * gain, -1.0f, 1.0f);
+  }
+}
+
+float DotProductScalar(const float *a, const float *b, size_t count) {
+  // SIMD版と足す順番をなるべく揃えるため、4つに分けて足す
+  float sums[4] = {};
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    for (size_t lane = 0; lane < 4; ++lane) {
+      sums[lane] += a[i + lane] * b[i + lane];
+    }
+  }
+  float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  for (; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#pragma endregion
+
+#ifdef AUDIO_MIX_X86
+
+#pragma region SSE
+
+void MixRampedSse(const float *src, float *dst, size_t count, float gainStart,
+                  float gainEnd) {
+  const float step = count > 0 ? (gainEnd - gainStart) / float(count) : 0.0f;
+  const __m128 start = _mm_set1_ps(gainStart);
+  const __m128 steps = _mm_set1_ps(step);
+  __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 gain = _mm_add_ps(start, _mm_mul_ps(steps, index));
+    __m128 mixed = _mm_add_ps(_mm_loadu_ps(dst + i),
+                              _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+    _mm_storeu_ps(dst + i, mixed);
+    index = _mm_add_ps(index, four);
+  }
+  for (; i < count; ++i) {
+    dst[i] += src[i] * (gainStart + step * float(i));
+  }
+}
+
+void InterleaveStereoSse(const float *left, const float *right, float *dst,
+                         size_t count, float gain) {
+  const __m128 gains = _mm_set1_ps(gain);
+  const __m128 lower = _mm_set1_ps(-1.0f);
+  const __m128 upper = _mm_set1_ps(1.0f);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 l = _mm_mul_ps(_mm_loadu_ps(left + i), gains);
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(right + i), gains);
+    l = _mm_min_ps(_mm_max_ps(l, lower), upper);
+    r = _mm_min_ps(_mm_max_ps(r, lower), upper);
+    _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+  }
+  InterleaveStereoScalar(left + i, right + i, dst + i * 2, count - i, gain);
+}
+
+float DotProductSse(const float *a, const float *b, size_t count) {
+  __m128 sums = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    sums = _mm_add_ps(sums,
+                      _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, sums);
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#pragma endregion
+
+#pragma region AVX
+
+AUDIO_MIX_TARGET_AVX
+void MixRampedAvx(const float *src, float *dst, size_t count, float gainStart,
+                  float gainEnd) {
+  const float step = count > 0 ? (gainEnd - gainStart) / float(count) : 0.0f;
+  const __m256 start = _mm256_set1_ps(gainStart);
+  const __m256 steps = _mm256_set1_ps(step);
+  __m256 index =
+      _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  const __m256 eight = _mm256_set1_ps(8.0f);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 gain = _mm256_add_ps(start, _mm256_mul_ps(steps, index));
+    __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(dst + i),
+                                 _mm256_mul_ps(_mm256_loadu_ps(src + i), gain));
+    _mm256_storeu_ps(dst + i, mixed);
+    index = _mm256_add_ps(index, eight);
+  }
+  for (; i < count; ++i) {
+    dst[i] += src[i] * (gainStart + step * float(i));
+  }
+}
+
+AUDIO_MIX_TARGET_AVX
+void InterleaveStereoAvx(const float *left, const float *right, float *dst,
+                         size_t count, float gain) {
+  const __m256 gains = _mm256_set1_ps(gain);
+  const __m256 lower = _mm256_set1_ps(-1.0f);
+  const __m256 upper = _mm256_set1_ps(1.0f);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 l = _mm256_mul_ps(_mm256_loadu_ps(left + i), gains);
+    __m256 r = _mm256_mul_ps(_mm256_loadu_ps(right + i), gains);
+    l = _mm256_min_ps(_mm256_max_ps(l, lower), upper);
+    r = _mm256_min_ps(_mm256_max_ps(r, lower), upper);
+    // unpackは128ビットごとに動くので、最後に前半と後半を入れ替えて並べる
+    __m256 low = _mm256_unpacklo_ps(l, r);
+    __m256 high = _mm256_unpackhi_ps(l, r);
+    _mm256_storeu_ps(dst + i * 2, _mm256_permute2f128_ps(low, high, 0x20));
+    _mm256_storeu_ps(dst + i * 2 + 8, _mm256_permute2f128_ps(low, high, 0x31));
+  }
+  InterleaveStereoScalar(left + i, right + i, dst + i * 2, count - i, gain);
+}
+
+AUDIO_MIX_TARGET_AVX
+float DotProductAvx(const float *a, const float *b, size_t count) {
+  __m256 sums = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    sums = _mm256_add_ps(
+        sums, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  // 上下128ビットを足してからSSEと同じ順番で足す
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sums),
+                           _mm256_extractf128_ps(sums, 1));
+  float lanes[4];
+  _mm_storeu_ps(lanes, half);
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#pragma endregion
+
+bool IsAvxSupported() {
+#ifdef _MSC_VER
+  int info[4] = {};
+  __cpuid(info, 1);
+  // AVXが使えても、OSがYMMレジスタを保存しないなら使えない
+  const bool hasAvx = (info[2] & (1 << 28)) != 0;
+  const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+  return hasAvx && hasOsxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+  return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif
+
+const MixKernels kScalarKernels = {MixRampedScalar, InterleaveStereoScalar,
+                                   DotProductScalar};
+#ifdef AUDIO_MIX_X86
+const MixKernels kSseKernels = {MixRampedSse, InterleaveStereoSse,
+                                DotProductSse};
+const MixKernels kAvxKernels = {MixRampedAvx, InterleaveStereoAvx,
+                                DotProductAvx};
+#endif
+
+} // namespace
+
+SimdLevel GetSupportedSimdLevel() {
+#ifdef AUDIO_MIX_X86
+  // x86/x64ではSSE2までは必ずある前提
+  static const SimdLevel level =
+      IsAvxSupported() ? SimdLevel::Avx : SimdLevel::Sse;
+  return level;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+const char *GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::Sse:
+    return "sse";
+  case SimdLevel::Avx:
+    return "avx";
+  default:
+    return "scalar";
+  }
+}
+
+const MixKernels &GetMixKernels(SimdLevel level) {
+  level = std::min(level, GetSupportedSimdLevel());
+#ifdef AUDIO_MIX_X86
+  if (level == SimdLevel::Avx) {
+    return kAvxKernels;
+  }
+  if (level == SimdLevel::Sse) {
+    return kSseKernels;
+  }
+#endif
+  return kScalarKernels;
+}
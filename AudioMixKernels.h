@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ミキサーで使うSIMD命令のレベル
+enum class SimdLevel { Scalar, Sse, Avx };
+
+// このCPUで使える一番高いレベル
+SimdLevel GetSupportedSimdLevel();
+
+const char *GetSimdLevelName(SimdLevel level);
+
+// ミキサーの内側のループ。どのレベルでも丸め誤差の範囲で同じ結果になる
+struct MixKernels {
+  // dst[i] += src[i] * gain。gainはgainStartからgainEndまで直線で変える
+  // (音量を急に変えたときのプチノイズを防ぐ)
+  void (*mixRamped)(const float *src, float *dst, size_t count,
+                    float gainStart, float gainEnd);
+  // 左右のバスをgain倍し、-1～1に収めてLRLR...の順に並べる
+  void (*interleaveStereo)(const float *left, const float *right, float *dst,
+                           size_t count, float gain);
+  // aとbの内積(リサンプラーのフィルタに使う)
+  float (*dotProduct)(const float *a, const float *b, size_t count);
+};
+
+// levelが使えないCPUではそれより低いレベルの実装を返す
+const MixKernels &GetMixKernels(SimdLevel level);
@@ -0,0 +1,594 @@
+#include "AudioMixer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+#include <utility>
+
+AudioMixer::AudioMixer(uint32_t sampleRate, uint32_t maxVoices,
+                       SimdLevel simdLevel)
+    : sampleRate_(sampleRate), slots_(std::max(maxVoices, 1u)),
+      // 全部のボイスを一度に鳴らして止めても入り切る大きさにする
+      commands_(std::max<size_t>(slots_.size() * 2, kMinCommandCapacity)),
+      finishedVoices_(slots_.size()), parameters_(slots_.size()),
+      voices_(slots_.size()) {
+  simdLevel_ = std::min(simdLevel, GetSupportedSimdLevel());
+  kernels_ = &GetMixKernels(simdLevel_);
+  // Renderで初めて変換するときに係数を作らないよう、ここで全部作っておく
+  Resampler::PrepareFilterTables();
+
+  for (uint32_t channel = 0; channel < kChannels; ++channel) {
+    scratch_[channel].resize(kBlockFrames);
+    master_[channel].resize(kBlockFrames);
+    sourceScratch_[channel].resize(kBlockFrames);
+    for (Bus &bus : buses_) {
+      bus.samples[channel].resize(kBlockFrames);
+    }
+  }
+  convertScratch_.resize(size_t(kBlockFrames) * kMaxPcmChannels);
+  for (std::vector<float> &samples : channelScratch_) {
+    samples.resize(kBlockFrames);
+  }
+  for (std::atomic<float> &gain : busGains_) {
+    gain.store(1.0f, std::memory_order_relaxed);
+  }
+
+  activeVoices_.reserve(voices_.size());
+  freeVoices_.reserve(slots_.size());
+  for (uint32_t i = uint32_t(slots_.size()); i > 0; --i) {
+    freeVoices_.push_back(i - 1);
+  }
+}
+
+#pragma region 再生
+
+AudioVoiceHandle AudioMixer::Play(const SoundData &soundData, float gain,
+                                  float pan, bool isLooping, uint32_t bus) {
+  const WAVEFORMATEX &wfex = soundData.wfex;
+  // ADPCMはブロックごとに16bitへ展開しながら読む
+  const bool isAdpcm = soundData.adpcm.IsValid();
+  PcmFormat format = PcmFormat::Int16;
+  if (!isAdpcm &&
+      !GetPcmFormat(wfex.wFormatTag, wfex.wBitsPerSample, format)) {
+    std::cerr << "AudioMixer: unsupported sample format (0x" << std::hex
+              << wfex.wFormatTag << std::dec << ", " << wfex.wBitsPerSample
+              << " bit)" << std::endl;
+    return {};
+  }
+  if (wfex.nChannels < 1 || wfex.nChannels > kMaxPcmChannels) {
+    std::cerr << "AudioMixer: unsupported channel count (" << wfex.nChannels
+              << ")" << std::endl;
+    return {};
+  }
+  if (wfex.nSamplesPerSec == 0 ||
+      double(wfex.nSamplesPerSec) / sampleRate_ > Resampler::kMaxRatio) {
+    std::cerr << "AudioMixer: unsupported sample rate (" << wfex.nSamplesPerSec
+              << " Hz)" << std::endl;
+    return {};
+  }
+  const uint32_t frameBytes = wfex.nChannels * GetPcmSampleBytes(format);
+  const uint32_t frameCount = isAdpcm ? soundData.adpcm.frameCount
+                                      : soundData.bufferSize / frameBytes;
+  if (frameCount == 0 || bus >= kMaxBuses || freeVoices_.empty()) {
+    return {};
+  }
+
+  // 番号はRenderから鳴り終わりを受け取るまで使い回さない
+  const uint32_t index = freeVoices_.back();
+  freeVoices_.pop_back();
+  VoiceSlot &slot = slots_[index];
+  ++slot.generation;
+  slot.isInUse = true;
+  slot.storage = soundData.storage;
+  ++usedVoiceCount_;
+
+  // 変換とADPCMの展開のバッファはここで確保し、Renderでは確保しない
+  // この番号はRenderが鳴り終わりを返した後なので、命令を積むまでRenderは触らない
+  Voice &voice = voices_[index];
+  if (!voice.resampler) {
+    // ピッチを変えると同じレートの音も変換するので、どのボイスにも用意する
+    // 品質は変換を始めるときにRenderが合わせる
+    voice.resampler = std::make_unique<Resampler>(
+        kChannels, ResamplerQuality::Medium, simdLevel_);
+  }
+  if (isAdpcm) {
+    // 確保したバッファは次に鳴らすときも使い回す
+    const size_t decodedSamples =
+        size_t(soundData.adpcm.samplesPerBlock) * wfex.nChannels;
+    if (voice.decodedBlock.size() < decodedSamples) {
+      voice.decodedBlock.resize(decodedSamples);
+    }
+  }
+
+  // キューに積む前に書いておけば、Renderが命令を受け取った時点で見える
+  VoiceParameters &parameters = parameters_[index];
+  parameters.gain.store(gain, std::memory_order_relaxed);
+  parameters.pan.store(std::clamp(pan, -1.0f, 1.0f),
+                       std::memory_order_relaxed);
+  parameters.pitch.store(1.0f, std::memory_order_relaxed);
+
+  Command command;
+  command.type = CommandType::Play;
+  command.index = index;
+  command.generation = slot.generation;
+  command.isLooping = isLooping;
+  command.bus = bus;
+  command.sound = soundData;
+  // 参照カウントの増減をオーディオスレッドでしないよう、中身はslotで持つ
+  command.sound.storage.reset();
+  PushCommand(std::move(command));
+  return {index, slot.generation};
+}
+
+void AudioMixer::Stop(AudioVoiceHandle handle) {
+  if (FindSlot(handle) == nullptr) {
+    return;
+  }
+  Command command;
+  command.type = CommandType::Stop;
+  command.index = handle.index;
+  command.generation = handle.generation;
+  PushCommand(std::move(command));
+}
+
+void AudioMixer::StopAll() {
+  Command command;
+  command.type = CommandType::StopAll;
+  PushCommand(std::move(command));
+}
+
+void AudioMixer::SetGain(AudioVoiceHandle handle, float gain) {
+  if (FindSlot(handle) != nullptr) {
+    parameters_[handle.index].gain.store(gain, std::memory_order_relaxed);
+  }
+}
+
+void AudioMixer::SetPan(AudioVoiceHandle handle, float pan) {
+  if (FindSlot(handle) != nullptr) {
+    parameters_[handle.index].pan.store(std::clamp(pan, -1.0f, 1.0f),
+                                        std::memory_order_relaxed);
+  }
+}
+
+void AudioMixer::SetPitch(AudioVoiceHandle handle, float pitch) {
+  // 元のレートに合わせた範囲への制限はRenderで行う
+  if (FindSlot(handle) != nullptr) {
+    parameters_[handle.index].pitch.store(pitch, std::memory_order_relaxed);
+  }
+}
+
+void AudioMixer::SetPosition(AudioVoiceHandle handle, uint32_t frame) {
+  if (FindSlot(handle) == nullptr) {
+    return;
+  }
+  Command command;
+  command.type = CommandType::SetPosition;
+  command.index = handle.index;
+  command.generation = handle.generation;
+  command.position = frame;
+  PushCommand(std::move(command));
+}
+
+bool AudioMixer::IsPlaying(AudioVoiceHandle handle) const {
+  return FindSlot(handle) != nullptr;
+}
+
+void AudioMixer::SetVoiceParameters(AudioVoiceHandle *handles,
+                                    const float *gains, const float *pans,
+                                    const float *pitches, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    if (!handles[i].IsValid()) {
+      continue;
+    }
+    if (FindSlot(handles[i]) == nullptr) {
+      handles[i] = {};
+      continue;
+    }
+    VoiceParameters &parameters = parameters_[handles[i].index];
+    parameters.gain.store(gains[i], std::memory_order_relaxed);
+    parameters.pan.store(std::clamp(pans[i], -1.0f, 1.0f),
+                         std::memory_order_relaxed);
+    parameters.pitch.store(pitches[i], std::memory_order_relaxed);
+  }
+}
+
+void AudioMixer::SetResamplerQuality(ResamplerQuality quality) {
+  Command command;
+  command.type = CommandType::SetResamplerQuality;
+  command.quality = quality;
+  PushCommand(std::move(command));
+}
+
+void AudioMixer::SetBusGain(uint32_t bus, float gain) {
+  if (bus < kMaxBuses) {
+    busGains_[bus].store(gain, std::memory_order_relaxed);
+  }
+}
+
+void AudioMixer::SetMasterGain(float gain) {
+  masterGain_.store(gain, std::memory_order_relaxed);
+}
+
+void AudioMixer::Update() {
+  uint32_t index = 0;
+  while (finishedVoices_.TryPop(index)) {
+    // Renderはもうこの音を読まないので、ここでファイルのマップを手放せる
+    VoiceSlot &slot = slots_[index];
+    slot.storage.reset();
+    slot.isInUse = false;
+    freeVoices_.push_back(index);
+    --usedVoiceCount_;
+  }
+  FlushPendingCommands();
+}
+
+uint32_t AudioMixer::GetActiveVoiceCount() const { return usedVoiceCount_; }
+
+const AudioMixer::VoiceSlot *
+AudioMixer::FindSlot(AudioVoiceHandle handle) const {
+  if (handle.index >= slots_.size()) {
+    return nullptr;
+  }
+  const VoiceSlot &slot = slots_[handle.index];
+  if (!slot.isInUse || slot.generation != handle.generation) {
+    return nullptr;
+  }
+  return &slot;
+}
+
+void AudioMixer::PushCommand(Command command) {
+  FlushPendingCommands();
+  if (!pendingCommands_.empty() || !commands_.TryPush(std::move(command))) {
+    pendingCommands_.push_back(std::move(command));
+  }
+}
+
+void AudioMixer::FlushPendingCommands() {
+  size_t pushed = 0;
+  while (pushed < pendingCommands_.size() &&
+         commands_.TryPush(pendingCommands_[pushed])) {
+    ++pushed;
+  }
+  pendingCommands_.erase(pendingCommands_.begin(),
+                         pendingCommands_.begin() + pushed);
+}
+
+#pragma endregion
+
+#pragma region 命令の反映
+
+void AudioMixer::ProcessCommands() {
+  Command command;
+  while (commands_.TryPop(command)) {
+    switch (command.type) {
+    case CommandType::Play:
+      StartVoice(command);
+      break;
+    case CommandType::Stop: {
+      Voice &voice = voices_[command.index];
+      if (voice.generation == command.generation &&
+          voice.state == VoiceState::Playing) {
+        voice.state = VoiceState::Stopping;
+      }
+      break;
+    }
+    case CommandType::StopAll:
+      for (uint32_t index : activeVoices_) {
+        if (voices_[index].state == VoiceState::Playing) {
+          voices_[index].state = VoiceState::Stopping;
+        }
+      }
+      break;
+    case CommandType::SetPosition: {
+      Voice &voice = voices_[command.index];
+      if (voice.generation != command.generation ||
+          voice.state != VoiceState::Playing) {
+        break;
+      }
+      voice.position = std::min(command.position, voice.frameCount);
+      // ADPCMは新しい位置のブロックを展開し直す
+      voice.decodedBlockIndex = UINT32_MAX;
+      if (voice.isResampling) {
+        voice.resampler->Reset();
+        voice.tailFrames = voice.resampler->GetLatency();
+      }
+      break;
+    }
+    case CommandType::SetResamplerQuality:
+      resamplerQuality_ = command.quality;
+      break;
+    }
+  }
+}
+
+void AudioMixer::StartVoice(Command &command) {
+  const SoundData &soundData = command.sound;
+  const WAVEFORMATEX &wfex = soundData.wfex;
+  const bool isAdpcm = soundData.adpcm.IsValid();
+  PcmFormat format = PcmFormat::Int16;
+  if (!isAdpcm) {
+    GetPcmFormat(wfex.wFormatTag, wfex.wBitsPerSample, format);
+  }
+
+  Voice &voice = voices_[command.index];
+  voice.generation = command.generation;
+  voice.state = VoiceState::Playing;
+  voice.sound = soundData;
+  voice.format = format;
+  voice.sourceChannels = wfex.nChannels;
+  voice.channels = std::min<uint32_t>(wfex.nChannels, kChannels);
+  if (voice.sourceChannels > kChannels) {
+    voice.downmix = BuildChannelMatrix(voice.sourceChannels,
+                                       soundData.channelMask, kChannels, 0);
+  }
+  voice.frameCount =
+      isAdpcm ? soundData.adpcm.frameCount
+              : soundData.bufferSize /
+                    (wfex.nChannels * GetPcmSampleBytes(format));
+  if (isAdpcm) {
+    // 展開先のバッファはPlayで確保してある
+    voice.decodedBlockIndex = UINT32_MAX;
+  }
+  voice.position = 0;
+  voice.isLooping = command.isLooping;
+  voice.bus = command.bus;
+  voice.hasStarted = false;
+  voice.pitch = 1.0f;
+  voice.isResampling = false;
+  ApplyParameters(command.index, voice);
+  if (wfex.nSamplesPerSec != sampleRate_ && !voice.isResampling) {
+    StartResampling(voice);
+  }
+  activeVoices_.push_back(command.index);
+}
+
+void AudioMixer::ApplyParameters(uint32_t index, Voice &voice) {
+  const VoiceParameters &parameters = parameters_[index];
+  voice.gain = parameters.gain.load(std::memory_order_relaxed);
+  voice.pan = parameters.pan.load(std::memory_order_relaxed);
+
+  // 元のレートとの比と合わせて、変換できる範囲に収める
+  const double baseRatio =
+      double(voice.sound.wfex.nSamplesPerSec) / sampleRate_;
+  const float pitch = parameters.pitch.load(std::memory_order_relaxed);
+  voice.pitch = float(std::clamp(double(pitch), 1.0 / Resampler::kMaxRatio,
+                                 Resampler::kMaxRatio / baseRatio));
+  if (!voice.isResampling && voice.pitch != 1.0f) {
+    StartResampling(voice);
+  }
+}
+
+void AudioMixer::StartResampling(Voice &voice) {
+  // Resamplerは鳴らす前に作ってあるので、ここではチャンネル数と品質を変えるだけ
+  voice.resampler->Configure(voice.channels, resamplerQuality_);
+  voice.resampler->SetRatio(double(voice.sound.wfex.nSamplesPerSec) /
+                            sampleRate_ * voice.pitch);
+  voice.tailFrames = voice.resampler->GetLatency();
+  voice.isResampling = true;
+}
+
+#pragma endregion
+
+#pragma region ミキシング
+
+void AudioMixer::Render(float *samples, uint32_t frameCount) {
+  ProcessCommands();
+  while (frameCount > 0) {
+    const uint32_t blockFrames = std::min(frameCount, kBlockFrames);
+    RenderBlock(samples, blockFrames);
+    samples += blockFrames * kChannels;
+    frameCount -= blockFrames;
+  }
+}
+
+void AudioMixer::RenderBlock(float *samples, uint32_t frameCount) {
+  for (Bus &bus : buses_) {
+    bus.isUsed = false;
+  }
+  for (std::vector<float> &channel : master_) {
+    std::fill_n(channel.begin(), frameCount, 0.0f);
+  }
+
+  for (size_t i = 0; i < activeVoices_.size();) {
+    const uint32_t index = activeVoices_[i];
+    Voice &voice = voices_[index];
+    ApplyParameters(index, voice);
+
+    float targetGains[kChannels];
+    ComputeTargetGains(voice, targetGains);
+    if (!voice.hasStarted) {
+      std::copy_n(targetGains, kChannels, voice.currentGains);
+      voice.hasStarted = true;
+    }
+
+    const uint32_t fetched = FetchVoice(voice, frameCount);
+
+    Bus &bus = buses_[voice.bus];
+    if (!bus.isUsed) {
+      for (std::vector<float> &channel : bus.samples) {
+        std::fill_n(channel.begin(), frameCount, 0.0f);
+      }
+      bus.isUsed = true;
+    }
+    // モノラルは同じサンプルを左右に振り分ける
+    for (uint32_t channel = 0; channel < kChannels; ++channel) {
+      const float *src = scratch_[voice.channels == 1 ? 0 : channel].data();
+      kernels_->mixRamped(src, bus.samples[channel].data(), frameCount,
+                          voice.currentGains[channel], targetGains[channel]);
+      voice.currentGains[channel] = targetGains[channel];
+    }
+
+    // 変換中のボイスはフィルタに残った分を出し切るまで続ける
+    const bool isEnded =
+        fetched < frameCount ||
+        (!voice.isResampling && !voice.isLooping &&
+         voice.position >= voice.frameCount);
+    if (voice.state == VoiceState::Stopping || isEnded) {
+      // 中身の解放はUpdateで行う。キューはボイスの数だけあるので溢れない
+      voice.state = VoiceState::Finished;
+      finishedVoices_.TryPush(index);
+      activeVoices_[i] = activeVoices_.back();
+      activeVoices_.pop_back();
+      continue;
+    }
+    ++i;
+  }
+
+  for (uint32_t busIndex = 0; busIndex < kMaxBuses; ++busIndex) {
+    Bus &bus = buses_[busIndex];
+    const float gain = busGains_[busIndex].load(std::memory_order_relaxed);
+    if (bus.isUsed) {
+      for (uint32_t channel = 0; channel < kChannels; ++channel) {
+        kernels_->mixRamped(bus.samples[channel].data(),
+                            master_[channel].data(), frameCount,
+                            bus.currentGain, gain);
+      }
+    }
+    bus.currentGain = gain;
+  }
+
+  kernels_->interleaveStereo(master_[0].data(), master_[1].data(), samples,
+                             frameCount,
+                             masterGain_.load(std::memory_order_relaxed));
+}
+
+uint32_t AudioMixer::FetchVoice(Voice &voice, uint32_t frameCount) {
+  float *const outputs[kChannels] = {scratch_[0].data(), scratch_[1].data()};
+  uint32_t written = 0;
+  if (!voice.isResampling) {
+    written = ReadSource(voice, outputs, frameCount);
+  } else {
+    Resampler &resampler = *voice.resampler;
+    const double ratio =
+        double(voice.sound.wfex.nSamplesPerSec) / sampleRate_ * voice.pitch;
+    if (ratio != resampler.GetRatio()) {
+      resampler.SetRatio(ratio);
+    }
+
+    float *const inputs[kChannels] = {sourceScratch_[0].data(),
+                                      sourceScratch_[1].data()};
+    while (true) {
+      float *const pulled[kChannels] = {outputs[0] + written,
+                                        outputs[1] + written};
+      written += resampler.PullOutput(pulled, frameCount - written);
+      if (written == frameCount) {
+        break;
+      }
+
+      const uint32_t needed =
+          std::min({resampler.GetRequiredInputFrames(frameCount - written),
+                    resampler.GetFreeInputFrames(), kBlockFrames});
+      uint32_t read = ReadSource(voice, inputs, needed);
+      if (read < needed) {
+        // 音の最後がフィルタを通り抜けるまで0を足す
+        const uint32_t silence = std::min(needed - read, voice.tailFrames);
+        for (uint32_t channel = 0; channel < voice.channels; ++channel) {
+          std::fill_n(inputs[channel] + read, silence, 0.0f);
+        }
+        voice.tailFrames -= silence;
+        read += silence;
+      }
+      if (read == 0) {
+        break;
+      }
+      const float *const pushed[kChannels] = {inputs[0], inputs[1]};
+      resampler.PushInput(pushed, read);
+    }
+  }
+
+  for (uint32_t channel = 0; channel < voice.channels; ++channel) {
+    std::fill(scratch_[channel].begin() + written,
+              scratch_[channel].begin() + frameCount, 0.0f);
+  }
+  return written;
+}
+
+uint32_t AudioMixer::ReadSource(Voice &voice, float *const *outputs,
+                                uint32_t frameCount) {
+  const uint32_t frameBytes =
+      GetPcmSampleBytes(voice.format) * voice.sourceChannels;
+
+  uint32_t written = 0;
+  while (written < frameCount) {
+    if (voice.position >= voice.frameCount) {
+      if (!voice.isLooping) {
+        break;
+      }
+      voice.position = 0;
+    }
+
+    uint32_t count =
+        std::min(frameCount - written, voice.frameCount - voice.position);
+    const BYTE *src = nullptr;
+    if (voice.sound.adpcm.IsValid()) {
+      src = ReadAdpcmBlock(voice, count);
+    } else {
+      src = voice.sound.pBUffer + size_t(voice.position) * frameBytes;
+    }
+    float *const destinations[kChannels] = {outputs[0] + written,
+                                            outputs[1] + written};
+    if (voice.sourceChannels == 1) {
+      ConvertPcmToFloat(voice.format, src, destinations[0], count, simdLevel_);
+    } else {
+      // いったんfloatのまま並べてから、チャンネルごとに分ける
+      ConvertPcmToFloat(voice.format, src, convertScratch_.data(),
+                        size_t(count) * voice.sourceChannels, simdLevel_);
+      if (voice.sourceChannels == kChannels) {
+        DeinterleaveSamples(convertScratch_.data(), kChannels, destinations,
+                            count, simdLevel_);
+      } else {
+        // 3チャンネル以上はステレオにダウンミックスする
+        float *planes[kMaxPcmChannels];
+        for (uint32_t channel = 0; channel < voice.sourceChannels; ++channel) {
+          planes[channel] = channelScratch_[channel].data();
+        }
+        DeinterleaveSamples(convertScratch_.data(), voice.sourceChannels,
+                            planes, count, simdLevel_);
+        MixChannels(voice.downmix, planes, destinations, count, simdLevel_);
+      }
+    }
+    written += count;
+    voice.position += count;
+  }
+  return written;
+}
+
+const BYTE *AudioMixer::ReadAdpcmBlock(Voice &voice, uint32_t &count) {
+  const AdpcmFormat &adpcm = voice.sound.adpcm;
+  const uint32_t block = voice.position / adpcm.samplesPerBlock;
+  if (block != voice.decodedBlockIndex) {
+    const size_t offset = size_t(block) * adpcm.blockAlign;
+    const uint32_t blockBytes = uint32_t(
+        std::min<size_t>(adpcm.blockAlign, voice.sound.bufferSize - offset));
+    DecodeAdpcmBlock(adpcm, voice.sound.pBUffer + offset, blockBytes,
+                     voice.decodedBlock.data());
+    voice.decodedBlockIndex = block;
+  }
+
+  const uint32_t offset = voice.position % adpcm.samplesPerBlock;
+  count = std::min(count, adpcm.samplesPerBlock - offset);
+  return reinterpret_cast<const BYTE *>(voice.decodedBlock.data() +
+                                        size_t(offset) * voice.sourceChannels);
+}
+
+void AudioMixer::ComputeTargetGains(const Voice &voice,
+                                    float gains[kChannels]) const {
+  if (voice.state == VoiceState::Stopping) {
+    gains[0] = 0.0f;
+    gains[1] = 0.0f;
+    return;
+  }
+
+  if (voice.channels == 1) {
+    // 定パワーパン。中央では左右とも-3dBになる
+    const float angle = (voice.pan + 1.0f) * std::numbers::pi_v<float> / 4.0f;
+    gains[0] = voice.gain * std::cos(angle);
+    gains[1] = voice.gain * std::sin(angle);
+  } else {
+    // ステレオは左右のバランスとして扱う
+    gains[0] = voice.gain * std::min(1.0f, 1.0f - voice.pan);
+    gains[1] = voice.gain * std::min(1.0f, 1.0f + voice.pan);
+  }
+}
+
+#pragma endregion
@@ -0,0 +1,225 @@
+#pragma once
+#include "AudioMixKernels.h"
+#include "PcmConvert.h"
+#include "Resampler.h"
+#include "Sound.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// AudioMixerで再生した音を指すハンドル
+// 音が鳴り終わると無効になる(無効なハンドルを渡しても何も起きない)
+struct AudioVoiceHandle {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+
+  bool IsValid() const { return index != UINT32_MAX; }
+};
+
+// XAudio2を使わずに音を混ぜるソフトウェアミキサー
+// ボイスをバスごとに混ぜ、バスをまとめてステレオのfloatで出力する
+// 出力先(デバイス・WAVファイル・捨てるだけ)はAudioOutputで決める
+//
+// Renderは出力のスレッドから、それ以外は1つのゲーム側のスレッドから呼ぶ
+// 再生と停止はロックフリーのキューで渡し、Renderの先頭でまとめて反映する
+// 音量・パン・ピッチはボイスごとのatomicに書くだけで、キューも通さない
+// どちらも待たないので、出力のスレッドを高い優先度で動かしても詰まらない
+class AudioMixer {
+public:
+  static constexpr uint32_t kChannels = 2;
+  // 一度に混ぜるフレーム数。これより長いRenderは分けて処理する
+  static constexpr uint32_t kBlockFrames = 256;
+  static constexpr uint32_t kMaxBuses = 8;
+  static constexpr uint32_t kDefaultSampleRate = 48000;
+  static constexpr uint32_t kDefaultMaxVoices = 256;
+  // キューに入り切らなかった命令は、次のUpdateか命令で積み直す
+  static constexpr uint32_t kMinCommandCapacity = 256;
+
+  explicit AudioMixer(uint32_t sampleRate = kDefaultSampleRate,
+                      uint32_t maxVoices = kDefaultMaxVoices,
+                      SimdLevel simdLevel = GetSupportedSimdLevel());
+
+  AudioMixer(const AudioMixer &) = delete;
+  AudioMixer &operator=(const AudioMixer &) = delete;
+
+  // 8/16/24/32bit整数か32bit浮動小数、ADPCMの1～8チャンネルの音を鳴らせる
+  // 3チャンネル以上はスピーカー配置に合わせてステレオにダウンミックスする
+  // サンプルレートが違う音はミキサーのレートに変換しながら鳴らす
+  // 鳴らせなければ無効なハンドルを返す
+  // panは-1(左)～1(右)。鳴っている間はsoundDataの中身を参照し続ける
+  // 実際に鳴り始めるのは次のRenderから
+  AudioVoiceHandle Play(const SoundData &soundData, float gain = 1.0f,
+                        float pan = 0.0f, bool isLooping = false,
+                        uint32_t bus = 0);
+  // 1ブロックかけて音量を下げてから止める
+  void Stop(AudioVoiceHandle handle);
+  void StopAll();
+  void SetGain(AudioVoiceHandle handle, float gain);
+  void SetPan(AudioVoiceHandle handle, float pan);
+  // 1で元の高さ、2で1オクターブ上。速さも同じだけ変わる
+  void SetPitch(AudioVoiceHandle handle, float pitch);
+  // 再生位置をframe(元の音のフレーム)に移す。最後より後なら最後にする
+  // 変換中のボイスはフィルタに溜まった分を捨てて、その位置から読み直す
+  void SetPosition(AudioVoiceHandle handle, uint32_t frame);
+  // 鳴り終わったことはUpdateで受け取るので、それまではtrueのまま
+  bool IsPlaying(AudioVoiceHandle handle) const;
+  // 多数のボイスの音量・パン・ピッチをまとめて書き込む(SpatialAudio用)
+  // 鳴り終わったボイスのハンドルは無効にする
+  void SetVoiceParameters(AudioVoiceHandle *handles, const float *gains,
+                          const float *pans, const float *pitches,
+                          size_t count);
+
+  void SetBusGain(uint32_t bus, float gain);
+  void SetMasterGain(float gain);
+  // これから鳴らす音の変換の品質
+  void SetResamplerQuality(ResamplerQuality quality);
+
+  // frameCountフレーム分をLRLR...の順でsamplesに書き込む
+  // 出力側のスレッドから呼ばれる
+  void Render(float *samples, uint32_t frameCount);
+
+  // 鳴り終わったボイスの中身を手放し、入り切らなかった命令を積み直す
+  // ゲーム側で毎フレーム呼ぶ
+  // (オーディオスレッドでファイルのマップを解放しないようにするため)
+  void Update();
+
+  uint32_t GetSampleRate() const { return sampleRate_; }
+  uint32_t GetMaxVoices() const { return uint32_t(voices_.size()); }
+  // ゲーム側から見て鳴っている(Updateでまだ回収していない)ボイスの数
+  uint32_t GetActiveVoiceCount() const;
+  SimdLevel GetSimdLevel() const { return simdLevel_; }
+
+private:
+  enum class VoiceState { Free, Playing, Stopping, Finished };
+
+  enum class CommandType {
+    Play,
+    Stop,
+    StopAll,
+    SetPosition,
+    SetResamplerQuality
+  };
+
+  // ゲーム側からRenderへ渡す命令
+  struct Command {
+    CommandType type = CommandType::Play;
+    uint32_t index = 0;
+    uint32_t generation = 0;
+    bool isLooping = false;
+    uint32_t bus = 0;
+    uint32_t position = 0;
+    ResamplerQuality quality = ResamplerQuality::Medium;
+    // storageは空にしてある(持つのはゲーム側のVoiceSlot)
+    SoundData sound{};
+  };
+
+  // ボイスごとの値。ゲーム側が書き、Renderがブロックごとに読む
+  struct VoiceParameters {
+    std::atomic<float> gain{1.0f};
+    std::atomic<float> pan{0.0f};
+    std::atomic<float> pitch{1.0f};
+  };
+
+  // ゲーム側から見たボイスの状態
+  struct VoiceSlot {
+    uint32_t generation = 0;
+    bool isInUse = false;
+    std::shared_ptr<const void> storage;
+  };
+
+  struct Voice {
+    VoiceState state = VoiceState::Free;
+    uint32_t generation = 0;
+    SoundData sound{};
+    PcmFormat format = PcmFormat::Int16;
+    // 元の音のチャンネル数と、ダウンミックスした後の1～2チャンネル
+    uint32_t sourceChannels = 0;
+    uint32_t channels = 0;
+    ChannelMatrix downmix;
+    // ADPCMを展開したブロックと、その番号
+    std::vector<int16_t> decodedBlock;
+    uint32_t decodedBlockIndex = UINT32_MAX;
+    uint32_t frameCount = 0;
+    uint32_t position = 0;
+    bool isLooping = false;
+    uint32_t bus = 0;
+    float gain = 1.0f;
+    float pan = 0.0f;
+    // 前のブロックの最後に使った左右の音量。ここから目標まで変える
+    float currentGains[kChannels] = {};
+    bool hasStarted = false;
+
+    // 元のレートとの比と合わせて、変換できる範囲に収めたピッチ
+    float pitch = 1.0f;
+    bool isResampling = false;
+    // Playで作り、使い終わっても残しておいて次に鳴らすときに使い回す
+    std::unique_ptr<Resampler> resampler;
+    // 元の音が終わった後に足す0の残り
+    uint32_t tailFrames = 0;
+  };
+
+  struct Bus {
+    float currentGain = 1.0f;
+    bool isUsed = false;
+    std::vector<float> samples[kChannels];
+  };
+
+  const VoiceSlot *FindSlot(AudioVoiceHandle handle) const;
+  // キューがいっぱいなら、順番を保つため後ろの命令もpendingCommands_に回す
+  void PushCommand(Command command);
+  void FlushPendingCommands();
+
+  // ここから下はRenderのスレッドで動く
+  void ProcessCommands();
+  void StartVoice(Command &command);
+  // ゲーム側が書いた音量などをボイスに写す
+  void ApplyParameters(uint32_t index, Voice &voice);
+  void RenderBlock(float *samples, uint32_t frameCount);
+  // ボイスの続きをscratch_に左右別々のfloatで読み出す
+  // 最後まで来たら残りを0で埋め、読めたフレーム数を返す
+  uint32_t FetchVoice(Voice &voice, uint32_t frameCount);
+  // 元の音をfloatの1～2チャンネルにして読む。ループしないなら最後で止まる
+  uint32_t ReadSource(Voice &voice, float *const *outputs,
+                      uint32_t frameCount);
+  // 今の位置を含むブロックを展開して、その位置を指すポインタを返す
+  // countはブロックの終わりまでに減らす
+  const BYTE *ReadAdpcmBlock(Voice &voice, uint32_t &count);
+  void StartResampling(Voice &voice);
+  void ComputeTargetGains(const Voice &voice, float gains[kChannels]) const;
+
+  uint32_t sampleRate_ = 0;
+  SimdLevel simdLevel_ = SimdLevel::Scalar;
+  const MixKernels *kernels_ = nullptr;
+
+  // ゲーム側のスレッドだけが触る
+  std::vector<VoiceSlot> slots_;
+  std::vector<uint32_t> freeVoices_;
+  uint32_t usedVoiceCount_ = 0;
+  std::vector<Command> pendingCommands_;
+
+  // 両方のスレッドから触る
+  SpscQueue<Command> commands_;
+  // 鳴り終わったボイスの番号。Renderが積み、Updateが取り出す
+  SpscQueue<uint32_t> finishedVoices_;
+  std::vector<VoiceParameters> parameters_;
+  std::atomic<float> busGains_[kMaxBuses];
+  std::atomic<float> masterGain_{1.0f};
+
+  // Renderのスレッドだけが触る
+  // (voices_の使っていないボイスのバッファだけは、Playがゲーム側で用意する)
+  ResamplerQuality resamplerQuality_ = ResamplerQuality::Medium;
+  std::vector<Voice> voices_;
+  // 鳴っているボイスの番号。Renderではここだけを見る
+  std::vector<uint32_t> activeVoices_;
+  Bus buses_[kMaxBuses];
+
+  std::vector<float> scratch_[kChannels];
+  // 変換前の元の音
+  std::vector<float> sourceScratch_[kChannels];
+  // floatにしただけの元の音(LRLR...)と、それをチャンネルごとに分けたもの
+  std::vector<float> convertScratch_;
+  std::vector<float> channelScratch_[kMaxPcmChannels];
+  std::vector<float> master_[kChannels];
+};
@@ -0,0 +1,183 @@
+#include "AudioOutput.h"
+#include "RiffReader.h"
+#include <algorithm>
+
+namespace {
+
+void WriteU16(std::FILE *file, uint16_t value) {
+  const uint8_t bytes[2] = {uint8_t(value), uint8_t(value >> 8)};
+  std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+void WriteU32(std::FILE *file, uint32_t value) {
+  const uint8_t bytes[4] = {uint8_t(value), uint8_t(value >> 8),
+                            uint8_t(value >> 16), uint8_t(value >> 24)};
+  std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+} // namespace
+
+#pragma region NullAudioOutput
+
+bool NullAudioOutput::Start(AudioMixer &mixer) {
+  mixer_ = &mixer;
+  samples_.resize(AudioMixer::kBlockFrames * AudioMixer::kChannels);
+  return true;
+}
+
+void NullAudioOutput::Pump(uint32_t frameCount) {
+  if (mixer_ == nullptr) {
+    return;
+  }
+  while (frameCount > 0) {
+    const uint32_t blockFrames = std::min(frameCount, AudioMixer::kBlockFrames);
+    mixer_->Render(samples_.data(), blockFrames);
+    frameCount -= blockFrames;
+  }
+}
+
+#pragma endregion
+
+#pragma region WavFileAudioOutput
+
+bool WavFileAudioOutput::Start(AudioMixer &mixer) {
+  Stop();
+  file_ = std::fopen(path_.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  mixer_ = &mixer;
+  dataSize_ = 0;
+  samples_.resize(AudioMixer::kBlockFrames * AudioMixer::kChannels);
+
+  // サイズは閉じるときに書き直す
+  const uint32_t sampleRate = mixer.GetSampleRate();
+  const uint16_t blockAlign = AudioMixer::kChannels * sizeof(float);
+  std::fwrite("RIFF", 1, 4, file_);
+  WriteU32(file_, 0);
+  std::fwrite("WAVE", 1, 4, file_);
+  std::fwrite("fmt ", 1, 4, file_);
+  WriteU32(file_, 16);
+  WriteU16(file_, kWaveFormatIeeeFloat);
+  WriteU16(file_, AudioMixer::kChannels);
+  WriteU32(file_, sampleRate);
+  WriteU32(file_, sampleRate * blockAlign);
+  WriteU16(file_, blockAlign);
+  WriteU16(file_, 32);
+  std::fwrite("data", 1, 4, file_);
+  WriteU32(file_, 0);
+  return true;
+}
+
+void WavFileAudioOutput::Stop() {
+  if (file_ == nullptr) {
+    return;
+  }
+  std::fseek(file_, 4, SEEK_SET);
+  WriteU32(file_, 36 + dataSize_);
+  std::fseek(file_, 40, SEEK_SET);
+  WriteU32(file_, dataSize_);
+  std::fclose(file_);
+  file_ = nullptr;
+  mixer_ = nullptr;
+}
+
+bool WavFileAudioOutput::Pump(uint32_t frameCount) {
+  if (file_ == nullptr) {
+    return false;
+  }
+  while (frameCount > 0) {
+    const uint32_t blockFrames = std::min(frameCount, AudioMixer::kBlockFrames);
+    mixer_->Render(samples_.data(), blockFrames);
+    const size_t count = size_t(blockFrames) * AudioMixer::kChannels;
+    if (std::fwrite(samples_.data(), sizeof(float), count, file_) != count) {
+      return false;
+    }
+    dataSize_ += uint32_t(count * sizeof(float));
+    frameCount -= blockFrames;
+  }
+  return true;
+}
+
+#pragma endregion
+
+#pragma region XAudio2AudioOutput
+#ifdef _WIN32
+
+bool XAudio2AudioOutput::Start(AudioMixer &mixer) {
+  Stop();
+
+  WAVEFORMATEX format{};
+  format.wFormatTag = kWaveFormatIeeeFloat;
+  format.nChannels = AudioMixer::kChannels;
+  format.nSamplesPerSec = mixer.GetSampleRate();
+  format.wBitsPerSample = 32;
+  format.nBlockAlign = AudioMixer::kChannels * sizeof(float);
+  format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+  // 再生が終わったバッファはOnBufferEndで返ってくる
+  HRESULT result = xAudio2_->CreateSourceVoice(
+      &voice_, &format, 0, XAUDIO2_DEFAULT_FREQ_RATIO, this);
+  if (FAILED(result)) {
+    voice_ = nullptr;
+    return false;
+  }
+
+  mixer_ = &mixer;
+  buffers_.assign(size_t(kBufferCount) * kBufferFrames * AudioMixer::kChannels,
+                  0.0f);
+  nextBuffer_ = 0;
+  // 前に止めたときの残りを捨ててから、すべてのバッファを空きにする
+  while (freeBuffers_.try_acquire()) {
+  }
+  freeBuffers_.release(kBufferCount);
+  isStopping_.store(false, std::memory_order_relaxed);
+  thread_ = std::thread(&XAudio2AudioOutput::ThreadMain, this);
+  voice_->Start();
+  return true;
+}
+
+void XAudio2AudioOutput::Stop() {
+  if (voice_ == nullptr) {
+    return;
+  }
+  voice_->Stop();
+  isStopping_.store(true, std::memory_order_release);
+  freeBuffers_.release();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  voice_->FlushSourceBuffers();
+  // コールバックがすべて終わるまで待ってから戻る
+  voice_->DestroyVoice();
+  voice_ = nullptr;
+  mixer_ = nullptr;
+}
+
+void XAudio2AudioOutput::OnBufferEnd(void *) { freeBuffers_.release(); }
+
+void XAudio2AudioOutput::ThreadMain() {
+  // ミキサーもコールバックもロックを取らないので、優先度を上げても詰まらない
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+  const size_t bufferSamples = size_t(kBufferFrames) * AudioMixer::kChannels;
+  while (true) {
+    freeBuffers_.acquire();
+    if (isStopping_.load(std::memory_order_acquire)) {
+      return;
+    }
+    const uint32_t index = nextBuffer_;
+    nextBuffer_ = (nextBuffer_ + 1) % kBufferCount;
+
+    float *samples = buffers_.data() + index * bufferSamples;
+    mixer_->Render(samples, kBufferFrames);
+
+    XAUDIO2_BUFFER buf{};
+    buf.pAudioData = reinterpret_cast<const BYTE *>(samples);
+    buf.AudioBytes = uint32_t(bufferSamples * sizeof(float));
+    voice_->SubmitSourceBuffer(&buf);
+  }
+}
+
+#endif
+#pragma endregion
@@ -0,0 +1,103 @@
+#pragma once
+#include "AudioMixer.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <vector>
+
+// AudioMixerの出力先
+// デバイスを持つ出力は自分のスレッドからmixer.Renderを呼ぶ
+// デバイスを持たない出力はPumpを呼んだ分だけ進む
+class AudioOutput {
+public:
+  virtual ~AudioOutput() = default;
+
+  virtual bool Start(AudioMixer &mixer) = 0;
+  virtual void Stop() = 0;
+};
+
+// 混ぜた結果を捨てる出力(ベンチマークや音の出ない環境用)
+class NullAudioOutput : public AudioOutput {
+public:
+  bool Start(AudioMixer &mixer) override;
+  void Stop() override { mixer_ = nullptr; }
+
+  // frameCountフレーム分を混ぜて捨てる
+  void Pump(uint32_t frameCount);
+
+  // 最後に混ぜたブロック(LRLR...)。結果を確かめるときに使う
+  const std::vector<float> &GetLastSamples() const { return samples_; }
+
+private:
+  AudioMixer *mixer_ = nullptr;
+  std::vector<float> samples_;
+};
+
+// 混ぜた結果を32bit浮動小数のWAVファイルに書き出す出力
+class WavFileAudioOutput : public AudioOutput {
+public:
+  explicit WavFileAudioOutput(const std::string &path) : path_(path) {}
+  ~WavFileAudioOutput() override { Stop(); }
+
+  bool Start(AudioMixer &mixer) override;
+  // ヘッダーのサイズを書き込んでファイルを閉じる
+  void Stop() override;
+
+  // frameCountフレーム分を混ぜて書き出す
+  bool Pump(uint32_t frameCount);
+
+private:
+  std::string path_;
+  AudioMixer *mixer_ = nullptr;
+  std::FILE *file_ = nullptr;
+  uint32_t dataSize_ = 0;
+  std::vector<float> samples_;
+};
+
+#ifdef _WIN32
+
+// XAudio2のソースボイス1つにミキサーの結果を流し込む出力
+// 再生の終わったバッファから順に、出力スレッドで混ぜ直して渡す
+// 空いたバッファの数はセマフォで数え、XAudio2のコールバックでもロックしない
+class XAudio2AudioOutput : public AudioOutput, public IXAudio2VoiceCallback {
+public:
+  static constexpr uint32_t kBufferCount = 3;
+  // 1バッファのフレーム数(48kHzで10ms)
+  static constexpr uint32_t kBufferFrames = 480;
+
+  explicit XAudio2AudioOutput(IXAudio2 *xAudio2) : xAudio2_(xAudio2) {}
+  ~XAudio2AudioOutput() override { Stop(); }
+
+  bool Start(AudioMixer &mixer) override;
+  void Stop() override;
+
+  // IXAudio2VoiceCallback
+  void STDMETHODCALLTYPE OnBufferEnd(void *) override;
+  void STDMETHODCALLTYPE OnVoiceProcessingPassStart(UINT32) override {}
+  void STDMETHODCALLTYPE OnVoiceProcessingPassEnd() override {}
+  void STDMETHODCALLTYPE OnStreamEnd() override {}
+  void STDMETHODCALLTYPE OnBufferStart(void *) override {}
+  void STDMETHODCALLTYPE OnLoopEnd(void *) override {}
+  void STDMETHODCALLTYPE OnVoiceError(void *, HRESULT) override {}
+
+private:
+  void ThreadMain();
+
+  IXAudio2 *xAudio2_ = nullptr;
+  IXAudio2SourceVoice *voice_ = nullptr;
+  AudioMixer *mixer_ = nullptr;
+
+  std::vector<float> buffers_;
+  // 出力スレッドだけが触る
+  uint32_t nextBuffer_ = 0;
+  // 空いたバッファの数。止めるときは1つ余分に増やしてスレッドを起こす
+  std::counting_semaphore<> freeBuffers_{0};
+  std::atomic<bool> isStopping_{false};
+
+  std::thread thread_;
+};
+
+#endif
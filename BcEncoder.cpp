@@ -0,0 +1,864 @@
+#include "BcEncoder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#define BC_ENCODER_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC/Clangは関数ごとにAVXを許可する。MSVCは指定しなくても使える
+#if defined(BC_ENCODER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BC_ENCODER_TARGET_AVX __attribute__((target("avx")))
+#else
+#define BC_ENCODER_TARGET_AVX
+#endif
+
+namespace {
+
+// 並列にするときの1つの仕事のブロックの行数
+constexpr uint32_t kBlockRowsPerBand = 16;
+constexpr uint32_t kBlockPixels = 16;
+// 主成分を求める反復の回数
+constexpr uint32_t kPowerIterations = 8;
+
+// BC1の2bitのインデックスが表す位置(color0からcolor1への割合)
+constexpr float kBc1Weights4[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+constexpr float kBc1Weights3[3] = {0.0f, 1.0f, 0.5f};
+// BC7の4bitのインデックスの補間の重み(64分率)
+constexpr uint32_t kBc7Weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                      34, 38, 43, 47, 51, 55, 60, 64};
+
+// 1ブロックのピクセルをチャンネルごとに並べたもの。SIMDで4/8ピクセルずつ読む
+// 値は0~255の整数なので、誤差の二乗和もfloatで丸めずに表せる
+struct BlockPixels {
+  alignas(32) float channels[4][kBlockPixels];
+};
+
+// ブロックの中で使える色。使わないチャンネルの値は見ない
+struct Palette {
+  float colors[16][4];
+  uint32_t count = 0;
+};
+
+// 2つの端点。値は0~255
+struct Endpoints {
+  float values[2][4];
+};
+
+uint32_t GetIterationCount(BcQuality quality) {
+  switch (quality) {
+  case BcQuality::Fast:
+    return 0;
+  case BcQuality::Normal:
+    return 1;
+  default:
+    return 3;
+  }
+}
+
+#pragma region 一番近い色を選ぶ
+
+#pragma region スカラー
+
+// ピクセルごとに、[ChannelBegin, ChannelEnd)のチャンネルで一番近いパレットの色を選ぶ
+// 同じ距離なら番号の小さい方を選ぶ。errorsには選んだ色との距離の二乗を入れる
+// チャンネルの範囲はテンプレートにして、ループを展開させる
+template <uint32_t ChannelBegin, uint32_t ChannelEnd>
+void SelectIndicesScalar(const BlockPixels &pixels, const Palette &palette,
+                         uint8_t *indices, float *errors) {
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    float best = std::numeric_limits<float>::max();
+    uint32_t bestIndex = 0;
+    for (uint32_t entry = 0; entry < palette.count; ++entry) {
+      float distance = 0.0f;
+      for (uint32_t c = ChannelBegin; c < ChannelEnd; ++c) {
+        const float difference =
+            pixels.channels[c][i] - palette.colors[entry][c];
+        distance += difference * difference;
+      }
+      if (distance < best) {
+        best = distance;
+        bestIndex = entry;
+      }
+    }
+    indices[i] = uint8_t(bestIndex);
+    errors[i] = best;
+  }
+}
+
+#pragma endregion
+
+#ifdef BC_ENCODER_X86
+#pragma region SSE
+
+// 4ピクセルずつ、すべてのパレットの色との距離を同時に求める
+template <uint32_t ChannelBegin, uint32_t ChannelEnd>
+void SelectIndicesSse(const BlockPixels &pixels, const Palette &palette,
+                      uint8_t *indices, float *errors) {
+  for (uint32_t i = 0; i < kBlockPixels; i += 4) {
+    __m128 values[4];
+    for (uint32_t c = ChannelBegin; c < ChannelEnd; ++c) {
+      values[c] = _mm_load_ps(pixels.channels[c] + i);
+    }
+    __m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128 bestIndex = _mm_setzero_ps();
+    for (uint32_t entry = 0; entry < palette.count; ++entry) {
+      __m128 distance = _mm_setzero_ps();
+      for (uint32_t c = ChannelBegin; c < ChannelEnd; ++c) {
+        const __m128 difference =
+            _mm_sub_ps(values[c], _mm_set1_ps(palette.colors[entry][c]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+      }
+      const __m128 isCloser = _mm_cmplt_ps(distance, best);
+      best = _mm_min_ps(distance, best);
+      bestIndex = _mm_or_ps(_mm_and_ps(isCloser, _mm_set1_ps(float(entry))),
+                            _mm_andnot_ps(isCloser, bestIndex));
+    }
+    _mm_storeu_ps(errors + i, best);
+    alignas(16) int32_t selected[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(selected),
+                    _mm_cvttps_epi32(bestIndex));
+    for (uint32_t j = 0; j < 4; ++j) {
+      indices[i + j] = uint8_t(selected[j]);
+    }
+  }
+}
+
+#pragma endregion
+
+#pragma region AVX
+
+// 16ピクセルを2本のレジスタに分け、パレットの色1つにつき両方をまとめて比べる
+// (2本の計算は依存しないので並べて実行できる)
+template <uint32_t ChannelBegin, uint32_t ChannelEnd>
+BC_ENCODER_TARGET_AVX void SelectIndicesAvx(const BlockPixels &pixels,
+                                            const Palette &palette,
+                                            uint8_t *indices, float *errors) {
+  __m256 values0[4];
+  __m256 values1[4];
+  for (uint32_t c = ChannelBegin; c < ChannelEnd; ++c) {
+    values0[c] = _mm256_load_ps(pixels.channels[c]);
+    values1[c] = _mm256_load_ps(pixels.channels[c] + 8);
+  }
+  __m256 best0 = _mm256_set1_ps(std::numeric_limits<float>::max());
+  __m256 best1 = best0;
+  __m256 bestIndex0 = _mm256_setzero_ps();
+  __m256 bestIndex1 = _mm256_setzero_ps();
+  for (uint32_t entry = 0; entry < palette.count; ++entry) {
+    __m256 distance0 = _mm256_setzero_ps();
+    __m256 distance1 = _mm256_setzero_ps();
+    for (uint32_t c = ChannelBegin; c < ChannelEnd; ++c) {
+      const __m256 color = _mm256_set1_ps(palette.colors[entry][c]);
+      const __m256 difference0 = _mm256_sub_ps(values0[c], color);
+      const __m256 difference1 = _mm256_sub_ps(values1[c], color);
+      distance0 =
+          _mm256_add_ps(distance0, _mm256_mul_ps(difference0, difference0));
+      distance1 =
+          _mm256_add_ps(distance1, _mm256_mul_ps(difference1, difference1));
+    }
+    const __m256 entryValue = _mm256_set1_ps(float(entry));
+    const __m256 isCloser0 = _mm256_cmp_ps(distance0, best0, _CMP_LT_OQ);
+    const __m256 isCloser1 = _mm256_cmp_ps(distance1, best1, _CMP_LT_OQ);
+    best0 = _mm256_min_ps(distance0, best0);
+    best1 = _mm256_min_ps(distance1, best1);
+    bestIndex0 = _mm256_or_ps(_mm256_and_ps(isCloser0, entryValue),
+                              _mm256_andnot_ps(isCloser0, bestIndex0));
+    bestIndex1 = _mm256_or_ps(_mm256_and_ps(isCloser1, entryValue),
+                              _mm256_andnot_ps(isCloser1, bestIndex1));
+  }
+  _mm256_storeu_ps(errors, best0);
+  _mm256_storeu_ps(errors + 8, best1);
+  alignas(32) int32_t selected[16];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(selected),
+                     _mm256_cvttps_epi32(bestIndex0));
+  _mm256_store_si256(reinterpret_cast<__m256i *>(selected + 8),
+                     _mm256_cvttps_epi32(bestIndex1));
+  for (uint32_t j = 0; j < kBlockPixels; ++j) {
+    indices[j] = uint8_t(selected[j]);
+  }
+  _mm256_zeroupper();
+}
+
+#pragma endregion
+#endif
+
+template <uint32_t ChannelBegin, uint32_t ChannelEnd>
+void SelectIndices(const BlockPixels &pixels, const Palette &palette,
+                   SimdLevel level, uint8_t *indices, float *errors) {
+#ifdef BC_ENCODER_X86
+  if (level == SimdLevel::Avx) {
+    SelectIndicesAvx<ChannelBegin, ChannelEnd>(pixels, palette, indices,
+                                               errors);
+    return;
+  }
+  if (level == SimdLevel::Sse) {
+    SelectIndicesSse<ChannelBegin, ChannelEnd>(pixels, palette, indices,
+                                               errors);
+    return;
+  }
+#endif
+  SelectIndicesScalar<ChannelBegin, ChannelEnd>(pixels, palette, indices,
+                                                errors);
+}
+
+// maskのビットが立っているピクセルの誤差の合計
+// 値はどれも整数なので、足す順番によらず同じになる
+float SumErrors(const float *errors, uint32_t mask) {
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (mask & (1u << i)) {
+      sum += errors[i];
+    }
+  }
+  return sum;
+}
+
+#pragma endregion
+
+#pragma region 端点を決める
+
+// 各チャンネルの最小と最大を端点にする
+// 一番広いチャンネルと逆向きに動くチャンネルは、端点を入れ替えて対角の向きを合わせる
+// insetがtrueなら、量子化で外に広がる分を見込んで範囲を1/16だけ内側に寄せる
+void ComputeBoundingBox(const BlockPixels &pixels, uint32_t mask,
+                        uint32_t channelCount, bool isInset,
+                        Endpoints &endpoints) {
+  float minimum[4];
+  float maximum[4];
+  float mean[4];
+  uint32_t count = 0;
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    minimum[c] = 255.0f;
+    maximum[c] = 0.0f;
+    mean[c] = 0.0f;
+  }
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+    for (uint32_t c = 0; c < channelCount; ++c) {
+      const float value = pixels.channels[c][i];
+      minimum[c] = std::min(minimum[c], value);
+      maximum[c] = std::max(maximum[c], value);
+      mean[c] += value;
+    }
+    ++count;
+  }
+
+  uint32_t widest = 0;
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    mean[c] /= float(count);
+    if (maximum[c] - minimum[c] > maximum[widest] - minimum[widest]) {
+      widest = c;
+    }
+  }
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    float covariance = 0.0f;
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      if (mask & (1u << i)) {
+        covariance += (pixels.channels[c][i] - mean[c]) *
+                      (pixels.channels[widest][i] - mean[widest]);
+      }
+    }
+    const float inset = isInset ? (maximum[c] - minimum[c]) / 16.0f : 0.0f;
+    const float low = minimum[c] + inset;
+    const float high = maximum[c] - inset;
+    endpoints.values[0][c] = covariance < 0.0f ? high : low;
+    endpoints.values[1][c] = covariance < 0.0f ? low : high;
+  }
+}
+
+// 色の広がりが一番大きい向き(主成分)に沿って、両端のピクセルの位置を端点にする
+void ComputePrincipalEndpoints(const BlockPixels &pixels, uint32_t mask,
+                               uint32_t channelCount, Endpoints &endpoints) {
+  float mean[4] = {};
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (mask & (1u << i)) {
+      for (uint32_t c = 0; c < channelCount; ++c) {
+        mean[c] += pixels.channels[c][i];
+      }
+      ++count;
+    }
+  }
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    mean[c] /= float(count);
+  }
+
+  float covariance[4][4] = {};
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+    for (uint32_t a = 0; a < channelCount; ++a) {
+      for (uint32_t b = a; b < channelCount; ++b) {
+        covariance[a][b] += (pixels.channels[a][i] - mean[a]) *
+                            (pixels.channels[b][i] - mean[b]);
+      }
+    }
+  }
+  uint32_t largest = 0;
+  for (uint32_t a = 0; a < channelCount; ++a) {
+    for (uint32_t b = 0; b < a; ++b) {
+      covariance[a][b] = covariance[b][a];
+    }
+    if (covariance[a][a] > covariance[largest][largest]) {
+      largest = a;
+    }
+  }
+
+  // 分散が一番大きいチャンネルの行から反復して、一番大きい固有ベクトルに近づける
+  float axis[4] = {};
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    axis[c] = covariance[largest][c];
+  }
+  for (uint32_t iteration = 0; iteration < kPowerIterations; ++iteration) {
+    float next[4] = {};
+    float length = 0.0f;
+    for (uint32_t a = 0; a < channelCount; ++a) {
+      for (uint32_t b = 0; b < channelCount; ++b) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      length = std::max(length, std::abs(next[a]));
+    }
+    if (length == 0.0f) {
+      break;
+    }
+    for (uint32_t c = 0; c < channelCount; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  float axisLength = 0.0f;
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    axisLength += axis[c] * axis[c];
+  }
+  // 全部同じ色
+  if (axisLength == 0.0f) {
+    for (uint32_t c = 0; c < channelCount; ++c) {
+      endpoints.values[0][c] = mean[c];
+      endpoints.values[1][c] = mean[c];
+    }
+    return;
+  }
+
+  float low = std::numeric_limits<float>::max();
+  float high = -std::numeric_limits<float>::max();
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+    float t = 0.0f;
+    for (uint32_t c = 0; c < channelCount; ++c) {
+      t += (pixels.channels[c][i] - mean[c]) * axis[c];
+    }
+    low = std::min(low, t);
+    high = std::max(high, t);
+  }
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    endpoints.values[0][c] =
+        std::clamp(mean[c] + low / axisLength * axis[c], 0.0f, 255.0f);
+    endpoints.values[1][c] =
+        std::clamp(mean[c] + high / axisLength * axis[c], 0.0f, 255.0f);
+  }
+}
+
+// 選んだインデックスの位置(weights、0~1)を固定して、
+// 誤差の二乗和が一番小さくなる端点を解き直す。全部同じ位置なら解けないのでfalse
+bool RefineEndpoints(const BlockPixels &pixels, uint32_t mask,
+                     uint32_t channelCount, const float *weights,
+                     Endpoints &endpoints) {
+  float a00 = 0.0f;
+  float a01 = 0.0f;
+  float a11 = 0.0f;
+  float b0[4] = {};
+  float b1[4] = {};
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+    const float w1 = weights[i];
+    const float w0 = 1.0f - w1;
+    a00 += w0 * w0;
+    a01 += w0 * w1;
+    a11 += w1 * w1;
+    for (uint32_t c = 0; c < channelCount; ++c) {
+      b0[c] += w0 * pixels.channels[c][i];
+      b1[c] += w1 * pixels.channels[c][i];
+    }
+  }
+  const float determinant = a00 * a11 - a01 * a01;
+  if (std::abs(determinant) < 1e-6f) {
+    return false;
+  }
+  for (uint32_t c = 0; c < channelCount; ++c) {
+    endpoints.values[0][c] = std::clamp(
+        (a11 * b0[c] - a01 * b1[c]) / determinant, 0.0f, 255.0f);
+    endpoints.values[1][c] = std::clamp(
+        (a00 * b1[c] - a01 * b0[c]) / determinant, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+#pragma endregion
+
+#pragma region BC1
+
+uint16_t ToRgb565(const float *color) {
+  const uint32_t r = uint32_t(color[0] * (31.0f / 255.0f) + 0.5f);
+  const uint32_t g = uint32_t(color[1] * (63.0f / 255.0f) + 0.5f);
+  const uint32_t b = uint32_t(color[2] * (31.0f / 255.0f) + 0.5f);
+  return uint16_t((r << 11) | (g << 5) | b);
+}
+
+void FromRgb565(uint16_t packed, uint32_t *color) {
+  const uint32_t r = (packed >> 11) & 31;
+  const uint32_t g = (packed >> 5) & 63;
+  const uint32_t b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+void WriteBc1Block(uint16_t color0, uint16_t color1, uint32_t indices,
+                   uint8_t *block) {
+  block[0] = uint8_t(color0);
+  block[1] = uint8_t(color0 >> 8);
+  block[2] = uint8_t(color1);
+  block[3] = uint8_t(color1 >> 8);
+  for (uint32_t i = 0; i < 4; ++i) {
+    block[4 + i] = uint8_t(indices >> (i * 8));
+  }
+}
+
+// BC1の色の8バイトを作る
+// isTransparentAllowedなら、アルファが128未満のピクセルを透明(3色のモードの3番)にする
+// BC3の色は常に4色として読まれるのでfalseにする
+void EncodeBc1Color(const BlockPixels &pixels, BcQuality quality,
+                    SimdLevel level, bool isTransparentAllowed,
+                    uint8_t *block) {
+  uint32_t opaqueMask = 0xFFFF;
+  if (isTransparentAllowed) {
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      if (pixels.channels[3][i] < 128.0f) {
+        opaqueMask &= ~(1u << i);
+      }
+    }
+  }
+  if (opaqueMask == 0) {
+    WriteBc1Block(0, 0, 0xFFFFFFFF, block);
+    return;
+  }
+  const bool hasTransparent = opaqueMask != 0xFFFF;
+
+  Endpoints endpoints;
+  if (quality == BcQuality::Fast) {
+    ComputeBoundingBox(pixels, opaqueMask, 3, true, endpoints);
+  } else {
+    ComputePrincipalEndpoints(pixels, opaqueMask, 3, endpoints);
+  }
+
+  const uint32_t iterationCount = GetIterationCount(quality);
+  float bestError = std::numeric_limits<float>::max();
+  uint16_t bestColors[2] = {};
+  uint32_t bestIndices = 0;
+  for (uint32_t iteration = 0; iteration <= iterationCount; ++iteration) {
+    uint16_t color0 = ToRgb565(endpoints.values[0]);
+    uint16_t color1 = ToRgb565(endpoints.values[1]);
+    // 4色はcolor0 > color1、3色はcolor0 <= color1で表す
+    if (hasTransparent ? color0 > color1 : color0 < color1) {
+      std::swap(color0, color1);
+    }
+    // 4色にしたくても両端が同じなら3色として読まれる(0番だけを使うので困らない)
+    const bool isThreeColor = color0 <= color1;
+
+    uint32_t colors[2][3];
+    FromRgb565(color0, colors[0]);
+    FromRgb565(color1, colors[1]);
+    Palette palette;
+    palette.count = isThreeColor ? 3 : 4;
+    for (uint32_t c = 0; c < 3; ++c) {
+      palette.colors[0][c] = float(colors[0][c]);
+      palette.colors[1][c] = float(colors[1][c]);
+      if (isThreeColor) {
+        palette.colors[2][c] = float((colors[0][c] + colors[1][c] + 1) / 2);
+      } else {
+        palette.colors[2][c] =
+            float((colors[0][c] * 2 + colors[1][c] + 1) / 3);
+        palette.colors[3][c] =
+            float((colors[0][c] + colors[1][c] * 2 + 1) / 3);
+      }
+    }
+
+    uint8_t indices[kBlockPixels];
+    alignas(32) float errors[kBlockPixels];
+    SelectIndices<0, 3>(pixels, palette, level, indices, errors);
+    const float error = SumErrors(errors, opaqueMask);
+    if (error < bestError) {
+      bestError = error;
+      bestColors[0] = color0;
+      bestColors[1] = color1;
+      bestIndices = 0;
+      for (uint32_t i = 0; i < kBlockPixels; ++i) {
+        const uint32_t index = (opaqueMask & (1u << i)) ? indices[i] : 3;
+        bestIndices |= index << (i * 2);
+      }
+    }
+    if (iteration == iterationCount || error == 0.0f) {
+      break;
+    }
+
+    float weights[kBlockPixels];
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      weights[i] = isThreeColor
+                       ? kBc1Weights3[std::min<uint32_t>(indices[i], 2)]
+                       : kBc1Weights4[indices[i]];
+    }
+    if (!RefineEndpoints(pixels, opaqueMask, 3, weights, endpoints)) {
+      break;
+    }
+  }
+  WriteBc1Block(bestColors[0], bestColors[1], bestIndices, block);
+}
+
+#pragma endregion
+
+#pragma region BC4(BC3のアルファ)
+
+// alpha0 > alpha1なら両端の間を7等分した8段階、
+// そうでなければ5等分した6段階と0、255になる
+void BuildBc4Palette(uint32_t alpha0, uint32_t alpha1, Palette &palette) {
+  palette.count = 8;
+  palette.colors[0][3] = float(alpha0);
+  palette.colors[1][3] = float(alpha1);
+  if (alpha0 > alpha1) {
+    for (uint32_t k = 2; k < 8; ++k) {
+      palette.colors[k][3] =
+          float(((8 - k) * alpha0 + (k - 1) * alpha1 + 3) / 7);
+    }
+  } else {
+    for (uint32_t k = 2; k < 6; ++k) {
+      palette.colors[k][3] =
+          float(((6 - k) * alpha0 + (k - 1) * alpha1 + 2) / 5);
+    }
+    palette.colors[6][3] = 0.0f;
+    palette.colors[7][3] = 255.0f;
+  }
+}
+
+// アルファの8バイトを作る
+// Fast以外は、0と255を除いた範囲を6段階にする並べ方も試す(切り抜きの縁向き)
+void EncodeBc4Alpha(const BlockPixels &pixels, BcQuality quality,
+                    SimdLevel level, uint8_t *block) {
+  uint32_t minimum = 255;
+  uint32_t maximum = 0;
+  uint32_t innerMinimum = 255;
+  uint32_t innerMaximum = 0;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    const uint32_t alpha = uint32_t(pixels.channels[3][i]);
+    minimum = std::min(minimum, alpha);
+    maximum = std::max(maximum, alpha);
+    if (alpha != 0 && alpha != 255) {
+      innerMinimum = std::min(innerMinimum, alpha);
+      innerMaximum = std::max(innerMaximum, alpha);
+    }
+  }
+
+  uint32_t candidates[2][2] = {{maximum, minimum}, {0, 0}};
+  uint32_t candidateCount = 1;
+  if (quality != BcQuality::Fast && innerMinimum <= innerMaximum &&
+      (minimum == 0 || maximum == 255)) {
+    candidates[1][0] = innerMinimum;
+    candidates[1][1] = innerMaximum;
+    candidateCount = 2;
+  }
+
+  float bestError = std::numeric_limits<float>::max();
+  uint64_t bestBits = 0;
+  for (uint32_t candidate = 0; candidate < candidateCount; ++candidate) {
+    const uint32_t alpha0 = candidates[candidate][0];
+    const uint32_t alpha1 = candidates[candidate][1];
+    Palette palette;
+    BuildBc4Palette(alpha0, alpha1, palette);
+    uint8_t indices[kBlockPixels];
+    alignas(32) float errors[kBlockPixels];
+    SelectIndices<3, 4>(pixels, palette, level, indices, errors);
+    const float error = SumErrors(errors, 0xFFFF);
+    if (error < bestError) {
+      bestError = error;
+      bestBits = uint64_t(alpha0) | (uint64_t(alpha1) << 8);
+      for (uint32_t i = 0; i < kBlockPixels; ++i) {
+        bestBits |= uint64_t(indices[i]) << (16 + i * 3);
+      }
+    }
+  }
+  for (uint32_t i = 0; i < 8; ++i) {
+    block[i] = uint8_t(bestBits >> (i * 8));
+  }
+}
+
+#pragma endregion
+
+#pragma region BC7
+
+// 128bitのブロックに下位ビットから詰める
+class BitWriter {
+public:
+  explicit BitWriter(uint8_t *block) : block_(block) {
+    std::memset(block_, 0, 16);
+  }
+
+  void Write(uint32_t value, uint32_t bitCount) {
+    for (uint32_t i = 0; i < bitCount; ++i, ++position_) {
+      if (value & (1u << i)) {
+        block_[position_ / 8] |= uint8_t(1u << (position_ % 8));
+      }
+    }
+  }
+
+private:
+  uint8_t *block_;
+  uint32_t position_ = 0;
+};
+
+// 端点を7bitとpビット(8bit目)にする。restoredには8bitに戻した値を入れる
+void QuantizeBc7Endpoint(const float *value, uint32_t pBit, uint8_t *codes,
+                         uint32_t *restored) {
+  for (uint32_t c = 0; c < 4; ++c) {
+    const int32_t code = int32_t(std::floor((value[c] - float(pBit)) * 0.5f +
+                                            0.5f));
+    codes[c] = uint8_t(std::clamp(code, 0, 127));
+    restored[c] = uint32_t(codes[c]) * 2 + pBit;
+  }
+}
+
+// 量子化したときの誤差が小さい方のpビット
+uint32_t SelectBc7PBit(const float *value) {
+  float errors[2] = {};
+  for (uint32_t pBit = 0; pBit < 2; ++pBit) {
+    uint8_t codes[4];
+    uint32_t restored[4];
+    QuantizeBc7Endpoint(value, pBit, codes, restored);
+    for (uint32_t c = 0; c < 4; ++c) {
+      const float difference = float(restored[c]) - value[c];
+      errors[pBit] += difference * difference;
+    }
+  }
+  return errors[1] < errors[0] ? 1 : 0;
+}
+
+struct Bc7Mode6 {
+  uint8_t codes[2][4];
+  uint32_t pBits[2];
+  uint8_t indices[kBlockPixels];
+};
+
+void WriteBc7Mode6(Bc7Mode6 mode, uint8_t *block) {
+  // 0番のピクセルのインデックスは最上位ビットを0として省くので、
+  // 8以上なら端点を入れ替えてインデックスを反転する
+  if (mode.indices[0] >= 8) {
+    for (uint32_t c = 0; c < 4; ++c) {
+      std::swap(mode.codes[0][c], mode.codes[1][c]);
+    }
+    std::swap(mode.pBits[0], mode.pBits[1]);
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      mode.indices[i] = uint8_t(15 - mode.indices[i]);
+    }
+  }
+  BitWriter writer(block);
+  writer.Write(1u << 6, 7);
+  for (uint32_t c = 0; c < 4; ++c) {
+    writer.Write(mode.codes[0][c], 7);
+    writer.Write(mode.codes[1][c], 7);
+  }
+  writer.Write(mode.pBits[0], 1);
+  writer.Write(mode.pBits[1], 1);
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    writer.Write(mode.indices[i], i == 0 ? 3 : 4);
+  }
+}
+
+void EncodeBc7Block(const BlockPixels &pixels, BcQuality quality,
+                    SimdLevel level, uint8_t *block) {
+  Endpoints endpoints;
+  if (quality == BcQuality::Fast) {
+    ComputeBoundingBox(pixels, 0xFFFF, 4, true, endpoints);
+  } else {
+    ComputePrincipalEndpoints(pixels, 0xFFFF, 4, endpoints);
+  }
+
+  const uint32_t iterationCount = GetIterationCount(quality);
+  float bestError = std::numeric_limits<float>::max();
+  Bc7Mode6 best{};
+  for (uint32_t iteration = 0; iteration <= iterationCount; ++iteration) {
+    // Highは4通りのpビットをすべて試す。それ以外は端点ごとに近い方を選ぶ
+    uint32_t pBitCandidates[4][2];
+    uint32_t pBitCandidateCount = 0;
+    if (quality == BcQuality::High) {
+      for (uint32_t i = 0; i < 4; ++i) {
+        pBitCandidates[i][0] = i & 1;
+        pBitCandidates[i][1] = i >> 1;
+      }
+      pBitCandidateCount = 4;
+    } else {
+      pBitCandidates[0][0] = SelectBc7PBit(endpoints.values[0]);
+      pBitCandidates[0][1] = SelectBc7PBit(endpoints.values[1]);
+      pBitCandidateCount = 1;
+    }
+
+    float iterationError = std::numeric_limits<float>::max();
+    uint8_t iterationIndices[kBlockPixels] = {};
+    for (uint32_t candidate = 0; candidate < pBitCandidateCount; ++candidate) {
+      Bc7Mode6 mode;
+      uint32_t restored[2][4];
+      for (uint32_t e = 0; e < 2; ++e) {
+        mode.pBits[e] = pBitCandidates[candidate][e];
+        QuantizeBc7Endpoint(endpoints.values[e], mode.pBits[e], mode.codes[e],
+                            restored[e]);
+      }
+      Palette palette;
+      palette.count = 16;
+      for (uint32_t k = 0; k < 16; ++k) {
+        const uint32_t weight = kBc7Weights[k];
+        for (uint32_t c = 0; c < 4; ++c) {
+          palette.colors[k][c] = float(
+              ((64 - weight) * restored[0][c] + weight * restored[1][c] + 32) >>
+              6);
+        }
+      }
+      alignas(32) float errors[kBlockPixels];
+      SelectIndices<0, 4>(pixels, palette, level, mode.indices, errors);
+      const float error = SumErrors(errors, 0xFFFF);
+      if (error < iterationError) {
+        iterationError = error;
+        std::memcpy(iterationIndices, mode.indices, sizeof(iterationIndices));
+      }
+      if (error < bestError) {
+        bestError = error;
+        best = mode;
+      }
+    }
+    if (iteration == iterationCount || bestError == 0.0f) {
+      break;
+    }
+
+    float weights[kBlockPixels];
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      weights[i] = float(kBc7Weights[iterationIndices[i]]) / 64.0f;
+    }
+    if (!RefineEndpoints(pixels, 0xFFFF, 4, weights, endpoints)) {
+      break;
+    }
+  }
+  WriteBc7Mode6(best, block);
+}
+
+#pragma endregion
+
+void LoadBlockPixels(const uint8_t *rgba, BlockPixels &pixels) {
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    for (uint32_t c = 0; c < 4; ++c) {
+      pixels.channels[c][i] = float(rgba[i * 4 + c]);
+    }
+  }
+}
+
+// [blockRowBegin, blockRowEnd)のブロックの行を圧縮する
+void EncodeBlockRows(const Rgba8Image &image, const BcEncodeSettings &settings,
+                     uint8_t *blocks, size_t blockRowPitch,
+                     uint32_t blockRowBegin, uint32_t blockRowEnd) {
+  const uint32_t blockColumns = (image.width + 3) / 4;
+  const size_t blockSize = GetBcBlockSize(settings.format);
+  uint8_t rgba[kBlockPixels * 4];
+  for (uint32_t blockY = blockRowBegin; blockY < blockRowEnd; ++blockY) {
+    uint8_t *blockRow = blocks + size_t(blockY) * blockRowPitch;
+    for (uint32_t blockX = 0; blockX < blockColumns; ++blockX) {
+      for (uint32_t y = 0; y < 4; ++y) {
+        const uint32_t sourceY = std::min(blockY * 4 + y, image.height - 1);
+        const uint8_t *sourceRow =
+            image.pixels + size_t(sourceY) * image.rowPitch;
+        if (blockX * 4 + 4 <= image.width) {
+          std::memcpy(rgba + y * 16, sourceRow + size_t(blockX) * 16, 16);
+          continue;
+        }
+        for (uint32_t x = 0; x < 4; ++x) {
+          const uint32_t sourceX = std::min(blockX * 4 + x, image.width - 1);
+          std::memcpy(rgba + (y * 4 + x) * 4, sourceRow + size_t(sourceX) * 4,
+                      4);
+        }
+      }
+      EncodeBcBlock(rgba, settings, blockRow + blockX * blockSize);
+    }
+  }
+}
+
+} // namespace
+
+const char *GetBcQualityName(BcQuality quality) {
+  switch (quality) {
+  case BcQuality::Fast:
+    return "fast";
+  case BcQuality::Normal:
+    return "normal";
+  default:
+    return "high";
+  }
+}
+
+bool ParseBcQuality(const std::string &name, BcQuality &quality) {
+  for (BcQuality candidate :
+       {BcQuality::Fast, BcQuality::Normal, BcQuality::High}) {
+    if (name == GetBcQualityName(candidate)) {
+      quality = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t GetBcBlockSize(BcFormat format) {
+  return format == BcFormat::Bc1 ? 8 : 16;
+}
+
+void EncodeBcBlock(const uint8_t *pixels, const BcEncodeSettings &settings,
+                   uint8_t *block) {
+  const SimdLevel level = std::min(settings.simd, GetSupportedSimdLevel());
+  BlockPixels blockPixels;
+  LoadBlockPixels(pixels, blockPixels);
+  switch (settings.format) {
+  case BcFormat::Bc1:
+    EncodeBc1Color(blockPixels, settings.quality, level, true, block);
+    break;
+  case BcFormat::Bc3:
+    EncodeBc4Alpha(blockPixels, settings.quality, level, block);
+    EncodeBc1Color(blockPixels, settings.quality, level, false, block + 8);
+    break;
+  case BcFormat::Bc7:
+    EncodeBc7Block(blockPixels, settings.quality, level, block);
+    break;
+  }
+}
+
+void EncodeBcImage(const Rgba8Image &image, const BcEncodeSettings &settings,
+                   uint8_t *blocks, size_t blockRowPitch, ThreadPool *pool) {
+  if (image.width == 0 || image.height == 0) {
+    return;
+  }
+  const uint32_t blockRows = (image.height + 3) / 4;
+  const uint32_t bandCount =
+      (blockRows + kBlockRowsPerBand - 1) / kBlockRowsPerBand;
+  if (pool == nullptr || bandCount <= 1) {
+    EncodeBlockRows(image, settings, blocks, blockRowPitch, 0, blockRows);
+    return;
+  }
+  pool->ParallelFor(bandCount, [&](uint32_t band) {
+    EncodeBlockRows(image, settings, blocks, blockRowPitch,
+                    band * kBlockRowsPerBand,
+                    std::min((band + 1) * kBlockRowsPerBand, blockRows));
+  });
+}
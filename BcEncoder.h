@@ -0,0 +1,57 @@
+#pragma once
+#include "AudioMixKernels.h"
+#include "MipGenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class ThreadPool;
+
+// その場で作るテクスチャ(焼き込んだデカール、サムネイル、アトラスなど)を
+// 毎フレームの合間にでも圧縮できる、速さ重視のBC圧縮
+// DirectXTexのCPUの圧縮(特にBC7)は画質は良いが遅すぎるので、こちらを使い分ける
+
+// どれも4x4ピクセルを1ブロックにする
+enum class BcFormat : uint8_t {
+  // RGB(アルファは1bit)。1ブロック8バイト
+  Bc1,
+  // BC1の色とBC4のアルファ。1ブロック16バイト
+  Bc3,
+  // RGBA。モード6(端点1組、16段階)だけを使う。1ブロック16バイト
+  Bc7,
+};
+
+enum class BcQuality : uint8_t {
+  // 端点を色の範囲から決めるだけ。一番速い
+  Fast,
+  // 色の広がる向き(主成分)で端点を決め、最小二乗で1回詰める
+  Normal,
+  // 詰める回数を増やし、BC7はpビットの組み合わせもすべて試す
+  High,
+};
+
+const char *GetBcQualityName(BcQuality quality);
+bool ParseBcQuality(const std::string &name, BcQuality &quality);
+
+struct BcEncodeSettings {
+  BcFormat format = BcFormat::Bc7;
+  BcQuality quality = BcQuality::Normal;
+  SimdLevel simd = GetSupportedSimdLevel();
+};
+
+// 1ブロックのバイト数
+size_t GetBcBlockSize(BcFormat format);
+
+// 16ピクセル(4x4を行の順に、1ピクセル4バイトのRGBA)を1ブロックにする
+// SIMDのどのレベルでも同じブロックになる
+void EncodeBcBlock(const uint8_t *pixels, const BcEncodeSettings &settings,
+                   uint8_t *block);
+
+// RGBAの画像(BGRAは不可)をブロックに圧縮する
+// ブロックの行は(幅 + 3) / 4個のブロックで、blockRowPitchバイトずつ並べる
+// 幅や高さが4の倍数でなければ、はみ出す分は端のピクセルを繰り返す
+// sRGBの画像もそのままの値で比べるので、sRGBの形式として使ってよい
+// poolを渡すと、ブロックの行をまとめた帯に分けて並列に圧縮する
+void EncodeBcImage(const Rgba8Image &image, const BcEncodeSettings &settings,
+                   uint8_t *blocks, size_t blockRowPitch,
+                   ThreadPool *pool = nullptr);
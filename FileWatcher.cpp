@@ -0,0 +1,227 @@
+#include "FileWatcher.h"
+#include <system_error>
+#include <vector>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::~FileWatcher() { Stop(); }
+
+std::string FileWatcher::NormalizePath(const std::filesystem::path &path) {
+  return path.lexically_normal().generic_string();
+}
+
+void FileWatcher::AddPath(const std::string &path) {
+  std::error_code ec;
+  if (std::filesystem::is_directory(path, ec)) {
+    directories_.insert(NormalizePath(path));
+  } else {
+    files_.insert(NormalizePath(path));
+  }
+}
+
+void FileWatcher::Start(ChangeCallback onChanged) {
+  Stop();
+  onChanged_ = std::move(onChanged);
+  isRunning_ = true;
+  thread_ = std::thread(&FileWatcher::ThreadMain, this);
+}
+
+void FileWatcher::Stop() {
+  isRunning_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void FileWatcher::ThreadMain() {
+  // inotifyが使えない環境ではポーリングに切り替える
+  if (!RunInotify()) {
+    RunPolling();
+  }
+}
+
+bool FileWatcher::IsWatched(const std::string &filePath) const {
+  if (files_.contains(filePath)) {
+    return true;
+  }
+  for (const std::string &directory : directories_) {
+    if (filePath.size() > directory.size() &&
+        filePath.compare(0, directory.size(), directory) == 0 &&
+        filePath[directory.size()] == '/') {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FileWatcher::MarkChanged(const std::string &filePath) {
+  pendingChanges_.insert(filePath);
+  lastChangeTime_ = std::chrono::steady_clock::now();
+}
+
+void FileWatcher::FlushChanges(bool force) {
+  if (pendingChanges_.empty()) {
+    return;
+  }
+  // エディタは何回かに分けて書き込むので、落ち着くまで通知しない
+  if (!force &&
+      std::chrono::steady_clock::now() - lastChangeTime_ < debounceTime_) {
+    return;
+  }
+  for (const std::string &filePath : pendingChanges_) {
+    onChanged_(filePath);
+  }
+  pendingChanges_.clear();
+}
+
+#pragma region inotify
+
+bool FileWatcher::RunInotify() {
+#ifdef __linux__
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  const uint32_t kMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+  std::map<int, std::string> watchDirectories;
+
+  auto addWatch = [&](const std::string &directory) {
+    int wd = inotify_add_watch(fd, directory.c_str(), kMask);
+    if (wd >= 0) {
+      watchDirectories[wd] = directory;
+    }
+  };
+
+  // 監視ディレクトリは再帰的に、単体ファイルは親ディレクトリを監視する
+  std::error_code ec;
+  for (const std::string &directory : directories_) {
+    addWatch(directory);
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+      if (it->is_directory(ec)) {
+        addWatch(NormalizePath(it->path()));
+      }
+    }
+  }
+  for (const std::string &file : files_) {
+    std::filesystem::path parent = std::filesystem::path(file).parent_path();
+    addWatch(parent.empty() ? std::string(".") : NormalizePath(parent));
+  }
+
+  if (watchDirectories.empty()) {
+    close(fd);
+    return false;
+  }
+
+  alignas(inotify_event) char buffer[4096];
+  while (isRunning_) {
+    pollfd pfd{fd, POLLIN, 0};
+    int timeout = static_cast<int>(
+        pendingChanges_.empty() ? pollInterval_.count() : debounceTime_.count());
+    if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+      for (;;) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+          break;
+        }
+        for (char *p = buffer; p < buffer + length;) {
+          const inotify_event *event = reinterpret_cast<inotify_event *>(p);
+          p += sizeof(inotify_event) + event->len;
+
+          auto it = watchDirectories.find(event->wd);
+          if (it == watchDirectories.end() || event->len == 0) {
+            continue;
+          }
+          std::string filePath =
+              NormalizePath(std::filesystem::path(it->second) / event->name);
+
+          if (event->mask & IN_ISDIR) {
+            // 監視中のディレクトリの下に作られたディレクトリも監視する
+            if (IsWatched(filePath)) {
+              addWatch(filePath);
+            }
+            continue;
+          }
+          // IN_CREATEだけではまだ書き込み中なので、書き込み完了を待つ
+          if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) &&
+              IsWatched(filePath)) {
+            MarkChanged(filePath);
+          }
+        }
+      }
+    }
+    FlushChanges(false);
+  }
+
+  FlushChanges(true);
+  close(fd);
+  return true;
+#else
+  return false;
+#endif
+}
+
+#pragma endregion
+
+#pragma region ポーリング
+
+void FileWatcher::ScanStamps(std::map<std::string, FileStamp> &stamps) const {
+  std::error_code ec;
+  auto stampFile = [&](const std::filesystem::path &path) {
+    FileStamp stamp{};
+    stamp.writeTime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+      return;
+    }
+    stamp.size = std::filesystem::file_size(path, ec);
+    if (ec) {
+      return;
+    }
+    stamps[NormalizePath(path)] = stamp;
+  };
+
+  for (const std::string &directory : directories_) {
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+      if (it->is_regular_file(ec)) {
+        stampFile(it->path());
+      }
+    }
+  }
+  for (const std::string &file : files_) {
+    stampFile(file);
+  }
+}
+
+void FileWatcher::RunPolling() {
+  std::map<std::string, FileStamp> stamps;
+  ScanStamps(stamps);
+
+  while (isRunning_) {
+    std::this_thread::sleep_for(pendingChanges_.empty() ? pollInterval_
+                                                        : debounceTime_);
+
+    std::map<std::string, FileStamp> current;
+    ScanStamps(current);
+    for (const auto &[filePath, stamp] : current) {
+      auto it = stamps.find(filePath);
+      if (it == stamps.end() || it->second.writeTime != stamp.writeTime ||
+          it->second.size != stamp.size) {
+        MarkChanged(filePath);
+      }
+    }
+    stamps = std::move(current);
+
+    FlushChanges(false);
+  }
+
+  FlushChanges(true);
+}
+
+#pragma endregion
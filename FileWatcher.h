@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// ファイルの変更を監視するクラス
+// Linuxではinotify、それ以外の環境では更新日時のポーリングで検出する
+class FileWatcher {
+public:
+  // 変更されたファイルのパス(正規化済み)を受け取る。監視スレッドから呼ばれる
+  using ChangeCallback = std::function<void(const std::string &filePath)>;
+
+  FileWatcher() = default;
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  // ディレクトリなら中身を再帰的に、ファイルならそのファイルだけを監視する
+  // Startより前に呼ぶ
+  void AddPath(const std::string &path);
+
+  void Start(ChangeCallback onChanged);
+  void Stop();
+
+  // ポーリングの間隔と、連続した書き込みをまとめる待ち時間
+  void SetPollInterval(std::chrono::milliseconds interval) {
+    pollInterval_ = interval;
+  }
+  void SetDebounceTime(std::chrono::milliseconds time) { debounceTime_ = time; }
+
+  // 比較に使うためのパスの正規化
+  static std::string NormalizePath(const std::filesystem::path &path);
+
+private:
+  struct FileStamp {
+    std::filesystem::file_time_type writeTime;
+    uintmax_t size;
+  };
+
+  void ThreadMain();
+  bool RunInotify();
+  void RunPolling();
+
+  // 変更を溜めておき、書き込みが落ち着いたらまとめて通知する
+  void MarkChanged(const std::string &filePath);
+  void FlushChanges(bool force);
+
+  bool IsWatched(const std::string &filePath) const;
+  void ScanStamps(std::map<std::string, FileStamp> &stamps) const;
+
+  std::set<std::string> directories_;
+  std::set<std::string> files_;
+
+  ChangeCallback onChanged_;
+  std::thread thread_;
+  std::atomic<bool> isRunning_ = false;
+
+  std::chrono::milliseconds pollInterval_{250};
+  std::chrono::milliseconds debounceTime_{100};
+
+  std::set<std::string> pendingChanges_;
+  std::chrono::steady_clock::time_point lastChangeTime_;
+};
@@ -0,0 +1,80 @@
+#include "HotReloader.h"
+
+HotReloader::HotReloader(uint32_t workerCount) : workers_(workerCount) {}
+
+HotReloader::~HotReloader() {
+  Stop();
+  workers_.WaitIdle();
+}
+
+void HotReloader::Register(const std::string &filePath, ReloadFunction reload) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_[FileWatcher::NormalizePath(filePath)].reloads.push_back(
+      std::move(reload));
+}
+
+void HotReloader::Start(const std::vector<std::string> &watchPaths) {
+  for (const std::string &path : watchPaths) {
+    watcher_.AddPath(path);
+  }
+  watcher_.Start(
+      [this](const std::string &filePath) { OnFileChanged(filePath); });
+}
+
+void HotReloader::Stop() { watcher_.Stop(); }
+
+void HotReloader::OnFileChanged(const std::string &filePath) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(filePath);
+  if (it == entries_.end()) {
+    // 登録されていないファイルは無視する
+    return;
+  }
+  if (it->second.isLoading) {
+    it->second.isDirty = true;
+    return;
+  }
+  it->second.isLoading = true;
+  Dispatch(filePath);
+}
+
+void HotReloader::Dispatch(const std::string &filePath) {
+  // mutex_をロックした状態で呼ぶ
+  std::vector<ReloadFunction> reloads = entries_[filePath].reloads;
+
+  workers_.Submit([this, filePath, reloads]() {
+    std::vector<ApplyFunction> applies;
+    for (const ReloadFunction &reload : reloads) {
+      ApplyFunction apply = reload();
+      if (apply) {
+        applies.push_back(std::move(apply));
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (ApplyFunction &apply : applies) {
+      pendingApplies_.push_back(std::move(apply));
+    }
+
+    Entry &entry = entries_[filePath];
+    if (entry.isDirty) {
+      entry.isDirty = false;
+      Dispatch(filePath);
+    } else {
+      entry.isLoading = false;
+    }
+  });
+}
+
+uint32_t HotReloader::ApplyPendingReloads() {
+  std::vector<ApplyFunction> applies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    applies.swap(pendingApplies_);
+  }
+  // ロックを外してから実行する(差し替え処理が重くてもワーカーを止めない)
+  for (ApplyFunction &apply : applies) {
+    apply();
+  }
+  return static_cast<uint32_t>(applies.size());
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "FileWatcher.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 変更されたアセットだけをワーカースレッドで読み直し、
+// フレームの区切りでメインスレッドから差し替えるクラス
+class HotReloader {
+public:
+  // 差し替え処理。フレームの区切りでメインスレッドから呼ばれる
+  using ApplyFunction = std::function<void()>;
+  // 読み込み処理。ワーカースレッドで呼ばれ、差し替え処理を返す
+  // 読み込みに失敗したときは空の関数を返せば何もしない
+  using ReloadFunction = std::function<ApplyFunction()>;
+
+  explicit HotReloader(uint32_t workerCount = 1);
+  ~HotReloader();
+
+  // 監視するファイルと読み込み処理を登録する。同じファイルに複数登録してもよい
+  void Register(const std::string &filePath, ReloadFunction reload);
+
+  // 監視を始める。watchPathsにはディレクトリも指定できる
+  void Start(const std::vector<std::string> &watchPaths);
+  void Stop();
+
+  // フレームの区切りで呼ぶ。読み込みが終わったアセットを差し替える
+  // 戻り値は差し替えた数
+  uint32_t ApplyPendingReloads();
+
+private:
+  struct Entry {
+    std::vector<ReloadFunction> reloads;
+    // 読み込み中にもう一度変更されたら、終わった後に読み直す
+    bool isLoading = false;
+    bool isDirty = false;
+  };
+
+  void OnFileChanged(const std::string &filePath);
+  void Dispatch(const std::string &filePath);
+
+  FileWatcher watcher_;
+  ThreadPool workers_;
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+  std::vector<ApplyFunction> pendingApplies_;
+};
@@ -0,0 +1,404 @@
+#include "Inflate.h"
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t kMaxCodeLength = 15;
+// この長さまでの符号は表を1回引くだけで読む。長いものは1ビットずつたどる
+constexpr uint32_t kFastBits = 10;
+constexpr uint32_t kMaxLiteralCodes = 288;
+constexpr uint32_t kMaxDistanceCodes = 32;
+
+const uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10,  11, 13,
+                                  15, 17, 19, 23, 27, 31, 35, 43,  51, 59,
+                                  67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                  1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                  4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistanceBase[30] = {
+    1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+    33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                    4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                    9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// 符号長の符号の長さが並ぶ順番
+const uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+// 下位のビットから読む(Deflateのビットの順番)
+class BitReader {
+public:
+  BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  // 最低でも57ビットを溜める。終わりより先は0として読み、IsOverrunで調べる
+  void Refill() {
+    if (position_ + 8 <= size_) {
+      uint64_t word;
+      std::memcpy(&word, data_ + position_, sizeof(word));
+      bits_ |= word << count_;
+      position_ += (63 - count_) >> 3;
+      count_ |= 56;
+      return;
+    }
+    while (count_ <= 56) {
+      const uint64_t byte = position_ < size_ ? data_[position_] : 0;
+      bits_ |= byte << count_;
+      ++position_;
+      count_ += 8;
+    }
+  }
+
+  uint32_t Peek(uint32_t n) const {
+    return uint32_t(bits_ & ((uint64_t(1) << n) - 1));
+  }
+  void Consume(uint32_t n) {
+    bits_ >>= n;
+    count_ -= n;
+  }
+  uint32_t Read(uint32_t n) {
+    const uint32_t value = Peek(n);
+    Consume(n);
+    return value;
+  }
+
+  void AlignToByte() { Consume(count_ & 7); }
+
+  // 非圧縮ブロックの中身をそのまま写す。AlignToByteの後に呼ぶ
+  bool CopyBytes(uint8_t *dst, size_t size) {
+    while (size > 0 && count_ >= 8) {
+      *dst++ = uint8_t(Read(8));
+      --size;
+    }
+    if (size == 0) {
+      return !IsOverrun();
+    }
+    // 溜めていたビットは使い切ったので、ここからはバイト列を直接読む
+    bits_ = 0;
+    count_ = 0;
+    if (position_ > size_ || size_ - position_ < size) {
+      return false;
+    }
+    std::memcpy(dst, data_ + position_, size);
+    position_ += size;
+    return true;
+  }
+
+  // 読んだビットがデータの終わりを越えた
+  bool IsOverrun() const { return position_ * 8 - count_ > size_ * 8; }
+  // 読み終えたバイト数(AlignToByteの後で正しい値になる)
+  size_t GetConsumedBytes() const { return position_ - count_ / 8; }
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t position_ = 0;
+  uint64_t bits_ = 0;
+  uint32_t count_ = 0;
+};
+
+// 符号長だけで決まるDeflateのハフマン符号(canonical Huffman)
+class HuffmanTable {
+public:
+  // 符号長が多すぎて符号が作れなければfalse。足りない(使わない符号がある)のはよい
+  bool Build(const uint8_t *lengths, uint32_t count) {
+    std::memset(counts_, 0, sizeof(counts_));
+    for (uint32_t i = 0; i < count; ++i) {
+      ++counts_[lengths[i]];
+    }
+    counts_[0] = 0;
+    int32_t left = 1;
+    for (uint32_t length = 1; length <= kMaxCodeLength; ++length) {
+      left = (left << 1) - counts_[length];
+      if (left < 0) {
+        return false;
+      }
+    }
+
+    uint16_t offsets[kMaxCodeLength + 2] = {};
+    for (uint32_t length = 1; length <= kMaxCodeLength; ++length) {
+      offsets[length + 1] = offsets[length] + counts_[length];
+    }
+    for (uint32_t symbol = 0; symbol < count; ++symbol) {
+      if (lengths[symbol] != 0) {
+        symbols_[offsets[lengths[symbol]]++] = uint16_t(symbol);
+      }
+    }
+
+    // 短い符号は、後ろに続くビットのすべての組み合わせで同じ記号を引けるようにする
+    std::memset(fast_, 0, sizeof(fast_));
+    uint32_t code = 0;
+    uint32_t index = 0;
+    for (uint32_t length = 1; length <= kFastBits; ++length) {
+      for (uint32_t i = 0; i < counts_[length]; ++i, ++code) {
+        const uint16_t entry = uint16_t((symbols_[index++] << 4) | length);
+        for (uint32_t j = Reverse(code, length); j < (1u << kFastBits);
+             j += 1u << length) {
+          fast_[j] = entry;
+        }
+      }
+      code <<= 1;
+    }
+    return true;
+  }
+
+  // 読む前にRefillしておくこと。表にない符号なら-1
+  int32_t Decode(BitReader &reader) const {
+    const uint16_t entry = fast_[reader.Peek(kFastBits)];
+    if (entry != 0) {
+      reader.Consume(entry & 15);
+      return entry >> 4;
+    }
+    uint32_t bits = reader.Peek(kMaxCodeLength);
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (uint32_t length = 1; length <= kMaxCodeLength; ++length) {
+      code |= bits & 1;
+      bits >>= 1;
+      const int32_t count = counts_[length];
+      if (code - first < count) {
+        reader.Consume(length);
+        return symbols_[index + code - first];
+      }
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    return -1;
+  }
+
+private:
+  static uint32_t Reverse(uint32_t code, uint32_t length) {
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < length; ++i) {
+      reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+  }
+
+  // 下位4bitが符号長、上位が記号。0は表にない長い符号
+  uint16_t fast_[1u << kFastBits];
+  uint16_t counts_[kMaxCodeLength + 1];
+  uint16_t symbols_[kMaxLiteralCodes];
+};
+
+struct FixedTables {
+  HuffmanTable literal;
+  HuffmanTable distance;
+};
+
+const FixedTables &GetFixedTables() {
+  static const FixedTables tables = [] {
+    FixedTables result;
+    uint8_t lengths[kMaxLiteralCodes];
+    std::memset(lengths, 8, 144);
+    std::memset(lengths + 144, 9, 112);
+    std::memset(lengths + 256, 7, 24);
+    std::memset(lengths + 280, 8, 8);
+    result.literal.Build(lengths, kMaxLiteralCodes);
+    std::memset(lengths, 5, kMaxDistanceCodes);
+    result.distance.Build(lengths, 30);
+    return result;
+  }();
+  return tables;
+}
+
+bool ReadDynamicTables(BitReader &reader, HuffmanTable &literal,
+                       HuffmanTable &distance) {
+  reader.Refill();
+  const uint32_t literalCount = reader.Read(5) + 257;
+  const uint32_t distanceCount = reader.Read(5) + 1;
+  const uint32_t codeLengthCount = reader.Read(4) + 4;
+  if (literalCount > 286 || distanceCount > 30) {
+    return false;
+  }
+
+  uint8_t codeLengthLengths[19] = {};
+  for (uint32_t i = 0; i < codeLengthCount; ++i) {
+    reader.Refill();
+    codeLengthLengths[kCodeLengthOrder[i]] = uint8_t(reader.Read(3));
+  }
+  HuffmanTable codeLength;
+  if (!codeLength.Build(codeLengthLengths, 19)) {
+    return false;
+  }
+
+  uint8_t lengths[kMaxLiteralCodes + kMaxDistanceCodes] = {};
+  const uint32_t total = literalCount + distanceCount;
+  uint32_t i = 0;
+  while (i < total) {
+    reader.Refill();
+    const int32_t symbol = codeLength.Decode(reader);
+    if (symbol < 0) {
+      return false;
+    }
+    if (symbol < 16) {
+      lengths[i++] = uint8_t(symbol);
+      continue;
+    }
+    uint8_t value = 0;
+    uint32_t repeat = 0;
+    if (symbol == 16) {
+      if (i == 0) {
+        return false;
+      }
+      value = lengths[i - 1];
+      repeat = 3 + reader.Read(2);
+    } else if (symbol == 17) {
+      repeat = 3 + reader.Read(3);
+    } else {
+      repeat = 11 + reader.Read(7);
+    }
+    if (i + repeat > total) {
+      return false;
+    }
+    std::memset(lengths + i, value, repeat);
+    i += repeat;
+  }
+  // ブロックの終わりの記号がなければ終われない
+  if (lengths[256] == 0) {
+    return false;
+  }
+  return literal.Build(lengths, literalCount) &&
+         distance.Build(lengths + literalCount, distanceCount);
+}
+
+bool InflateBlock(BitReader &reader, const HuffmanTable &literal,
+                  const HuffmanTable &distance, uint8_t *dst, uint8_t *&out,
+                  uint8_t *end) {
+  for (;;) {
+    // 長さ(15+5ビット)と距離(15+13ビット)を続けて読んでも57ビットに収まる
+    reader.Refill();
+    int32_t symbol = literal.Decode(reader);
+    if (symbol < 256) {
+      if (symbol < 0 || out == end) {
+        return false;
+      }
+      *out++ = uint8_t(symbol);
+      continue;
+    }
+    if (symbol == 256) {
+      return !reader.IsOverrun();
+    }
+    symbol -= 257;
+    if (symbol >= 29) {
+      return false;
+    }
+    const size_t length = kLengthBase[symbol] + reader.Read(kLengthExtra[symbol]);
+    const int32_t distanceSymbol = distance.Decode(reader);
+    if (distanceSymbol < 0 || distanceSymbol >= 30) {
+      return false;
+    }
+    const size_t offset = kDistanceBase[distanceSymbol] +
+                          reader.Read(kDistanceExtra[distanceSymbol]);
+    if (offset > size_t(out - dst) || length > size_t(end - out)) {
+      return false;
+    }
+    const uint8_t *from = out - offset;
+    if (offset >= length) {
+      std::memcpy(out, from, length);
+    } else if (offset == 1) {
+      std::memset(out, *from, length);
+    } else {
+      // 重なっているので、書いたものをまた読みながら進める
+      for (size_t i = 0; i < length; ++i) {
+        out[i] = from[i];
+      }
+    }
+    out += length;
+  }
+}
+
+// consumedBytesに最後のブロックの後ろまでのバイト数を返す
+bool InflateStream(const uint8_t *src, size_t srcSize, uint8_t *dst,
+                   size_t dstSize, size_t &consumedBytes) {
+  BitReader reader(src, srcSize);
+  uint8_t *out = dst;
+  uint8_t *const end = dst + dstSize;
+  HuffmanTable literal;
+  HuffmanTable distance;
+  bool isFinal = false;
+  while (!isFinal) {
+    reader.Refill();
+    isFinal = reader.Read(1) != 0;
+    const uint32_t type = reader.Read(2);
+    if (type == 0) {
+      reader.AlignToByte();
+      const uint32_t length = reader.Read(16);
+      const uint32_t complement = reader.Read(16);
+      if (length != (~complement & 0xFFFF) ||
+          length > size_t(end - out) || !reader.CopyBytes(out, length)) {
+        return false;
+      }
+      out += length;
+    } else if (type == 1) {
+      const FixedTables &fixed = GetFixedTables();
+      if (!InflateBlock(reader, fixed.literal, fixed.distance, dst, out,
+                        end)) {
+        return false;
+      }
+    } else if (type == 2) {
+      if (!ReadDynamicTables(reader, literal, distance) ||
+          !InflateBlock(reader, literal, distance, dst, out, end)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  reader.AlignToByte();
+  consumedBytes = reader.GetConsumedBytes();
+  return out == end && !reader.IsOverrun();
+}
+
+uint32_t ComputeAdler32(const uint8_t *data, size_t size) {
+  // 5552バイトまでならbが32bitからあふれない
+  constexpr size_t kBlockSize = 5552;
+  uint32_t a = 1;
+  uint32_t b = 0;
+  while (size > 0) {
+    const size_t blockSize = size < kBlockSize ? size : kBlockSize;
+    for (size_t i = 0; i < blockSize; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += blockSize;
+    size -= blockSize;
+  }
+  return (b << 16) | a;
+}
+
+} // namespace
+
+bool Inflate(const uint8_t *src, size_t srcSize, uint8_t *dst,
+             size_t dstSize) {
+  size_t consumedBytes = 0;
+  return InflateStream(src, srcSize, dst, dstSize, consumedBytes);
+}
+
+bool InflateZlib(const uint8_t *src, size_t srcSize, uint8_t *dst,
+                 size_t dstSize) {
+  if (srcSize < 2 + 4) {
+    return false;
+  }
+  // 圧縮方法はDeflateだけ。プリセット辞書は使われないので扱わない
+  const uint32_t cmf = src[0];
+  const uint32_t flg = src[1];
+  if ((cmf & 15) != 8 || (cmf >> 4) > 7 || (cmf * 256 + flg) % 31 != 0 ||
+      (flg & 0x20) != 0) {
+    return false;
+  }
+  size_t consumedBytes = 0;
+  if (!InflateStream(src + 2, srcSize - 2, dst, dstSize, consumedBytes) ||
+      srcSize - 2 - consumedBytes < 4) {
+    return false;
+  }
+  const uint8_t *trailer = src + 2 + consumedBytes;
+  const uint32_t adler = (uint32_t(trailer[0]) << 24) |
+                         (uint32_t(trailer[1]) << 16) |
+                         (uint32_t(trailer[2]) << 8) | uint32_t(trailer[3]);
+  return adler == ComputeAdler32(dst, dstSize);
+}
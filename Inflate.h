@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Deflate(RFC 1951)の展開。PNGの画像データをWICやzlibなしで読むのに使う
+// 圧縮側は持たない(クックしたものはDDSで持つので、書くことはない)
+
+// ヘッダーなしのDeflateをちょうどdstSizeバイトに展開できたときだけtrueを返す
+// 壊れたデータでも範囲外を読み書きしない
+bool Inflate(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+
+// zlib形式(RFC 1950。2バイトのヘッダーと末尾のAdler-32)を展開する
+// Adler-32が合わなければfalse
+bool InflateZlib(const uint8_t *src, size_t srcSize, uint8_t *dst,
+                 size_t dstSize);
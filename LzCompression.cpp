@@ -0,0 +1,170 @@
+#include "LzCompression.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t kMinMatch = 4;
+const size_t kMaxOffset = 65535;
+// 最後の数バイトは必ずリテラルにする(展開側の終了判定を単純にするため)
+const size_t kLastLiterals = 5;
+const uint32_t kHashBits = 16;
+
+uint32_t Read32(const uint8_t *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// 15以上の長さは255の連続と残りで表す
+void WriteLength(std::vector<uint8_t> &dst, size_t length) {
+  while (length >= 255) {
+    dst.push_back(255);
+    length -= 255;
+  }
+  dst.push_back(uint8_t(length));
+}
+
+// matchLengthが0なら最後のリテラルだけの並び
+void WriteSequence(std::vector<uint8_t> &dst, const uint8_t *literals,
+                   size_t literalLength, size_t matchLength, size_t offset) {
+  size_t matchCode = matchLength == 0 ? 0 : matchLength - kMinMatch;
+  dst.push_back(uint8_t((std::min<size_t>(literalLength, 15) << 4) |
+                        std::min<size_t>(matchCode, 15)));
+  if (literalLength >= 15) {
+    WriteLength(dst, literalLength - 15);
+  }
+  dst.insert(dst.end(), literals, literals + literalLength);
+
+  if (matchLength == 0) {
+    return;
+  }
+  dst.push_back(uint8_t(offset & 0xFF));
+  dst.push_back(uint8_t(offset >> 8));
+  if (matchCode >= 15) {
+    WriteLength(dst, matchCode - 15);
+  }
+}
+
+// 壊れたデータで止まらないよう、読み出し位置を確認しながら長さを読む
+bool ReadLength(const uint8_t *&src, const uint8_t *srcEnd, size_t &length) {
+  uint8_t value;
+  do {
+    if (src == srcEnd) {
+      return false;
+    }
+    value = *src++;
+    length += value;
+  } while (value == 255);
+  return true;
+}
+
+} // namespace
+
+size_t LzCompressBound(size_t size) { return size + size / 255 + 16; }
+
+size_t LzCompress(const uint8_t *src, size_t srcSize,
+                  std::vector<uint8_t> &dst) {
+  size_t start = dst.size();
+  dst.reserve(start + LzCompressBound(srcSize));
+
+  // 4バイトの並びから直近の出現位置(+1)を引く表
+  std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+
+  size_t anchor = 0;
+  size_t pos = 0;
+  if (srcSize > kMinMatch + kLastLiterals) {
+    const size_t limit = srcSize - kLastLiterals;
+    while (pos + kMinMatch <= limit) {
+      uint32_t sequence = Read32(src + pos);
+      uint32_t &slot = table[Hash(sequence)];
+      size_t candidate = slot;
+      slot = uint32_t(pos + 1);
+
+      if (candidate == 0 || pos - (candidate - 1) > kMaxOffset ||
+          Read32(src + candidate - 1) != sequence) {
+        ++pos;
+        continue;
+      }
+
+      size_t matchPos = candidate - 1;
+      size_t length = kMinMatch;
+      while (pos + length < limit &&
+             src[matchPos + length] == src[pos + length]) {
+        ++length;
+      }
+
+      WriteSequence(dst, src + anchor, pos - anchor, length, pos - matchPos);
+      pos += length;
+      anchor = pos;
+    }
+  }
+  WriteSequence(dst, src + anchor, srcSize - anchor, 0, 0);
+
+  return dst.size() - start;
+}
+
+bool LzDecompress(const uint8_t *src, size_t srcSize, uint8_t *dst,
+                  size_t dstSize) {
+  const uint8_t *srcEnd = src + srcSize;
+  uint8_t *const dstBegin = dst;
+  uint8_t *const dstEnd = dst + dstSize;
+
+  while (src < srcEnd) {
+    uint8_t token = *src++;
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !ReadLength(src, srcEnd, literalLength)) {
+      return false;
+    }
+    if (literalLength > size_t(srcEnd - src) ||
+        literalLength > size_t(dstEnd - dst)) {
+      return false;
+    }
+    if (literalLength > 0) {
+      std::memcpy(dst, src, literalLength);
+    }
+    src += literalLength;
+    dst += literalLength;
+
+    // 最後の並びはリテラルだけ
+    if (src == srcEnd) {
+      break;
+    }
+
+    if (srcEnd - src < 2) {
+      return false;
+    }
+    size_t offset = size_t(src[0]) | (size_t(src[1]) << 8);
+    src += 2;
+    if (offset == 0 || offset > size_t(dst - dstBegin)) {
+      return false;
+    }
+
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !ReadLength(src, srcEnd, matchLength)) {
+      return false;
+    }
+    matchLength += kMinMatch;
+    if (matchLength > size_t(dstEnd - dst)) {
+      return false;
+    }
+
+    const uint8_t *match = dst - offset;
+    if (offset >= matchLength) {
+      std::memcpy(dst, match, matchLength);
+      dst += matchLength;
+    } else {
+      // 重なっている場合は前から1バイトずつ(同じ並びの繰り返しになる)
+      for (size_t i = 0; i < matchLength; ++i) {
+        *dst++ = match[i];
+      }
+    }
+  }
+
+  return dst == dstEnd;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LZ4のブロック形式に近い、展開の速さを優先した圧縮
+// トークン(上位4bitがリテラル長、下位4bitが一致長-4)、リテラル、
+// 2バイトのオフセットの繰り返しで、最後はリテラルだけで終わる
+
+// 圧縮後の最大サイズ。圧縮できないデータでもこれを超えない
+size_t LzCompressBound(size_t size);
+
+// 圧縮してdstの後ろに追加する。戻り値は追加したバイト数
+size_t LzCompress(const uint8_t *src, size_t srcSize,
+                  std::vector<uint8_t> &dst);
+
+// ちょうどdstSizeバイトに展開できたときだけtrueを返す
+// 壊れたデータでも範囲外を読み書きしない
+bool LzDecompress(const uint8_t *src, size_t srcSize, uint8_t *dst,
+                  size_t dstSize);
@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+
+  // パスはUTF-8として扱う
+  int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  std::wstring pathW(length, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, pathW.data(), length);
+
+  // マップしている間もエディタがファイルを上書き・置き換えできるようにする
+  HANDLE file = CreateFileW(pathW.c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize{};
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<const uint8_t *>(view);
+  size_ = size_t(fileSize.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    CloseHandle(file_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_ = nullptr;
+  file_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat status {};
+  if (fstat(fd, &status) != 0 || status.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  void *view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE,
+                    fd, 0);
+  // マップした後はファイルを閉じてもよい
+  close(fd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t *>(view);
+  size_ = size_t(status.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// 読み込んだファイルの中身。ownerが生きている間だけdataが有効
+// ownerはメモリマップ全体や展開済みのバッファを指している
+struct FileData {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  std::shared_ptr<const void> owner;
+
+  bool IsValid() const { return owner != nullptr; }
+  std::string_view GetText() const {
+    return std::string_view(reinterpret_cast<const char *>(data), size);
+  }
+};
+
+// ファイルを読み取り専用でメモリにマップするクラス
+// マップしている間に書き換えられると困るので、パックファイルなど
+// 実行中に変わらないファイルだけに使う
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // 空のファイルはマップできないので失敗扱いにする
+  bool Open(const std::string &path);
+  void Close();
+
+  bool IsOpen() const { return data_ != nullptr; }
+  const uint8_t *GetData() const { return data_; }
+  size_t GetSize() const { return size_; }
+
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+};
@@ -0,0 +1,629 @@
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#define MIP_GENERATOR_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC/Clangは関数ごとにAVXを許可する。MSVCは指定しなくても使える
+#if defined(MIP_GENERATOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MIP_GENERATOR_TARGET_AVX __attribute__((target("avx")))
+#else
+#define MIP_GENERATOR_TARGET_AVX
+#endif
+
+namespace {
+
+// 並列にするときの1つの仕事の行数(書き込む側のレベルの行)
+constexpr uint32_t kRowsPerBand = 32;
+// リニア -> sRGBの表の細かさ
+constexpr uint32_t kEncodeTableSize = 4096;
+constexpr uint32_t kMaxTaps = 6;
+// デコードした元の行を覚えておく数。タップ数より多い2の累乗
+constexpr uint32_t kCachedRows = 8;
+// カイザー窓の形を決める値。大きいほど高い周波数のちらつきを抑えるがぼける
+constexpr double kKaiserAlpha = 4.0;
+// アルファのカバレッジを合わせるときに掛ける倍率の上限
+constexpr float kMaxAlphaScale = 4.0f;
+
+struct SrgbTables {
+  // sRGB -> リニア
+  float decode[256];
+  // 0~255 -> 0~1
+  float unorm[256];
+  uint8_t encode[kEncodeTableSize];
+};
+
+const SrgbTables &GetSrgbTables() {
+  static const SrgbTables tables = [] {
+    SrgbTables result{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      const float c = i / 255.0f;
+      result.decode[i] = c <= 0.04045f ? c / 12.92f
+                                       : std::pow((c + 0.055f) / 1.055f, 2.4f);
+      result.unorm[i] = c;
+    }
+    for (uint32_t i = 0; i < kEncodeTableSize; ++i) {
+      const float linear = float(i) / float(kEncodeTableSize - 1);
+      const float c = linear <= 0.0031308f
+                          ? linear * 12.92f
+                          : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+      result.encode[i] = uint8_t(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+    }
+    return result;
+  }();
+  return tables;
+}
+
+// 縦と横で同じものを使う。出力のiは元の2i+firstOffsetからtapCount個を見る
+struct FilterKernel {
+  uint32_t tapCount;
+  int32_t firstOffset;
+  float weights[kMaxTaps];
+};
+
+// 第1種変形ベッセル関数I0(級数で十分に収束する)
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (uint32_t k = 1; k < 32; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+const FilterKernel &GetFilterKernel(MipFilter filter) {
+  static const FilterKernel kBox = {2, 0, {0.5f, 0.5f}};
+  static const FilterKernel kKaiser = [] {
+    // 出力の中心から±0.5、±1.5、±2.5の位置の元のピクセルに
+    // 半分に縮めるsincと、半径3のカイザー窓を掛けたものを使う
+    FilterKernel kernel = {kMaxTaps, -2, {}};
+    double weights[kMaxTaps];
+    double sum = 0.0;
+    for (uint32_t i = 0; i < kMaxTaps; ++i) {
+      const double distance = double(i) - 2.5;
+      const double x = std::numbers::pi * distance * 0.5;
+      const double sinc = std::sin(x) / x;
+      const double t = distance / 3.0;
+      const double window =
+          BesselI0(kKaiserAlpha * std::sqrt(1.0 - t * t)) /
+          BesselI0(kKaiserAlpha);
+      weights[i] = sinc * window;
+      sum += weights[i];
+    }
+    for (uint32_t i = 0; i < kMaxTaps; ++i) {
+      kernel.weights[i] = float(weights[i] / sum);
+    }
+    return kernel;
+  }();
+  return filter == MipFilter::Kaiser ? kKaiser : kBox;
+}
+
+uint32_t GetChannelCount(MipFormat format) {
+  switch (format) {
+  case MipFormat::R8:
+    return 1;
+  case MipFormat::Rg8:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+bool HasAlpha(MipFormat format) {
+  return format == MipFormat::Rgba8 || format == MipFormat::Rgba16Float;
+}
+
+#pragma region 半精度浮動小数点
+
+float HalfToFloat(uint16_t half) {
+  const uint32_t sign = uint32_t(half & 0x8000) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1F;
+  const uint32_t mantissa = half & 0x3FF;
+  uint32_t bits = 0;
+  if (exponent == 0x1F) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {
+    // 非正規化数は2^-24の単位
+    const float value = float(mantissa) * (1.0f / 16777216.0f);
+    return sign != 0 ? -value : value;
+  } else {
+    bits = sign;
+  }
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// 最近接の偶数丸め
+uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+  bits &= 0x7FFFFFFF;
+  if (bits >= 0x7F800000) {
+    return uint16_t(sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 : 0));
+  }
+  // 65520以上は無限大に丸まる
+  if (bits >= 0x477FF000) {
+    return uint16_t(sign | 0x7C00);
+  }
+  if (bits < 0x38800000) {
+    // 2^-25より小さいものは0
+    if (bits < 0x33000000) {
+      return sign;
+    }
+    const uint32_t shift = 126 - (bits >> 23);
+    const uint32_t mantissa = (bits & 0x7FFFFF) | 0x800000;
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1) != 0)) {
+      ++half;
+    }
+    return uint16_t(sign | half);
+  }
+  uint32_t half = (bits - 0x38000000) >> 13;
+  const uint32_t remainder = bits & 0x1FFF;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0)) {
+    ++half;
+  }
+  return uint16_t(sign | half);
+}
+
+#pragma endregion
+
+#pragma region 行のデコードとエンコード
+
+// 1行を0~1(sRGBはリニア)のfloatにする
+void DecodeRow(const uint8_t *src, uint32_t width, const MipSettings &settings,
+               float *dst) {
+  const SrgbTables &tables = GetSrgbTables();
+  const size_t count = size_t(width) * GetChannelCount(settings.format);
+  if (settings.format == MipFormat::Rgba16Float) {
+    for (size_t i = 0; i < count; ++i) {
+      uint16_t half;
+      std::memcpy(&half, src + i * 2, sizeof(half));
+      dst[i] = HalfToFloat(half);
+    }
+  } else if (settings.format == MipFormat::Rgba8 && settings.isSrgb) {
+    for (size_t i = 0; i < count; i += 4) {
+      dst[i] = tables.decode[src[i]];
+      dst[i + 1] = tables.decode[src[i + 1]];
+      dst[i + 2] = tables.decode[src[i + 2]];
+      dst[i + 3] = tables.unorm[src[i + 3]];
+    }
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = tables.unorm[src[i]];
+    }
+  }
+}
+
+uint8_t EncodeUnorm8(float value) {
+  return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+uint8_t EncodeSrgb8(float value) {
+  const float index = std::clamp(value, 0.0f, 1.0f) * (kEncodeTableSize - 1);
+  return GetSrgbTables().encode[uint32_t(index + 0.5f)];
+}
+
+void EncodeRowScalar(const float *src, uint32_t width,
+                     const MipSettings &settings, uint8_t *dst) {
+  const size_t count = size_t(width) * GetChannelCount(settings.format);
+  if (settings.format == MipFormat::Rgba16Float) {
+    for (size_t i = 0; i < count; i += 4) {
+      // カイザーの負の部分で色が負にならないようにする。アルファは0~1
+      const uint16_t pixel[4] = {
+          FloatToHalf(std::max(src[i], 0.0f)),
+          FloatToHalf(std::max(src[i + 1], 0.0f)),
+          FloatToHalf(std::max(src[i + 2], 0.0f)),
+          FloatToHalf(std::clamp(src[i + 3], 0.0f, 1.0f))};
+      std::memcpy(dst + i * 2, pixel, sizeof(pixel));
+    }
+  } else if (settings.format == MipFormat::Rgba8 && settings.isSrgb) {
+    for (size_t i = 0; i < count; i += 4) {
+      dst[i] = EncodeSrgb8(src[i]);
+      dst[i + 1] = EncodeSrgb8(src[i + 1]);
+      dst[i + 2] = EncodeSrgb8(src[i + 2]);
+      dst[i + 3] = EncodeUnorm8(src[i + 3]);
+    }
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = EncodeUnorm8(src[i]);
+    }
+  }
+}
+
+#pragma endregion
+
+#pragma region スカラー
+
+// dst[i] = Σ weights[k] * rows[k][i]
+void AccumulateRowsScalar(const float *const *rows, const float *weights,
+                          uint32_t rowCount, size_t begin, size_t count,
+                          float *dst) {
+  for (size_t i = begin; i < count; ++i) {
+    float sum = weights[0] * rows[0][i];
+    for (uint32_t k = 1; k < rowCount; ++k) {
+      sum += weights[k] * rows[k][i];
+    }
+    dst[i] = sum;
+  }
+}
+
+// 横方向に縮める。dstの[begin, end)ピクセルを作る
+void FilterRowScalar(const float *src, uint32_t srcWidth, uint32_t channels,
+                     const FilterKernel &kernel, uint32_t begin, uint32_t end,
+                     float *dst) {
+  for (uint32_t x = begin; x < end; ++x) {
+    for (uint32_t c = 0; c < channels; ++c) {
+      float sum = 0.0f;
+      for (uint32_t k = 0; k < kernel.tapCount; ++k) {
+        const int32_t sx = std::clamp(int32_t(x * 2) + kernel.firstOffset +
+                                          int32_t(k),
+                                      0, int32_t(srcWidth) - 1);
+        sum += kernel.weights[k] * src[size_t(sx) * channels + c];
+      }
+      dst[size_t(x) * channels + c] = sum;
+    }
+  }
+}
+
+#pragma endregion
+
+#ifdef MIP_GENERATOR_X86
+#pragma region SSE
+
+void AccumulateRowsSse(const float *const *rows, const float *weights,
+                       uint32_t rowCount, size_t count, float *dst) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+    for (uint32_t k = 1; k < rowCount; ++k) {
+      sum = _mm_add_ps(
+          sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+    }
+    _mm_storeu_ps(dst + i, sum);
+  }
+  AccumulateRowsScalar(rows, weights, rowCount, i, count, dst);
+}
+
+// 4チャンネルは1ピクセルが1レジスタに収まる
+void FilterRow4Sse(const float *src, uint32_t srcWidth,
+                   const FilterKernel &kernel, uint32_t begin, uint32_t end,
+                   float *dst) {
+  for (uint32_t x = begin; x < end; ++x) {
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t k = 0; k < kernel.tapCount; ++k) {
+      const int32_t sx = std::clamp(int32_t(x * 2) + kernel.firstOffset +
+                                        int32_t(k),
+                                    0, int32_t(srcWidth) - 1);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[k]),
+                                       _mm_loadu_ps(src + size_t(sx) * 4)));
+    }
+    _mm_storeu_ps(dst + size_t(x) * 4, sum);
+  }
+}
+
+// 0~1を0~255に丸めて詰める。sRGBの色以外(アルファ、R8、RG8、リニアのRGBA)用
+void EncodeUnorm8RowSse(const float *src, size_t count, uint8_t *dst) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i words[4];
+    for (uint32_t j = 0; j < 4; ++j) {
+      const __m128 value =
+          _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + j * 4), zero), one);
+      words[j] =
+          _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+    }
+    const __m128i packed =
+        _mm_packus_epi16(_mm_packs_epi32(words[0], words[1]),
+                         _mm_packs_epi32(words[2], words[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+  }
+  for (; i < count; ++i) {
+    dst[i] = EncodeUnorm8(src[i]);
+  }
+}
+
+#pragma endregion
+
+#pragma region AVX
+
+MIP_GENERATOR_TARGET_AVX
+void AccumulateRowsAvx(const float *const *rows, const float *weights,
+                       uint32_t rowCount, size_t count, float *dst) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]),
+                               _mm256_loadu_ps(rows[0] + i));
+    for (uint32_t k = 1; k < rowCount; ++k) {
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]),
+                                             _mm256_loadu_ps(rows[k] + i)));
+    }
+    _mm256_storeu_ps(dst + i, sum);
+  }
+  AccumulateRowsScalar(rows, weights, rowCount, i, count, dst);
+  _mm256_zeroupper();
+}
+
+// 隣り合う2つの出力ピクセルを1レジスタで作る
+// 端をはみ出すところはSSEの方で繰り返しを処理する
+MIP_GENERATOR_TARGET_AVX
+void FilterRow4Avx(const float *src, uint32_t srcWidth,
+                   const FilterKernel &kernel, uint32_t dstWidth, float *dst) {
+  // 左端のタップが0以上になる最初の出力
+  const uint32_t first = uint32_t(std::max(0, -kernel.firstOffset) + 1) / 2;
+  uint32_t x = std::min(first, dstWidth);
+  FilterRow4Sse(src, srcWidth, kernel, 0, x, dst);
+  // 2つ目の出力の右端のタップが元の幅に収まる間
+  for (; x + 1 < dstWidth &&
+         int64_t(x + 1) * 2 + kernel.firstOffset + kernel.tapCount <=
+             int64_t(srcWidth);
+       x += 2) {
+    const float *base = src + (int64_t(x) * 2 + kernel.firstOffset) * 4;
+    __m256 sum = _mm256_setzero_ps();
+    for (uint32_t k = 0; k < kernel.tapCount; ++k) {
+      const __m256 pixels = _mm256_insertf128_ps(
+          _mm256_castps128_ps256(_mm_loadu_ps(base + k * 4)),
+          _mm_loadu_ps(base + k * 4 + 8), 1);
+      sum = _mm256_add_ps(
+          sum, _mm256_mul_ps(_mm256_set1_ps(kernel.weights[k]), pixels));
+    }
+    _mm256_storeu_ps(dst + size_t(x) * 4, sum);
+  }
+  _mm256_zeroupper();
+  FilterRow4Sse(src, srcWidth, kernel, x, dstWidth, dst);
+}
+
+#pragma endregion
+#endif
+
+void AccumulateRows(const float *const *rows, const float *weights,
+                    uint32_t rowCount, size_t count, float *dst,
+                    SimdLevel level) {
+#ifdef MIP_GENERATOR_X86
+  if (level == SimdLevel::Avx) {
+    AccumulateRowsAvx(rows, weights, rowCount, count, dst);
+    return;
+  }
+  if (level == SimdLevel::Sse) {
+    AccumulateRowsSse(rows, weights, rowCount, count, dst);
+    return;
+  }
+#endif
+  AccumulateRowsScalar(rows, weights, rowCount, 0, count, dst);
+}
+
+void FilterRow(const float *src, uint32_t srcWidth, uint32_t channels,
+               const FilterKernel &kernel, uint32_t dstWidth, float *dst,
+               SimdLevel level) {
+#ifdef MIP_GENERATOR_X86
+  if (channels == 4 && level == SimdLevel::Avx) {
+    FilterRow4Avx(src, srcWidth, kernel, dstWidth, dst);
+    return;
+  }
+  if (channels == 4 && level == SimdLevel::Sse) {
+    FilterRow4Sse(src, srcWidth, kernel, 0, dstWidth, dst);
+    return;
+  }
+#endif
+  FilterRowScalar(src, srcWidth, channels, kernel, 0, dstWidth, dst);
+}
+
+void EncodeRow(const float *src, uint32_t width, const MipSettings &settings,
+               uint8_t *dst, SimdLevel level) {
+#ifdef MIP_GENERATOR_X86
+  // sRGBは表を引くのでまとめられない。RGBAの色だけスカラーで上書きする
+  if (level != SimdLevel::Scalar && settings.format != MipFormat::Rgba16Float) {
+    EncodeUnorm8RowSse(src, size_t(width) * GetChannelCount(settings.format),
+                       dst);
+    if (settings.format == MipFormat::Rgba8 && settings.isSrgb) {
+      for (size_t i = 0; i < size_t(width) * 4; i += 4) {
+        dst[i] = EncodeSrgb8(src[i]);
+        dst[i + 1] = EncodeSrgb8(src[i + 1]);
+        dst[i + 2] = EncodeSrgb8(src[i + 2]);
+      }
+    }
+    return;
+  }
+#endif
+  EncodeRowScalar(src, width, settings, dst);
+}
+
+#pragma region アルファのカバレッジ
+
+std::vector<float> ReadAlphas(const MipImage &image, MipFormat format) {
+  std::vector<float> alphas(size_t(image.width) * image.height);
+  const SrgbTables &tables = GetSrgbTables();
+  for (uint32_t y = 0; y < image.height; ++y) {
+    const uint8_t *row = image.pixels + y * image.rowPitch;
+    float *dst = alphas.data() + size_t(y) * image.width;
+    for (uint32_t x = 0; x < image.width; ++x) {
+      if (format == MipFormat::Rgba16Float) {
+        uint16_t half;
+        std::memcpy(&half, row + x * 8 + 6, sizeof(half));
+        dst[x] = HalfToFloat(half);
+      } else {
+        dst[x] = tables.unorm[row[x * 4 + 3]];
+      }
+    }
+  }
+  return alphas;
+}
+
+// アルファをscale倍したときに、referenceを超えるピクセルの割合
+float ComputeAlphaCoverage(const std::vector<float> &alphas, float reference,
+                           float scale) {
+  size_t count = 0;
+  for (float alpha : alphas) {
+    count += std::min(alpha * scale, 1.0f) > reference ? 1 : 0;
+  }
+  return alphas.empty() ? 0.0f : float(count) / float(alphas.size());
+}
+
+void ScaleAlpha(const MipImage &image, MipFormat format, float scale) {
+  for (uint32_t y = 0; y < image.height; ++y) {
+    uint8_t *row = image.pixels + y * image.rowPitch;
+    for (uint32_t x = 0; x < image.width; ++x) {
+      if (format == MipFormat::Rgba16Float) {
+        uint16_t half;
+        std::memcpy(&half, row + x * 8 + 6, sizeof(half));
+        half = FloatToHalf(std::min(HalfToFloat(half) * scale, 1.0f));
+        std::memcpy(row + x * 8 + 6, &half, sizeof(half));
+      } else {
+        row[x * 4 + 3] =
+            uint8_t(std::min(row[x * 4 + 3] * scale, 255.0f) + 0.5f);
+      }
+    }
+  }
+}
+
+// 縮めると切り抜きの境目のアルファが平均されて閾値を下回り、形が痩せていく
+// 閾値を超える割合が元と同じになる倍率を二分探索で探してアルファに掛ける
+void PreserveAlphaCoverage(const MipImage &image, const MipSettings &settings,
+                           float targetCoverage) {
+  const std::vector<float> alphas = ReadAlphas(image, settings.format);
+  float low = 0.0f;
+  float high = kMaxAlphaScale;
+  for (uint32_t i = 0; i < 16; ++i) {
+    const float middle = (low + high) * 0.5f;
+    if (ComputeAlphaCoverage(alphas, settings.alphaCoverageReference,
+                             middle) < targetCoverage) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  // 割合は飛び飛びにしか変わらないので、近い方を選ぶ
+  const float lowError = std::abs(
+      ComputeAlphaCoverage(alphas, settings.alphaCoverageReference, low) -
+      targetCoverage);
+  const float highError = std::abs(
+      ComputeAlphaCoverage(alphas, settings.alphaCoverageReference, high) -
+      targetCoverage);
+  ScaleAlpha(image, settings.format, lowError < highError ? low : high);
+}
+
+#pragma endregion
+
+} // namespace
+
+const char *GetMipFilterName(MipFilter filter) {
+  return filter == MipFilter::Kaiser ? "kaiser" : "box";
+}
+
+bool ParseMipFilter(const std::string &name, MipFilter &filter) {
+  for (MipFilter candidate : {MipFilter::Box, MipFilter::Kaiser}) {
+    if (name == GetMipFilterName(candidate)) {
+      filter = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+  uint32_t size = std::max(width, height);
+  uint32_t count = 1;
+  while (size > 1) {
+    size >>= 1;
+    ++count;
+  }
+  return count;
+}
+
+void DownsampleMip(const MipImage &source, const MipImage &destination,
+                   const MipSettings &settings, uint32_t rowBegin,
+                   uint32_t rowEnd) {
+  rowEnd = std::min(rowEnd, destination.height);
+  if (rowBegin >= rowEnd) {
+    return;
+  }
+  const SimdLevel level = std::min(settings.simd, GetSupportedSimdLevel());
+  const FilterKernel &kernel = GetFilterKernel(settings.filter);
+  const uint32_t channels = GetChannelCount(settings.format);
+  const size_t sourceCount = size_t(source.width) * channels;
+
+  // デコードした元の行、縦にかけた結果、横にかけた結果
+  std::vector<float> buffer(sourceCount * (kCachedRows + 1) +
+                            size_t(destination.width) * channels);
+  float *cachedRows[kCachedRows];
+  int64_t cachedRowIndices[kCachedRows];
+  for (uint32_t i = 0; i < kCachedRows; ++i) {
+    cachedRows[i] = buffer.data() + sourceCount * i;
+    cachedRowIndices[i] = -1;
+  }
+  float *vertical = buffer.data() + sourceCount * kCachedRows;
+  float *horizontal = vertical + sourceCount;
+
+  for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+    // 隣の出力行とはタップが重なるので、デコードした行は使い回す
+    const float *rows[kMaxTaps];
+    for (uint32_t k = 0; k < kernel.tapCount; ++k) {
+      const int64_t sy =
+          std::clamp(int64_t(y) * 2 + kernel.firstOffset + int64_t(k),
+                     int64_t(0), int64_t(source.height) - 1);
+      const uint32_t slot = uint32_t(sy) % kCachedRows;
+      if (cachedRowIndices[slot] != sy) {
+        DecodeRow(source.pixels + size_t(sy) * source.rowPitch, source.width,
+                  settings, cachedRows[slot]);
+        cachedRowIndices[slot] = sy;
+      }
+      rows[k] = cachedRows[slot];
+    }
+    AccumulateRows(rows, kernel.weights, kernel.tapCount, sourceCount,
+                   vertical, level);
+    FilterRow(vertical, source.width, channels, kernel, destination.width,
+              horizontal, level);
+    EncodeRow(horizontal, destination.width, settings,
+              destination.pixels + size_t(y) * destination.rowPitch, level);
+  }
+}
+
+void GenerateMipChain(const MipImage *levels, uint32_t levelCount,
+                      const MipSettings &settings, ThreadPool *pool) {
+  const bool isCoveragePreserved =
+      settings.alphaCoverageReference > 0.0f && HasAlpha(settings.format);
+  const float targetCoverage =
+      isCoveragePreserved
+          ? ComputeAlphaCoverage(ReadAlphas(levels[0], settings.format),
+                                 settings.alphaCoverageReference, 1.0f)
+          : 0.0f;
+
+  for (uint32_t level = 1; level < levelCount; ++level) {
+    const MipImage &source = levels[level - 1];
+    const MipImage &destination = levels[level];
+    const uint32_t bandCount =
+        (destination.height + kRowsPerBand - 1) / kRowsPerBand;
+    // 小さいレベルは分けても待ち合わせの方が高くつく
+    if (pool == nullptr || bandCount <= 1) {
+      DownsampleMip(source, destination, settings, 0, destination.height);
+    } else {
+      pool->ParallelFor(bandCount, [&](uint32_t band) {
+        DownsampleMip(source, destination, settings, band * kRowsPerBand,
+                      (band + 1) * kRowsPerBand);
+      });
+    }
+    // 次のレベルは合わせた後のアルファから作る
+    if (isCoveragePreserved) {
+      PreserveAlphaCoverage(destination, settings, targetCoverage);
+    }
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "AudioMixKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class ThreadPool;
+
+// 1ピクセル4バイトの画像。RGBAでもBGRAでもよい(アルファは4バイト目)
+struct Rgba8Image {
+  uint8_t *pixels = nullptr;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  size_t rowPitch = 0;
+};
+
+// ミップを作れるピクセルの形式
+enum class MipFormat : uint8_t {
+  // 1ピクセル4バイト。RGBAでもBGRAでもよい(アルファは4バイト目)
+  Rgba8,
+  // 1チャンネル2バイトの半精度浮動小数点(R16G16B16A16_FLOAT)
+  Rgba16Float,
+  // 1チャンネル(マスクなど)
+  R8,
+  // 2チャンネル(法線マップのXYなど)
+  Rg8,
+};
+
+enum class MipFilter : uint8_t {
+  // 2x2の平均。一番速いが、遠くで少しぼける
+  Box,
+  // カイザー窓をかけたsincの6x6。シャープでちらつきにくい
+  Kaiser,
+};
+
+const char *GetMipFilterName(MipFilter filter);
+bool ParseMipFilter(const std::string &name, MipFilter &filter);
+
+struct MipSettings {
+  MipFormat format = MipFormat::Rgba8;
+  // Rgba8のRGBをsRGBとして扱う(リニアに直してからフィルターをかける)
+  bool isSrgb = false;
+  MipFilter filter = MipFilter::Box;
+  // 0より大きければ、アルファがこの値を超えるピクセルの割合をlevels[0]にそろえる
+  // 切り抜きのテクスチャ(葉や柵)が遠くで痩せて消えないようにする
+  float alphaCoverageReference = 0.0f;
+  SimdLevel simd = GetSupportedSimdLevel();
+};
+
+// 1つのミップレベル。ピクセルの並びはMipSettings::formatで決まる
+struct MipImage {
+  uint8_t *pixels = nullptr;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  size_t rowPitch = 0;
+};
+
+// 1x1までのミップの数(元の画像を含む)
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// sourceを縮めて、destinationの[rowBegin, rowEnd)行を作る
+// destinationの大きさはsourceの半分(最低1)。はみ出すタップは端のピクセルを繰り返す
+// sRGBの色は表でリニアに直してからフィルターをかけ、表でsRGBに戻す
+void DownsampleMip(const MipImage &source, const MipImage &destination,
+                   const MipSettings &settings, uint32_t rowBegin,
+                   uint32_t rowEnd);
+
+// levels[0]から順に、levels[1]からlevels[levelCount - 1]までを作る
+// poolを渡すと、大きいレベルは行をまとめた帯に分けて並列に作る
+void GenerateMipChain(const MipImage *levels, uint32_t levelCount,
+                      const MipSettings &settings, ThreadPool *pool = nullptr);
@@ -0,0 +1,541 @@
+#include "Model.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+#pragma region テキストの読み込み
+
+namespace {
+
+// textの先頭から1行取り出して進める。行末の改行(\r\nも)は含めない
+// lineはtextの中を指すだけでコピーしない
+bool ReadLine(std::string_view &text, std::string_view &line) {
+  if (text.empty()) {
+    return false;
+  }
+  size_t end = text.find('\n');
+  line = text.substr(0, end);
+  text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  return true;
+}
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// 空白を読み飛ばして、次の空白までを取り出して進める。なければ空を返す
+std::string_view ReadToken(std::string_view &line) {
+  size_t begin = 0;
+  while (begin < line.size() && IsSpace(line[begin])) {
+    ++begin;
+  }
+  size_t end = begin;
+  while (end < line.size() && !IsSpace(line[end])) {
+    ++end;
+  }
+  std::string_view token = line.substr(begin, end - begin);
+  line.remove_prefix(end);
+  return token;
+}
+
+// 次の語をfloatとして読む。語の全体が数でなければfalse
+bool ReadFloat(std::string_view &line, float &value) {
+  std::string_view token = ReadToken(line);
+  // from_charsは先頭の+を受け付けない
+  if (token.size() > 1 && token[0] == '+') {
+    token.remove_prefix(1);
+  }
+  const char *end = token.data() + token.size();
+  auto result = std::from_chars(token.data(), end, value);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+bool Fail(std::string *error, const std::string &message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+} // namespace
+
+#pragma endregion
+
+#pragma region MaterialTemplate関数
+bool TryLoadMaterialTemplateFile(const std::string &directoryPath,
+                                 const std::string &filename,
+                                 MaterialData &materialData,
+                                 std::string *error) {
+  materialData = {};
+  std::string_view line;
+  const std::string path = directoryPath + "/" + filename;
+  FileData file = VirtualFileSystem::GetInstance().ReadFile(path);
+  if (!file.IsValid()) {
+    return Fail(error, "failed to open " + path);
+  }
+
+  std::string_view text = file.GetText();
+  while (ReadLine(text, line)) {
+    std::string_view identifier = ReadToken(line);
+
+    if (identifier == "map_Kd") {
+      std::string_view textureFilename = ReadToken(line);
+      if (textureFilename.empty()) {
+        return Fail(error, "map_Kd without a file name in " + path);
+      }
+
+      materialData.textureFilePath =
+          directoryPath + "/" + std::string(textureFilename);
+    }
+  }
+  return true;
+}
+
+MaterialData LoadMaterialTemplateFile(const std::string &directoryPath,
+                                      const std::string &filename) {
+  MaterialData materialData;
+  std::string error;
+  if (!TryLoadMaterialTemplateFile(directoryPath, filename, materialData,
+                                   &error)) {
+    std::cerr << "Failed to load material: " << error << std::endl;
+    return {};
+  }
+  return materialData;
+}
+#pragma endregion
+
+#pragma region 多角形の三角形分割
+
+namespace {
+
+// 面の1頂点分のインデックス。0は省略されたもの
+struct FaceCorner {
+  int32_t position;
+  int32_t texcoord;
+  int32_t normal;
+};
+
+// "v", "v/vt", "v//vn", "v/vt/vn" のどれかを読む
+bool ParseFaceCorner(std::string_view vdef, FaceCorner &corner) {
+  corner = {};
+  int32_t *elements[3] = {&corner.position, &corner.texcoord, &corner.normal};
+  const char *p = vdef.data();
+  const char *end = p + vdef.size();
+
+  for (int32_t element = 0; element < 3; ++element) {
+    if (p < end && *p != '/') {
+      auto result = std::from_chars(p, end, *elements[element]);
+      if (result.ec != std::errc()) {
+        return false;
+      }
+      p = result.ptr;
+    }
+    if (p == end || *p != '/') {
+      break;
+    }
+    ++p;
+  }
+  return corner.position != 0;
+}
+
+// 1始まりのインデックスを0始まりにする。負の値は末尾からの相対指定
+// 範囲外なら-1を返す
+int64_t ResolveIndex(int32_t index, size_t count) {
+  if (index > 0 && size_t(index) <= count) {
+    return index - 1;
+  }
+  if (index < 0 && size_t(-int64_t(index)) <= count) {
+    return int64_t(count) + index;
+  }
+  return -1;
+}
+
+// 多角形の法線(Newell法)。凹多角形でも頂点の並びから向きが決まる
+Vector3 ComputePolygonNormal(const std::vector<VertexData> &polygon) {
+  Vector3 normal{0.0f, 0.0f, 0.0f};
+  for (size_t i = 0; i < polygon.size(); ++i) {
+    const Vector4 &current = polygon[i].position;
+    const Vector4 &next = polygon[(i + 1) % polygon.size()].position;
+    normal.x += (current.y - next.y) * (current.z + next.z);
+    normal.y += (current.z - next.z) * (current.x + next.x);
+    normal.z += (current.x - next.x) * (current.y + next.y);
+  }
+  return normal;
+}
+
+// 法線の一番大きい軸を捨てて2次元に落とした座標
+struct ProjectedPoint {
+  float u;
+  float v;
+};
+
+ProjectedPoint Project(const Vector4 &position, int32_t dropAxis) {
+  switch (dropAxis) {
+  case 0:
+    return {position.y, position.z};
+  case 1:
+    return {position.z, position.x};
+  default:
+    return {position.x, position.y};
+  }
+}
+
+float Cross2D(const ProjectedPoint &a, const ProjectedPoint &b,
+              const ProjectedPoint &c) {
+  return (b.u - a.u) * (c.v - a.v) - (b.v - a.v) * (c.u - a.u);
+}
+
+// 凸多角形かどうか。すべての角で曲がる向きが同じなら凸
+bool IsConvex(const std::vector<VertexData> &polygon, int32_t dropAxis,
+              float orientation) {
+  size_t count = polygon.size();
+  for (size_t i = 0; i < count; ++i) {
+    ProjectedPoint a = Project(polygon[i].position, dropAxis);
+    ProjectedPoint b = Project(polygon[(i + 1) % count].position, dropAxis);
+    ProjectedPoint c = Project(polygon[(i + 2) % count].position, dropAxis);
+    if (Cross2D(a, b, c) * orientation < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsInsideTriangle(const ProjectedPoint &p, const ProjectedPoint &a,
+                      const ProjectedPoint &b, const ProjectedPoint &c,
+                      float orientation) {
+  return Cross2D(a, b, p) * orientation > 0.0f &&
+         Cross2D(b, c, p) * orientation > 0.0f &&
+         Cross2D(c, a, p) * orientation > 0.0f;
+}
+
+// 耳を1つずつ切り取って三角形に分割する
+// remainingとtrianglesは作業用で、呼び出し側で使い回してメモリ確保を避ける
+void EarClip(const std::vector<VertexData> &polygon, int32_t dropAxis,
+             float orientation, std::vector<uint32_t> &remaining,
+             std::vector<uint32_t> &triangles) {
+  remaining.clear();
+  for (uint32_t i = 0; i < polygon.size(); ++i) {
+    remaining.push_back(i);
+  }
+
+  size_t start = 0;
+  while (remaining.size() > 3) {
+    size_t count = remaining.size();
+    bool isClipped = false;
+
+    for (size_t n = 0; n < count; ++n) {
+      size_t k = (start + n) % count;
+      uint32_t prev = remaining[(k + count - 1) % count];
+      uint32_t current = remaining[k];
+      uint32_t next = remaining[(k + 1) % count];
+
+      ProjectedPoint a = Project(polygon[prev].position, dropAxis);
+      ProjectedPoint b = Project(polygon[current].position, dropAxis);
+      ProjectedPoint c = Project(polygon[next].position, dropAxis);
+      if (Cross2D(a, b, c) * orientation <= 0.0f) {
+        // 凹んでいる角は耳にならない
+        continue;
+      }
+
+      bool isEar = true;
+      for (uint32_t other : remaining) {
+        if (other == prev || other == current || other == next) {
+          continue;
+        }
+        if (IsInsideTriangle(Project(polygon[other].position, dropAxis), a, b,
+                             c, orientation)) {
+          isEar = false;
+          break;
+        }
+      }
+      if (!isEar) {
+        continue;
+      }
+
+      triangles.push_back(prev);
+      triangles.push_back(current);
+      triangles.push_back(next);
+      remaining.erase(remaining.begin() + k);
+      start = k;
+      isClipped = true;
+      break;
+    }
+
+    if (!isClipped) {
+      // 自己交差などで耳が見つからないときは、そのまま切り取って先に進む
+      triangles.push_back(remaining[count - 1]);
+      triangles.push_back(remaining[0]);
+      triangles.push_back(remaining[1]);
+      remaining.erase(remaining.begin());
+      start = 0;
+    }
+  }
+
+  triangles.push_back(remaining[0]);
+  triangles.push_back(remaining[1]);
+  triangles.push_back(remaining[2]);
+}
+
+// 多角形を三角形に分割してtrianglesに頂点番号を3つずつ入れる
+// 三角形はそのまま、凸ならファン、凹なら耳切りで分割する
+void Triangulate(const std::vector<VertexData> &polygon, const Vector3 &normal,
+                 std::vector<uint32_t> &remaining,
+                 std::vector<uint32_t> &triangles) {
+  triangles.clear();
+  uint32_t count = uint32_t(polygon.size());
+
+  if (count > 3) {
+    float ax = std::fabs(normal.x);
+    float ay = std::fabs(normal.y);
+    float az = std::fabs(normal.z);
+    int32_t dropAxis = (ax >= ay && ax >= az) ? 0 : (ay >= az ? 1 : 2);
+    float axisValue = dropAxis == 0 ? normal.x
+                                    : (dropAxis == 1 ? normal.y : normal.z);
+    float orientation = axisValue >= 0.0f ? 1.0f : -1.0f;
+
+    if (!IsConvex(polygon, dropAxis, orientation)) {
+      EarClip(polygon, dropAxis, orientation, remaining, triangles);
+      return;
+    }
+  }
+
+  for (uint32_t i = 1; i + 1 < count; ++i) {
+    triangles.push_back(0);
+    triangles.push_back(i);
+    triangles.push_back(i + 1);
+  }
+}
+
+} // namespace
+
+#pragma endregion
+
+#pragma region Objファイルを読む関数
+
+bool TryLoadObjFile(const std::string &directoryPath,
+                    const std::string &filename, ModelData &modelData,
+                    std::string *error) {
+  modelData = {};
+  std::vector<Vector4> positions;
+  std::vector<Vector3> normals;
+  std::vector<Vector2> texcoords;
+
+  const std::string path = directoryPath + "/" + filename;
+  FileData file = VirtualFileSystem::GetInstance().ReadFile(path);
+  if (!file.IsValid()) {
+    return Fail(error, "failed to open " + path);
+  }
+
+  std::string_view line;
+  uint32_t lineNumber = 0;
+  const auto failAtLine = [&](const char *message) {
+    return Fail(error, path + ":" + std::to_string(lineNumber) + ": " +
+                           message);
+  };
+
+  // 面の読み込みで使う作業用の配列
+  std::vector<VertexData> polygon;
+  std::vector<uint32_t> remaining;
+  std::vector<uint32_t> triangles;
+
+  std::string_view text = file.GetText();
+  while (ReadLine(text, line)) {
+    ++lineNumber;
+    std::string_view identifier = ReadToken(line);
+
+    if (identifier == "v") {
+      Vector4 position{};
+
+      if (!ReadFloat(line, position.x) || !ReadFloat(line, position.y) ||
+          !ReadFloat(line, position.z)) {
+        return failAtLine("invalid vertex position");
+      }
+
+      position.w = 1.0f;
+      position.x *= -1.0f;
+      positions.push_back(position);
+
+    } else if (identifier == "vt") {
+      Vector2 texcoord{};
+      if (!ReadFloat(line, texcoord.x) || !ReadFloat(line, texcoord.y)) {
+        return failAtLine("invalid texture coordinate");
+      }
+
+      texcoord.y = 1.0f - texcoord.y;
+      texcoords.push_back(texcoord);
+
+    } else if (identifier == "vn") {
+
+      Vector3 normal{};
+
+      if (!ReadFloat(line, normal.x) || !ReadFloat(line, normal.y) ||
+          !ReadFloat(line, normal.z)) {
+        return failAtLine("invalid normal");
+      }
+      normal.x *= -1.0f;
+      normals.push_back(normal);
+
+    } else if (identifier == "f") {
+
+      // 多角形の頂点を集める。作業用の配列は面ごとに確保し直さない
+      polygon.clear();
+      bool hasNormal = true;
+
+      for (std::string_view vdef = ReadToken(line); !vdef.empty();
+           vdef = ReadToken(line)) {
+        FaceCorner corner;
+        if (!ParseFaceCorner(vdef, corner)) {
+          return failAtLine("invalid face");
+        }
+
+        int64_t positionIndex =
+            ResolveIndex(corner.position, positions.size());
+        int64_t texcoordIndex =
+            ResolveIndex(corner.texcoord, texcoords.size());
+        int64_t normalIndex =
+            ResolveIndex(corner.normal, normals.size());
+        // 書きかけのファイルでは、まだない頂点を指していることがある
+        if (positionIndex < 0 ||
+            (corner.texcoord != 0 && texcoordIndex < 0) ||
+            (corner.normal != 0 && normalIndex < 0)) {
+          return failAtLine("face index out of range");
+        }
+
+        VertexData vertex{};
+        vertex.position = positions[positionIndex];
+        if (texcoordIndex >= 0) {
+          vertex.texcoord = texcoords[texcoordIndex];
+        }
+        if (normalIndex >= 0) {
+          vertex.normal = normals[normalIndex];
+        } else {
+          hasNormal = false;
+        }
+        polygon.push_back(vertex);
+      }
+
+      if (polygon.size() < 3) {
+        continue;
+      }
+
+      Vector3 polygonNormal = ComputePolygonNormal(polygon);
+
+      if (!hasNormal) {
+        // 法線がない面は面法線を使う
+        // X軸を反転しているので頂点の並びが逆になり、Newellの向きも逆になる
+        float length = std::sqrt(polygonNormal.x * polygonNormal.x +
+                                 polygonNormal.y * polygonNormal.y +
+                                 polygonNormal.z * polygonNormal.z);
+        Vector3 faceNormal{0.0f, 0.0f, 0.0f};
+        if (length > 0.0f) {
+          faceNormal = {-polygonNormal.x / length, -polygonNormal.y / length,
+                        -polygonNormal.z / length};
+        }
+        for (VertexData &vertex : polygon) {
+          vertex.normal = faceNormal;
+        }
+      }
+
+      Triangulate(polygon, polygonNormal, remaining, triangles);
+
+      // X軸を反転しているので、三角形の頂点は逆順に入れる
+      for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+        modelData.vertices.push_back(polygon[triangles[i + 2]]);
+        modelData.vertices.push_back(polygon[triangles[i + 1]]);
+        modelData.vertices.push_back(polygon[triangles[i]]);
+      }
+
+    } else if (identifier == "mtllib") {
+      std::string_view materialFilename = ReadToken(line);
+      if (materialFilename.empty()) {
+        return failAtLine("mtllib without a file name");
+      }
+
+      if (!TryLoadMaterialTemplateFile(directoryPath,
+                                       std::string(materialFilename),
+                                       modelData.material, error)) {
+        return false;
+      }
+    }
+  }
+  if (modelData.vertices.empty()) {
+    return Fail(error, "no faces in " + path);
+  }
+
+  for (const VertexData &vertex : modelData.vertices) {
+    const Vector4 &p = vertex.position;
+    modelData.boundingRadius =
+        std::max(modelData.boundingRadius,
+                 std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z));
+  }
+  return true;
+}
+
+ModelData LoadObjFile(const std::string &directoryPath,
+                      const std::string &filename) {
+  ModelData modelData;
+  std::string error;
+  if (!TryLoadObjFile(directoryPath, filename, modelData, &error)) {
+    std::cerr << "Failed to load OBJ file: " << error << std::endl;
+    return {};
+  }
+  return modelData;
+}
+
+#pragma endregion
+
+#pragma region Objファイルを共有して読む関数
+
+namespace {
+
+size_t GetModelDataSize(const ModelData &modelData) {
+  return sizeof(ModelData) +
+         modelData.vertices.capacity() * sizeof(VertexData) +
+         modelData.material.textureFilePath.capacity();
+}
+
+} // namespace
+
+AssetRegistry::Handle<ModelData>
+AcquireObjFile(const std::string &directoryPath, const std::string &filename) {
+  return AssetRegistry::GetInstance().Acquire<ModelData>(
+      AssetType::Model, directoryPath + "/" + filename,
+      [&](ModelData &modelData) {
+        std::string error;
+        if (!TryLoadObjFile(directoryPath, filename, modelData, &error)) {
+          std::cerr << "Failed to load OBJ file: " << error << std::endl;
+          return false;
+        }
+        return true;
+      },
+      GetModelDataSize);
+}
+
+AssetRegistry::Handle<ModelData>
+ReloadObjFile(const std::string &directoryPath, const std::string &filename,
+              std::string *error) {
+  // 先に読んでみて、読めたときだけ古い登録を外す
+  ModelData modelData;
+  if (!TryLoadObjFile(directoryPath, filename, modelData, error)) {
+    return nullptr;
+  }
+  const std::string path = directoryPath + "/" + filename;
+  AssetRegistry &registry = AssetRegistry::GetInstance();
+  registry.Invalidate(AssetType::Model, path);
+  return registry.Acquire<ModelData>(
+      AssetType::Model, path,
+      [&](ModelData &loaded) {
+        loaded = std::move(modelData);
+        return true;
+      },
+      GetModelDataSize);
+}
+
+#pragma endregion
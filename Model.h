@@ -0,0 +1,68 @@
+#pragma once
+#include "AssetRegistry.h"
+#include "Math.h"
+#include <string>
+#include <vector>
+
+#pragma region 構造体
+struct VertexData {
+  Vector4 position;
+  Vector2 texcoord;
+  Vector3 normal;
+
+  bool operator<(const VertexData &other) const {
+    if (position != other.position)
+      return position < other.position;
+    if (texcoord != other.texcoord)
+      return texcoord < other.texcoord;
+    if (normal != other.normal)
+      return normal < other.normal;
+    return false;
+  }
+};
+
+struct MaterialData {
+  std::string textureFilePath;
+};
+
+struct ModelData {
+  std::vector<VertexData> vertices;
+  MaterialData material;
+  // 原点を中心にすべての頂点を含む球の半径(テクスチャのミップの見積もりに使う)
+  float boundingRadius = 0.0f;
+};
+
+#pragma endregion
+
+#pragma region 関数
+
+// 読めなければ空のデータを返す
+MaterialData LoadMaterialTemplateFile(const std::string &directoryPath,
+                                      const std::string &filename);
+
+ModelData LoadObjFile(const std::string &directoryPath,
+                      const std::string &filename);
+
+// 読めないときや壊れているときはfalseを返し、errorに理由を入れる
+// 書きかけのファイルを読んでも止まらないので、ホットリロードではこちらを使う
+bool TryLoadMaterialTemplateFile(const std::string &directoryPath,
+                                 const std::string &filename,
+                                 MaterialData &materialData,
+                                 std::string *error = nullptr);
+
+bool TryLoadObjFile(const std::string &directoryPath,
+                    const std::string &filename, ModelData &modelData,
+                    std::string *error = nullptr);
+
+// AssetRegistry経由で読み込む。同じファイルは一度だけ読み込まれて共有される
+// 読めなければ登録せずにnullptrを返す
+AssetRegistry::Handle<ModelData>
+AcquireObjFile(const std::string &directoryPath, const std::string &filename);
+
+// 読み直して登録し直す(ホットリロード用)
+// 読めなければ登録は古いまま残してnullptrを返す
+AssetRegistry::Handle<ModelData>
+ReloadObjFile(const std::string &directoryPath, const std::string &filename,
+              std::string *error = nullptr);
+
+#pragma endregion
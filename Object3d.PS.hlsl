@@ -4,6 +4,8 @@ struct Material
 {
     float32_t4 color;
     int32_t enableLighting;
+    // gTexturesの何番目を使うか
+    int32_t textureIndex;
     float32_t4x4 uvTransform;
     
 };
@@ -17,7 +19,13 @@ struct DirectionalLight
 };
 
 ConstantBuffer<Material> gMaterial : register(b0);
-Texture2D<float32_t4> gTexture : register(t0);
+// マテリアルのテクスチャの表。マテリアルが持つ番号で引く
+// 大きさを決めない表を使えないTier1では、ルートシグネチャの範囲と同じ数をホストが渡す
+#ifdef MATERIAL_TEXTURE_COUNT
+Texture2D<float32_t4> gTextures[MATERIAL_TEXTURE_COUNT] : register(t0);
+#else
+Texture2D<float32_t4> gTextures[] : register(t0);
+#endif
 SamplerState gSampler : register(s0);
 ConstantBuffer<DirectionalLight> gDirectionalLight : register(b2);
 
@@ -31,7 +39,9 @@ PixelShaderOutput main(VertexShaderOutput input)
     PixelShaderOutput output;
    
     float4 transformedUV = mul(float32_t4(input.texcoord, 0.0f, 1.0f), gMaterial.uvTransform);
-    float32_t4 textureColor = gTexture.Sample(gSampler, transformedUV.xy);
+    // 番号は描画ごとの定数なので、波の中で揃っている
+    // インスタンスごとに番号を変えるときはNonUniformResourceIndexで囲む
+    float32_t4 textureColor = gTextures[gMaterial.textureIndex].Sample(gSampler, transformedUV.xy);
     
     if (gMaterial.enableLighting != 0)
     {
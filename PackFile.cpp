@@ -0,0 +1,151 @@
+#include "PackFile.h"
+#include "LzCompression.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+char ToLowerAscii(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (ToLowerAscii(a[i]) != ToLowerAscii(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+uint64_t HashPackName(std::string_view name) {
+  // FNV-1a
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (char c : name) {
+    hash ^= uint8_t(ToLowerAscii(c));
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+bool PackFile::Open(const std::string &path) {
+  auto file = std::make_shared<MappedFile>();
+  if (!file->Open(path) || file->GetSize() < sizeof(PackHeader)) {
+    return false;
+  }
+
+  const uint8_t *data = file->GetData();
+  const uint64_t fileSize = file->GetSize();
+  PackHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kPackMagic, sizeof(kPackMagic)) != 0 ||
+      header.version != kPackVersion || header.blockSize == 0) {
+    return false;
+  }
+
+  // エントリの表はマップしたメモリをそのまま参照するので、配置も確かめる
+  if (header.entryOffset % alignof(PackEntry) != 0 ||
+      header.entryOffset > fileSize ||
+      uint64_t(header.entryCount) >
+          (fileSize - header.entryOffset) / sizeof(PackEntry) ||
+      header.nameOffset > fileSize) {
+    return false;
+  }
+
+  const PackEntry *entries =
+      reinterpret_cast<const PackEntry *>(data + header.entryOffset);
+  const uint64_t nameAreaSize = fileSize - header.nameOffset;
+  for (uint32_t i = 0; i < header.entryCount; ++i) {
+    const PackEntry &entry = entries[i];
+    if (uint64_t(entry.nameOffset) + entry.nameLength > nameAreaSize ||
+        entry.dataOffset > fileSize ||
+        entry.storedSize > fileSize - entry.dataOffset) {
+      return false;
+    }
+    if (!(entry.flags & kPackEntryCompressed) &&
+        entry.storedSize != entry.size) {
+      return false;
+    }
+  }
+
+  file_ = std::move(file);
+  header_ = header;
+  entries_ = entries;
+  names_ = reinterpret_cast<const char *>(data + header.nameOffset);
+  return true;
+}
+
+std::string_view PackFile::GetEntryName(uint32_t index) const {
+  const PackEntry &entry = entries_[index];
+  return std::string_view(names_ + entry.nameOffset, entry.nameLength);
+}
+
+const PackEntry *PackFile::FindEntry(std::string_view name) const {
+  if (entries_ == nullptr) {
+    return nullptr;
+  }
+
+  const uint64_t hash = HashPackName(name);
+  const PackEntry *end = entries_ + header_.entryCount;
+  const PackEntry *it = std::lower_bound(
+      entries_, end, hash,
+      [](const PackEntry &entry, uint64_t h) { return entry.nameHash < h; });
+
+  // ハッシュが衝突していることもあるので名前も比べる
+  for (; it != end && it->nameHash == hash; ++it) {
+    if (EqualsIgnoreCase(
+            std::string_view(names_ + it->nameOffset, it->nameLength), name)) {
+      return it;
+    }
+  }
+  return nullptr;
+}
+
+FileData PackFile::Read(std::string_view name) const {
+  const PackEntry *entry = FindEntry(name);
+  if (entry == nullptr) {
+    return {};
+  }
+
+  const uint8_t *stored = file_->GetData() + entry->dataOffset;
+  if (!(entry->flags & kPackEntryCompressed)) {
+    return {stored, size_t(entry->size), file_};
+  }
+
+  // ブロックごとの格納サイズの表を確かめてから展開する
+  const uint64_t blockSize = header_.blockSize;
+  const uint64_t blockCount = (entry->size + blockSize - 1) / blockSize;
+  const uint64_t tableSize = blockCount * sizeof(uint32_t);
+  if (entry->blockCount != blockCount || tableSize > entry->storedSize) {
+    return {};
+  }
+
+  auto buffer = std::make_shared<std::vector<uint8_t>>(size_t(entry->size));
+  const uint8_t *src = stored + tableSize;
+  const uint8_t *srcEnd = stored + entry->storedSize;
+  for (uint64_t i = 0; i < blockCount; ++i) {
+    uint32_t storedBlockSize;
+    std::memcpy(&storedBlockSize, stored + i * sizeof(uint32_t),
+                sizeof(storedBlockSize));
+    const uint64_t offset = i * blockSize;
+    const size_t rawBlockSize =
+        size_t(std::min(blockSize, entry->size - offset));
+    if (storedBlockSize > uint64_t(srcEnd - src)) {
+      return {};
+    }
+
+    uint8_t *dst = buffer->data() + offset;
+    if (storedBlockSize == rawBlockSize) {
+      std::memcpy(dst, src, rawBlockSize);
+    } else if (!LzDecompress(src, storedBlockSize, dst, rawBlockSize)) {
+      return {};
+    }
+    src += storedBlockSize;
+  }
+
+  const uint8_t *data = buffer->data();
+  return {data, buffer->size(), std::move(buffer)};
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma region パックファイルの形式
+
+// ファイルの並び
+//   PackHeader
+//   各エントリのデータ(alignmentごとに揃える)
+//   PackEntry[entryCount](nameHashの昇順)
+//   名前の文字列(終端なし)
+//
+// 圧縮されたエントリのデータは、ブロックごとの格納サイズの表
+// (uint32_t[blockCount])と各ブロックの並び。格納サイズが元のブロックの
+// サイズと同じなら、そのブロックは圧縮せずに入っている
+const char kPackMagic[4] = {'P', 'A', 'C', 'K'};
+const uint32_t kPackVersion = 1;
+
+enum PackEntryFlags : uint32_t {
+  kPackEntryCompressed = 1 << 0,
+};
+
+struct PackHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  // 圧縮の単位。展開はブロックごとに独立して行える
+  uint32_t blockSize;
+  uint64_t entryOffset;
+  uint64_t nameOffset;
+};
+
+struct PackEntry {
+  uint64_t nameHash;
+  uint32_t nameOffset;
+  uint32_t nameLength;
+  uint64_t dataOffset;
+  // 展開後のサイズ
+  uint64_t size;
+  // パック内で占めるサイズ
+  uint64_t storedSize;
+  uint32_t flags;
+  uint32_t blockCount;
+};
+
+// 名前は'/'区切りで、大文字小文字を区別しない
+uint64_t HashPackName(std::string_view name);
+
+#pragma endregion
+
+// メモリマップしたパックファイルからエントリを読むクラス
+class PackFile {
+public:
+  bool Open(const std::string &path);
+
+  bool Contains(std::string_view name) const {
+    return FindEntry(name) != nullptr;
+  }
+
+  // 圧縮されていないエントリはマップしたメモリをそのまま返す
+  // 見つからないか壊れていたら無効なFileDataを返す
+  FileData Read(std::string_view name) const;
+
+  uint32_t GetEntryCount() const { return header_.entryCount; }
+  std::string_view GetEntryName(uint32_t index) const;
+
+private:
+  const PackEntry *FindEntry(std::string_view name) const;
+
+  std::shared_ptr<MappedFile> file_;
+  PackHeader header_{};
+  const PackEntry *entries_ = nullptr;
+  const char *names_ = nullptr;
+};
@@ -0,0 +1,803 @@
+#include "PcmConvert.h"
+#include "RiffReader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#define AUDIO_MIX_X86 1
+#include <immintrin.h>
+#endif
+
+// AVXが使えるCPUならSSSE3(pshufb)も使える。GCC/Clangは関数ごとに許可する
+#if defined(AUDIO_MIX_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AUDIO_MIX_TARGET_AVX __attribute__((target("avx")))
+#else
+#define AUDIO_MIX_TARGET_AVX
+#endif
+
+namespace {
+
+constexpr float kInt8Scale = 1.0f / 128.0f;
+constexpr float kInt16Scale = 1.0f / 32768.0f;
+constexpr float kInt24Scale = 1.0f / 8388608.0f;
+constexpr float kInt32Scale = 1.0f / 2147483648.0f;
+// 1.0を2^31倍するとint32に収まらないので、floatで表せる1未満の最大値で止める
+constexpr float kInt32Limit = 2147483520.0f / 2147483648.0f;
+
+#pragma region スカラー
+
+int32_t LoadInt24(const uint8_t *p) {
+  // 上位24ビットに置いてから算術シフトで符号を広げる
+  return int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 |
+                 uint32_t(p[2]) << 24) >>
+         8;
+}
+
+void StoreInt24(uint8_t *p, int32_t value) {
+  p[0] = uint8_t(value);
+  p[1] = uint8_t(value >> 8);
+  p[2] = uint8_t(value >> 16);
+}
+
+// -1～upperに収める。NaNは無音にする(SIMD版も同じ)
+float ClampSample(float sample, float upper = 1.0f) {
+  return std::isnan(sample) ? 0.0f : std::clamp(sample, -1.0f, upper);
+}
+
+// SIMD版(cvtps2dq)と同じく、偶数への丸めを使う
+int32_t QuantizeSample(float sample, float scale, int32_t lower,
+                       int32_t upper) {
+  const float scaled = ClampSample(sample) * scale;
+  return std::clamp(int32_t(std::lrint(scaled)), lower, upper);
+}
+
+void ToFloatScalar(PcmFormat format, const uint8_t *src, float *dst,
+                   size_t count) {
+  switch (format) {
+  case PcmFormat::UInt8:
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = (int32_t(src[i]) - 128) * kInt8Scale;
+    }
+    break;
+  case PcmFormat::Int16:
+    for (size_t i = 0; i < count; ++i) {
+      int16_t value;
+      std::memcpy(&value, src + i * 2, sizeof(value));
+      dst[i] = value * kInt16Scale;
+    }
+    break;
+  case PcmFormat::Int24:
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = LoadInt24(src + i * 3) * kInt24Scale;
+    }
+    break;
+  case PcmFormat::Int32:
+    for (size_t i = 0; i < count; ++i) {
+      int32_t value;
+      std::memcpy(&value, src + i * 4, sizeof(value));
+      dst[i] = float(value) * kInt32Scale;
+    }
+    break;
+  case PcmFormat::Float32:
+    std::memcpy(dst, src, count * sizeof(float));
+    break;
+  }
+}
+
+void FromFloatScalar(PcmFormat format, const float *src, uint8_t *dst,
+                     size_t count) {
+  switch (format) {
+  case PcmFormat::UInt8:
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = uint8_t(QuantizeSample(src[i], 128.0f, -128, 127) + 128);
+    }
+    break;
+  case PcmFormat::Int16:
+    for (size_t i = 0; i < count; ++i) {
+      const int16_t value =
+          int16_t(QuantizeSample(src[i], 32768.0f, -32768, 32767));
+      std::memcpy(dst + i * 2, &value, sizeof(value));
+    }
+    break;
+  case PcmFormat::Int24:
+    for (size_t i = 0; i < count; ++i) {
+      StoreInt24(dst + i * 3,
+                 QuantizeSample(src[i], 8388608.0f, -8388608, 8388607));
+    }
+    break;
+  case PcmFormat::Int32:
+    for (size_t i = 0; i < count; ++i) {
+      const float scaled = ClampSample(src[i], kInt32Limit) * 2147483648.0f;
+      const int32_t value = int32_t(std::lrint(scaled));
+      std::memcpy(dst + i * 4, &value, sizeof(value));
+    }
+    break;
+  case PcmFormat::Float32:
+    // floatのままでも、整数の形式と同じく範囲外は収める
+    for (size_t i = 0; i < count; ++i) {
+      const float value = ClampSample(src[i]);
+      std::memcpy(dst + i * 4, &value, sizeof(value));
+    }
+    break;
+  }
+}
+
+void DeinterleaveScalar(const float *src, uint32_t channels, float *const *dst,
+                        size_t frames) {
+  for (size_t i = 0; i < frames; ++i) {
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+      dst[channel][i] = src[i * channels + channel];
+    }
+  }
+}
+
+void InterleaveScalar(const float *const *src, uint32_t channels, float *dst,
+                      size_t frames) {
+  for (size_t i = 0; i < frames; ++i) {
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+      dst[i * channels + channel] = src[channel][i];
+    }
+  }
+}
+
+#pragma endregion
+
+#ifdef AUDIO_MIX_X86
+
+#pragma region SSE
+
+// 8bit/16bit/32bitはSSE2だけで変換できる。24bitはスカラーで変換する
+void ToFloatSse(PcmFormat format, const uint8_t *src, float *dst,
+                size_t count) {
+  size_t i = 0;
+  switch (format) {
+  case PcmFormat::UInt8: {
+    const __m128i bias = _mm_set1_epi8(char(0x80));
+    const __m128 scale = _mm_set1_ps(kInt8Scale);
+    for (; i + 16 <= count; i += 16) {
+      // 符号なしを符号付きにしてから、上位に置いて算術シフトで広げる
+      const __m128i v = _mm_xor_si128(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), bias);
+      const __m128i words[2] = {
+          _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8),
+          _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8)};
+      for (int half = 0; half < 2; ++half) {
+        const __m128i w = words[half];
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16);
+        _mm_storeu_ps(dst + i + half * 8,
+                      _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + half * 8 + 4,
+                      _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+      }
+    }
+    break;
+  }
+  case PcmFormat::Int16: {
+    const __m128 scale = _mm_set1_ps(kInt16Scale);
+    for (; i + 8 <= count; i += 8) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+      const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    break;
+  }
+  case PcmFormat::Int32: {
+    const __m128 scale = _mm_set1_ps(kInt32Scale);
+    for (; i + 4 <= count; i += 4) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  const size_t sampleBytes = GetPcmSampleBytes(format);
+  ToFloatScalar(format, src + i * sampleBytes, dst + i, count - i);
+}
+
+// -1～upperに収める。NaNはcmpordのマスクで0にしてからmax/minに通す
+// (maxpsはNaNのとき2つ目を返すので、そのままだと-1になりスカラー版とずれる)
+__m128 ClampSampleSse(__m128 v, __m128 lower, __m128 upper) {
+  v = _mm_and_ps(v, _mm_cmpord_ps(v, v));
+  return _mm_min_ps(_mm_max_ps(v, lower), upper);
+}
+
+void FromFloatSse(PcmFormat format, const float *src, uint8_t *dst,
+                  size_t count) {
+  const __m128 lower = _mm_set1_ps(-1.0f);
+  const __m128 upper = _mm_set1_ps(1.0f);
+  size_t i = 0;
+  switch (format) {
+  case PcmFormat::UInt8: {
+    // 128倍した+1.0はpacksで127に飽和する
+    const __m128 scale = _mm_set1_ps(128.0f);
+    const __m128i bias = _mm_set1_epi8(char(0x80));
+    for (; i + 16 <= count; i += 16) {
+      __m128i words[4];
+      for (int part = 0; part < 4; ++part) {
+        const __m128 v =
+            ClampSampleSse(_mm_loadu_ps(src + i + part * 4), lower, upper);
+        words[part] = _mm_cvtps_epi32(_mm_mul_ps(v, scale));
+      }
+      const __m128i packed =
+          _mm_packs_epi16(_mm_packs_epi32(words[0], words[1]),
+                          _mm_packs_epi32(words[2], words[3]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                       _mm_xor_si128(packed, bias));
+    }
+    break;
+  }
+  case PcmFormat::Int16: {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    for (; i + 8 <= count; i += 8) {
+      const __m128 a = ClampSampleSse(_mm_loadu_ps(src + i), lower, upper);
+      const __m128 b = ClampSampleSse(_mm_loadu_ps(src + i + 4), lower, upper);
+      const __m128i packed =
+          _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)),
+                          _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), packed);
+    }
+    break;
+  }
+  case PcmFormat::Int32: {
+    const __m128 limit = _mm_set1_ps(kInt32Limit);
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    for (; i + 4 <= count; i += 4) {
+      const __m128 v = ClampSampleSse(_mm_loadu_ps(src + i), lower, limit);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+                       _mm_cvtps_epi32(_mm_mul_ps(v, scale)));
+    }
+    break;
+  }
+  case PcmFormat::Float32:
+    for (; i + 4 <= count; i += 4) {
+      _mm_storeu_ps(reinterpret_cast<float *>(dst + i * 4),
+                    ClampSampleSse(_mm_loadu_ps(src + i), lower, upper));
+    }
+    break;
+  default:
+    break;
+  }
+  const size_t sampleBytes = GetPcmSampleBytes(format);
+  FromFloatScalar(format, src + i, dst + i * sampleBytes, count - i);
+}
+
+void DeinterleaveSse(const float *src, uint32_t channels, float *const *dst,
+                     size_t frames) {
+  if (channels != 2) {
+    DeinterleaveScalar(src, channels, dst, frames);
+    return;
+  }
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    const __m128 a = _mm_loadu_ps(src + i * 2);
+    const __m128 b = _mm_loadu_ps(src + i * 2 + 4);
+    _mm_storeu_ps(dst[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(dst[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  float *const rest[2] = {dst[0] + i, dst[1] + i};
+  DeinterleaveScalar(src + i * 2, 2, rest, frames - i);
+}
+
+void InterleaveSse(const float *const *src, uint32_t channels, float *dst,
+                   size_t frames) {
+  if (channels != 2) {
+    InterleaveScalar(src, channels, dst, frames);
+    return;
+  }
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    const __m128 l = _mm_loadu_ps(src[0] + i);
+    const __m128 r = _mm_loadu_ps(src[1] + i);
+    _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+  }
+  const float *const rest[2] = {src[0] + i, src[1] + i};
+  InterleaveScalar(rest, 2, dst + i * 2, frames - i);
+}
+
+#pragma endregion
+
+#pragma region AVX
+
+AUDIO_MIX_TARGET_AVX
+__m256 Int16ToFloatAvx(__m128i v, __m256 scale) {
+  const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+  const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+  const __m256i wide =
+      _mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1);
+  return _mm256_mul_ps(_mm256_cvtepi32_ps(wide), scale);
+}
+
+AUDIO_MIX_TARGET_AVX
+void ToFloatAvx(PcmFormat format, const uint8_t *src, float *dst,
+                size_t count) {
+  size_t i = 0;
+  switch (format) {
+  case PcmFormat::Int16: {
+    const __m256 scale = _mm256_set1_ps(kInt16Scale);
+    for (; i + 16 <= count; i += 16) {
+      const __m128i *p = reinterpret_cast<const __m128i *>(src + i * 2);
+      _mm256_storeu_ps(dst + i, Int16ToFloatAvx(_mm_loadu_si128(p), scale));
+      _mm256_storeu_ps(dst + i + 8,
+                       Int16ToFloatAvx(_mm_loadu_si128(p + 1), scale));
+    }
+    break;
+  }
+  case PcmFormat::Int24: {
+    // 3バイトずつを各32ビットの上位に並べ、算術シフトで符号を広げる
+    const __m128i shuffle =
+        _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m256 scale = _mm256_set1_ps(kInt24Scale);
+    // 16バイト読むので、最後の読み込みが末尾を越えないところまで
+    for (; i + 8 + 2 <= count; i += 8) {
+      const uint8_t *p = src + i * 3;
+      const __m128i a = _mm_srai_epi32(
+          _mm_shuffle_epi8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), shuffle),
+          8);
+      const __m128i b = _mm_srai_epi32(
+          _mm_shuffle_epi8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)),
+              shuffle),
+          8);
+      const __m256i wide =
+          _mm256_insertf128_si256(_mm256_castsi128_si256(a), b, 1);
+      _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(wide), scale));
+    }
+    break;
+  }
+  case PcmFormat::Int32: {
+    const __m256 scale = _mm256_set1_ps(kInt32Scale);
+    for (; i + 8 <= count; i += 8) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+      _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  const size_t sampleBytes = GetPcmSampleBytes(format);
+  ToFloatSse(format, src + i * sampleBytes, dst + i, count - i);
+}
+
+AUDIO_MIX_TARGET_AVX
+__m256 ClampSampleAvx(__m256 v, __m256 lower, __m256 upper) {
+  v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+  return _mm256_min_ps(_mm256_max_ps(v, lower), upper);
+}
+
+AUDIO_MIX_TARGET_AVX
+void FromFloatAvx(PcmFormat format, const float *src, uint8_t *dst,
+                  size_t count) {
+  const __m256 lower = _mm256_set1_ps(-1.0f);
+  const __m256 upper = _mm256_set1_ps(1.0f);
+  size_t i = 0;
+  switch (format) {
+  case PcmFormat::Int16: {
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    for (; i + 8 <= count; i += 8) {
+      const __m256 v = ClampSampleAvx(_mm256_loadu_ps(src + i), lower, upper);
+      const __m256i words = _mm256_cvtps_epi32(_mm256_mul_ps(v, scale));
+      const __m128i packed =
+          _mm_packs_epi32(_mm256_castsi256_si128(words),
+                          _mm256_extractf128_si256(words, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), packed);
+    }
+    break;
+  }
+  case PcmFormat::Int32: {
+    const __m256 limit = _mm256_set1_ps(kInt32Limit);
+    const __m256 scale = _mm256_set1_ps(2147483648.0f);
+    for (; i + 8 <= count; i += 8) {
+      const __m256 v = ClampSampleAvx(_mm256_loadu_ps(src + i), lower, limit);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4),
+                          _mm256_cvtps_epi32(_mm256_mul_ps(v, scale)));
+    }
+    break;
+  }
+  case PcmFormat::Float32:
+    for (; i + 8 <= count; i += 8) {
+      _mm256_storeu_ps(reinterpret_cast<float *>(dst + i * 4),
+                       ClampSampleAvx(_mm256_loadu_ps(src + i), lower, upper));
+    }
+    break;
+  default:
+    break;
+  }
+  const size_t sampleBytes = GetPcmSampleBytes(format);
+  FromFloatSse(format, src + i, dst + i * sampleBytes, count - i);
+}
+
+AUDIO_MIX_TARGET_AVX
+void DeinterleaveAvx(const float *src, uint32_t channels, float *const *dst,
+                     size_t frames) {
+  if (channels != 2) {
+    DeinterleaveScalar(src, channels, dst, frames);
+    return;
+  }
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    const __m256 a = _mm256_loadu_ps(src + i * 2);
+    const __m256 b = _mm256_loadu_ps(src + i * 2 + 8);
+    // shuffleは128ビットごとに動くので、先に前半同士・後半同士を並べる
+    const __m256 first = _mm256_permute2f128_ps(a, b, 0x20);
+    const __m256 second = _mm256_permute2f128_ps(a, b, 0x31);
+    _mm256_storeu_ps(dst[0] + i, _mm256_shuffle_ps(first, second,
+                                                   _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm256_storeu_ps(dst[1] + i, _mm256_shuffle_ps(first, second,
+                                                   _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  float *const rest[2] = {dst[0] + i, dst[1] + i};
+  DeinterleaveSse(src + i * 2, 2, rest, frames - i);
+}
+
+AUDIO_MIX_TARGET_AVX
+void InterleaveAvx(const float *const *src, uint32_t channels, float *dst,
+                   size_t frames) {
+  if (channels != 2) {
+    InterleaveScalar(src, channels, dst, frames);
+    return;
+  }
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    const __m256 l = _mm256_loadu_ps(src[0] + i);
+    const __m256 r = _mm256_loadu_ps(src[1] + i);
+    const __m256 low = _mm256_unpacklo_ps(l, r);
+    const __m256 high = _mm256_unpackhi_ps(l, r);
+    _mm256_storeu_ps(dst + i * 2, _mm256_permute2f128_ps(low, high, 0x20));
+    _mm256_storeu_ps(dst + i * 2 + 8, _mm256_permute2f128_ps(low, high, 0x31));
+  }
+  const float *const rest[2] = {src[0] + i, src[1] + i};
+  InterleaveSse(rest, 2, dst + i * 2, frames - i);
+}
+
+#pragma endregion
+
+#endif
+
+#pragma region スピーカー配置
+
+// dwChannelMaskのビットの並び(SPEAKER_FRONT_LEFTなど)
+enum Speaker : uint32_t {
+  kFrontLeft,
+  kFrontRight,
+  kFrontCenter,
+  kLowFrequency,
+  kBackLeft,
+  kBackRight,
+  kFrontLeftOfCenter,
+  kFrontRightOfCenter,
+  kBackCenter,
+  kSideLeft,
+  kSideRight,
+  kTopCenter,
+  kTopFrontLeft,
+  kTopFrontCenter,
+  kTopFrontRight,
+  kTopBackLeft,
+  kTopBackCenter,
+  kTopBackRight,
+  kSpeakerCount
+};
+
+constexpr float kMinus3dB = 0.70710678f;
+
+// スピーカーごとの出力チャンネル。無ければ-1
+struct SpeakerMap {
+  int channels[kSpeakerCount];
+
+  bool Has(Speaker speaker) const { return channels[speaker] >= 0; }
+};
+
+// マスクの下位ビットから順にチャンネルを割り当てる
+// マスクのビットより多いチャンネルはどのスピーカーにも割り当てない
+SpeakerMap MapSpeakers(uint32_t channels, uint32_t mask) {
+  if (mask == 0) {
+    mask = GetDefaultChannelMask(channels);
+  }
+  SpeakerMap map;
+  std::fill(std::begin(map.channels), std::end(map.channels), -1);
+  uint32_t channel = 0;
+  for (uint32_t speaker = 0; speaker < kSpeakerCount && channel < channels;
+       ++speaker) {
+    if (mask & (1u << speaker)) {
+      map.channels[speaker] = int(channel++);
+    }
+  }
+  return map;
+}
+
+// 出力にspeakerがあればそこへ、無ければ近いスピーカーへ振り分ける
+void Route(ChannelMatrix &matrix, const SpeakerMap &destination,
+           uint32_t source, Speaker speaker, float gain) {
+  if (destination.Has(speaker)) {
+    matrix.gains[destination.channels[speaker]][source] += gain;
+    return;
+  }
+
+  const auto routePair = [&](Speaker left, Speaker right) {
+    Route(matrix, destination, source, left, gain * kMinus3dB);
+    Route(matrix, destination, source, right, gain * kMinus3dB);
+  };
+  switch (speaker) {
+  case kFrontLeft:
+  case kFrontRight:
+    // 左右の無い出力(モノラル)は中央にまとめる
+    if (destination.Has(kFrontCenter)) {
+      Route(matrix, destination, source, kFrontCenter, gain * kMinus3dB);
+    }
+    break;
+  case kFrontCenter:
+    if (destination.Has(kFrontLeft) && destination.Has(kFrontRight)) {
+      routePair(kFrontLeft, kFrontRight);
+    }
+    break;
+  case kLowFrequency:
+    break;
+  case kFrontLeftOfCenter:
+    Route(matrix, destination, source, kFrontLeft, gain);
+    break;
+  case kFrontRightOfCenter:
+    Route(matrix, destination, source, kFrontRight, gain);
+    break;
+  case kBackLeft:
+  case kSideLeft: {
+    const Speaker other = speaker == kBackLeft ? kSideLeft : kBackLeft;
+    Route(matrix, destination, source,
+          destination.Has(other) ? other : kFrontLeft,
+          destination.Has(other) ? gain : gain * kMinus3dB);
+    break;
+  }
+  case kBackRight:
+  case kSideRight: {
+    const Speaker other = speaker == kBackRight ? kSideRight : kBackRight;
+    Route(matrix, destination, source,
+          destination.Has(other) ? other : kFrontRight,
+          destination.Has(other) ? gain : gain * kMinus3dB);
+    break;
+  }
+  case kBackCenter:
+    if (destination.Has(kBackLeft) && destination.Has(kBackRight)) {
+      routePair(kBackLeft, kBackRight);
+    } else if (destination.Has(kSideLeft) && destination.Has(kSideRight)) {
+      routePair(kSideLeft, kSideRight);
+    } else {
+      Route(matrix, destination, source, kFrontCenter, gain * kMinus3dB);
+    }
+    break;
+  // 上方のスピーカーは同じ側の下へ落とす
+  case kTopCenter:
+  case kTopFrontCenter:
+    Route(matrix, destination, source, kFrontCenter, gain * kMinus3dB);
+    break;
+  case kTopFrontLeft:
+    Route(matrix, destination, source, kFrontLeft, gain * kMinus3dB);
+    break;
+  case kTopFrontRight:
+    Route(matrix, destination, source, kFrontRight, gain * kMinus3dB);
+    break;
+  case kTopBackLeft:
+    Route(matrix, destination, source, kBackLeft, gain * kMinus3dB);
+    break;
+  case kTopBackCenter:
+    Route(matrix, destination, source, kBackCenter, gain * kMinus3dB);
+    break;
+  case kTopBackRight:
+    Route(matrix, destination, source, kBackRight, gain * kMinus3dB);
+    break;
+  default:
+    break;
+  }
+}
+
+#pragma endregion
+
+} // namespace
+
+#pragma region 形式の変換
+
+bool GetPcmFormat(uint16_t formatTag, uint16_t bitsPerSample,
+                  PcmFormat &format) {
+  if (formatTag == kWaveFormatIeeeFloat) {
+    if (bitsPerSample != 32) {
+      return false;
+    }
+    format = PcmFormat::Float32;
+    return true;
+  }
+  if (formatTag != kWaveFormatPcm) {
+    return false;
+  }
+  switch (bitsPerSample) {
+  case 8:
+    format = PcmFormat::UInt8;
+    return true;
+  case 16:
+    format = PcmFormat::Int16;
+    return true;
+  case 24:
+    format = PcmFormat::Int24;
+    return true;
+  case 32:
+    format = PcmFormat::Int32;
+    return true;
+  default:
+    return false;
+  }
+}
+
+uint32_t GetPcmSampleBytes(PcmFormat format) {
+  switch (format) {
+  case PcmFormat::UInt8:
+    return 1;
+  case PcmFormat::Int16:
+    return 2;
+  case PcmFormat::Int24:
+    return 3;
+  default:
+    return 4;
+  }
+}
+
+void ConvertPcmToFloat(PcmFormat format, const void *src, float *dst,
+                       size_t count, SimdLevel level) {
+  if (count == 0) {
+    return;
+  }
+  const uint8_t *bytes = static_cast<const uint8_t *>(src);
+  level = std::min(level, GetSupportedSimdLevel());
+#ifdef AUDIO_MIX_X86
+  if (level == SimdLevel::Avx) {
+    ToFloatAvx(format, bytes, dst, count);
+    return;
+  }
+  if (level == SimdLevel::Sse) {
+    ToFloatSse(format, bytes, dst, count);
+    return;
+  }
+#endif
+  ToFloatScalar(format, bytes, dst, count);
+}
+
+void ConvertFloatToPcm(PcmFormat format, const float *src, void *dst,
+                       size_t count, SimdLevel level) {
+  if (count == 0) {
+    return;
+  }
+  uint8_t *bytes = static_cast<uint8_t *>(dst);
+  level = std::min(level, GetSupportedSimdLevel());
+#ifdef AUDIO_MIX_X86
+  if (level == SimdLevel::Avx) {
+    FromFloatAvx(format, src, bytes, count);
+    return;
+  }
+  if (level == SimdLevel::Sse) {
+    FromFloatSse(format, src, bytes, count);
+    return;
+  }
+#endif
+  FromFloatScalar(format, src, bytes, count);
+}
+
+#pragma endregion
+
+#pragma region チャンネルの並べ替え
+
+void DeinterleaveSamples(const float *src, uint32_t channels,
+                         float *const *dst, size_t frames, SimdLevel level) {
+  if (frames == 0) {
+    return;
+  }
+  if (channels == 1) {
+    std::memcpy(dst[0], src, frames * sizeof(float));
+    return;
+  }
+  level = std::min(level, GetSupportedSimdLevel());
+#ifdef AUDIO_MIX_X86
+  if (level == SimdLevel::Avx) {
+    DeinterleaveAvx(src, channels, dst, frames);
+    return;
+  }
+  if (level == SimdLevel::Sse) {
+    DeinterleaveSse(src, channels, dst, frames);
+    return;
+  }
+#endif
+  DeinterleaveScalar(src, channels, dst, frames);
+}
+
+void InterleaveSamples(const float *const *src, uint32_t channels, float *dst,
+                       size_t frames, SimdLevel level) {
+  if (frames == 0) {
+    return;
+  }
+  if (channels == 1) {
+    std::memcpy(dst, src[0], frames * sizeof(float));
+    return;
+  }
+  level = std::min(level, GetSupportedSimdLevel());
+#ifdef AUDIO_MIX_X86
+  if (level == SimdLevel::Avx) {
+    InterleaveAvx(src, channels, dst, frames);
+    return;
+  }
+  if (level == SimdLevel::Sse) {
+    InterleaveSse(src, channels, dst, frames);
+    return;
+  }
+#endif
+  InterleaveScalar(src, channels, dst, frames);
+}
+
+#pragma endregion
+
+#pragma region チャンネル数の変換
+
+uint32_t GetDefaultChannelMask(uint32_t channels) {
+  switch (channels) {
+  case 1:
+    return 0x4; // FC
+  case 2:
+    return 0x3; // FL FR
+  case 3:
+    return 0x7; // FL FR FC
+  case 4:
+    return 0x33; // FL FR BL BR
+  case 5:
+    return 0x37; // FL FR FC BL BR
+  case 6:
+    return 0x3F; // 5.1
+  case 7:
+    return 0x13F; // 6.1
+  case 8:
+    return 0x63F; // 7.1 (FL FR FC LFE BL BR SL SR)
+  default:
+    return 0;
+  }
+}
+
+ChannelMatrix BuildChannelMatrix(uint32_t sourceChannels, uint32_t sourceMask,
+                                 uint32_t destinationChannels,
+                                 uint32_t destinationMask) {
+  ChannelMatrix matrix;
+  matrix.sourceChannels = std::min(sourceChannels, kMaxPcmChannels);
+  matrix.destinationChannels = std::min(destinationChannels, kMaxPcmChannels);
+
+  const SpeakerMap source = MapSpeakers(matrix.sourceChannels, sourceMask);
+  const SpeakerMap destination =
+      MapSpeakers(matrix.destinationChannels, destinationMask);
+  for (uint32_t speaker = 0; speaker < kSpeakerCount; ++speaker) {
+    if (source.Has(Speaker(speaker))) {
+      Route(matrix, destination, uint32_t(source.channels[speaker]),
+            Speaker(speaker), 1.0f);
+    }
+  }
+  return matrix;
+}
+
+void MixChannels(const ChannelMatrix &matrix, const float *const *src,
+                 float *const *dst, size_t frames, SimdLevel level) {
+  const MixKernels &kernels = GetMixKernels(level);
+  for (uint32_t out = 0; out < matrix.destinationChannels; ++out) {
+    std::fill_n(dst[out], frames, 0.0f);
+    for (uint32_t in = 0; in < matrix.sourceChannels; ++in) {
+      const float gain = matrix.gains[out][in];
+      if (gain != 0.0f) {
+        kernels.mixRamped(src[in], dst[out], frames, gain, gain);
+      }
+    }
+  }
+}
+
+#pragma endregion
@@ -0,0 +1,68 @@
+#pragma once
+#include "AudioMixKernels.h"
+#include <cstddef>
+#include <cstdint>
+
+// WAVのサンプルの形式。8bitだけは符号なし
+enum class PcmFormat { UInt8, Int16, Int24, Int32, Float32 };
+
+// チャンネル配置を扱える最大のチャンネル数(7.1まで)
+constexpr uint32_t kMaxPcmChannels = 8;
+
+#pragma region 形式の変換
+
+// formatTag(EXTENSIBLEは中身の形式)とビット数から。扱えない形式ならfalse
+bool GetPcmFormat(uint16_t formatTag, uint16_t bitsPerSample,
+                  PcmFormat &format);
+uint32_t GetPcmSampleBytes(PcmFormat format);
+
+// countはチャンネルをまとめたサンプル数(フレーム数×チャンネル数)
+// srcの境界は揃っていなくてよい
+void ConvertPcmToFloat(PcmFormat format, const void *src, float *dst,
+                       size_t count,
+                       SimdLevel level = GetSupportedSimdLevel());
+// -1～1に収めてから四捨五入する(Float32も収める)。NaNは0になる
+void ConvertFloatToPcm(PcmFormat format, const float *src, void *dst,
+                       size_t count,
+                       SimdLevel level = GetSupportedSimdLevel());
+
+#pragma endregion
+
+#pragma region チャンネルの並べ替え
+
+// LRLR...の並びをチャンネルごとの配列に分ける
+void DeinterleaveSamples(const float *src, uint32_t channels,
+                         float *const *dst, size_t frames,
+                         SimdLevel level = GetSupportedSimdLevel());
+// チャンネルごとの配列をLRLR...の並びにまとめる
+void InterleaveSamples(const float *const *src, uint32_t channels, float *dst,
+                       size_t frames,
+                       SimdLevel level = GetSupportedSimdLevel());
+
+#pragma endregion
+
+#pragma region チャンネル数の変換
+
+// WAVのdwChannelMaskが0のときに使う標準の配置
+uint32_t GetDefaultChannelMask(uint32_t channels);
+
+// gains[出力][入力]。出力の各チャンネルは入力の重み付きの和になる
+struct ChannelMatrix {
+  uint32_t sourceChannels = 0;
+  uint32_t destinationChannels = 0;
+  float gains[kMaxPcmChannels][kMaxPcmChannels] = {};
+};
+
+// スピーカー配置(マスクが0なら標準の配置)から、アップ/ダウンミックスの
+// 係数を作る。同じスピーカーはそのまま、無いスピーカーは近いものに-3dBで
+// 振り分ける(LFEはダウンミックスでは捨てる)
+ChannelMatrix BuildChannelMatrix(uint32_t sourceChannels, uint32_t sourceMask,
+                                 uint32_t destinationChannels,
+                                 uint32_t destinationMask);
+
+// チャンネルごとの配列に対して行列を掛ける。srcとdstは重ならないこと
+void MixChannels(const ChannelMatrix &matrix, const float *const *src,
+                 float *const *dst, size_t frames,
+                 SimdLevel level = GetSupportedSimdLevel());
+
+#pragma endregion
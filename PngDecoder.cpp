@@ -0,0 +1,618 @@
+#include "PngDecoder.h"
+#include "Inflate.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#define PNG_DECODER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+// これより大きい画像は壊れたファイルとして扱う
+constexpr uint32_t kMaxDimension = 1u << 16;
+
+enum ColorType : uint8_t {
+  kGray = 0,
+  kRgb = 2,
+  kPalette = 3,
+  kGrayAlpha = 4,
+  kRgba = 6,
+};
+
+// Adam7の7回のパスの開始位置と間隔
+struct Adam7Pass {
+  uint32_t x;
+  uint32_t y;
+  uint32_t stepX;
+  uint32_t stepY;
+};
+const Adam7Pass kAdam7Passes[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8},
+                                   {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2},
+                                   {0, 1, 1, 2}};
+
+bool Fail(std::string *error, const char *message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+uint32_t ReadUint32(const uint8_t *bytes) {
+  return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) |
+         (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+uint16_t ReadUint16(const uint8_t *bytes) {
+  return uint16_t((bytes[0] << 8) | bytes[1]);
+}
+
+struct Header {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint8_t depth = 0;
+  uint8_t colorType = 0;
+  bool isInterlaced = false;
+
+  uint32_t GetChannelCount() const {
+    switch (colorType) {
+    case kGrayAlpha:
+      return 2;
+    case kRgb:
+      return 3;
+    case kRgba:
+      return 4;
+    default:
+      return 1;
+    }
+  }
+  // フィルターで左隣として扱うバイト数。1ピクセルが1バイト未満でも1
+  uint32_t GetFilterStride() const {
+    const uint32_t bits = GetChannelCount() * depth;
+    return bits < 8 ? 1 : bits / 8;
+  }
+  // フィルターの種類のバイトを除いた1行のバイト数
+  size_t GetRowBytes(uint32_t rowWidth) const {
+    return (size_t(rowWidth) * GetChannelCount() * depth + 7) / 8;
+  }
+  uint32_t GetOutputBits() const { return depth == 16 ? 16 : 8; }
+};
+
+bool IsValidDepth(uint8_t colorType, uint8_t depth) {
+  switch (colorType) {
+  case kGray:
+    return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+  case kPalette:
+    return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+  case kRgb:
+  case kGrayAlpha:
+  case kRgba:
+    return depth == 8 || depth == 16;
+  default:
+    return false;
+  }
+}
+
+bool ParseHeader(const uint8_t *bytes, size_t size, Header &header,
+                 std::string *error) {
+  if (size < 8 + 8 + 13 + 4 ||
+      std::memcmp(bytes, kSignature, sizeof(kSignature)) != 0) {
+    return Fail(error, "not a PNG file");
+  }
+  if (ReadUint32(bytes + 8) != 13 || std::memcmp(bytes + 12, "IHDR", 4) != 0) {
+    return Fail(error, "missing IHDR");
+  }
+  const uint8_t *data = bytes + 16;
+  header.width = ReadUint32(data);
+  header.height = ReadUint32(data + 4);
+  header.depth = data[8];
+  header.colorType = data[9];
+  header.isInterlaced = data[12] == 1;
+  if (header.width == 0 || header.height == 0 ||
+      header.width > kMaxDimension || header.height > kMaxDimension) {
+    return Fail(error, "invalid image size");
+  }
+  if (!IsValidDepth(header.colorType, header.depth) || data[10] != 0 ||
+      data[11] != 0 || data[12] > 1) {
+    return Fail(error, "unsupported PNG format");
+  }
+  return true;
+}
+
+// 画像を作るのに必要なチャンクの中身
+struct Chunks {
+  Header header;
+  // RGBA。範囲外の番号は黒になるように全部埋めておく
+  uint8_t palette[256][4] = {};
+  uint32_t paletteCount = 0;
+  // tRNSで透明にするグレーかRGBの値(パレットのときはpaletteのアルファに入れる)
+  bool hasColorKey = false;
+  uint16_t colorKey[3] = {};
+  // IDATの中身。分かれていれば順につなげる
+  std::vector<const uint8_t *> dataChunks;
+  std::vector<size_t> dataSizes;
+};
+
+bool ParseChunks(const uint8_t *bytes, size_t size, Chunks &chunks,
+                 std::string *error) {
+  if (!ParseHeader(bytes, size, chunks.header, error)) {
+    return false;
+  }
+  const Header &header = chunks.header;
+  for (uint32_t i = 0; i < 256; ++i) {
+    chunks.palette[i][3] = 255;
+  }
+
+  bool hasEnd = false;
+  size_t offset = 8 + 12 + 13;
+  while (!hasEnd) {
+    if (size - offset < 12) {
+      return Fail(error, "truncated PNG file");
+    }
+    const uint32_t length = ReadUint32(bytes + offset);
+    const uint8_t *type = bytes + offset + 4;
+    const uint8_t *data = bytes + offset + 8;
+    if (length > size - offset - 12) {
+      return Fail(error, "truncated PNG file");
+    }
+    // CRCは見ない。壊れていても展開やAdler-32で気づける
+    offset += 12 + size_t(length);
+
+    if (std::memcmp(type, "IDAT", 4) == 0) {
+      chunks.dataChunks.push_back(data);
+      chunks.dataSizes.push_back(length);
+    } else if (std::memcmp(type, "PLTE", 4) == 0) {
+      if (length % 3 != 0 || length / 3 > 256 || length == 0) {
+        return Fail(error, "invalid PLTE");
+      }
+      chunks.paletteCount = length / 3;
+      for (uint32_t i = 0; i < chunks.paletteCount; ++i) {
+        std::memcpy(chunks.palette[i], data + i * 3, 3);
+      }
+    } else if (std::memcmp(type, "tRNS", 4) == 0) {
+      if (header.colorType == kPalette) {
+        if (length > chunks.paletteCount) {
+          return Fail(error, "invalid tRNS");
+        }
+        for (uint32_t i = 0; i < length; ++i) {
+          chunks.palette[i][3] = data[i];
+        }
+      } else if (header.colorType == kGray && length == 2) {
+        chunks.hasColorKey = true;
+        chunks.colorKey[0] = ReadUint16(data);
+      } else if (header.colorType == kRgb && length == 6) {
+        chunks.hasColorKey = true;
+        for (uint32_t i = 0; i < 3; ++i) {
+          chunks.colorKey[i] = ReadUint16(data + i * 2);
+        }
+      }
+    } else if (std::memcmp(type, "IEND", 4) == 0) {
+      hasEnd = true;
+    } else if ((type[0] & 0x20) == 0) {
+      // 知らない必須チャンク(先頭が大文字)があれば正しく描けない
+      return Fail(error, "unknown critical chunk");
+    }
+  }
+  if (chunks.dataChunks.empty()) {
+    return Fail(error, "missing IDAT");
+  }
+  if (header.colorType == kPalette && chunks.paletteCount == 0) {
+    return Fail(error, "missing PLTE");
+  }
+  return true;
+}
+
+#pragma region スカラー
+
+void UnfilterSubScalar(uint8_t *row, size_t rowBytes, uint32_t stride) {
+  for (size_t i = stride; i < rowBytes; ++i) {
+    row[i] = uint8_t(row[i] + row[i - stride]);
+  }
+}
+
+void UnfilterUpScalar(uint8_t *row, const uint8_t *prior, size_t begin,
+                      size_t rowBytes) {
+  for (size_t i = begin; i < rowBytes; ++i) {
+    row[i] = uint8_t(row[i] + prior[i]);
+  }
+}
+
+void UnfilterAverageScalar(uint8_t *row, const uint8_t *prior, size_t rowBytes,
+                           uint32_t stride) {
+  for (size_t i = 0; i < stride && i < rowBytes; ++i) {
+    row[i] = uint8_t(row[i] + (prior[i] >> 1));
+  }
+  for (size_t i = stride; i < rowBytes; ++i) {
+    row[i] = uint8_t(row[i] + ((row[i - stride] + prior[i]) >> 1));
+  }
+}
+
+uint8_t PaethPredictor(int32_t a, int32_t b, int32_t c) {
+  const int32_t pa = std::abs(b - c);
+  const int32_t pb = std::abs(a - c);
+  const int32_t pc = std::abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) {
+    return uint8_t(a);
+  }
+  return uint8_t(pb <= pc ? b : c);
+}
+
+void UnfilterPaethScalar(uint8_t *row, const uint8_t *prior, size_t rowBytes,
+                         uint32_t stride) {
+  // 左端は左と左上が0なので上と同じ
+  for (size_t i = 0; i < stride && i < rowBytes; ++i) {
+    row[i] = uint8_t(row[i] + prior[i]);
+  }
+  for (size_t i = stride; i < rowBytes; ++i) {
+    row[i] = uint8_t(row[i] + PaethPredictor(row[i - stride], prior[i],
+                                             prior[i - stride]));
+  }
+}
+
+#pragma endregion
+
+#ifdef PNG_DECODER_X86
+#pragma region SSE
+
+// 3か4バイトの1ピクセルをレジスタの下位に読み書きする
+__m128i LoadPixel(const uint8_t *pixel, uint32_t stride) {
+  uint32_t value = 0;
+  std::memcpy(&value, pixel, stride);
+  return _mm_cvtsi32_si128(int(value));
+}
+
+void StorePixel(uint8_t *pixel, __m128i value, uint32_t stride) {
+  const uint32_t bits = uint32_t(_mm_cvtsi128_si32(value));
+  std::memcpy(pixel, &bits, stride);
+}
+
+__m128i Select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__m128i Abs16(__m128i value) {
+  return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+}
+
+void UnfilterUpSse(uint8_t *row, const uint8_t *prior, size_t rowBytes) {
+  size_t i = 0;
+  for (; i + 16 <= rowBytes; i += 16) {
+    const __m128i value = _mm_add_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(prior + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), value);
+  }
+  UnfilterUpScalar(row, prior, i, rowBytes);
+}
+
+// 1ピクセル4バイトなら、16バイトの中で左のピクセルを足し込む累積和にできる
+void UnfilterSub4Sse(uint8_t *row, size_t rowBytes) {
+  __m128i left = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= rowBytes; i += 16) {
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+    value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+    value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+    value = _mm_add_epi8(value, left);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), value);
+    left = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  for (; i < rowBytes; i += 4) {
+    left = _mm_add_epi8(LoadPixel(row + i, 4), left);
+    StorePixel(row + i, left, 4);
+  }
+}
+
+void UnfilterSub3Sse(uint8_t *row, size_t rowBytes) {
+  __m128i left = _mm_setzero_si128();
+  for (size_t i = 0; i < rowBytes; i += 3) {
+    left = _mm_add_epi8(LoadPixel(row + i, 3), left);
+    StorePixel(row + i, left, 3);
+  }
+}
+
+// 切り捨ての平均は、切り上げの平均(pavgb)から奇数のときだけ1引けばよい
+void UnfilterAverageSse(uint8_t *row, const uint8_t *prior, size_t rowBytes,
+                        uint32_t stride) {
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i left = _mm_setzero_si128();
+  for (size_t i = 0; i < rowBytes; i += stride) {
+    const __m128i up = LoadPixel(prior + i, stride);
+    const __m128i average =
+        _mm_sub_epi8(_mm_avg_epu8(left, up),
+                     _mm_and_si128(_mm_xor_si128(left, up), one));
+    left = _mm_add_epi8(LoadPixel(row + i, stride), average);
+    StorePixel(row + i, left, stride);
+  }
+}
+
+// 差を16bitで計算して、1ピクセルの全チャンネルの予測を一度に選ぶ
+void UnfilterPaethSse(uint8_t *row, const uint8_t *prior, size_t rowBytes,
+                      uint32_t stride) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i left = zero;
+  __m128i upperLeft = zero;
+  for (size_t i = 0; i < rowBytes; i += stride) {
+    const __m128i up = _mm_unpacklo_epi8(LoadPixel(prior + i, stride), zero);
+    // pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|
+    __m128i pa = _mm_sub_epi16(up, upperLeft);
+    __m128i pb = _mm_sub_epi16(left, upperLeft);
+    __m128i pc = _mm_add_epi16(pa, pb);
+    pa = Abs16(pa);
+    pb = Abs16(pb);
+    pc = Abs16(pc);
+    const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    // 同じ距離ならa、b、cの順に優先する
+    __m128i nearest = Select(_mm_cmpeq_epi16(smallest, pb), up, upperLeft);
+    nearest = Select(_mm_cmpeq_epi16(smallest, pa), left, nearest);
+    const __m128i value = _mm_add_epi8(LoadPixel(row + i, stride),
+                                       _mm_packus_epi16(nearest, nearest));
+    StorePixel(row + i, value, stride);
+    left = _mm_unpacklo_epi8(value, zero);
+    upperLeft = up;
+  }
+}
+
+#pragma endregion
+#endif
+
+// priorは前の行(フィルターを戻した後)。1行目は0の行を渡す
+bool Unfilter(uint8_t filter, uint8_t *row, const uint8_t *prior,
+              size_t rowBytes, uint32_t stride) {
+#ifdef PNG_DECODER_X86
+  // 8bitのRGBとRGBAはピクセル単位でまとめて処理する
+  const bool isPixelStride = stride == 3 || stride == 4;
+#endif
+  switch (filter) {
+  case 0:
+    return true;
+  case 1:
+#ifdef PNG_DECODER_X86
+    if (stride == 4) {
+      UnfilterSub4Sse(row, rowBytes);
+      return true;
+    }
+    if (stride == 3) {
+      UnfilterSub3Sse(row, rowBytes);
+      return true;
+    }
+#endif
+    UnfilterSubScalar(row, rowBytes, stride);
+    return true;
+  case 2:
+#ifdef PNG_DECODER_X86
+    UnfilterUpSse(row, prior, rowBytes);
+#else
+    UnfilterUpScalar(row, prior, 0, rowBytes);
+#endif
+    return true;
+  case 3:
+#ifdef PNG_DECODER_X86
+    if (isPixelStride) {
+      UnfilterAverageSse(row, prior, rowBytes, stride);
+      return true;
+    }
+#endif
+    UnfilterAverageScalar(row, prior, rowBytes, stride);
+    return true;
+  case 4:
+#ifdef PNG_DECODER_X86
+    if (isPixelStride) {
+      UnfilterPaethSse(row, prior, rowBytes, stride);
+      return true;
+    }
+#endif
+    UnfilterPaethScalar(row, prior, rowBytes, stride);
+    return true;
+  default:
+    return false;
+  }
+}
+
+#pragma region RGBAへの変換
+
+uint32_t GetSample(const uint8_t *row, uint32_t index, uint32_t depth) {
+  const size_t bit = size_t(index) * depth;
+  return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+}
+
+void StoreRgba16(uint8_t *dst, uint16_t r, uint16_t g, uint16_t b,
+                 uint16_t a) {
+  const uint16_t pixel[4] = {r, g, b, a};
+  std::memcpy(dst, pixel, sizeof(pixel));
+}
+
+void ExpandRow16(const Chunks &chunks, const uint8_t *src, uint32_t width,
+                 uint8_t *dst) {
+  const uint16_t *key = chunks.colorKey;
+  for (uint32_t x = 0; x < width; ++x, dst += 8) {
+    switch (chunks.header.colorType) {
+    case kGray: {
+      const uint16_t gray = ReadUint16(src + x * 2);
+      const bool isKey = chunks.hasColorKey && gray == key[0];
+      StoreRgba16(dst, gray, gray, gray, isKey ? 0 : 0xFFFF);
+      break;
+    }
+    case kGrayAlpha: {
+      const uint16_t gray = ReadUint16(src + x * 4);
+      StoreRgba16(dst, gray, gray, gray, ReadUint16(src + x * 4 + 2));
+      break;
+    }
+    case kRgb: {
+      const uint8_t *p = src + x * 6;
+      const uint16_t r = ReadUint16(p);
+      const uint16_t g = ReadUint16(p + 2);
+      const uint16_t b = ReadUint16(p + 4);
+      const bool isKey =
+          chunks.hasColorKey && r == key[0] && g == key[1] && b == key[2];
+      StoreRgba16(dst, r, g, b, isKey ? 0 : 0xFFFF);
+      break;
+    }
+    default: {
+      const uint8_t *p = src + x * 8;
+      StoreRgba16(dst, ReadUint16(p), ReadUint16(p + 2), ReadUint16(p + 4),
+                  ReadUint16(p + 6));
+      break;
+    }
+    }
+  }
+}
+
+// 1行をRGBA(8bitか16bit)に広げてdstに詰めて書く
+void ExpandRow(const Chunks &chunks, const uint8_t *src, uint32_t width,
+               uint8_t *dst) {
+  const Header &header = chunks.header;
+  if (header.depth == 16) {
+    ExpandRow16(chunks, src, width, dst);
+    return;
+  }
+  const uint16_t *key = chunks.colorKey;
+  switch (header.colorType) {
+  case kRgba:
+    std::memcpy(dst, src, size_t(width) * 4);
+    break;
+  case kRgb:
+    for (uint32_t x = 0; x < width; ++x, src += 3, dst += 4) {
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+      dst[3] = 255;
+      if (chunks.hasColorKey && src[0] == key[0] && src[1] == key[1] &&
+          src[2] == key[2]) {
+        dst[3] = 0;
+      }
+    }
+    break;
+  case kGrayAlpha:
+    for (uint32_t x = 0; x < width; ++x, src += 2, dst += 4) {
+      dst[0] = dst[1] = dst[2] = src[0];
+      dst[3] = src[1];
+    }
+    break;
+  case kPalette:
+    for (uint32_t x = 0; x < width; ++x, dst += 4) {
+      const uint32_t index =
+          header.depth == 8 ? src[x] : GetSample(src, x, header.depth);
+      std::memcpy(dst, chunks.palette[index], 4);
+    }
+    break;
+  default: {
+    // 8bit未満のグレーはビットを繰り返して8bitに広げる(1bitなら0か255)
+    const uint32_t scale = 255 / ((1u << header.depth) - 1);
+    for (uint32_t x = 0; x < width; ++x, dst += 4) {
+      const uint32_t sample =
+          header.depth == 8 ? src[x] : GetSample(src, x, header.depth);
+      dst[0] = dst[1] = dst[2] = uint8_t(sample * scale);
+      dst[3] = chunks.hasColorKey && sample == key[0] ? 0 : 255;
+    }
+    break;
+  }
+  }
+}
+
+#pragma endregion
+
+} // namespace
+
+bool IsPng(const void *data, size_t size) {
+  return size >= sizeof(kSignature) &&
+         std::memcmp(data, kSignature, sizeof(kSignature)) == 0;
+}
+
+bool ReadPngInfo(const void *data, size_t size, PngInfo &info,
+                 std::string *error) {
+  Header header;
+  if (!ParseHeader(static_cast<const uint8_t *>(data), size, header, error)) {
+    return false;
+  }
+  info.width = header.width;
+  info.height = header.height;
+  info.bitsPerChannel = header.GetOutputBits();
+  return true;
+}
+
+bool DecodePng(const void *data, size_t size, uint8_t *dst, size_t rowPitch,
+               std::string *error) {
+  Chunks chunks;
+  if (!ParseChunks(static_cast<const uint8_t *>(data), size, chunks, error)) {
+    return false;
+  }
+  const Header &header = chunks.header;
+
+  // インターレースなしは1回のパスとして同じ処理で扱う
+  const Adam7Pass kSinglePass = {0, 0, 1, 1};
+  const Adam7Pass *passes = header.isInterlaced ? kAdam7Passes : &kSinglePass;
+  const uint32_t passCount = header.isInterlaced ? 7 : 1;
+  size_t rawSize = 0;
+  for (uint32_t i = 0; i < passCount; ++i) {
+    const Adam7Pass &pass = passes[i];
+    if (header.width > pass.x && header.height > pass.y) {
+      const uint32_t passWidth =
+          (header.width - pass.x + pass.stepX - 1) / pass.stepX;
+      const uint32_t passHeight =
+          (header.height - pass.y + pass.stepY - 1) / pass.stepY;
+      rawSize += size_t(passHeight) * (1 + header.GetRowBytes(passWidth));
+    }
+  }
+
+  // IDATが1つならそのまま、分かれていればつなげてから展開する
+  const uint8_t *compressed = chunks.dataChunks[0];
+  size_t compressedSize = chunks.dataSizes[0];
+  std::vector<uint8_t> joined;
+  if (chunks.dataChunks.size() > 1) {
+    for (size_t i = 0; i < chunks.dataChunks.size(); ++i) {
+      joined.insert(joined.end(), chunks.dataChunks[i],
+                    chunks.dataChunks[i] + chunks.dataSizes[i]);
+    }
+    compressed = joined.data();
+    compressedSize = joined.size();
+  }
+  std::vector<uint8_t> raw(rawSize);
+  if (!InflateZlib(compressed, compressedSize, raw.data(), raw.size())) {
+    return Fail(error, "broken image data");
+  }
+
+  const uint32_t stride = header.GetFilterStride();
+  const size_t pixelBytes = header.GetOutputBits() / 2;
+  const std::vector<uint8_t> zeroRow(header.GetRowBytes(header.width), 0);
+  std::vector<uint8_t> expanded;
+  if (header.isInterlaced) {
+    expanded.resize(size_t(header.width) * pixelBytes);
+  }
+  size_t offset = 0;
+  for (uint32_t i = 0; i < passCount; ++i) {
+    const Adam7Pass &pass = passes[i];
+    if (header.width <= pass.x || header.height <= pass.y) {
+      continue;
+    }
+    const uint32_t passWidth =
+        (header.width - pass.x + pass.stepX - 1) / pass.stepX;
+    const uint32_t passHeight =
+        (header.height - pass.y + pass.stepY - 1) / pass.stepY;
+    const size_t rowBytes = header.GetRowBytes(passWidth);
+    const uint8_t *prior = zeroRow.data();
+    for (uint32_t y = 0; y < passHeight; ++y) {
+      uint8_t *row = raw.data() + offset + 1;
+      if (!Unfilter(raw[offset], row, prior, rowBytes, stride)) {
+        return Fail(error, "invalid filter type");
+      }
+      uint8_t *dstRow = dst + size_t(pass.y + y * pass.stepY) * rowPitch;
+      if (!header.isInterlaced) {
+        ExpandRow(chunks, row, passWidth, dstRow);
+      } else {
+        ExpandRow(chunks, row, passWidth, expanded.data());
+        for (uint32_t x = 0; x < passWidth; ++x) {
+          std::memcpy(dstRow + size_t(pass.x + x * pass.stepX) * pixelBytes,
+                      expanded.data() + x * pixelBytes, pixelBytes);
+        }
+      }
+      prior = row;
+      offset += 1 + rowBytes;
+    }
+  }
+  return true;
+}
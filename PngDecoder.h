@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// WICを使わないPNGのデコーダー。Windows以外のクック用のマシンで使う
+// WICと同じ結果になるように、色はRGBA(グレーはRGBに広げる)、16bitは16bitのまま返す
+// ガンマやsRGBのチャンクは見ない(sRGBかどうかはクックの設定で決める)
+
+struct PngInfo {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // 出力の1チャンネルのビット数。8か16
+  uint32_t bitsPerChannel = 8;
+
+  // 出力の1行のバイト数(RGBAでパディングなし)
+  size_t GetRowBytes() const { return size_t(width) * 4 * bitsPerChannel / 8; }
+};
+
+// 先頭がPNGのシグネチャか
+bool IsPng(const void *data, size_t size);
+
+// IHDRだけを読んで大きさを返す
+bool ReadPngInfo(const void *data, size_t size, PngInfo &info,
+                 std::string *error = nullptr);
+
+// dstにRGBAをrowPitchバイト間隔で書く。16bitはホストのバイト順
+// dstはReadPngInfoで返した大きさの分だけ用意しておくこと
+bool DecodePng(const void *data, size_t size, uint8_t *dst, size_t rowPitch,
+               std::string *error = nullptr);
@@ -0,0 +1,319 @@
+#include "Resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+namespace {
+
+struct QualitySettings {
+  uint32_t taps;
+  // 位相の数は2のべき乗にする(固定小数の上位ビットをそのまま使う)
+  uint32_t phaseShift;
+  // Kaiser窓のβ。大きいほど阻止域の減衰が大きい
+  double beta;
+  // ナイキスト周波数に対する通過域の割合
+  double rolloff;
+};
+
+const QualitySettings kQualitySettings[] = {
+    {8, 6, 5.0, 0.85},
+    {16, 8, 7.0, 0.90},
+    {32, 10, 9.5, 0.94},
+};
+
+const uint32_t kMaxTaps = 32;
+const uint32_t kQualityCount = 3;
+// 1オクターブを何段階に分けてフィルタの帯域を狭めるか
+const uint32_t kCutoffStepsPerOctave = 8;
+// kMaxRatio(3オクターブ)まで狭めた帯域の番号
+const uint32_t kMaxCutoffIndex = 3 * kCutoffStepsPerOctave;
+
+const QualitySettings &GetSettings(ResamplerQuality quality) {
+  return kQualitySettings[uint32_t(quality)];
+}
+
+// 第1種変形ベッセル関数I0(Kaiser窓に使う)
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+uint32_t GetCutoffIndex(double ratio) {
+  if (ratio <= 1.0) {
+    return 0;
+  }
+  // 帯域は必要より少しだけ狭い側に丸める
+  return uint32_t(std::ceil(std::log2(ratio) * kCutoffStepsPerOctave - 1e-9));
+}
+
+} // namespace
+
+struct Resampler::FilterTable {
+  uint32_t taps = 0;
+  uint32_t phaseShift = 0;
+  // (位相の数 + 1)行 × taps列。最後の行は次のフレームの位相0と同じ
+  std::vector<float> coefficients;
+};
+
+namespace {
+
+void BuildFilterTable(ResamplerQuality quality, uint32_t cutoffIndex,
+                      Resampler::FilterTable &table);
+
+// すべての品質・帯域のフィルタ。全部で4MB弱
+struct FilterTables {
+  Resampler::FilterTable tables[kQualityCount][kMaxCutoffIndex + 1];
+
+  FilterTables() {
+    for (uint32_t quality = 0; quality < kQualityCount; ++quality) {
+      for (uint32_t cutoff = 0; cutoff <= kMaxCutoffIndex; ++cutoff) {
+        BuildFilterTable(ResamplerQuality(quality), cutoff,
+                         tables[quality][cutoff]);
+      }
+    }
+  }
+};
+
+// 関数の中のstaticなので作るのは一度だけ。作った後は読むだけでロックしない
+const FilterTables &GetFilterTables() {
+  static const FilterTables tables;
+  return tables;
+}
+
+} // namespace
+
+const char *GetResamplerQualityName(ResamplerQuality quality) {
+  switch (quality) {
+  case ResamplerQuality::Low:
+    return "low";
+  case ResamplerQuality::High:
+    return "high";
+  default:
+    return "medium";
+  }
+}
+
+#pragma region フィルタ
+
+namespace {
+
+void BuildFilterTable(ResamplerQuality quality, uint32_t cutoffIndex,
+                      Resampler::FilterTable &table) {
+  const QualitySettings &settings = GetSettings(quality);
+  const uint32_t phases = 1u << settings.phaseShift;
+  const double cutoff =
+      settings.rolloff /
+      std::exp2(double(cutoffIndex) / kCutoffStepsPerOctave);
+  const double halfTaps = settings.taps / 2.0;
+  const double windowScale = 1.0 / BesselI0(settings.beta);
+
+  table.taps = settings.taps;
+  table.phaseShift = settings.phaseShift;
+  table.coefficients.resize(size_t(phases + 1) * settings.taps);
+
+  for (uint32_t phase = 0; phase <= phases; ++phase) {
+    const double fraction = double(phase) / phases;
+    float *row = table.coefficients.data() + size_t(phase) * settings.taps;
+    double sum = 0.0;
+    for (uint32_t tap = 0; tap < settings.taps; ++tap) {
+      // 出力位置から見た入力サンプルの距離
+      const double x = double(tap) - (halfTaps - 1.0) - fraction;
+      const double u = x / halfTaps;
+      double value = 0.0;
+      if (std::abs(u) < 1.0) {
+        const double t = std::numbers::pi * cutoff * x;
+        const double sinc = std::abs(t) < 1e-12 ? 1.0 : std::sin(t) / t;
+        const double window =
+            BesselI0(settings.beta * std::sqrt(1.0 - u * u)) * windowScale;
+        value = cutoff * sinc * window;
+      }
+      row[tap] = float(value);
+      sum += value;
+    }
+    // 直流の音量が変わらないように、位相ごとに合計を1にする
+    for (uint32_t tap = 0; tap < settings.taps; ++tap) {
+      row[tap] = float(row[tap] / sum);
+    }
+  }
+}
+
+} // namespace
+
+const Resampler::FilterTable &
+Resampler::GetFilterTable(ResamplerQuality quality, uint32_t cutoffIndex) {
+  // 同じ品質・帯域のフィルタはすべてのResamplerで共有する
+  return GetFilterTables()
+      .tables[uint32_t(quality)][std::min(cutoffIndex, kMaxCutoffIndex)];
+}
+
+void Resampler::PrepareFilterTables() { GetFilterTables(); }
+
+#pragma endregion
+
+#pragma region Resampler
+
+Resampler::Resampler(uint32_t channels, ResamplerQuality quality,
+                     SimdLevel simdLevel)
+    : channels_(channels), quality_(quality),
+      kernels_(&GetMixKernels(simdLevel)),
+      inputs_(channels, std::vector<float>(kMaxInputFrames + kMaxTaps)) {
+  filter_ = &GetFilterTable(quality_, 0);
+  SetRatio(1.0);
+  Reset();
+}
+
+Resampler::~Resampler() = default;
+
+void Resampler::SetRatio(double ratio) {
+  ratio_ = std::clamp(ratio, 1.0 / kMaxRatio, kMaxRatio);
+  step_ = uint64_t(std::llround(ratio_ * 4294967296.0));
+
+  const uint32_t cutoffIndex = GetCutoffIndex(ratio_);
+  if (cutoffIndex != cutoffIndex_) {
+    cutoffIndex_ = cutoffIndex;
+    filter_ = &GetFilterTable(quality_, cutoffIndex_);
+  }
+}
+
+void Resampler::Configure(uint32_t channels, ResamplerQuality quality) {
+  channels_ = std::min(channels, uint32_t(inputs_.size()));
+  quality_ = quality;
+  filter_ = &GetFilterTable(quality_, cutoffIndex_);
+  Reset();
+}
+
+void Resampler::Reset() {
+  // 最初の出力がフィルタの中心に来るよう、先頭を0で埋める
+  inputFrames_ = GetLatency() - 1;
+  for (uint32_t channel = 0; channel < channels_; ++channel) {
+    std::fill_n(inputs_[channel].begin(), inputFrames_, 0.0f);
+  }
+  position_ = 0;
+}
+
+uint32_t Resampler::GetFreeInputFrames() const {
+  return uint32_t(inputs_.empty() ? 0 : inputs_[0].size()) - inputFrames_;
+}
+
+uint32_t Resampler::GetRequiredInputFrames(uint32_t outputFrames) const {
+  if (outputFrames == 0) {
+    return 0;
+  }
+  const uint64_t last = position_ + uint64_t(outputFrames - 1) * step_;
+  const uint64_t needed = (last >> 32) + filter_->taps;
+  return needed > inputFrames_ ? uint32_t(needed - inputFrames_) : 0;
+}
+
+uint32_t Resampler::GetLatency() const { return filter_->taps / 2; }
+
+void Resampler::PushInput(const float *const *input, uint32_t frames) {
+  frames = std::min(frames, GetFreeInputFrames());
+  for (uint32_t channel = 0; channel < channels_; ++channel) {
+    std::memcpy(inputs_[channel].data() + inputFrames_, input[channel],
+                frames * sizeof(float));
+  }
+  inputFrames_ += frames;
+}
+
+uint32_t Resampler::PullOutput(float *const *output, uint32_t frames) {
+  const FilterTable &filter = *filter_;
+  const uint32_t taps = filter.taps;
+  const uint32_t fractionShift = 32 - filter.phaseShift;
+  const uint64_t halfPhase = uint64_t(1) << (fractionShift - 1);
+
+  uint32_t produced = 0;
+  for (; produced < frames; ++produced) {
+    const uint64_t base = position_ >> 32;
+    if (base + taps > inputFrames_) {
+      break;
+    }
+    // 一番近い位相の係数を使う
+    const uint64_t phase =
+        ((position_ & 0xFFFFFFFFull) + halfPhase) >> fractionShift;
+    const float *coefficients = filter.coefficients.data() + phase * taps;
+    for (uint32_t channel = 0; channel < channels_; ++channel) {
+      output[channel][produced] = kernels_->dotProduct(
+          inputs_[channel].data() + base, coefficients, taps);
+    }
+    position_ += step_;
+  }
+
+  // 使い終わった入力を詰める(残るのはフィルタの長さ程度)
+  const uint32_t drop =
+      uint32_t(std::min<uint64_t>(position_ >> 32, inputFrames_));
+  if (drop > 0) {
+    for (uint32_t channel = 0; channel < channels_; ++channel) {
+      std::memmove(inputs_[channel].data(), inputs_[channel].data() + drop,
+                   (inputFrames_ - drop) * sizeof(float));
+    }
+    inputFrames_ -= drop;
+    position_ -= uint64_t(drop) << 32;
+  }
+  return produced;
+}
+
+#pragma endregion
+
+#pragma region まとめて変換
+
+std::vector<std::vector<float>>
+ResampleBuffer(const std::vector<std::vector<float>> &input,
+               uint32_t inputRate, uint32_t outputRate,
+               ResamplerQuality quality) {
+  const uint32_t channels = uint32_t(input.size());
+  if (channels == 0 || inputRate == 0 || outputRate == 0) {
+    return {};
+  }
+  const uint64_t inputFrames = input[0].size();
+  const uint64_t outputFrames =
+      (inputFrames * outputRate + inputRate - 1) / inputRate;
+
+  std::vector<std::vector<float>> output(channels,
+                                         std::vector<float>(outputFrames));
+  Resampler resampler(channels, quality);
+  resampler.SetRatio(double(inputRate) / outputRate);
+
+  // 入力が尽きたら0を足して、フィルタに残った分を押し出す
+  const std::vector<float> silence(Resampler::kMaxInputFrames, 0.0f);
+  std::vector<const float *> inputPointers(channels);
+  std::vector<float *> outputPointers(channels);
+  uint64_t consumed = 0;
+  uint64_t produced = 0;
+  while (produced < outputFrames) {
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+      outputPointers[channel] = output[channel].data() + produced;
+    }
+    const uint32_t pulled = resampler.PullOutput(
+        outputPointers.data(),
+        uint32_t(std::min<uint64_t>(outputFrames - produced, 4096)));
+    produced += pulled;
+    if (pulled > 0) {
+      continue;
+    }
+
+    uint32_t frames = resampler.GetFreeInputFrames();
+    if (consumed < inputFrames) {
+      frames = uint32_t(std::min<uint64_t>(frames, inputFrames - consumed));
+      for (uint32_t channel = 0; channel < channels; ++channel) {
+        inputPointers[channel] = input[channel].data() + consumed;
+      }
+      consumed += frames;
+    } else {
+      frames = std::min<uint32_t>(frames, uint32_t(silence.size()));
+      std::fill(inputPointers.begin(), inputPointers.end(), silence.data());
+    }
+    resampler.PushInput(inputPointers.data(), frames);
+  }
+  return output;
+}
+
+#pragma endregion
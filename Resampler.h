@@ -0,0 +1,85 @@
+#pragma once
+#include "AudioMixKernels.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 品質が高いほどタップ数と位相の数が増え、重くなる
+enum class ResamplerQuality { Low, Medium, High };
+
+const char *GetResamplerQualityName(ResamplerQuality quality);
+
+// 窓付きsincのポリフェーズフィルタでサンプルレートを変換するクラス
+// チャンネルごとに分かれたfloat(planar)を入力し、同じ形で出力する
+// 変換比は再生中に変えられる(ピッチの変更に使う)
+// フィルタの係数は最初に使うときにすべての品質・帯域の分を作っておくので、
+// 構築した後はどの関数もロックもメモリの確保もしない(オーディオスレッドで使える)
+class Resampler {
+public:
+  // 入力側に溜めておけるフレーム数
+  static constexpr uint32_t kMaxInputFrames = 4096;
+  // これより速く進めると、フィルタが入力バッファに収まらない
+  static constexpr double kMaxRatio = 8.0;
+
+  // channelsは後でConfigureできるチャンネル数の上限も兼ねる
+  Resampler(uint32_t channels, ResamplerQuality quality,
+            SimdLevel simdLevel = GetSupportedSimdLevel());
+  ~Resampler();
+
+  // フィルタの係数を作っておく。オーディオスレッドで初めて使う前に呼んでおく
+  // (呼ばなくても最初に構築したときに作る)
+  static void PrepareFilterTables();
+  // フィルタの係数の表。中身はResampler.cppの中でだけ使う
+  struct FilterTable;
+
+  Resampler(const Resampler &) = delete;
+  Resampler &operator=(const Resampler &) = delete;
+
+  // ratioは入力レート/出力レート(にピッチを掛けたもの)
+  // 1より大きいときは折り返しが出ないようにフィルタの帯域を狭める
+  void SetRatio(double ratio);
+  double GetRatio() const { return ratio_; }
+
+  // 溜めた入力と位置を捨てて最初の状態に戻す
+  void Reset();
+  // チャンネル数(構築したときの数以下)と品質を変えてResetする。メモリは確保しない
+  void Configure(uint32_t channels, ResamplerQuality quality);
+
+  // あといくつ入力を受け取れるか
+  uint32_t GetFreeInputFrames() const;
+  // outputFramesだけ出力するのに、まだ足りない入力のフレーム数
+  uint32_t GetRequiredInputFrames(uint32_t outputFrames) const;
+  // フィルタの半分の長さ。入力の最後の音はこれだけ0を足すと出てくる
+  uint32_t GetLatency() const;
+
+  // framesはGetFreeInputFrames以下にすること
+  void PushInput(const float *const *input, uint32_t frames);
+  // 溜まっている入力から出せるだけ(最大frames)出力し、その数を返す
+  uint32_t PullOutput(float *const *output, uint32_t frames);
+
+private:
+  static const FilterTable &GetFilterTable(ResamplerQuality quality,
+                                           uint32_t cutoffIndex);
+
+  uint32_t channels_ = 0;
+  ResamplerQuality quality_ = ResamplerQuality::Medium;
+  const MixKernels *kernels_ = nullptr;
+  const FilterTable *filter_ = nullptr;
+  uint32_t cutoffIndex_ = 0;
+
+  double ratio_ = 1.0;
+  // 入力上の位置(32.32の固定小数)。整数部がフィルタの先頭のフレーム
+  uint64_t position_ = 0;
+  uint64_t step_ = 0;
+
+  // チャンネルごとの入力。先頭はフィルタの遅延分の0で埋めてある
+  std::vector<std::vector<float>> inputs_;
+  uint32_t inputFrames_ = 0;
+};
+
+// 全体をまとめて変換する(ツールなどで、前もって出力レートに揃えるとき用)
+// inputはチャンネルごとのfloat。戻り値も同じ形
+std::vector<std::vector<float>>
+ResampleBuffer(const std::vector<std::vector<float>> &input,
+               uint32_t inputRate, uint32_t outputRate,
+               ResamplerQuality quality);
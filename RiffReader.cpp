@@ -0,0 +1,179 @@
+#include "RiffReader.h"
+#include <cstring>
+
+namespace {
+
+uint16_t ReadU16(const uint8_t *p) { return uint16_t(p[0] | (p[1] << 8)); }
+
+uint32_t ReadU32(const uint8_t *p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+         (uint32_t(p[3]) << 24);
+}
+
+bool Fail(std::string *error, const char *message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+// KSDATAFORMAT_SUBTYPE_PCMなどは先頭2バイト以外が共通
+const uint8_t kSubFormatBase[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                    0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+bool ParseFormat(const RiffChunk &chunk, WaveFormat &format,
+                 std::string *error) {
+  if (chunk.size < 16) {
+    return Fail(error, "fmt chunk is too small");
+  }
+  const uint8_t *p = chunk.data;
+  format.formatTag = ReadU16(p);
+  format.channels = ReadU16(p + 2);
+  format.samplesPerSec = ReadU32(p + 4);
+  format.avgBytesPerSec = ReadU32(p + 8);
+  format.blockAlign = ReadU16(p + 12);
+  format.bitsPerSample = ReadU16(p + 14);
+  format.validBitsPerSample = format.bitsPerSample;
+
+  if (format.formatTag == kWaveFormatExtensible) {
+    // cbSize(2) + wValidBitsPerSample(2) + dwChannelMask(4) + SubFormat(16)
+    if (chunk.size < 40) {
+      return Fail(error, "WAVE_FORMAT_EXTENSIBLE fmt chunk is too small");
+    }
+    if (std::memcmp(p + 26, kSubFormatBase, sizeof(kSubFormatBase)) != 0) {
+      return Fail(error, "unknown WAVE_FORMAT_EXTENSIBLE sub format");
+    }
+    format.isExtensible = true;
+    format.validBitsPerSample = ReadU16(p + 18);
+    format.channelMask = ReadU32(p + 20);
+    format.formatTag = ReadU16(p + 24);
+    if (format.validBitsPerSample == 0) {
+      format.validBitsPerSample = format.bitsPerSample;
+    }
+  }
+
+  if (format.channels == 0 || format.samplesPerSec == 0 ||
+      format.blockAlign == 0) {
+    return Fail(error, "invalid fmt chunk");
+  }
+
+  // 非圧縮の形式はブロックサイズとビット数の整合も確かめる
+  if (format.formatTag == kWaveFormatPcm ||
+      format.formatTag == kWaveFormatIeeeFloat) {
+    uint32_t bits = format.bitsPerSample;
+    bool isValidBits = format.formatTag == kWaveFormatPcm
+                           ? (bits == 8 || bits == 16 || bits == 24 ||
+                              bits == 32)
+                           : (bits == 32 || bits == 64);
+    if (!isValidBits ||
+        format.blockAlign != format.channels * (bits / 8) ||
+        format.validBitsPerSample > bits) {
+      return Fail(error, "inconsistent PCM format");
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+#pragma region RIFF
+
+bool WalkRiffChunks(const uint8_t *data, size_t size, const char *formType,
+                    const std::function<bool(const RiffChunk &)> &visit,
+                    std::string *error) {
+  if (size < 12 || std::memcmp(data, "RIFF", 4) != 0) {
+    return Fail(error, "not a RIFF file");
+  }
+  if (std::memcmp(data + 8, formType, 4) != 0) {
+    return Fail(error, "unexpected RIFF form type");
+  }
+
+  // RIFFのサイズが実際より大きい(書き込み途中で止まった)ファイルもあるので、
+  // ファイルの終わりで打ち切る
+  size_t end = size;
+  uint64_t riffEnd = 8 + uint64_t(ReadU32(data + 4));
+  if (riffEnd < end) {
+    end = size_t(riffEnd);
+  }
+
+  size_t position = 12;
+  while (end - position >= 8) {
+    RiffChunk chunk;
+    std::memcpy(chunk.id, data + position, 4);
+    chunk.size = ReadU32(data + position + 4);
+    chunk.data = data + position + 8;
+
+    size_t available = end - position - 8;
+    if (chunk.size > available) {
+      // 末尾のdataだけが切れているのはよくあるので、読める分だけ使う
+      if (!chunk.Is("data")) {
+        return Fail(error, "chunk size exceeds file size");
+      }
+      chunk.size = uint32_t(available);
+    }
+
+    if (!visit(chunk)) {
+      return true;
+    }
+
+    // 奇数サイズのチャンクの後ろには1バイトの詰め物がある
+    size_t advance = 8 + size_t(chunk.size) + (chunk.size & 1);
+    if (advance > end - position) {
+      break;
+    }
+    position += advance;
+  }
+  return true;
+}
+
+#pragma endregion
+
+#pragma region WAVE
+
+bool ParseWave(const uint8_t *data, size_t size, WaveFile &wave,
+               std::string *error) {
+  wave = {};
+  bool hasFormat = false;
+  bool hasData = false;
+  bool isFormatValid = true;
+
+  bool isWalked = WalkRiffChunks(
+      data, size, "WAVE",
+      [&](const RiffChunk &chunk) {
+        if (chunk.Is("fmt ") && !hasFormat) {
+          hasFormat = true;
+          wave.formatChunk = chunk.data;
+          wave.formatChunkSize = chunk.size;
+          isFormatValid = ParseFormat(chunk, wave.format, error);
+          return isFormatValid;
+        }
+        if (chunk.Is("data") && !hasData) {
+          hasData = true;
+          wave.samples = chunk.data;
+          wave.sampleBytes = chunk.size;
+        } else if (chunk.Is("fact") && chunk.size >= 4) {
+          wave.factSampleCount = ReadU32(chunk.data);
+        }
+        // LIST, JUNK, bext, cue などは使わないので読み飛ばす
+        return true;
+      },
+      error);
+
+  if (!isWalked || !isFormatValid) {
+    return false;
+  }
+  if (!hasFormat) {
+    return Fail(error, "fmt chunk not found");
+  }
+  if (!hasData) {
+    return Fail(error, "data chunk not found");
+  }
+
+  if (wave.format.formatTag != kWaveFormatAdpcm &&
+      wave.format.formatTag != kWaveFormatImaAdpcm) {
+    wave.sampleBytes -= wave.sampleBytes % wave.format.blockAlign;
+  }
+  return true;
+}
+
+#pragma endregion
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#pragma region RIFF
+
+// RIFFのチャンク1つ分。dataは読み込んだファイルの中を直接指す
+struct RiffChunk {
+  char id[4];
+  const uint8_t *data;
+  uint32_t size;
+
+  bool Is(const char (&name)[5]) const {
+    return id[0] == name[0] && id[1] == name[1] && id[2] == name[2] &&
+           id[3] == name[3];
+  }
+};
+
+// formTypeのRIFFファイルのチャンクを先頭から順に渡す
+// visitがfalseを返したらそこで止める。形式が壊れていたらfalseを返す
+bool WalkRiffChunks(const uint8_t *data, size_t size, const char *formType,
+                    const std::function<bool(const RiffChunk &)> &visit,
+                    std::string *error = nullptr);
+
+#pragma endregion
+
+#pragma region WAVE
+
+const uint16_t kWaveFormatPcm = 0x0001;
+const uint16_t kWaveFormatAdpcm = 0x0002;
+const uint16_t kWaveFormatIeeeFloat = 0x0003;
+const uint16_t kWaveFormatImaAdpcm = 0x0011;
+const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+struct WaveFormat {
+  // WAVE_FORMAT_EXTENSIBLEのときはSubFormatから取り出した形式
+  uint16_t formatTag = 0;
+  uint16_t channels = 0;
+  uint32_t samplesPerSec = 0;
+  uint32_t avgBytesPerSec = 0;
+  uint16_t blockAlign = 0;
+  uint16_t bitsPerSample = 0;
+  uint16_t validBitsPerSample = 0;
+  // 0ならチャンネル数から決まる標準の並び
+  uint32_t channelMask = 0;
+  bool isExtensible = false;
+};
+
+struct WaveFile {
+  WaveFormat format;
+  // fmtチャンクの中身(形式ごとの追加情報もここにある)
+  const uint8_t *formatChunk = nullptr;
+  uint32_t formatChunkSize = 0;
+  // dataチャンク。非圧縮の形式はblockAlignの倍数に切り詰めてある
+  // (ADPCMの最後のブロックは短いことがあるので切り詰めない)
+  const uint8_t *samples = nullptr;
+  uint32_t sampleBytes = 0;
+  // factチャンクがあればその値(圧縮形式のサンプル数)、なければ0
+  uint32_t factSampleCount = 0;
+};
+
+// WAVファイル全体を解析する。サンプルはコピーせずdataの中を指す
+bool ParseWave(const uint8_t *data, size_t size, WaveFile &wave,
+               std::string *error = nullptr);
+
+#pragma endregion
@@ -0,0 +1,41 @@
+#include "RingAllocator.h"
+
+uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  if (size > capacity_) {
+    return kInvalidOffset;
+  }
+  if (head_ == tail_) {
+    // 全部返っていれば先頭から使う。途中から始めると大きいものが入らない
+    head_ = 0;
+    tail_ = 0;
+  }
+  const uint64_t offset = head_ % capacity_;
+  uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+  if (aligned + size > capacity_) {
+    // 末尾の残りは捨てて先頭から切り出す
+    aligned = 0;
+  }
+  const uint64_t consumed =
+      (aligned >= offset ? aligned - offset : capacity_ - offset) + size;
+  if (GetUsedSize() + consumed > capacity_) {
+    return kInvalidOffset;
+  }
+  head_ += consumed;
+  return aligned;
+}
+
+void RingAllocator::Submit(uint64_t fenceValue) {
+  // 前の印から新しく割り当てていなければ何もしない
+  const uint64_t submitted = regions_.empty() ? tail_ : regions_.back().end;
+  if (head_ != submitted) {
+    regions_.push_back({fenceValue, head_});
+  }
+}
+
+void RingAllocator::Release(uint64_t completedFenceValue) {
+  while (!regions_.empty() &&
+         regions_.front().fenceValue <= completedFenceValue) {
+    tail_ = regions_.front().end;
+    regions_.pop_front();
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+// 先頭から順に切り出し、GPUが使い終わった古い方から返していくリングバッファの割り当て
+// バッファそのものは持たずオフセットだけを扱うので、GPUなしでも動かせる
+// 1つの割り当てが末尾をまたぐことはない(足りなければ先頭まで飛ばす)
+class RingAllocator {
+public:
+  static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+  explicit RingAllocator(uint64_t capacity) : capacity_(capacity) {}
+
+  // alignmentは2のべき乗。空きが足りなければkInvalidOffsetを返す
+  uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+
+  // ここまでの割り当てに、GPUがfenceValueまで進んだら返すという印を付ける
+  // コマンドをキューに積んでSignalした後に、その値で呼ぶ
+  void Submit(uint64_t fenceValue);
+  // completedFenceValue以下の印が付いた割り当てを返す
+  void Release(uint64_t completedFenceValue);
+
+  uint64_t GetCapacity() const { return capacity_; }
+  // 境界合わせや末尾を飛ばした分も含む
+  uint64_t GetUsedSize() const { return head_ - tail_; }
+
+private:
+  struct Region {
+    uint64_t fenceValue;
+    // この印までに割り当てた位置(headと同じく戻らない値)
+    uint64_t end;
+  };
+
+  uint64_t capacity_ = 0;
+  // 割り当てた量と返した量の累計。差が使用中の量になる
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+  std::deque<Region> regions_;
+};
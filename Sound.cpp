@@ -0,0 +1,170 @@
+#include "Sound.h"
+#include "RiffReader.h"
+#include "VirtualFileSystem.h"
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#pragma region 音声
+
+#pragma region 音声データの読み込み
+
+namespace {
+
+SoundData LoadAdpcmWave(const char *filename, const WaveFile &wave,
+                        std::shared_ptr<const void> owner,
+                        const SoundDecodePolicy &policy) {
+  AdpcmFormat adpcm;
+  std::string error;
+  if (!ParseAdpcmFormat(wave, adpcm, &error)) {
+    std::cerr << "Failed to load WAV file: " << filename << " (" << error
+              << ")" << std::endl;
+    return {};
+  }
+
+  SoundData soundData = {};
+  soundData.wfex.nChannels = adpcm.channels;
+  soundData.wfex.nSamplesPerSec = wave.format.samplesPerSec;
+  soundData.channelMask = wave.format.channelMask;
+
+  const size_t decodedBytes =
+      size_t(adpcm.frameCount) * adpcm.channels * sizeof(int16_t);
+  const bool isDecoding =
+      policy.adpcmMode == AdpcmDecodeMode::OnLoad ||
+      (policy.adpcmMode == AdpcmDecodeMode::Auto &&
+       decodedBytes <= policy.maxDecodedBytes);
+  if (!isDecoding) {
+    // ファイルのマップはそのままにして、ブロックを直接指す
+    soundData.wfex.wFormatTag = adpcm.formatTag;
+    soundData.wfex.nBlockAlign = uint16_t(adpcm.blockAlign);
+    soundData.wfex.nAvgBytesPerSec = wave.format.avgBytesPerSec;
+    soundData.wfex.wBitsPerSample = 4;
+    soundData.adpcm = adpcm;
+    soundData.pBUffer = wave.samples;
+    soundData.bufferSize = wave.sampleBytes;
+    soundData.storage = std::move(owner);
+    return soundData;
+  }
+
+  // 16bitのPCMに展開したら、ファイルはもう要らない
+  auto samples = std::make_shared<std::vector<int16_t>>(
+      DecodeAdpcm(adpcm, wave.samples, wave.sampleBytes));
+  soundData.wfex.wFormatTag = kWaveFormatPcm;
+  soundData.wfex.nBlockAlign = uint16_t(adpcm.channels * sizeof(int16_t));
+  soundData.wfex.nAvgBytesPerSec =
+      soundData.wfex.nSamplesPerSec * soundData.wfex.nBlockAlign;
+  soundData.wfex.wBitsPerSample = 16;
+  soundData.pBUffer = reinterpret_cast<const BYTE *>(samples->data());
+  soundData.bufferSize = unsigned(samples->size() * sizeof(int16_t));
+  soundData.storage = std::move(samples);
+  return soundData;
+}
+
+} // namespace
+
+SoundData SoundLoadWave(const char *filename,
+                        const SoundDecodePolicy &policy) {
+  FileData file = VirtualFileSystem::GetInstance().ReadFile(filename);
+  if (!file.IsValid()) {
+    std::cerr << "Failed to open WAV file: " << filename << std::endl;
+    return {};
+  }
+
+  // チャンクをすべてたどり、dataはコピーせずファイルの中を指す
+  WaveFile wave;
+  std::string error;
+  if (!ParseWave(file.data, file.size, wave, &error)) {
+    std::cerr << "Failed to load WAV file: " << filename << " (" << error
+              << ")" << std::endl;
+    return {};
+  }
+  const bool isAdpcm = IsAdpcmFormatTag(wave.format.formatTag);
+  if (wave.format.formatTag != kWaveFormatPcm &&
+      wave.format.formatTag != kWaveFormatIeeeFloat && !isAdpcm) {
+    std::cerr << "Unsupported WAV format: " << filename << " (0x" << std::hex
+              << wave.format.formatTag << std::dec << ")" << std::endl;
+    return {};
+  }
+  if (isAdpcm) {
+    return LoadAdpcmWave(filename, wave, std::move(file.owner), policy);
+  }
+
+  SoundData soundData = {};
+
+  // WAVE_FORMAT_EXTENSIBLEもPCM/IEEE_FLOATにそろえ、配置だけ残す
+  soundData.wfex.wFormatTag = wave.format.formatTag;
+  soundData.wfex.nChannels = wave.format.channels;
+  soundData.wfex.nSamplesPerSec = wave.format.samplesPerSec;
+  soundData.wfex.nAvgBytesPerSec =
+      wave.format.samplesPerSec * wave.format.blockAlign;
+  soundData.wfex.nBlockAlign = wave.format.blockAlign;
+  soundData.wfex.wBitsPerSample = wave.format.bitsPerSample;
+  soundData.wfex.cbSize = 0;
+  soundData.channelMask = wave.format.channelMask;
+
+  soundData.pBUffer = wave.samples;
+  soundData.bufferSize = wave.sampleBytes;
+  soundData.storage = std::move(file.owner);
+
+  return soundData;
+}
+
+#pragma endregion
+
+#pragma region 音声データの解放
+void SoundUnload(SoundData *soundData) {
+  // 他に参照がなければここでファイルのマップが外れる
+  soundData->storage.reset();
+
+  soundData->pBUffer = 0;
+  soundData->bufferSize = 0;
+  soundData->wfex = {};
+  soundData->adpcm = {};
+}
+
+#pragma endregion
+
+#pragma region 音声データを共有して読み込む
+AssetRegistry::Handle<SoundData>
+AcquireSoundWave(const char *filename, const SoundDecodePolicy &policy) {
+  return AssetRegistry::GetInstance().Acquire<SoundData>(
+      AssetType::Sound, filename,
+      [&](SoundData &soundData) {
+        soundData = SoundLoadWave(filename, policy);
+        return soundData.storage != nullptr;
+      },
+      [](const SoundData &soundData) {
+        return sizeof(SoundData) + soundData.bufferSize;
+      },
+      [](SoundData &soundData) { SoundUnload(&soundData); });
+}
+
+#pragma endregion
+
+#pragma region ボイスの形式
+#ifdef _WIN32
+
+WAVEFORMATEXTENSIBLE SoundGetVoiceFormat(const SoundData &soundData) {
+  WAVEFORMATEXTENSIBLE extensible{};
+  extensible.Format = soundData.wfex;
+
+  // 3チャンネル以上で配置が決まっているときはEXTENSIBLEで渡す
+  if (soundData.channelMask != 0 && soundData.wfex.nChannels > 2) {
+    extensible.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+    extensible.Format.cbSize =
+        sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+    extensible.Samples.wValidBitsPerSample = soundData.wfex.wBitsPerSample;
+    extensible.dwChannelMask = soundData.channelMask;
+    extensible.SubFormat = {soundData.wfex.wFormatTag,
+                            0x0000,
+                            0x0010,
+                            {0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71}};
+  }
+  return extensible;
+}
+
+#endif
+#pragma endregion
+
+#pragma endregion
@@ -0,0 +1,99 @@
+#pragma once
+#include "Adpcm.h"
+#include "AssetRegistry.h"
+#include <cstdint>
+#include <memory>
+#ifdef _WIN32
+// std::min/std::maxと衝突しないようにする
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <mmreg.h>
+#include <xaudio2.h>
+#else
+// Windows以外(ツールやCI)でも読み込みだけはできるよう、必要な型を用意しておく
+typedef uint8_t BYTE;
+
+#pragma pack(push, 1)
+typedef struct tWAVEFORMATEX {
+  uint16_t wFormatTag;
+  uint16_t nChannels;
+  uint32_t nSamplesPerSec;
+  uint32_t nAvgBytesPerSec;
+  uint16_t nBlockAlign;
+  uint16_t wBitsPerSample;
+  uint16_t cbSize;
+} WAVEFORMATEX;
+#pragma pack(pop)
+
+#define WAVE_FORMAT_PCM 1
+#endif
+
+#pragma region サウンド再生
+struct ChunkHeader {
+  char id[4];
+  int32_t size;
+};
+
+struct RiffHeader {
+  ChunkHeader chunk;
+  char type[4];
+};
+
+struct FormatChunk {
+  ChunkHeader chunk;
+  WAVEFORMATEX fmt;
+};
+
+struct SoundData {
+  WAVEFORMATEX wfex;
+  // storageの中(メモリマップしたファイルなど)を直接指す
+  const BYTE *pBUffer;
+  unsigned int bufferSize;
+  // 3チャンネル以上のときのスピーカー配置。0なら標準の並び
+  uint32_t channelMask;
+  // ADPCMのまま持っているときの形式。PCMならIsValid()がfalse
+  // (このときpBUfferはADPCMのブロックの並びで、AudioMixerでだけ鳴らせる)
+  AdpcmFormat adpcm;
+  // pBUfferの中身を持っているもの。最後の参照がなくなると解放される
+  std::shared_ptr<const void> storage;
+};
+
+// ADPCMのWAVをいつPCMに展開するか
+enum class AdpcmDecodeMode {
+  // 読み込み時にすべて展開する。XAudio2(VoicePool)でも鳴らせる
+  OnLoad,
+  // 圧縮したまま持ち、AudioMixerが鳴らしながらブロックごとに展開する
+  OnPlay,
+  // 展開した大きさがmaxDecodedBytes以下ならOnLoad、超えるならOnPlay
+  Auto,
+};
+
+struct SoundDecodePolicy {
+  AdpcmDecodeMode adpcmMode = AdpcmDecodeMode::OnLoad;
+  size_t maxDecodedBytes = 256 * 1024;
+};
+
+#pragma endregion
+
+#pragma region 関数
+
+SoundData SoundLoadWave(const char *filename,
+                        const SoundDecodePolicy &policy = {});
+
+void SoundUnload(SoundData *soundData);
+
+// AssetRegistry経由で読み込む。最後のハンドルが破棄されるとSoundUnloadされる
+// すでに読み込まれていれば、policyに関係なくそれを共有する
+// 読めなければ登録せずにnullptrを返す
+AssetRegistry::Handle<SoundData>
+AcquireSoundWave(const char *filename, const SoundDecodePolicy &policy = {});
+
+#ifdef _WIN32
+// CreateSourceVoiceに渡す形式。再生はVoicePoolを使う
+// ADPCMのまま持っている音には使えない
+WAVEFORMATEXTENSIBLE SoundGetVoiceFormat(const SoundData &soundData);
+#endif
+
+#pragma endregion
@@ -0,0 +1,189 @@
+#include "SoundBank.h"
+#include "PackFile.h"
+#include "PcmConvert.h"
+#include "RiffReader.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+char ToLowerAscii(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (ToLowerAscii(a[i]) != ToLowerAscii(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ミキサーがdataSizeを信じて読めるよう、形式と大きさの組み合わせを確かめる
+bool IsValidEntry(const SoundBankEntry &entry) {
+  if (entry.channels == 0 || entry.channels > kMaxPcmChannels ||
+      entry.sampleRate == 0 || entry.frameCount == 0) {
+    return false;
+  }
+  if (entry.formatTag == kWaveFormatPcm) {
+    return entry.blockAlign == entry.channels * sizeof(int16_t) &&
+           entry.samplesPerBlock == 1 &&
+           uint64_t(entry.frameCount) * entry.blockAlign == entry.dataSize;
+  }
+  if (entry.formatTag == kWaveFormatImaAdpcm) {
+    // チャンネルごとにヘッダ4バイトと8サンプルずつの4バイト
+    const uint32_t channelBytes = 4 * entry.channels;
+    if (entry.blockAlign <= channelBytes || entry.blockAlign > UINT16_MAX ||
+        entry.blockAlign % channelBytes != 0 ||
+        entry.samplesPerBlock !=
+            (entry.blockAlign / channelBytes - 1) * 8 + 1) {
+      return false;
+    }
+    // 最後のブロックも埋めてあるので、ブロックの数で大きさが決まる
+    const uint64_t blocks =
+        (uint64_t(entry.frameCount) + entry.samplesPerBlock - 1) /
+        entry.samplesPerBlock;
+    return blocks * entry.blockAlign == entry.dataSize;
+  }
+  return false;
+}
+
+} // namespace
+
+bool SoundBank::Open(const std::string &path) {
+  Close();
+
+  FileData file = VirtualFileSystem::GetInstance().ReadFile(path);
+  if (!file.IsValid() || file.size < sizeof(SoundBankHeader)) {
+    return false;
+  }
+
+  const uint8_t *data = file.data;
+  const uint64_t fileSize = file.size;
+  SoundBankHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kSoundBankMagic, sizeof(kSoundBankMagic)) !=
+          0 ||
+      header.version != kSoundBankVersion) {
+    return false;
+  }
+
+  // エントリの表はメモリをそのまま参照するので、アドレスの配置も確かめる
+  // (パックの中ではパックのalignmentに従って置かれている)
+  if (header.entryOffset > fileSize ||
+      reinterpret_cast<uintptr_t>(data + header.entryOffset) %
+              alignof(SoundBankEntry) !=
+          0 ||
+      uint64_t(header.entryCount) >
+          (fileSize - header.entryOffset) / sizeof(SoundBankEntry) ||
+      header.nameOffset > fileSize) {
+    return false;
+  }
+
+  const SoundBankEntry *entries =
+      reinterpret_cast<const SoundBankEntry *>(data + header.entryOffset);
+  const uint64_t nameAreaSize = fileSize - header.nameOffset;
+  for (uint32_t i = 0; i < header.entryCount; ++i) {
+    const SoundBankEntry &entry = entries[i];
+    if (uint64_t(entry.nameOffset) + entry.nameLength > nameAreaSize ||
+        entry.dataOffset > fileSize ||
+        entry.dataSize > fileSize - entry.dataOffset ||
+        reinterpret_cast<uintptr_t>(data + entry.dataOffset) %
+                alignof(int16_t) !=
+            0 ||
+        !IsValidEntry(entry)) {
+      return false;
+    }
+  }
+
+  file_ = std::move(file);
+  header_ = header;
+  entries_ = entries;
+  names_ = reinterpret_cast<const char *>(data + header.nameOffset);
+  return true;
+}
+
+void SoundBank::Close() {
+  // 渡したSoundDataが残っていれば、マップはそれが消えるまで保たれる
+  file_ = {};
+  header_ = {};
+  entries_ = nullptr;
+  names_ = nullptr;
+}
+
+std::string_view SoundBank::GetSoundName(uint32_t index) const {
+  const SoundBankEntry &entry = entries_[index];
+  return std::string_view(names_ + entry.nameOffset, entry.nameLength);
+}
+
+uint64_t SoundBank::GetSampleBytes() const {
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < header_.entryCount; ++i) {
+    total += entries_[i].dataSize;
+  }
+  return total;
+}
+
+const SoundBankEntry *SoundBank::FindEntry(std::string_view name) const {
+  if (entries_ == nullptr) {
+    return nullptr;
+  }
+
+  const uint64_t hash = HashPackName(name);
+  const SoundBankEntry *end = entries_ + header_.entryCount;
+  const SoundBankEntry *it =
+      std::lower_bound(entries_, end, hash,
+                       [](const SoundBankEntry &entry, uint64_t h) {
+                         return entry.nameHash < h;
+                       });
+
+  // ハッシュが衝突していることもあるので名前も比べる
+  for (; it != end && it->nameHash == hash; ++it) {
+    if (EqualsIgnoreCase(
+            std::string_view(names_ + it->nameOffset, it->nameLength), name)) {
+      return it;
+    }
+  }
+  return nullptr;
+}
+
+SoundData SoundBank::GetSound(std::string_view name) const {
+  const SoundBankEntry *entry = FindEntry(name);
+  return entry != nullptr ? MakeSoundData(*entry) : SoundData{};
+}
+
+SoundData SoundBank::GetSound(uint32_t index) const {
+  return index < header_.entryCount ? MakeSoundData(entries_[index])
+                                    : SoundData{};
+}
+
+SoundData SoundBank::MakeSoundData(const SoundBankEntry &entry) const {
+  SoundData soundData = {};
+  soundData.wfex.wFormatTag = entry.formatTag;
+  soundData.wfex.nChannels = entry.channels;
+  soundData.wfex.nSamplesPerSec = entry.sampleRate;
+  soundData.wfex.nBlockAlign = uint16_t(entry.blockAlign);
+  soundData.wfex.nAvgBytesPerSec = uint32_t(
+      uint64_t(entry.sampleRate) * entry.blockAlign / entry.samplesPerBlock);
+  soundData.wfex.wBitsPerSample =
+      entry.formatTag == kWaveFormatImaAdpcm ? 4 : 16;
+  soundData.channelMask = entry.channelMask;
+
+  if (entry.formatTag == kWaveFormatImaAdpcm) {
+    soundData.adpcm.formatTag = entry.formatTag;
+    soundData.adpcm.channels = entry.channels;
+    soundData.adpcm.blockAlign = entry.blockAlign;
+    soundData.adpcm.samplesPerBlock = entry.samplesPerBlock;
+    soundData.adpcm.frameCount = entry.frameCount;
+  }
+
+  // バンク全体を持っているものを共有する
+  soundData.pBUffer = file_.data + entry.dataOffset;
+  soundData.bufferSize = entry.dataSize;
+  soundData.storage = file_.owner;
+  return soundData;
+}
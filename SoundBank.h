@@ -0,0 +1,83 @@
+#pragma once
+#include "MappedFile.h"
+#include "Sound.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#pragma region サウンドバンクの形式
+
+// ファイルの並び
+//   SoundBankHeader
+//   各サウンドのサンプル(alignmentごとに揃える)
+//   SoundBankEntry[entryCount](nameHashの昇順)
+//   名前の文字列(終端なし)
+//
+// サンプルは作るときに16bit PCMかIMA ADPCMにそろえてあるので、
+// 読み込み側は変換もコピーもせずにマップしたメモリを指すだけでよい
+const char kSoundBankMagic[4] = {'S', 'B', 'N', 'K'};
+const uint32_t kSoundBankVersion = 1;
+
+struct SoundBankHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t alignment;
+  uint64_t entryOffset;
+  uint64_t nameOffset;
+};
+
+struct SoundBankEntry {
+  // 名前はパックと同じくHashPackNameで引く
+  uint64_t nameHash;
+  uint32_t nameOffset;
+  uint32_t nameLength;
+  uint64_t dataOffset;
+  uint32_t dataSize;
+  // kWaveFormatPcm(16bit)かkWaveFormatImaAdpcm
+  uint16_t formatTag;
+  uint16_t channels;
+  uint32_t sampleRate;
+  uint32_t channelMask;
+  uint32_t blockAlign;
+  // ADPCMのときの1ブロックのフレーム数。PCMなら1
+  uint32_t samplesPerBlock;
+  uint32_t frameCount;
+  uint32_t reserved;
+};
+
+#pragma endregion
+
+// 多数の効果音をまとめたバンクを一度にマップし、コピーせずに渡すクラス
+// 返したSoundDataはマップを共有するので、バンクより長く使ってもよい
+class SoundBank {
+public:
+  // VirtualFileSystemから読む。パックに無圧縮で入っていればそのままマップを使う
+  bool Open(const std::string &path);
+  void Close();
+
+  bool IsOpen() const { return file_.IsValid(); }
+
+  bool Contains(std::string_view name) const {
+    return FindEntry(name) != nullptr;
+  }
+
+  // 見つからなければ無効(bufferSizeが0)なSoundDataを返す
+  // ADPCMの音はOnPlayで読み込んだときと同じく、AudioMixerでだけ鳴らせる
+  SoundData GetSound(std::string_view name) const;
+  SoundData GetSound(uint32_t index) const;
+
+  uint32_t GetSoundCount() const { return header_.entryCount; }
+  std::string_view GetSoundName(uint32_t index) const;
+  // サンプルの合計バイト数(メモリ使用量の目安)
+  uint64_t GetSampleBytes() const;
+
+private:
+  const SoundBankEntry *FindEntry(std::string_view name) const;
+  SoundData MakeSoundData(const SoundBankEntry &entry) const;
+
+  FileData file_;
+  SoundBankHeader header_{};
+  const SoundBankEntry *entries_ = nullptr;
+  const char *names_ = nullptr;
+};
@@ -0,0 +1,296 @@
+#include "SoundStream.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+SoundStream::~SoundStream() {
+#ifdef _WIN32
+  Stop();
+#endif
+  Close();
+}
+
+#pragma region ヘッダーの読み込み
+
+bool SoundStream::Open(const std::string &filename, bool isLooping,
+                       uint32_t blockSize, uint32_t blockCount) {
+  Close();
+
+  // パックに入っていればそのメモリから読む。なければファイルを開いて少しずつ読む
+  VirtualFileSystem &fileSystem = VirtualFileSystem::GetInstance();
+  packed_ = fileSystem.ReadPackedFile(filename);
+  packedPosition_ = 0;
+  if (!packed_.IsValid()) {
+    if (!fileSystem.IsLooseFileFallback()) {
+      return false;
+    }
+    file_ = std::fopen(VirtualFileSystem::NormalizePath(filename).c_str(),
+                       "rb");
+    if (file_ == nullptr) {
+      return false;
+    }
+  }
+
+  RiffHeader riff;
+  if (Read(&riff, sizeof(riff)) != sizeof(riff) ||
+      strncmp(riff.chunk.id, "RIFF", 4) != 0 ||
+      strncmp(riff.type, "WAVE", 4) != 0) {
+    Close();
+    return false;
+  }
+
+  // fmtとdataが見つかるまでチャンクを順にたどる。それ以外は読み飛ばす
+  bool hasFormat = false;
+  bool hasData = false;
+  ChunkHeader chunk;
+  while (!(hasFormat && hasData) &&
+         Read(&chunk, sizeof(chunk)) == sizeof(chunk)) {
+    uint32_t chunkSize = uint32_t(chunk.size);
+    // チャンクは2バイト境界に揃えてある
+    uint64_t paddedSize = uint64_t(chunkSize) + (chunkSize & 1);
+    const uint64_t chunkOffset = Tell();
+
+    if (strncmp(chunk.id, "fmt ", 4) == 0 && !hasFormat) {
+      if (chunkSize < 16) {
+        break;
+      }
+      // 16バイトしかない古い形式でもcbSizeまで読めるようにしておく
+      format_.assign(std::max<size_t>(chunkSize, sizeof(WAVEFORMATEX)), 0);
+      if (Read(format_.data(), chunkSize) != chunkSize) {
+        break;
+      }
+      Seek(chunkOffset + paddedSize);
+      hasFormat = true;
+    } else if (strncmp(chunk.id, "data", 4) == 0 && !hasData) {
+      dataOffset_ = chunkOffset;
+      dataSize_ = chunkSize;
+      hasData = true;
+      if (!hasFormat) {
+        Seek(chunkOffset + paddedSize);
+      }
+    } else {
+      Seek(chunkOffset + paddedSize);
+    }
+  }
+
+  if (!hasFormat || !hasData) {
+    Close();
+    return false;
+  }
+
+  // ブロックはサンプルの途中で切れないようにする
+  uint32_t blockAlign = std::max<uint32_t>(GetFormat().nBlockAlign, 1);
+  blockSize_ = std::max(blockSize - blockSize % blockAlign, blockAlign);
+  blockCount_ = std::max<uint32_t>(blockCount, 2);
+  buffer_.assign(size_t(blockSize_) * blockCount_, 0);
+  isLooping_ = isLooping;
+  return true;
+}
+
+void SoundStream::Close() {
+  StopReading();
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+  packed_ = {};
+  packedPosition_ = 0;
+  format_.clear();
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  dataSize_ = 0;
+}
+
+#pragma endregion
+
+#pragma region 読み込みスレッド
+
+void SoundStream::Start(SubmitFunction submit) {
+  StopReading();
+  assert(IsOpen());
+
+  Seek(dataOffset_);
+  dataPosition_ = 0;
+  nextBlock_ = 0;
+  freeBlockCount_ = blockCount_;
+  isEndReached_ = false;
+  isStopping_ = false;
+  submit_ = std::move(submit);
+  thread_ = std::thread(&SoundStream::ThreadMain, this);
+}
+
+void SoundStream::StopReading() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  condition_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SoundStream::ReleaseBlock() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (freeBlockCount_ < blockCount_) {
+      ++freeBlockCount_;
+    }
+  }
+  condition_.notify_one();
+}
+
+bool SoundStream::IsFinished() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return isEndReached_ && freeBlockCount_ == blockCount_;
+}
+
+void SoundStream::ThreadMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this]() {
+      return isStopping_ || (freeBlockCount_ > 0 && !isEndReached_);
+    });
+    if (isStopping_) {
+      return;
+    }
+
+    // 空いたブロックは渡した順に返ってくるので、リングの順に使えばよい
+    --freeBlockCount_;
+    BYTE *block = buffer_.data() + size_t(nextBlock_) * blockSize_;
+    nextBlock_ = (nextBlock_ + 1) % blockCount_;
+
+    // ファイルの読み込み中は再生側をブロックしない
+    lock.unlock();
+    uint32_t size = ReadBlock(block);
+    bool isEndOfStream = !isLooping_ && dataPosition_ >= dataSize_;
+    if (size > 0) {
+      submit_(block, size, isEndOfStream);
+    }
+    lock.lock();
+
+    if (size == 0) {
+      ++freeBlockCount_;
+    }
+    if (isEndOfStream || size == 0) {
+      isEndReached_ = true;
+    }
+  }
+}
+
+uint32_t SoundStream::ReadBlock(BYTE *block) {
+  uint32_t filled = 0;
+  while (filled < blockSize_) {
+    if (dataPosition_ >= dataSize_) {
+      if (!isLooping_ || dataSize_ == 0) {
+        break;
+      }
+      Seek(dataOffset_);
+      dataPosition_ = 0;
+    }
+
+    uint32_t readSize =
+        std::min(dataSize_ - dataPosition_, blockSize_ - filled);
+    uint32_t actualSize = uint32_t(Read(block + filled, readSize));
+    filled += actualSize;
+    dataPosition_ += actualSize;
+    if (actualSize < readSize) {
+      // ヘッダーより短いファイルは、読めたところまでを全体とする
+      dataSize_ = dataPosition_;
+    }
+  }
+
+  uint32_t blockAlign = std::max<uint32_t>(GetFormat().nBlockAlign, 1);
+  return filled - filled % blockAlign;
+}
+
+size_t SoundStream::Read(void *dst, size_t size) {
+  if (file_ != nullptr) {
+    return std::fread(dst, 1, size, file_);
+  }
+  const uint64_t remaining =
+      packed_.size - std::min<uint64_t>(packedPosition_, packed_.size);
+  size = size_t(std::min<uint64_t>(size, remaining));
+  if (size > 0) {
+    std::memcpy(dst, packed_.data + packedPosition_, size);
+    packedPosition_ += size;
+  }
+  return size;
+}
+
+bool SoundStream::Seek(uint64_t offset) {
+  if (file_ == nullptr) {
+    // 最後より後に移ったときは、次のReadで何も読めないだけにする
+    packedPosition_ = offset;
+    return offset <= packed_.size;
+  }
+#ifdef _WIN32
+  return _fseeki64(file_, int64_t(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file_, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+uint64_t SoundStream::Tell() const {
+  if (file_ == nullptr) {
+    return packedPosition_;
+  }
+#ifdef _WIN32
+  return uint64_t(_ftelli64(file_));
+#else
+  return uint64_t(ftello(file_));
+#endif
+}
+
+#pragma endregion
+
+#pragma region XAudio2での再生
+#ifdef _WIN32
+
+bool SoundStream::Play(IXAudio2 *xAudio2, float volume) {
+  Stop();
+  if (!IsOpen()) {
+    return false;
+  }
+
+  // 再生が終わったブロックはOnBufferEndで返ってくる
+  HRESULT result = xAudio2->CreateSourceVoice(
+      &voice_, &GetFormat(), 0, XAUDIO2_DEFAULT_FREQ_RATIO, this);
+  if (FAILED(result)) {
+    voice_ = nullptr;
+    return false;
+  }
+  voice_->SetVolume(volume);
+
+  Start([this](const BYTE *data, uint32_t size, bool isEndOfStream) {
+    XAUDIO2_BUFFER buf{};
+    buf.pAudioData = data;
+    buf.AudioBytes = size;
+    buf.Flags = isEndOfStream ? XAUDIO2_END_OF_STREAM : 0;
+    voice_->SubmitSourceBuffer(&buf);
+  });
+  voice_->Start();
+  return true;
+}
+
+void SoundStream::Stop() {
+  if (voice_ == nullptr) {
+    return;
+  }
+  voice_->Stop();
+  StopReading();
+  voice_->FlushSourceBuffers();
+  // コールバックがすべて終わるまで待ってから戻る
+  voice_->DestroyVoice();
+  voice_ = nullptr;
+}
+
+void SoundStream::SetVolume(float volume) {
+  if (voice_ != nullptr) {
+    voice_->SetVolume(volume);
+  }
+}
+
+#endif
+#pragma endregion
@@ -0,0 +1,116 @@
+#pragma once
+#include "MappedFile.h"
+#include "Sound.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// WAVファイルを少しずつ読みながら再生するクラス(BGMなどの長い音声用)
+// 読み込みスレッドが固定サイズのブロックをリングに読み込み、
+// 再生の終わったブロックから順に使い回す
+// パックに入っていればVirtualFileSystemが返すメモリから、なければファイルから読む
+class SoundStream
+#ifdef _WIN32
+    : public IXAudio2VoiceCallback
+#endif
+{
+public:
+  // 読み込んだブロックを渡す処理。読み込みスレッドから呼ばれる
+  // 再生が終わったらReleaseBlockを呼んでブロックを返すこと
+  using SubmitFunction =
+      std::function<void(const BYTE *data, uint32_t size, bool isEndOfStream)>;
+
+  static const uint32_t kDefaultBlockSize = 64 * 1024;
+  static const uint32_t kDefaultBlockCount = 3;
+
+  SoundStream() = default;
+  ~SoundStream();
+
+  SoundStream(const SoundStream &) = delete;
+  SoundStream &operator=(const SoundStream &) = delete;
+
+  // ヘッダーだけを読む。サンプルは再生しながら読む
+  // (パックに入っているときは、マップされた中身や展開済みのバッファを指すだけ)
+  bool Open(const std::string &filename, bool isLooping = false,
+            uint32_t blockSize = kDefaultBlockSize,
+            uint32_t blockCount = kDefaultBlockCount);
+  void Close();
+
+  bool IsOpen() const { return file_ != nullptr || packed_.IsValid(); }
+  const WAVEFORMATEX &GetFormat() const {
+    return *reinterpret_cast<const WAVEFORMATEX *>(format_.data());
+  }
+  uint32_t GetDataSize() const { return dataSize_; }
+  // 再生中に使うメモリ(ブロックのリング)の大きさ
+  size_t GetBufferSize() const { return buffer_.size(); }
+
+  // 先頭から読み込みを始める
+  void Start(SubmitFunction submit);
+  // 読み込みスレッドを止める。渡したブロックは使えなくなる
+  void StopReading();
+  // 渡したブロックの再生が終わったら呼ぶ。どのスレッドからでもよい
+  void ReleaseBlock();
+  // 最後まで読み、渡したブロックもすべて返ってきた
+  bool IsFinished() const;
+
+#ifdef _WIN32
+  bool Play(IXAudio2 *xAudio2, float volume = 1.0f);
+  void Stop();
+  void SetVolume(float volume);
+
+  // IXAudio2VoiceCallback
+  void STDMETHODCALLTYPE OnBufferEnd(void *) override { ReleaseBlock(); }
+  void STDMETHODCALLTYPE OnVoiceProcessingPassStart(UINT32) override {}
+  void STDMETHODCALLTYPE OnVoiceProcessingPassEnd() override {}
+  void STDMETHODCALLTYPE OnStreamEnd() override {}
+  void STDMETHODCALLTYPE OnBufferStart(void *) override {}
+  void STDMETHODCALLTYPE OnLoopEnd(void *) override {}
+  void STDMETHODCALLTYPE OnVoiceError(void *, HRESULT) override {}
+#endif
+
+private:
+  void ThreadMain();
+  // ブロックを埋める。ループしないときは最後だけ短くなる
+  uint32_t ReadBlock(BYTE *block);
+
+  // ファイルかパックの中身のどちらかから読む。読めたバイト数を返す
+  size_t Read(void *dst, size_t size);
+  // 先頭からの位置に移る。4GBを超えるファイルでも使える
+  bool Seek(uint64_t offset);
+  uint64_t Tell() const;
+
+  // 単体のファイルから読むときだけ開く
+  std::FILE *file_ = nullptr;
+  // パックに入っているときの中身と、その中の読む位置
+  FileData packed_;
+  uint64_t packedPosition_ = 0;
+  // fmtチャンクの中身(WAVE_FORMAT_EXTENSIBLEならその分長い)
+  std::vector<uint8_t> format_;
+  uint64_t dataOffset_ = 0;
+  uint32_t dataSize_ = 0;
+  uint32_t dataPosition_ = 0;
+  bool isLooping_ = false;
+
+  std::vector<BYTE> buffer_;
+  uint32_t blockSize_ = 0;
+  uint32_t blockCount_ = 0;
+  uint32_t nextBlock_ = 0;
+  uint32_t freeBlockCount_ = 0;
+  bool isEndReached_ = false;
+  bool isStopping_ = false;
+
+  SubmitFunction submit_;
+  std::thread thread_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+
+#ifdef _WIN32
+  IXAudio2SourceVoice *voice_ = nullptr;
+#endif
+};
@@ -0,0 +1,367 @@
+#include "SpatialAudio.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#define AUDIO_MIX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 近づく速さ・遠ざかる速さは音速の半分で止める(ピッチは1/3～3倍)
+constexpr float kMaxDopplerSpeed = SpatialAudio::kSpeedOfSound * 0.5f;
+// 距離0で割らないための下限
+constexpr float kMinDistance = 1e-6f;
+
+// 全エミッターで共通の値
+struct ListenerTerms {
+  float x, y, z;
+  float rightX, rightY, rightZ;
+  float velocityX, velocityY, velocityZ;
+  float inverseDeltaTime;
+};
+
+// SoAの各配列。previousは計算後に今の位置で上書きする
+struct EmitterArrays {
+  const float *x, *y, *z;
+  float *previousX, *previousY, *previousZ;
+  const float *minDistance, *maxDistance, *rolloff;
+  const float *gain, *dopplerScale;
+  float *outputGain, *outputPan, *outputPitch;
+};
+
+#pragma region スカラー
+
+// SSE版と同じ順で計算し、同じ結果にする
+void ComputeScalar(const ListenerTerms &l, const EmitterArrays &e,
+                   size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const float dx = e.x[i] - l.x;
+    const float dy = e.y[i] - l.y;
+    const float dz = e.z[i] - l.z;
+    const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+    // 最小距離と最大距離の間だけ、距離に反比例して小さくする
+    const float clamped =
+        std::min(std::max(distance, e.minDistance[i]), e.maxDistance[i]);
+    e.outputGain[i] =
+        e.gain[i] * e.minDistance[i] /
+        (e.minDistance[i] + e.rolloff[i] * (clamped - e.minDistance[i]));
+
+    // 最小距離より内側では、近づくほど中央に寄せる
+    e.outputPan[i] = (dx * l.rightX + dy * l.rightY + dz * l.rightZ) /
+                     std::max(distance, e.minDistance[i]);
+
+    // 聞く側からエミッターへの向きに沿った速さ。近づく向きで高くなる
+    const float inverseDistance = 1.0f / std::max(distance, kMinDistance);
+    const float emitterVelocityX =
+        (e.x[i] - e.previousX[i]) * l.inverseDeltaTime;
+    const float emitterVelocityY =
+        (e.y[i] - e.previousY[i]) * l.inverseDeltaTime;
+    const float emitterVelocityZ =
+        (e.z[i] - e.previousZ[i]) * l.inverseDeltaTime;
+    const float listenerSpeed =
+        (dx * l.velocityX + dy * l.velocityY + dz * l.velocityZ) *
+        inverseDistance * e.dopplerScale[i];
+    const float emitterSpeed =
+        (dx * emitterVelocityX + dy * emitterVelocityY +
+         dz * emitterVelocityZ) *
+        inverseDistance * e.dopplerScale[i];
+    e.outputPitch[i] =
+        (SpatialAudio::kSpeedOfSound +
+         std::min(std::max(listenerSpeed, -kMaxDopplerSpeed),
+                  kMaxDopplerSpeed)) /
+        (SpatialAudio::kSpeedOfSound +
+         std::min(std::max(emitterSpeed, -kMaxDopplerSpeed),
+                  kMaxDopplerSpeed));
+
+    e.previousX[i] = e.x[i];
+    e.previousY[i] = e.y[i];
+    e.previousZ[i] = e.z[i];
+  }
+}
+
+#pragma endregion
+
+#pragma region SSE
+#ifdef AUDIO_MIX_X86
+
+__m128 Clamp(__m128 value, __m128 low, __m128 high) {
+  return _mm_min_ps(_mm_max_ps(value, low), high);
+}
+
+void ComputeSse(const ListenerTerms &l, const EmitterArrays &e,
+                size_t count) {
+  const __m128 listenerX = _mm_set1_ps(l.x);
+  const __m128 listenerY = _mm_set1_ps(l.y);
+  const __m128 listenerZ = _mm_set1_ps(l.z);
+  const __m128 rightX = _mm_set1_ps(l.rightX);
+  const __m128 rightY = _mm_set1_ps(l.rightY);
+  const __m128 rightZ = _mm_set1_ps(l.rightZ);
+  const __m128 listenerVelocityX = _mm_set1_ps(l.velocityX);
+  const __m128 listenerVelocityY = _mm_set1_ps(l.velocityY);
+  const __m128 listenerVelocityZ = _mm_set1_ps(l.velocityZ);
+  const __m128 inverseDeltaTime = _mm_set1_ps(l.inverseDeltaTime);
+  const __m128 speedOfSound = _mm_set1_ps(SpatialAudio::kSpeedOfSound);
+  const __m128 maxSpeed = _mm_set1_ps(kMaxDopplerSpeed);
+  const __m128 minSpeed = _mm_set1_ps(-kMaxDopplerSpeed);
+  const __m128 minDistance = _mm_set1_ps(kMinDistance);
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 x = _mm_loadu_ps(e.x + i);
+    const __m128 y = _mm_loadu_ps(e.y + i);
+    const __m128 z = _mm_loadu_ps(e.z + i);
+    const __m128 dx = _mm_sub_ps(x, listenerX);
+    const __m128 dy = _mm_sub_ps(y, listenerY);
+    const __m128 dz = _mm_sub_ps(z, listenerZ);
+    const __m128 distance = _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+        _mm_mul_ps(dz, dz)));
+
+    const __m128 nearDistance = _mm_loadu_ps(e.minDistance + i);
+    const __m128 clamped =
+        Clamp(distance, nearDistance, _mm_loadu_ps(e.maxDistance + i));
+    const __m128 gain = _mm_div_ps(
+        _mm_mul_ps(_mm_loadu_ps(e.gain + i), nearDistance),
+        _mm_add_ps(nearDistance,
+                   _mm_mul_ps(_mm_loadu_ps(e.rolloff + i),
+                              _mm_sub_ps(clamped, nearDistance))));
+    _mm_storeu_ps(e.outputGain + i, gain);
+
+    const __m128 side = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(dx, rightX), _mm_mul_ps(dy, rightY)),
+        _mm_mul_ps(dz, rightZ));
+    _mm_storeu_ps(e.outputPan + i,
+                  _mm_div_ps(side, _mm_max_ps(distance, nearDistance)));
+
+    const __m128 inverseDistance =
+        _mm_div_ps(one, _mm_max_ps(distance, minDistance));
+    const __m128 previousX = _mm_loadu_ps(e.previousX + i);
+    const __m128 previousY = _mm_loadu_ps(e.previousY + i);
+    const __m128 previousZ = _mm_loadu_ps(e.previousZ + i);
+    const __m128 emitterVelocityX =
+        _mm_mul_ps(_mm_sub_ps(x, previousX), inverseDeltaTime);
+    const __m128 emitterVelocityY =
+        _mm_mul_ps(_mm_sub_ps(y, previousY), inverseDeltaTime);
+    const __m128 emitterVelocityZ =
+        _mm_mul_ps(_mm_sub_ps(z, previousZ), inverseDeltaTime);
+    const __m128 dopplerScale = _mm_loadu_ps(e.dopplerScale + i);
+    const __m128 listenerSpeed = _mm_mul_ps(
+        _mm_mul_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, listenerVelocityX),
+                                  _mm_mul_ps(dy, listenerVelocityY)),
+                       _mm_mul_ps(dz, listenerVelocityZ)),
+            inverseDistance),
+        dopplerScale);
+    const __m128 emitterSpeed = _mm_mul_ps(
+        _mm_mul_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, emitterVelocityX),
+                                  _mm_mul_ps(dy, emitterVelocityY)),
+                       _mm_mul_ps(dz, emitterVelocityZ)),
+            inverseDistance),
+        dopplerScale);
+    _mm_storeu_ps(
+        e.outputPitch + i,
+        _mm_div_ps(
+            _mm_add_ps(speedOfSound, Clamp(listenerSpeed, minSpeed, maxSpeed)),
+            _mm_add_ps(speedOfSound, Clamp(emitterSpeed, minSpeed, maxSpeed))));
+
+    _mm_storeu_ps(e.previousX + i, x);
+    _mm_storeu_ps(e.previousY + i, y);
+    _mm_storeu_ps(e.previousZ + i, z);
+  }
+  ComputeScalar(l, e, i, count);
+}
+
+#endif
+#pragma endregion
+
+} // namespace
+
+AudioListener MakeAudioListener(const Transform &cameraTransform) {
+  // 行ベクトルの変換なので、回転行列の1行目がカメラの右方向になる
+  const Matrix4x4 rotate = MakeAffineMatrix(
+      {1.0f, 1.0f, 1.0f}, cameraTransform.rotate, {0.0f, 0.0f, 0.0f});
+  AudioListener listener;
+  listener.position = cameraTransform.translate;
+  listener.right = {rotate.m[0][0], rotate.m[0][1], rotate.m[0][2]};
+  return listener;
+}
+
+SpatialAudio::SpatialAudio(SimdLevel simdLevel)
+    : simdLevel_(std::min(simdLevel, GetSupportedSimdLevel())) {}
+
+AudioEmitterHandle SpatialAudio::CreateEmitter(const Vector3 &position,
+                                               const AudioEmitterDesc &desc) {
+  uint32_t index = 0;
+  if (!freeIndices_.empty()) {
+    index = freeIndices_.back();
+    freeIndices_.pop_back();
+  } else {
+    index = uint32_t(denseIndices_.size());
+    denseIndices_.push_back(UINT32_MAX);
+    generations_.push_back(0);
+  }
+  ++generations_[index];
+  denseIndices_[index] = uint32_t(x_.size());
+
+  // 0で割らないよう、距離の範囲を正しい順に直しておく
+  const float minDistance = std::max(desc.minDistance, kMinDistance);
+  handleIndices_.push_back(index);
+  x_.push_back(position.x);
+  y_.push_back(position.y);
+  z_.push_back(position.z);
+  previousX_.push_back(position.x);
+  previousY_.push_back(position.y);
+  previousZ_.push_back(position.z);
+  minDistance_.push_back(minDistance);
+  maxDistance_.push_back(std::max(desc.maxDistance, minDistance));
+  rolloff_.push_back(std::max(desc.rolloff, 0.0f));
+  gain_.push_back(desc.gain);
+  dopplerScale_.push_back(desc.dopplerScale);
+  voices_.push_back({});
+  outputGain_.push_back(0.0f);
+  outputPan_.push_back(0.0f);
+  outputPitch_.push_back(1.0f);
+  return {index, generations_[index]};
+}
+
+void SpatialAudio::DestroyEmitter(AudioEmitterHandle handle) {
+  const uint32_t dense = FindDense(handle);
+  if (dense == UINT32_MAX) {
+    return;
+  }
+
+  // 最後の要素を空いた場所に移して詰める
+  const uint32_t last = uint32_t(x_.size() - 1);
+  auto erase = [&](auto &values) {
+    values[dense] = values[last];
+    values.pop_back();
+  };
+  erase(handleIndices_);
+  erase(x_);
+  erase(y_);
+  erase(z_);
+  erase(previousX_);
+  erase(previousY_);
+  erase(previousZ_);
+  erase(minDistance_);
+  erase(maxDistance_);
+  erase(rolloff_);
+  erase(gain_);
+  erase(dopplerScale_);
+  erase(voices_);
+  erase(outputGain_);
+  erase(outputPan_);
+  erase(outputPitch_);
+  if (dense != last) {
+    denseIndices_[handleIndices_[dense]] = dense;
+  }
+
+  denseIndices_[handle.index] = UINT32_MAX;
+  freeIndices_.push_back(handle.index);
+}
+
+void SpatialAudio::SetEmitterPosition(AudioEmitterHandle handle,
+                                      const Vector3 &position) {
+  const uint32_t dense = FindDense(handle);
+  if (dense != UINT32_MAX) {
+    x_[dense] = position.x;
+    y_[dense] = position.y;
+    z_[dense] = position.z;
+  }
+}
+
+void SpatialAudio::SetEmitterGain(AudioEmitterHandle handle, float gain) {
+  const uint32_t dense = FindDense(handle);
+  if (dense != UINT32_MAX) {
+    gain_[dense] = gain;
+  }
+}
+
+void SpatialAudio::AttachVoice(AudioEmitterHandle handle,
+                               AudioVoiceHandle voice) {
+  const uint32_t dense = FindDense(handle);
+  if (dense != UINT32_MAX) {
+    voices_[dense] = voice;
+  }
+}
+
+void SpatialAudio::ResetVelocities() {
+  previousX_ = x_;
+  previousY_ = y_;
+  previousZ_ = z_;
+  hasListener_ = false;
+}
+
+void SpatialAudio::Compute(const AudioListener &listener, float deltaTime) {
+  ListenerTerms terms{};
+  terms.x = listener.position.x;
+  terms.y = listener.position.y;
+  terms.z = listener.position.z;
+  terms.rightX = listener.right.x;
+  terms.rightY = listener.right.y;
+  terms.rightZ = listener.right.z;
+  terms.inverseDeltaTime = deltaTime > 0.0f ? 1.0f / deltaTime : 0.0f;
+  if (hasListener_) {
+    terms.velocityX =
+        (listener.position.x - previousListener_.x) * terms.inverseDeltaTime;
+    terms.velocityY =
+        (listener.position.y - previousListener_.y) * terms.inverseDeltaTime;
+    terms.velocityZ =
+        (listener.position.z - previousListener_.z) * terms.inverseDeltaTime;
+  }
+  previousListener_ = listener.position;
+  hasListener_ = true;
+
+  const EmitterArrays arrays = {
+      x_.data(),           y_.data(),           z_.data(),
+      previousX_.data(),   previousY_.data(),   previousZ_.data(),
+      minDistance_.data(), maxDistance_.data(), rolloff_.data(),
+      gain_.data(),        dopplerScale_.data(), outputGain_.data(),
+      outputPan_.data(),   outputPitch_.data()};
+#ifdef AUDIO_MIX_X86
+  if (simdLevel_ >= SimdLevel::Sse) {
+    ComputeSse(terms, arrays, x_.size());
+    return;
+  }
+#endif
+  ComputeScalar(terms, arrays, 0, x_.size());
+}
+
+void SpatialAudio::Update(const AudioListener &listener, float deltaTime,
+                          AudioMixer &mixer) {
+  Compute(listener, deltaTime);
+
+  // ミキサーへはatomicに書くだけなので、ボイスが多くても待たない
+  mixer.SetVoiceParameters(voices_.data(), outputGain_.data(),
+                           outputPan_.data(), outputPitch_.data(),
+                           voices_.size());
+}
+
+float SpatialAudio::GetGain(AudioEmitterHandle handle) const {
+  const uint32_t dense = FindDense(handle);
+  return dense != UINT32_MAX ? outputGain_[dense] : 0.0f;
+}
+
+float SpatialAudio::GetPan(AudioEmitterHandle handle) const {
+  const uint32_t dense = FindDense(handle);
+  return dense != UINT32_MAX ? outputPan_[dense] : 0.0f;
+}
+
+float SpatialAudio::GetPitch(AudioEmitterHandle handle) const {
+  const uint32_t dense = FindDense(handle);
+  return dense != UINT32_MAX ? outputPitch_[dense] : 1.0f;
+}
+
+uint32_t SpatialAudio::FindDense(AudioEmitterHandle handle) const {
+  if (handle.index >= denseIndices_.size() ||
+      generations_[handle.index] != handle.generation) {
+    return UINT32_MAX;
+  }
+  return denseIndices_[handle.index];
+}
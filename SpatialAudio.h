@@ -0,0 +1,97 @@
+#pragma once
+#include "AudioMixKernels.h"
+#include "AudioMixer.h"
+#include "Math.h"
+#include <cstdint>
+#include <vector>
+
+// 音を聞く位置と向き。パンは右方向との内積で決まる
+struct AudioListener {
+  Vector3 position{0.0f, 0.0f, 0.0f};
+  Vector3 right{1.0f, 0.0f, 0.0f};
+};
+
+// カメラのTransformから作る(回転の順はMakeAffineMatrixと同じ)
+AudioListener MakeAudioListener(const Transform &cameraTransform);
+
+struct AudioEmitterDesc {
+  // これより近いと減衰しない(パンも中央に寄せていく)
+  float minDistance = 1.0f;
+  // これより遠くなっても、それ以上は小さくならない
+  float maxDistance = 100.0f;
+  // 1で距離に反比例して小さくなる。大きいほど急に小さくなる
+  float rolloff = 1.0f;
+  float gain = 1.0f;
+  // 0でドップラー効果なし
+  float dopplerScale = 1.0f;
+};
+
+struct AudioEmitterHandle {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+
+  bool IsValid() const { return index != UINT32_MAX; }
+};
+
+// 位置を持つ音(エミッター)の音量・パン・ピッチをまとめて計算するクラス
+// エミッターは要素ごとの配列(SoA)で持ち、Updateで全部を一度に計算して
+// 結びつけたAudioMixerのボイスに書き込む
+// (AVXが使えてもSSEで計算する。4つずつで十分速く、残りはボイスへの書き込み)
+class SpatialAudio {
+public:
+  static constexpr float kSpeedOfSound = 343.0f;
+
+  explicit SpatialAudio(SimdLevel simdLevel = GetSupportedSimdLevel());
+
+  AudioEmitterHandle CreateEmitter(const Vector3 &position,
+                                   const AudioEmitterDesc &desc = {});
+  void DestroyEmitter(AudioEmitterHandle handle);
+
+  // 毎フレーム位置を渡す。前のUpdateからの移動量が速度になる
+  void SetEmitterPosition(AudioEmitterHandle handle, const Vector3 &position);
+  void SetEmitterGain(AudioEmitterHandle handle, float gain);
+  // 結びつけたボイスの音量・パン・ピッチはUpdateで上書きする
+  // ボイスが鳴り終わると自動で外れる
+  void AttachVoice(AudioEmitterHandle handle, AudioVoiceHandle voice);
+
+  // 瞬間移動したとき、次のUpdateでドップラー効果が跳ねないようにする
+  void ResetVelocities();
+
+  // deltaTimeは前のUpdateからの秒数。0以下ならドップラー効果を止める
+  void Update(const AudioListener &listener, float deltaTime,
+              AudioMixer &mixer);
+  // ボイスには反映せず計算だけ行う
+  void Compute(const AudioListener &listener, float deltaTime);
+
+  // 最後に計算した値
+  float GetGain(AudioEmitterHandle handle) const;
+  float GetPan(AudioEmitterHandle handle) const;
+  float GetPitch(AudioEmitterHandle handle) const;
+
+  uint32_t GetEmitterCount() const { return uint32_t(x_.size()); }
+  SimdLevel GetSimdLevel() const { return simdLevel_; }
+
+private:
+  // 見つからなければUINT32_MAX
+  uint32_t FindDense(AudioEmitterHandle handle) const;
+
+  SimdLevel simdLevel_ = SimdLevel::Scalar;
+
+  // ハンドルの番号 -> 配列の位置。消すときは最後の要素を詰めるので変わる
+  std::vector<uint32_t> denseIndices_;
+  std::vector<uint32_t> generations_;
+  std::vector<uint32_t> freeIndices_;
+
+  // ここから下はエミッターの数だけ並ぶ
+  std::vector<uint32_t> handleIndices_;
+  std::vector<float> x_, y_, z_;
+  std::vector<float> previousX_, previousY_, previousZ_;
+  std::vector<float> minDistance_, maxDistance_, rolloff_;
+  std::vector<float> gain_, dopplerScale_;
+  std::vector<AudioVoiceHandle> voices_;
+  // 計算結果
+  std::vector<float> outputGain_, outputPan_, outputPitch_;
+
+  Vector3 previousListener_{0.0f, 0.0f, 0.0f};
+  bool hasListener_ = false;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// 1つのスレッドが積み、別の1つのスレッドが取り出すロックフリーのキュー
+// どちらの操作も待たない。いっぱいならTryPushが、空ならTryPopがfalseを返す
+// 容量は2のべき乗に切り上げる
+template <typename T> class SpscQueue {
+public:
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots_ = std::make_unique<T[]>(size);
+    mask_ = size - 1;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // 積む側のスレッドからだけ呼ぶ。失敗したときはvalueに触らない
+  template <typename U> bool TryPush(U &&value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cachedHead_ > mask_) {
+      // 取り出す側の位置は、いっぱいに見えたときだけ読み直す
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail - cachedHead_ > mask_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::forward<U>(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 取り出す側のスレッドからだけ呼ぶ
+  bool TryPop(T &value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cachedTail_) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if (head == cachedTail_) {
+        return false;
+      }
+    }
+    value = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t GetCapacity() const { return mask_ + 1; }
+
+private:
+  // 両側の位置が同じキャッシュラインに乗ると、互いの書き込みで遅くなる
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::unique_ptr<T[]> slots_;
+  size_t mask_ = 0;
+
+  // 取り出す側が書く
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t cachedTail_ = 0;
+  // 積む側が書く
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t cachedHead_ = 0;
+};
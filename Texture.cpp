@@ -0,0 +1,258 @@
+#include "Texture.h"
+#include "VirtualFileSystem.h"
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+bool IsDdsPath(const std::string &filePath) {
+  if (filePath.size() < 4) {
+    return false;
+  }
+  std::string extension = filePath.substr(filePath.size() - 4);
+  for (char &c : extension) {
+    if (c >= 'A' && c <= 'Z') {
+      c = char(c - 'A' + 'a');
+    }
+  }
+  return extension == ".dds";
+}
+
+} // namespace
+
+FileData ReadCookedTexture(const std::string &filePath,
+                           const TextureCookSettings &settings,
+                           ThreadPool *pool) {
+  VirtualFileSystem &fileSystem = VirtualFileSystem::GetInstance();
+  // パックファイルに入っていればそこから読む
+  FileData file = fileSystem.ReadFile(filePath);
+  if (!file.IsValid()) {
+    std::cerr << "Failed to open texture: " << filePath << std::endl;
+    return {};
+  }
+  if (IsDdsPath(filePath)) {
+    return file;
+  }
+
+  // クック済みならDDSを読むだけで済む
+  // キャッシュもパックに入れられるよう、仮想ファイルシステムから探す
+  const std::string cookedPath = GetCookedTexturePath(
+      kTextureCacheDirectory,
+      ComputeTextureCookKey(file.data, file.size, settings));
+  FileData cookedFile = fileSystem.ReadFile(cookedPath);
+  if (cookedFile.IsValid()) {
+    return cookedFile;
+  }
+
+  DirectX::ScratchImage image{};
+  std::string error;
+  if (!CookTexture(file.data, file.size, settings, image, &error, pool)) {
+    std::cerr << "Failed to cook texture: " << filePath << " (" << error
+              << ")" << std::endl;
+    return {};
+  }
+  std::shared_ptr<DirectX::Blob> blob = std::make_shared<DirectX::Blob>();
+  if (!EncodeCookedTexture(image, *blob, &error)) {
+    std::cerr << "Failed to cook texture: " << filePath << " (" << error
+              << ")" << std::endl;
+    return {};
+  }
+  // 書き出せなくても(読み取り専用の場所など)今回はクックしたものを使う
+  if (!WriteCookedTexture(blob->GetBufferPointer(), blob->GetBufferSize(),
+                          cookedPath, &error)) {
+    std::cerr << "Failed to save cooked texture: " << cookedPath << " ("
+              << error << ")" << std::endl;
+  }
+  FileData cooked;
+  cooked.data = static_cast<const uint8_t *>(blob->GetBufferPointer());
+  cooked.size = blob->GetBufferSize();
+  cooked.owner = std::move(blob);
+  return cooked;
+}
+
+DirectX::ScratchImage LoadTexture(const std::string &filePath,
+                                  const TextureCookSettings &settings,
+                                  ThreadPool *pool) {
+  FileData file = ReadCookedTexture(filePath, settings, pool);
+  if (!file.IsValid()) {
+    return {};
+  }
+  DirectX::ScratchImage image{};
+  std::string error;
+  if (!LoadDdsTexture(file.data, file.size, image, &error)) {
+    std::cerr << "Failed to load texture: " << filePath << " (" << error
+              << ")" << std::endl;
+    return {};
+  }
+  return image;
+}
+
+AssetRegistry::Handle<FileData>
+AcquireCookedTexture(const std::string &filePath,
+                     const TextureCookSettings &settings, ThreadPool *pool) {
+  return AssetRegistry::GetInstance().Acquire<FileData>(
+      AssetType::Texture, filePath,
+      [&](FileData &file) {
+        file = ReadCookedTexture(filePath, settings, pool);
+        return file.IsValid();
+      },
+      [](const FileData &file) { return sizeof(FileData) + file.size; });
+}
+
+bool LoadTextureAtlas(const std::string &manifestPath, TextureAtlas &atlas) {
+  atlas = {};
+  FileData file = VirtualFileSystem::GetInstance().ReadFile(manifestPath);
+  if (!file.IsValid()) {
+    std::cerr << "Failed to open atlas: " << manifestPath << std::endl;
+    return false;
+  }
+  std::string error;
+  if (!ParseAtlasManifest(file.GetText(), atlas.manifest, &error)) {
+    std::cerr << "Failed to load atlas: " << manifestPath << " (" << error
+              << ")" << std::endl;
+    return false;
+  }
+
+  const size_t separator = manifestPath.find_last_of("/\\");
+  const std::string directory = separator != std::string::npos
+                                    ? manifestPath.substr(0, separator + 1)
+                                    : std::string();
+  for (const AtlasManifest::Page &page : atlas.manifest.pages) {
+    AssetRegistry::Handle<FileData> dds =
+        AcquireCookedTexture(directory + page.fileName);
+    if (dds == nullptr) {
+      atlas = {};
+      return false;
+    }
+    atlas.pages.push_back(std::move(dds));
+  }
+  return true;
+}
+
+bool BuildTextureAtlas(const std::vector<std::string> &filePaths,
+                       const AtlasSettings &settings, TextureAtlas &atlas,
+                       const TextureCookSettings &cookSettings,
+                       ThreadPool *pool) {
+  atlas = {};
+  const uint32_t imageCount = uint32_t(filePaths.size());
+  std::vector<DirectX::ScratchImage> decoded(imageCount);
+  std::vector<std::string> errors(imageCount);
+  auto decode = [&](uint32_t i) {
+    FileData file = VirtualFileSystem::GetInstance().ReadFile(filePaths[i]);
+    if (!file.IsValid()) {
+      errors[i] = "cannot open";
+      return;
+    }
+    DecodeRgba8Texture(file.data, file.size, cookSettings.isSrgb, decoded[i],
+                       &errors[i]);
+  };
+  if (pool != nullptr) {
+    pool->ParallelFor(imageCount, decode);
+  } else {
+    for (uint32_t i = 0; i < imageCount; ++i) {
+      decode(i);
+    }
+  }
+
+  std::vector<Rgba8Image> images(imageCount);
+  for (uint32_t i = 0; i < imageCount; ++i) {
+    if (!errors[i].empty()) {
+      std::cerr << "Failed to load atlas image: " << filePaths[i] << " ("
+                << errors[i] << ")" << std::endl;
+      return false;
+    }
+    const DirectX::Image *image = decoded[i].GetImage(0, 0, 0);
+    images[i] = {image->pixels, uint32_t(image->width),
+                 uint32_t(image->height), image->rowPitch};
+  }
+
+  std::vector<AtlasPage> pages;
+  std::vector<AtlasRegion> regions;
+  std::string error;
+  if (!PackAtlas(images.data(), imageCount, settings, pages, regions,
+                 &error)) {
+    std::cerr << "Failed to pack atlas (" << error << ")" << std::endl;
+    return false;
+  }
+
+  for (AtlasPage &page : pages) {
+    DirectX::ScratchImage cooked{};
+    std::shared_ptr<DirectX::Blob> blob = std::make_shared<DirectX::Blob>();
+    if (!CookRgba8Texture(page.GetImage(), cookSettings, cooked, &error,
+                          pool) ||
+        !EncodeCookedTexture(cooked, *blob, &error)) {
+      std::cerr << "Failed to cook atlas page (" << error << ")" << std::endl;
+      atlas = {};
+      return false;
+    }
+    std::shared_ptr<FileData> dds = std::make_shared<FileData>();
+    dds->data = static_cast<const uint8_t *>(blob->GetBufferPointer());
+    dds->size = blob->GetBufferSize();
+    dds->owner = std::move(blob);
+    atlas.pages.push_back(std::move(dds));
+    atlas.manifest.pages.push_back({std::string(), page.width, page.height});
+  }
+  for (uint32_t i = 0; i < imageCount; ++i) {
+    atlas.manifest.sprites.push_back(
+        {std::filesystem::path(filePaths[i]).stem().string(), regions[i]});
+  }
+  return true;
+}
+
+TextureLoader::~TextureLoader() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [this] { return runningCount_ == 0; });
+}
+
+uint32_t TextureLoader::Request(const std::string &filePath,
+                                const TextureCookSettings &settings) {
+  uint32_t id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = nextId_++;
+    ++pendingCount_;
+    ++runningCount_;
+  }
+  pool_.Submit([this, id, filePath, settings]() {
+    Result result;
+    result.id = id;
+    result.filePath = filePath;
+    // 同じファイルが同時に要求されても、AssetRegistryが1回だけ読む
+    result.dds = AcquireCookedTexture(filePath, settings, &pool_);
+    // 通知し終わるまでロックを持ち、デストラクタが先に進まないようにする
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_.push_back(std::move(result));
+    --runningCount_;
+    condition_.notify_all();
+  });
+  return id;
+}
+
+bool TextureLoader::TryPop(Result &result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (completed_.empty()) {
+    return false;
+  }
+  result = std::move(completed_.front());
+  completed_.pop_front();
+  --pendingCount_;
+  return true;
+}
+
+bool TextureLoader::WaitPop(Result &result) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock,
+                  [this] { return !completed_.empty() || pendingCount_ == 0; });
+  if (completed_.empty()) {
+    return false;
+  }
+  result = std::move(completed_.front());
+  completed_.pop_front();
+  --pendingCount_;
+  return true;
+}
+
+uint32_t TextureLoader::GetPendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pendingCount_;
+}
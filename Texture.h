@@ -0,0 +1,96 @@
+#pragma once
+#include "AssetRegistry.h"
+#include "MappedFile.h"
+#include "TextureAtlas.h"
+#include "TextureCooker.h"
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// クック済みのDDSファイルの中身を返す。失敗したら無効なFileDataを返す
+// .ddsはそのまま読む。それ以外はキャッシュにクック済みのDDSがあればそれを読み、
+// なければその場でクックしてキャッシュに書き出す
+// (次からはデコードもミップ生成もせず、圧縮されたまま転送できる)
+// poolを渡すと、クックするときのミップ生成を並列にする
+FileData ReadCookedTexture(const std::string &filePath,
+                           const TextureCookSettings &settings = {},
+                           ThreadPool *pool = nullptr);
+
+// ReadCookedTextureしたものを展開する。失敗したら空のScratchImageを返す
+DirectX::ScratchImage LoadTexture(const std::string &filePath,
+                                  const TextureCookSettings &settings = {},
+                                  ThreadPool *pool = nullptr);
+
+// AssetRegistry経由でReadCookedTextureする。同じファイルは一度だけ読まれて共有される
+// DDSのまま持つので、ミップごとに必要になったときに取り出して転送できる
+// 登録はパスだけで見分けるので、同じファイルを別の設定で読まないこと
+// 読めなければ登録せずにnullptrを返す
+AssetRegistry::Handle<FileData>
+AcquireCookedTexture(const std::string &filePath,
+                     const TextureCookSettings &settings = {},
+                     ThreadPool *pool = nullptr);
+
+// アトラスのページ(クック済みのDDS)と、スプライトごとの場所
+// ページはTextureStreamerにそのまま渡せる
+struct TextureAtlas {
+  std::vector<AssetRegistry::Handle<FileData>> pages;
+  AtlasManifest manifest;
+};
+
+// AssetTool atlasで作った定義ファイルと、そこに書かれたページを読む
+bool LoadTextureAtlas(const std::string &manifestPath, TextureAtlas &atlas);
+
+// 画像をその場で詰めてアトラスを作る。スプライトの名前は拡張子を除いたファイル名
+// ページはキャッシュしないので、決まった組み合わせはAssetTool atlasで前もって作る
+// poolを渡すと、画像のデコードとページのミップ生成を並列にする
+bool BuildTextureAtlas(const std::vector<std::string> &filePaths,
+                       const AtlasSettings &settings, TextureAtlas &atlas,
+                       const TextureCookSettings &cookSettings = {},
+                       ThreadPool *pool = nullptr);
+
+// 複数のテクスチャをワーカースレッドで並列に読み込むクラス
+// 読み終わった順に完了キューに入るので、メインスレッドは取り出したものから転送する
+class TextureLoader {
+public:
+  struct Result {
+    // Requestが返した番号
+    uint32_t id = 0;
+    std::string filePath;
+    // 読み込みに失敗したときはnullptrになる
+    AssetRegistry::Handle<FileData> dds;
+  };
+
+  // poolのワーカーは大きい画像のミップ生成の手伝いにも使う
+  explicit TextureLoader(ThreadPool &pool) : pool_(pool) {}
+  // 読み込み中のものが終わるまで待つ
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+
+  uint32_t Request(const std::string &filePath,
+                   const TextureCookSettings &settings = {});
+
+  // 読み終わったものがなければfalse
+  bool TryPop(Result &result);
+  // 読み終わるまで待って取り出す。取り出していないものが残っていなければfalse
+  bool WaitPop(Result &result);
+
+  // 要求したが、まだ取り出していない数
+  uint32_t GetPendingCount() const;
+
+private:
+  ThreadPool &pool_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Result> completed_;
+  uint32_t nextId_ = 0;
+  uint32_t pendingCount_ = 0;
+  // ワーカーで実行中の数。デストラクタはこれが0になるまで待つ
+  uint32_t runningCount_ = 0;
+};
@@ -0,0 +1,212 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "externals/imgui/imstb_rectpack.h"
+
+namespace {
+
+bool Fail(std::string *error, const std::string &message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// パディングを含めた枠をimageで埋める。画像の外側は一番近い端のピクセルを使う
+void FillCell(const Rgba8Image &image, uint32_t padding,
+              const Rgba8Image &page, uint32_t cellX, uint32_t cellY,
+              uint32_t cellWidth, uint32_t cellHeight) {
+  for (uint32_t y = 0; y < cellHeight; ++y) {
+    const uint32_t sourceY =
+        uint32_t(std::clamp(int64_t(y) - int64_t(padding), int64_t(0),
+                            int64_t(image.height) - 1));
+    const uint8_t *sourceRow = image.pixels + sourceY * image.rowPitch;
+    uint8_t *row = page.pixels + (cellY + y) * page.rowPitch + cellX * 4;
+    // 左右の伸ばした部分
+    for (uint32_t x = 0; x < padding; ++x) {
+      std::memcpy(row + x * 4, sourceRow, 4);
+    }
+    std::memcpy(row + padding * 4, sourceRow, size_t(image.width) * 4);
+    for (uint32_t x = padding + image.width; x < cellWidth; ++x) {
+      std::memcpy(row + x * 4, sourceRow + (image.width - 1) * 4, 4);
+    }
+  }
+}
+
+} // namespace
+
+bool PackAtlas(const Rgba8Image *images, uint32_t imageCount,
+               const AtlasSettings &settings, std::vector<AtlasPage> &pages,
+               std::vector<AtlasRegion> &regions, std::string *error) {
+  pages.clear();
+  regions.assign(imageCount, {});
+  const uint32_t alignment = std::max(settings.alignment, 1u);
+
+  std::vector<stbrp_rect> remaining;
+  for (uint32_t i = 0; i < imageCount; ++i) {
+    if (images[i].width == 0 || images[i].height == 0) {
+      return Fail(error, "image " + std::to_string(i) + " is empty");
+    }
+    stbrp_rect rect{};
+    rect.id = int(i);
+    rect.w = int(AlignUp(images[i].width + settings.padding * 2, alignment));
+    rect.h = int(AlignUp(images[i].height + settings.padding * 2, alignment));
+    if (uint32_t(rect.w) > settings.pageWidth ||
+        uint32_t(rect.h) > settings.pageHeight) {
+      return Fail(error, "image " + std::to_string(i) +
+                             " does not fit in a page");
+    }
+    remaining.push_back(rect);
+  }
+
+  std::vector<stbrp_node> nodes(settings.pageWidth);
+  while (!remaining.empty()) {
+    stbrp_context context{};
+    stbrp_init_target(&context, int(settings.pageWidth),
+                      int(settings.pageHeight), nodes.data(),
+                      int(nodes.size()));
+    stbrp_pack_rects(&context, remaining.data(), int(remaining.size()));
+
+    // 入ったものをこのページに置き、残りは次のページへ
+    std::vector<stbrp_rect> packed;
+    std::vector<stbrp_rect> next;
+    uint32_t usedWidth = 0;
+    uint32_t usedHeight = 0;
+    for (stbrp_rect &rect : remaining) {
+      if (rect.was_packed) {
+        packed.push_back(rect);
+        usedWidth = std::max(usedWidth, uint32_t(rect.x + rect.w));
+        usedHeight = std::max(usedHeight, uint32_t(rect.y + rect.h));
+      } else {
+        rect.x = 0;
+        rect.y = 0;
+        next.push_back(rect);
+      }
+    }
+
+    const uint32_t pageIndex = uint32_t(pages.size());
+    AtlasPage &page = pages.emplace_back();
+    page.width = AlignUp(usedWidth, alignment);
+    page.height = AlignUp(usedHeight, alignment);
+    page.pixels.assign(size_t(page.width) * page.height * 4, 0);
+    const Rgba8Image pageImage = page.GetImage();
+    for (const stbrp_rect &rect : packed) {
+      const Rgba8Image &image = images[rect.id];
+      FillCell(image, settings.padding, pageImage, uint32_t(rect.x),
+               uint32_t(rect.y), uint32_t(rect.w), uint32_t(rect.h));
+
+      AtlasRegion &region = regions[rect.id];
+      region.page = pageIndex;
+      region.x = uint32_t(rect.x) + settings.padding;
+      region.y = uint32_t(rect.y) + settings.padding;
+      region.width = image.width;
+      region.height = image.height;
+      region.u0 = float(region.x) / float(page.width);
+      region.v0 = float(region.y) / float(page.height);
+      region.u1 = float(region.x + region.width) / float(page.width);
+      region.v1 = float(region.y + region.height) / float(page.height);
+    }
+    remaining = std::move(next);
+  }
+  return true;
+}
+
+Matrix4x4 MakeAtlasUvTransform(const AtlasRegion &region) {
+  // 拡大してから平行移動する(行ベクトルに右から掛ける並び)
+  Matrix4x4 matrix = {};
+  matrix.m[0][0] = region.u1 - region.u0;
+  matrix.m[1][1] = region.v1 - region.v0;
+  matrix.m[2][2] = 1.0f;
+  matrix.m[3][3] = 1.0f;
+  matrix.m[3][0] = region.u0;
+  matrix.m[3][1] = region.v0;
+  return matrix;
+}
+
+const AtlasManifest::Sprite *
+AtlasManifest::Find(std::string_view name) const {
+  for (const Sprite &sprite : sprites) {
+    if (sprite.name == name) {
+      return &sprite;
+    }
+  }
+  return nullptr;
+}
+
+std::string FormatAtlasManifest(const AtlasManifest &manifest) {
+  std::ostringstream stream;
+  for (const AtlasManifest::Page &page : manifest.pages) {
+    stream << "page " << page.fileName << ' ' << page.width << ' '
+           << page.height << '\n';
+  }
+  for (const AtlasManifest::Sprite &sprite : manifest.sprites) {
+    const AtlasRegion &region = sprite.region;
+    stream << "sprite " << region.page << ' ' << region.x << ' ' << region.y
+           << ' ' << region.width << ' ' << region.height << ' '
+           << sprite.name << '\n';
+  }
+  return stream.str();
+}
+
+bool ParseAtlasManifest(std::string_view text, AtlasManifest &manifest,
+                        std::string *error) {
+  manifest = {};
+  std::istringstream stream{std::string(text)};
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline(stream, line)) {
+    ++lineNumber;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    std::istringstream s(line);
+    std::string identifier;
+    if (!(s >> identifier) || identifier[0] == '#') {
+      continue;
+    }
+    const std::string where = "line " + std::to_string(lineNumber) + ": ";
+
+    if (identifier == "page") {
+      AtlasManifest::Page page;
+      if (!(s >> page.fileName >> page.width >> page.height) ||
+          page.width == 0 || page.height == 0) {
+        return Fail(error, where + "invalid page");
+      }
+      manifest.pages.push_back(std::move(page));
+    } else if (identifier == "sprite") {
+      AtlasManifest::Sprite sprite;
+      AtlasRegion &region = sprite.region;
+      if (!(s >> region.page >> region.x >> region.y >> region.width >>
+            region.height)) {
+        return Fail(error, where + "invalid sprite");
+      }
+      // 名前は行の残り全部(空白を含んでもよい)
+      s >> std::ws;
+      std::getline(s, sprite.name);
+      if (sprite.name.empty() || region.page >= manifest.pages.size()) {
+        return Fail(error, where + "invalid sprite");
+      }
+      const AtlasManifest::Page &page = manifest.pages[region.page];
+      if (region.x + region.width > page.width ||
+          region.y + region.height > page.height) {
+        return Fail(error, where + "sprite is outside the page");
+      }
+      region.u0 = float(region.x) / float(page.width);
+      region.v0 = float(region.y) / float(page.height);
+      region.u1 = float(region.x + region.width) / float(page.width);
+      region.v1 = float(region.y + region.height) / float(page.height);
+      manifest.sprites.push_back(std::move(sprite));
+    } else {
+      return Fail(error, where + "unknown identifier " + identifier);
+    }
+  }
+  return true;
+}
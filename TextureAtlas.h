@@ -0,0 +1,89 @@
+#pragma once
+#include "Math.h"
+#include "MipGenerator.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 小さい画像をまとめて何枚かの大きいページに詰めるアトラス
+// スプライトごとにSRVを切り替えずに、ページの数だけのバインドで描けるようにする
+// 詰め方はimguiに入っているstb_rect_packを使う
+
+struct AtlasSettings {
+  uint32_t pageWidth = 2048;
+  uint32_t pageHeight = 2048;
+  // 画像の周りに端のピクセルを伸ばして埋める幅
+  // ミップを作ったときに隣の画像の色が混ざらないようにする
+  uint32_t padding = 4;
+  // 置く場所と大きさをこの倍数に揃える(BC圧縮のブロックが画像をまたがないよう4)
+  uint32_t alignment = 4;
+};
+
+// ページの中での1つの画像の場所(パディングは含まない)
+struct AtlasRegion {
+  uint32_t page = 0;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // ページの中でのUVの範囲
+  float u0 = 0.0f;
+  float v0 = 0.0f;
+  float u1 = 0.0f;
+  float v1 = 0.0f;
+};
+
+// 詰め終わったページ。ピクセルは入力と同じ並び(RGBAかBGRA)
+// 大きさは使った範囲まで縮めてある
+struct AtlasPage {
+  std::vector<uint8_t> pixels;
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  Rgba8Image GetImage() {
+    return {pixels.data(), width, height, size_t(width) * 4};
+  }
+};
+
+// imagesを詰めてregions[i]にimages[i]の場所を入れる
+// 1枚のページに入りきらない画像があれば失敗する
+bool PackAtlas(const Rgba8Image *images, uint32_t imageCount,
+               const AtlasSettings &settings, std::vector<AtlasPage> &pages,
+               std::vector<AtlasRegion> &regions,
+               std::string *error = nullptr);
+
+// 0~1のUVをregionの範囲に移す行列。MaterialのuvTransformにそのまま入れられる
+// スプライト自身のUVの変形と合わせるときは、その後ろに掛ける
+Matrix4x4 MakeAtlasUvTransform(const AtlasRegion &region);
+
+#pragma region アトラスの定義ファイル
+
+// AssetTool atlasが書き出すテキスト。1行に1つ
+//   page <DDSのファイル名> <幅> <高さ>
+//   sprite <ページ番号> <x> <y> <幅> <高さ> <名前>
+// DDSのファイル名は定義ファイルからの相対パス
+struct AtlasManifest {
+  struct Page {
+    std::string fileName;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+  struct Sprite {
+    std::string name;
+    AtlasRegion region;
+  };
+
+  std::vector<Page> pages;
+  std::vector<Sprite> sprites;
+
+  // 見つからなければnullptr
+  const Sprite *Find(std::string_view name) const;
+};
+
+std::string FormatAtlasManifest(const AtlasManifest &manifest);
+// 読んだスプライトのUVはページの大きさから計算し直す
+bool ParseAtlasManifest(std::string_view text, AtlasManifest &manifest,
+                        std::string *error = nullptr);
+
+#pragma endregion
@@ -0,0 +1,794 @@
+#include "TextureCooker.h"
+#include "BcEncoder.h"
+#include "MipGenerator.h"
+#include "PngDecoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+// クックの中身を変えたら上げる。古いキャッシュはキーが変わって使われなくなる
+constexpr uint32_t kTextureCookVersion = 5;
+
+bool Fail(std::string *error, const char *message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+// FNV-1aを8バイト単位で回す。毎回の起動でPNG全体をなめるので速さを優先する
+uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash ^= word;
+    hash *= 0x100000001B3ull;
+  }
+  for (; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+// BC5は2チャンネルの値をそのまま持つのでsRGBにはしない
+bool IsSrgb(const TextureCookSettings &settings) {
+  return settings.isSrgb && settings.compression != TextureCompression::Bc5;
+}
+
+#ifdef _WIN32
+
+DXGI_FORMAT GetCompressedFormat(const TextureCookSettings &settings) {
+  const bool isSrgb = IsSrgb(settings);
+  switch (settings.compression) {
+  case TextureCompression::Bc1:
+    return isSrgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+  case TextureCompression::Bc3:
+    return isSrgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+  case TextureCompression::Bc5:
+    return DXGI_FORMAT_BC5_UNORM;
+  case TextureCompression::Bc7:
+    return isSrgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+  default:
+    return DXGI_FORMAT_UNKNOWN;
+  }
+}
+
+// 自前のミップ生成で扱える形式か
+bool GetMipFormat(DXGI_FORMAT format, MipFormat &mipFormat) {
+  switch (format) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    mipFormat = MipFormat::Rgba8;
+    return true;
+  case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    mipFormat = MipFormat::Rgba16Float;
+    return true;
+  case DXGI_FORMAT_R8_UNORM:
+    mipFormat = MipFormat::R8;
+    return true;
+  case DXGI_FORMAT_R8G8_UNORM:
+    mipFormat = MipFormat::Rg8;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// よく使う形式は自前のミップ生成で作る
+// DirectXTexのものはfloatを経由して1スレッドで処理するので大きい画像で遅い
+HRESULT GenerateMips(const DirectX::ScratchImage &image,
+                     const TextureCookSettings &settings, ThreadPool *pool,
+                     DirectX::ScratchImage &mipImages) {
+  const DirectX::TexMetadata &metadata = image.GetMetadata();
+  const bool isSrgb = IsSrgb(settings);
+  MipSettings mipSettings;
+  if (!GetMipFormat(metadata.format, mipSettings.format) ||
+      metadata.arraySize != 1) {
+    return DirectX::GenerateMipMaps(
+        image.GetImages(), image.GetImageCount(), metadata,
+        isSrgb ? DirectX::TEX_FILTER_SRGB : DirectX::TEX_FILTER_DEFAULT, 0,
+        mipImages);
+  }
+  mipSettings.isSrgb = isSrgb;
+  mipSettings.filter = settings.mipFilter;
+  mipSettings.alphaCoverageReference = settings.alphaCoverageReference;
+
+  const uint32_t levelCount =
+      GetMipLevelCount(uint32_t(metadata.width), uint32_t(metadata.height));
+  HRESULT hr = mipImages.Initialize2D(metadata.format, metadata.width,
+                                      metadata.height, 1, levelCount);
+  if (FAILED(hr)) {
+    return hr;
+  }
+  std::vector<MipImage> levels(levelCount);
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    const DirectX::Image *mip = mipImages.GetImage(level, 0, 0);
+    levels[level] = {mip->pixels, uint32_t(mip->width), uint32_t(mip->height),
+                     mip->rowPitch};
+  }
+  const DirectX::Image *base = image.GetImage(0, 0, 0);
+  const size_t rowBytes = std::min(base->rowPitch, levels[0].rowPitch);
+  for (uint32_t y = 0; y < levels[0].height; ++y) {
+    std::memcpy(levels[0].pixels + y * levels[0].rowPitch,
+                base->pixels + y * base->rowPitch, rowBytes);
+  }
+  GenerateMipChain(levels.data(), levelCount, mipSettings, pool);
+  return S_OK;
+}
+
+// 自前の速い圧縮で作れる組み合わせか
+bool GetFastBcFormat(const TextureCookSettings &settings,
+                     const DirectX::TexMetadata &metadata, BcFormat &format) {
+  if (!settings.isFastCompression || metadata.arraySize != 1 ||
+      (metadata.format != DXGI_FORMAT_R8G8B8A8_UNORM &&
+       metadata.format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)) {
+    return false;
+  }
+  switch (settings.compression) {
+  case TextureCompression::Bc1:
+    format = BcFormat::Bc1;
+    return true;
+  case TextureCompression::Bc3:
+    format = BcFormat::Bc3;
+    return true;
+  case TextureCompression::Bc7:
+    format = BcFormat::Bc7;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// ミップごとに自前の圧縮をかける。sRGBの値はそのまま比べる
+HRESULT CompressFast(const DirectX::ScratchImage &image, DXGI_FORMAT format,
+                     const BcEncodeSettings &bcSettings, ThreadPool *pool,
+                     DirectX::ScratchImage &compressed) {
+  const DirectX::TexMetadata &metadata = image.GetMetadata();
+  HRESULT hr = compressed.Initialize2D(format, metadata.width, metadata.height,
+                                       1, metadata.mipLevels);
+  if (FAILED(hr)) {
+    return hr;
+  }
+  for (size_t level = 0; level < metadata.mipLevels; ++level) {
+    const DirectX::Image *source = image.GetImage(level, 0, 0);
+    const DirectX::Image *destination = compressed.GetImage(level, 0, 0);
+    const Rgba8Image rgba = {source->pixels, uint32_t(source->width),
+                             uint32_t(source->height), source->rowPitch};
+    EncodeBcImage(rgba, bcSettings, destination->pixels, destination->rowPitch,
+                  pool);
+  }
+  return S_OK;
+}
+
+#pragma region 元の画像のデコード
+
+bool IsDds(const uint8_t *bytes, size_t size) {
+  return size >= 4 && std::memcmp(bytes, "DDS ", 4) == 0;
+}
+
+bool IsHdr(const uint8_t *bytes, size_t size) {
+  return (size >= 10 && std::memcmp(bytes, "#?RADIANCE", 10) == 0) ||
+         (size >= 6 && std::memcmp(bytes, "#?RGBE", 6) == 0);
+}
+
+bool DecodePngImage(const void *data, size_t size,
+                    DirectX::ScratchImage &image, std::string *error) {
+  PngInfo info;
+  std::string message;
+  if (!ReadPngInfo(data, size, info, &message)) {
+    return Fail(error, message.c_str());
+  }
+  HRESULT hr = image.Initialize2D(info.bitsPerChannel == 16
+                                      ? DXGI_FORMAT_R16G16B16A16_UNORM
+                                      : DXGI_FORMAT_R8G8B8A8_UNORM,
+                                  info.width, info.height, 1, 1);
+  if (FAILED(hr)) {
+    return Fail(error, "failed to allocate the image");
+  }
+  const DirectX::Image *pixels = image.GetImage(0, 0, 0);
+  if (!DecodePng(data, size, pixels->pixels, pixels->rowPitch, &message)) {
+    return Fail(error, message.c_str());
+  }
+  return true;
+}
+
+// WICはグレーのPNGを1チャンネルで返すので、自前のデコーダーと同じRGBAに広げる
+// DirectX::Convertだと赤だけの画像になってしまう
+template <typename T>
+void ExpandGrayRows(const DirectX::Image &source, const DirectX::Image &dest,
+                    T opaque) {
+  for (size_t y = 0; y < source.height; ++y) {
+    const T *src = reinterpret_cast<const T *>(source.pixels +
+                                               y * source.rowPitch);
+    T *dst = reinterpret_cast<T *>(dest.pixels + y * dest.rowPitch);
+    for (size_t x = 0; x < source.width; ++x, dst += 4) {
+      dst[0] = dst[1] = dst[2] = src[x];
+      dst[3] = opaque;
+    }
+  }
+}
+
+bool ExpandGrayToRgba(DirectX::ScratchImage &image) {
+  const DXGI_FORMAT format = image.GetMetadata().format;
+  if (format != DXGI_FORMAT_R8_UNORM && format != DXGI_FORMAT_R16_UNORM) {
+    return true;
+  }
+  const DirectX::Image *source = image.GetImage(0, 0, 0);
+  DirectX::ScratchImage expanded{};
+  if (FAILED(expanded.Initialize2D(format == DXGI_FORMAT_R8_UNORM
+                                       ? DXGI_FORMAT_R8G8B8A8_UNORM
+                                       : DXGI_FORMAT_R16G16B16A16_UNORM,
+                                   source->width, source->height, 1, 1))) {
+    return false;
+  }
+  if (format == DXGI_FORMAT_R8_UNORM) {
+    ExpandGrayRows<uint8_t>(*source, *expanded.GetImage(0, 0, 0), 0xFF);
+  } else {
+    ExpandGrayRows<uint16_t>(*source, *expanded.GetImage(0, 0, 0), 0xFFFF);
+  }
+  image = std::move(expanded);
+  return true;
+}
+
+// 元の画像をデコードする。DDS、HDR、TGAはDirectXTexが自分で読む
+// PNGはWICが使えないとき(Windows以外やCoInitializeExしていないスレッド)は自前で読む
+// どちらで読んでもRGBA(8bitか16bit)の同じピクセルになる
+bool DecodeSourceImage(const void *data, size_t size, bool isSrgb,
+                       DirectX::ScratchImage &image, std::string *error) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  HRESULT hr = E_FAIL;
+  if (IsDds(bytes, size)) {
+    hr = DirectX::LoadFromDDSMemory(data, size, DirectX::DDS_FLAGS_NONE,
+                                    nullptr, image);
+  } else if (IsHdr(bytes, size)) {
+    hr = DirectX::LoadFromHDRMemory(data, size, nullptr, image);
+  } else {
+#ifdef _WIN32
+    // BGRAで返されると自前のデコーダーと並びが変わるのでRGBにそろえる
+    hr = DirectX::LoadFromWICMemory(
+        data, size,
+        DirectX::WIC_FLAGS_FORCE_RGB | DirectX::WIC_FLAGS_IGNORE_SRGB, nullptr,
+        image);
+#endif
+    if (FAILED(hr) && IsPng(data, size)) {
+      if (!DecodePngImage(data, size, image, error)) {
+        return false;
+      }
+      hr = S_OK;
+    } else if (FAILED(hr)) {
+      hr = DirectX::LoadFromTGAMemory(
+          data, size, DirectX::TGA_FLAGS_IGNORE_SRGB, nullptr, image);
+    }
+  }
+  if (FAILED(hr)) {
+    return Fail(error, "failed to decode the image");
+  }
+  if (!ExpandGrayToRgba(image)) {
+    return Fail(error, "failed to expand the gray image");
+  }
+  // ファイルの中のsRGBの指定は見ず、クックの設定で決める(DDSは書いてあるまま)
+  const DXGI_FORMAT format = image.GetMetadata().format;
+  if (!IsDds(bytes, size)) {
+    image.OverrideFormat(isSrgb ? DirectX::MakeSRGB(format)
+                                : DirectX::MakeLinear(format));
+  }
+  return true;
+}
+
+#pragma endregion
+
+// デコード済みの画像から、ミップを作って圧縮する
+bool CookDecodedImage(DirectX::ScratchImage image,
+                      const TextureCookSettings &settings,
+                      DirectX::ScratchImage &cooked, std::string *error,
+                      ThreadPool *pool) {
+  const bool isSrgb = IsSrgb(settings);
+  if (image.GetMetadata().dimension != DirectX::TEX_DIMENSION_TEXTURE2D) {
+    return Fail(error, "only 2D textures can be cooked");
+  }
+
+  const DirectX::TEX_FILTER_FLAGS filter =
+      isSrgb ? DirectX::TEX_FILTER_SRGB : DirectX::TEX_FILTER_DEFAULT;
+  const DXGI_FORMAT format = GetCompressedFormat(settings);
+
+  // D3D12ではBC圧縮したテクスチャの一番上のミップは幅も高さも4の倍数が必要
+  HRESULT hr = S_OK;
+  if (format != DXGI_FORMAT_UNKNOWN) {
+    const size_t width = image.GetMetadata().width;
+    const size_t height = image.GetMetadata().height;
+    const size_t alignedWidth = (width + 3) & ~size_t(3);
+    const size_t alignedHeight = (height + 3) & ~size_t(3);
+    if (alignedWidth != width || alignedHeight != height) {
+      DirectX::ScratchImage resized{};
+      hr = DirectX::Resize(image.GetImages(), image.GetImageCount(),
+                           image.GetMetadata(), alignedWidth, alignedHeight,
+                           filter, resized);
+      if (FAILED(hr)) {
+        return Fail(error, "failed to resize to a multiple of 4");
+      }
+      image = std::move(resized);
+    }
+  }
+
+  if (settings.isMipMapped) {
+    DirectX::ScratchImage mipImages{};
+    hr = GenerateMips(image, settings, pool, mipImages);
+    if (FAILED(hr)) {
+      return Fail(error, "failed to generate mipmaps");
+    }
+    image = std::move(mipImages);
+  }
+
+  if (format == DXGI_FORMAT_UNKNOWN) {
+    cooked = std::move(image);
+    return true;
+  }
+  BcEncodeSettings bcSettings;
+  if (GetFastBcFormat(settings, image.GetMetadata(), bcSettings.format)) {
+    bcSettings.quality = settings.fastCompressionQuality;
+    DirectX::ScratchImage compressed{};
+    hr = CompressFast(image, format, bcSettings, pool, compressed);
+    if (FAILED(hr)) {
+      return Fail(error, "failed to compress");
+    }
+    cooked = std::move(compressed);
+    return true;
+  }
+  DirectX::TEX_COMPRESS_FLAGS compressFlags = DirectX::TEX_COMPRESS_PARALLEL;
+  if (isSrgb) {
+    compressFlags |= DirectX::TEX_COMPRESS_SRGB;
+  }
+  DirectX::ScratchImage compressed{};
+  hr = DirectX::Compress(image.GetImages(), image.GetImageCount(),
+                         image.GetMetadata(), format, compressFlags,
+                         DirectX::TEX_THRESHOLD_DEFAULT, compressed);
+  if (FAILED(hr)) {
+    return Fail(error, "failed to compress");
+  }
+  cooked = std::move(compressed);
+  return true;
+}
+
+#endif
+
+} // namespace
+
+const char *GetTextureCompressionName(TextureCompression compression) {
+  switch (compression) {
+  case TextureCompression::None:
+    return "none";
+  case TextureCompression::Bc1:
+    return "bc1";
+  case TextureCompression::Bc3:
+    return "bc3";
+  case TextureCompression::Bc5:
+    return "bc5";
+  case TextureCompression::Bc7:
+    return "bc7";
+  }
+  return "unknown";
+}
+
+bool ParseTextureCompression(const std::string &name,
+                             TextureCompression &compression) {
+  for (TextureCompression candidate :
+       {TextureCompression::None, TextureCompression::Bc1,
+        TextureCompression::Bc3, TextureCompression::Bc5,
+        TextureCompression::Bc7}) {
+    if (name == GetTextureCompressionName(candidate)) {
+      compression = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t ComputeTextureCookKey(const void *data, size_t size,
+                               const TextureCookSettings &settings) {
+  const uint8_t settingBytes[] = {
+      uint8_t(kTextureCookVersion), uint8_t(settings.compression),
+      uint8_t(IsSrgb(settings)), uint8_t(settings.isMipMapped),
+      uint8_t(settings.mipFilter), uint8_t(settings.isFastCompression),
+      uint8_t(settings.fastCompressionQuality)};
+  uint64_t hash = HashBytes(0xCBF29CE484222325ull, settingBytes,
+                            sizeof(settingBytes));
+  hash = HashBytes(hash, &settings.alphaCoverageReference,
+                   sizeof(settings.alphaCoverageReference));
+  const uint64_t size64 = size;
+  hash = HashBytes(hash, &size64, sizeof(size64));
+  return HashBytes(hash, data, size);
+}
+
+std::string GetCookedTexturePath(const std::string &cacheDirectory,
+                                 uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.dds",
+                static_cast<unsigned long long>(key));
+  return cacheDirectory + "/" + name;
+}
+
+#ifdef _WIN32
+
+bool DecodeRgba8Texture(const void *data, size_t size, bool isSrgb,
+                        DirectX::ScratchImage &image, std::string *error) {
+  DirectX::ScratchImage decoded{};
+  if (!DecodeSourceImage(data, size, isSrgb, decoded, error)) {
+    return false;
+  }
+  const DXGI_FORMAT format = isSrgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+                                    : DXGI_FORMAT_R8G8B8A8_UNORM;
+  if (decoded.GetMetadata().format == format) {
+    image = std::move(decoded);
+    return true;
+  }
+  HRESULT hr = DirectX::Convert(
+      decoded.GetImages(), decoded.GetImageCount(), decoded.GetMetadata(),
+      format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT,
+      image);
+  if (FAILED(hr)) {
+    return Fail(error, "failed to convert to RGBA8");
+  }
+  return true;
+}
+
+bool CookTexture(const void *data, size_t size,
+                 const TextureCookSettings &settings,
+                 DirectX::ScratchImage &cooked, std::string *error,
+                 ThreadPool *pool) {
+  DirectX::ScratchImage image{};
+  if (!DecodeSourceImage(data, size, IsSrgb(settings), image, error)) {
+    return false;
+  }
+  return CookDecodedImage(std::move(image), settings, cooked, error, pool);
+}
+
+bool CookRgba8Texture(const Rgba8Image &source,
+                      const TextureCookSettings &settings,
+                      DirectX::ScratchImage &cooked, std::string *error,
+                      ThreadPool *pool) {
+  DirectX::ScratchImage image{};
+  HRESULT hr = image.Initialize2D(IsSrgb(settings)
+                                      ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+                                      : DXGI_FORMAT_R8G8B8A8_UNORM,
+                                  source.width, source.height, 1, 1);
+  if (FAILED(hr)) {
+    return Fail(error, "failed to allocate the image");
+  }
+  const DirectX::Image *destination = image.GetImage(0, 0, 0);
+  for (uint32_t y = 0; y < source.height; ++y) {
+    std::memcpy(destination->pixels + y * destination->rowPitch,
+                source.pixels + y * source.rowPitch, size_t(source.width) * 4);
+  }
+  return CookDecodedImage(std::move(image), settings, cooked, error, pool);
+}
+
+bool EncodeCookedTexture(const DirectX::ScratchImage &image,
+                         DirectX::Blob &blob, std::string *error) {
+  HRESULT hr = DirectX::SaveToDDSMemory(image.GetImages(),
+                                        image.GetImageCount(),
+                                        image.GetMetadata(),
+                                        DirectX::DDS_FLAGS_NONE, blob);
+  if (FAILED(hr)) {
+    return Fail(error, "failed to encode DDS");
+  }
+  return true;
+}
+
+#endif
+
+bool WriteCookedTexture(const void *data, size_t size, const std::string &path,
+                        std::string *error) {
+  const std::filesystem::path target(path);
+  std::error_code ec;
+  if (target.has_parent_path()) {
+    std::filesystem::create_directories(target.parent_path(), ec);
+  }
+  std::filesystem::path temporary = target;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return Fail(error, "failed to create the file");
+    }
+    file.write(static_cast<const char *>(data), std::streamsize(size));
+    if (!file) {
+      file.close();
+      std::filesystem::remove(temporary, ec);
+      return Fail(error, "failed to write the file");
+    }
+  }
+  std::filesystem::rename(temporary, target, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+    return Fail(error, "failed to replace the file");
+  }
+  return true;
+}
+
+#ifdef _WIN32
+
+bool SaveCookedTexture(const DirectX::ScratchImage &image,
+                       const std::string &path, std::string *error) {
+  DirectX::Blob blob;
+  if (!EncodeCookedTexture(image, blob, error)) {
+    return false;
+  }
+  return WriteCookedTexture(blob.GetBufferPointer(), blob.GetBufferSize(), path,
+                            error);
+}
+
+bool LoadDdsTexture(const void *data, size_t size, DirectX::ScratchImage &image,
+                    std::string *error) {
+  HRESULT hr = DirectX::LoadFromDDSMemory(data, size, DirectX::DDS_FLAGS_NONE,
+                                          nullptr, image);
+  if (FAILED(hr)) {
+    return Fail(error, "failed to load DDS");
+  }
+  return true;
+}
+
+#endif
+
+#pragma region DirectXTexを使わないクック
+
+namespace {
+
+// DDSのヘッダー。dxgiformat.hのない環境でも書けるよう、自前で定義する
+constexpr uint32_t kDdsMagic = 0x20534444;      // "DDS "
+constexpr uint32_t kDdsFourCcDx10 = 0x30315844; // "DX10"
+constexpr uint32_t kDdsFlagCaps = 0x1;
+constexpr uint32_t kDdsFlagHeight = 0x2;
+constexpr uint32_t kDdsFlagWidth = 0x4;
+constexpr uint32_t kDdsFlagPitch = 0x8;
+constexpr uint32_t kDdsFlagPixelFormat = 0x1000;
+constexpr uint32_t kDdsFlagMipMapCount = 0x20000;
+constexpr uint32_t kDdsFlagLinearSize = 0x80000;
+constexpr uint32_t kDdsPixelFormatFourCc = 0x4;
+constexpr uint32_t kDdsCapsComplex = 0x8;
+constexpr uint32_t kDdsCapsTexture = 0x1000;
+constexpr uint32_t kDdsCapsMipMap = 0x400000;
+constexpr uint32_t kDdsDimensionTexture2D = 3;
+
+struct DdsPixelFormat {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCc;
+  uint32_t rgbBitCount;
+  uint32_t bitMasks[4];
+};
+
+struct DdsHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  DdsPixelFormat pixelFormat;
+  uint32_t caps[4];
+  uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER is 124 bytes");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DDS_HEADER_DXT10 is 20 bytes");
+
+// DXGI_FORMATの値
+uint32_t GetDxgiFormatValue(TextureCompression compression, bool isSrgb) {
+  switch (compression) {
+  case TextureCompression::None:
+    return isSrgb ? 29 : 28; // R8G8B8A8_UNORM_SRGB / R8G8B8A8_UNORM
+  case TextureCompression::Bc1:
+    return isSrgb ? 72 : 71;
+  case TextureCompression::Bc3:
+    return isSrgb ? 78 : 77;
+  case TextureCompression::Bc5:
+    return 83;
+  case TextureCompression::Bc7:
+    return isSrgb ? 99 : 98;
+  }
+  return 0;
+}
+
+// 自前の速い圧縮で作れる形式か
+bool GetPortableBcFormat(TextureCompression compression, BcFormat &format) {
+  switch (compression) {
+  case TextureCompression::Bc1:
+    format = BcFormat::Bc1;
+    return true;
+  case TextureCompression::Bc3:
+    format = BcFormat::Bc3;
+    return true;
+  case TextureCompression::Bc7:
+    format = BcFormat::Bc7;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// ミップの並びを決めてlevelsに入れ、全体のバイト数を返す
+// blockSizeが0ならRGBA8、それ以外は4x4のブロック1つのバイト数
+size_t LayoutLevels(uint32_t width, uint32_t height, uint32_t levelCount,
+                    size_t blockSize, std::vector<CookedImage::Level> &levels) {
+  levels.resize(levelCount);
+  size_t offset = 0;
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    CookedImage::Level &mip = levels[level];
+    mip.width = std::max(width >> level, 1u);
+    mip.height = std::max(height >> level, 1u);
+    mip.offset = offset;
+    if (blockSize == 0) {
+      mip.rowPitch = size_t(mip.width) * 4;
+      mip.slicePitch = mip.rowPitch * mip.height;
+    } else {
+      mip.rowPitch = size_t((mip.width + 3) / 4) * blockSize;
+      mip.slicePitch = mip.rowPitch * ((mip.height + 3) / 4);
+    }
+    offset += mip.slicePitch;
+  }
+  return offset;
+}
+
+} // namespace
+
+bool CookPngTexture(const void *data, size_t size,
+                    const TextureCookSettings &settings, CookedImage &cooked,
+                    std::string *error, ThreadPool *pool) {
+  cooked = {};
+  if (!IsPng(data, size)) {
+    return Fail(error, "only PNG can be cooked without DirectXTex");
+  }
+  const bool isCompressed = settings.compression != TextureCompression::None;
+  BcEncodeSettings bcSettings;
+  if (isCompressed) {
+    if (!GetPortableBcFormat(settings.compression, bcSettings.format)) {
+      return Fail(error, "bc5 needs DirectXTex");
+    }
+    if (!settings.isFastCompression) {
+      return Fail(error, "BC compression without DirectXTex needs the fast "
+                         "encoder");
+    }
+    bcSettings.quality = settings.fastCompressionQuality;
+  }
+
+  PngInfo info;
+  std::string message;
+  if (!ReadPngInfo(data, size, info, &message)) {
+    return Fail(error, message.c_str());
+  }
+  // D3D12ではBC圧縮したテクスチャの一番上のミップは幅も高さも4の倍数が必要
+  // 揃えるための縮小はDirectXTexに任せているので、ここでは受け付けない
+  if (isCompressed && (info.width % 4 != 0 || info.height % 4 != 0)) {
+    return Fail(error, "BC textures need a width and height that are "
+                       "multiples of 4 without DirectXTex");
+  }
+  const size_t decodedPitch = info.GetRowBytes();
+  std::vector<uint8_t> decoded(decodedPitch * info.height);
+  if (!DecodePng(data, size, decoded.data(), decodedPitch, &message)) {
+    return Fail(error, message.c_str());
+  }
+
+  const uint32_t levelCount =
+      settings.isMipMapped ? GetMipLevelCount(info.width, info.height) : 1;
+  std::vector<CookedImage::Level> rgbaLevels;
+  std::vector<uint8_t> rgba(
+      LayoutLevels(info.width, info.height, levelCount, 0, rgbaLevels));
+  std::vector<MipImage> mips(levelCount);
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    const CookedImage::Level &mip = rgbaLevels[level];
+    mips[level] = {rgba.data() + mip.offset, mip.width, mip.height,
+                   mip.rowPitch};
+  }
+
+  // 16bitは一番近い8bitの値に丸める
+  const size_t rowValues = size_t(info.width) * 4;
+  for (uint32_t y = 0; y < info.height; ++y) {
+    const uint8_t *src = decoded.data() + decodedPitch * y;
+    uint8_t *dst = mips[0].pixels + mips[0].rowPitch * y;
+    if (info.bitsPerChannel == 16) {
+      const uint16_t *src16 = reinterpret_cast<const uint16_t *>(src);
+      for (size_t i = 0; i < rowValues; ++i) {
+        dst[i] = uint8_t((uint32_t(src16[i]) * 255 + 32767) / 65535);
+      }
+    } else {
+      std::memcpy(dst, src, rowValues);
+    }
+  }
+
+  if (levelCount > 1) {
+    MipSettings mipSettings;
+    mipSettings.format = MipFormat::Rgba8;
+    mipSettings.isSrgb = IsSrgb(settings);
+    mipSettings.filter = settings.mipFilter;
+    mipSettings.alphaCoverageReference = settings.alphaCoverageReference;
+    GenerateMipChain(mips.data(), levelCount, mipSettings, pool);
+  }
+
+  cooked.compression = settings.compression;
+  cooked.isSrgb = IsSrgb(settings);
+  if (!isCompressed) {
+    cooked.levels = std::move(rgbaLevels);
+    cooked.pixels = std::move(rgba);
+    return true;
+  }
+
+  cooked.pixels.resize(LayoutLevels(info.width, info.height, levelCount,
+                                    GetBcBlockSize(bcSettings.format),
+                                    cooked.levels));
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    const MipImage &source = mips[level];
+    const CookedImage::Level &destination = cooked.levels[level];
+    EncodeBcImage({source.pixels, source.width, source.height, source.rowPitch},
+                  bcSettings, cooked.pixels.data() + destination.offset,
+                  destination.rowPitch, pool);
+  }
+  return true;
+}
+
+bool EncodeCookedImage(const CookedImage &image, std::vector<uint8_t> &dds,
+                       std::string *error) {
+  if (image.levels.empty()) {
+    return Fail(error, "the image is empty");
+  }
+  const bool isCompressed = image.compression != TextureCompression::None;
+  const uint32_t levelCount = uint32_t(image.levels.size());
+
+  DdsHeader header{};
+  header.size = sizeof(DdsHeader);
+  header.flags = kDdsFlagCaps | kDdsFlagHeight | kDdsFlagWidth |
+                 kDdsFlagPixelFormat |
+                 (isCompressed ? kDdsFlagLinearSize : kDdsFlagPitch);
+  header.height = image.GetHeight();
+  header.width = image.GetWidth();
+  header.pitchOrLinearSize = uint32_t(isCompressed ? image.levels[0].slicePitch
+                                                   : image.levels[0].rowPitch);
+  header.depth = 1;
+  header.caps[0] = kDdsCapsTexture;
+  if (levelCount > 1) {
+    header.flags |= kDdsFlagMipMapCount;
+    header.mipMapCount = levelCount;
+    header.caps[0] |= kDdsCapsComplex | kDdsCapsMipMap;
+  }
+  header.pixelFormat.size = sizeof(DdsPixelFormat);
+  header.pixelFormat.flags = kDdsPixelFormatFourCc;
+  header.pixelFormat.fourCc = kDdsFourCcDx10;
+
+  DdsHeaderDx10 headerDx10{};
+  headerDx10.dxgiFormat = GetDxgiFormatValue(image.compression, image.isSrgb);
+  headerDx10.resourceDimension = kDdsDimensionTexture2D;
+  headerDx10.arraySize = 1;
+
+  dds.resize(sizeof(kDdsMagic) + sizeof(header) + sizeof(headerDx10) +
+             image.pixels.size());
+  uint8_t *dst = dds.data();
+  std::memcpy(dst, &kDdsMagic, sizeof(kDdsMagic));
+  dst += sizeof(kDdsMagic);
+  std::memcpy(dst, &header, sizeof(header));
+  dst += sizeof(header);
+  std::memcpy(dst, &headerDx10, sizeof(headerDx10));
+  dst += sizeof(headerDx10);
+  std::memcpy(dst, image.pixels.data(), image.pixels.size());
+  return true;
+}
+
+#pragma endregion
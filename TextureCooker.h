@@ -0,0 +1,135 @@
+#pragma once
+#include "BcEncoder.h"
+#include "MipGenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include "externals/DirectXTex/DirectXTex.h"
+#endif
+
+class ThreadPool;
+
+// テクスチャのクック(ミップ生成とBC圧縮を前もって済ませたDDSを作る)
+// ゲームの読み込み時の自動キャッシュとAssetTool cookの両方から使う
+// DirectXTexを使うものはWindowsだけ。ほかの環境では自前の処理だけでPNGをクックできる
+
+enum class TextureCompression : uint8_t {
+  // RGBA8のまま。ミップだけ作る
+  None,
+  // RGB(アルファは1bit)。1ピクセル4bit
+  Bc1,
+  // RGBA。1ピクセル8bit
+  Bc3,
+  // 2チャンネル(法線マップのXYなど)。1ピクセル8bit
+  Bc5,
+  // RGBA。BC3と同じサイズで綺麗だが、圧縮に時間がかかる
+  Bc7,
+};
+
+const char *GetTextureCompressionName(TextureCompression compression);
+bool ParseTextureCompression(const std::string &name,
+                             TextureCompression &compression);
+
+struct TextureCookSettings {
+  TextureCompression compression = TextureCompression::Bc7;
+  // 色のテクスチャはtrue。法線マップやマスクはfalseにする(BC5は常にfalse扱い)
+  bool isSrgb = true;
+  bool isMipMapped = true;
+  MipFilter mipFilter = MipFilter::Kaiser;
+  // 0より大きければ、切り抜きのテクスチャのミップでアルファがこれを超える割合を保つ
+  // アルファテストの閾値(0.5など)を入れる
+  float alphaCoverageReference = 0.0f;
+  // trueならBC1/BC3/BC7を自前の速い圧縮で作る(BC7はモード6だけ)
+  // その場で作るテクスチャ向け。BC5やRGBA8以外の画像はDirectXTexで圧縮する
+  bool isFastCompression = false;
+  BcQuality fastCompressionQuality = BcQuality::Normal;
+};
+
+// クック済みのDDSを置くディレクトリの既定値
+inline constexpr const char *kTextureCacheDirectory = "cache/textures";
+
+// 元の画像の中身と設定から作るキャッシュのキー
+// どちらかが変われば別のキーになるので、古いDDSを読むことはない
+uint64_t ComputeTextureCookKey(const void *data, size_t size,
+                               const TextureCookSettings &settings);
+// <cacheDirectory>/<キーの16進16桁>.dds
+std::string GetCookedTexturePath(const std::string &cacheDirectory,
+                                 uint64_t key);
+
+// 一時ファイルに書いてから置き換えるので、読み込み中の側が壊れたDDSを見ることはない
+bool WriteCookedTexture(const void *data, size_t size, const std::string &path,
+                        std::string *error = nullptr);
+
+#pragma region DirectXTexを使わないクック
+
+// 自前の処理だけでクックしたテクスチャ
+// ミップはlevels[0]から順に、pixelsの中に隙間なく並ぶ
+struct CookedImage {
+  struct Level {
+    size_t offset = 0;
+    size_t rowPitch = 0;
+    size_t slicePitch = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  TextureCompression compression = TextureCompression::None;
+  bool isSrgb = false;
+  std::vector<Level> levels;
+  std::vector<uint8_t> pixels;
+
+  uint32_t GetWidth() const { return levels.empty() ? 0 : levels[0].width; }
+  uint32_t GetHeight() const { return levels.empty() ? 0 : levels[0].height; }
+};
+
+// PNGの中身から、DirectXTexを使わずにミップ付きのテクスチャを作る
+// 16bitのPNGは8bitにする。BC1/BC3/BC7は自前の速い圧縮で作るので
+// isFastCompressionが要る。BC5と、4の倍数でない大きさのBC圧縮は扱えない
+bool CookPngTexture(const void *data, size_t size,
+                    const TextureCookSettings &settings, CookedImage &cooked,
+                    std::string *error = nullptr, ThreadPool *pool = nullptr);
+
+// DDSファイルの中身にする。形式はDX10の拡張ヘッダーに書く(DirectXTexで読める)
+bool EncodeCookedImage(const CookedImage &image, std::vector<uint8_t> &dds,
+                       std::string *error = nullptr);
+
+#pragma endregion
+
+#ifdef _WIN32
+
+// 画像ファイル(PNG、TGA、HDR、DDS。WindowsではWICで読めるJPGなども)の中身から
+// ミップ付きの圧縮テクスチャを作る
+// WindowsではWICを使うので、呼ぶスレッドでCoInitializeExしておくこと
+// WICが使えなければPNGは自前のデコーダーで読む(結果のピクセルは同じ)
+// poolを渡すと、大きい画像のミップは行を分けて並列に作る
+bool CookTexture(const void *data, size_t size,
+                 const TextureCookSettings &settings,
+                 DirectX::ScratchImage &cooked, std::string *error = nullptr,
+                 ThreadPool *pool = nullptr);
+
+// その場で作ったRGBA8の画像(アトラスのページなど)からクックする
+bool CookRgba8Texture(const Rgba8Image &image,
+                      const TextureCookSettings &settings,
+                      DirectX::ScratchImage &cooked,
+                      std::string *error = nullptr, ThreadPool *pool = nullptr);
+
+// CookTextureと同じ画像を1ピクセル4バイトのRGBA(isSrgbならsRGBの形式)にする
+// アトラスのように自前でピクセルを扱うとき用
+bool DecodeRgba8Texture(const void *data, size_t size, bool isSrgb,
+                        DirectX::ScratchImage &image,
+                        std::string *error = nullptr);
+
+// クックしたものをDDSファイルの中身にする
+bool EncodeCookedTexture(const DirectX::ScratchImage &image,
+                         DirectX::Blob &blob, std::string *error = nullptr);
+// EncodeCookedTextureしてWriteCookedTextureする
+bool SaveCookedTexture(const DirectX::ScratchImage &image,
+                       const std::string &path, std::string *error = nullptr);
+
+// DDSの中身をそのまま読む。ミップも圧縮もファイルのまま
+bool LoadDdsTexture(const void *data, size_t size, DirectX::ScratchImage &image,
+                    std::string *error = nullptr);
+
+#endif
@@ -0,0 +1,138 @@
+#include "TextureManager.h"
+#include <algorithm>
+#include <utility>
+
+const char *GetTextureCategoryName(TextureCategory category) {
+  switch (category) {
+  case TextureCategory::Model:
+    return "Model";
+  case TextureCategory::Sprite:
+    return "Sprite";
+  case TextureCategory::Ui:
+    return "UI";
+  default:
+    return "Generated";
+  }
+}
+
+uint32_t TextureManager::Register(Desc desc) {
+  uint32_t id = 0;
+  if (!freeIds_.empty()) {
+    id = freeIds_.back();
+    freeIds_.pop_back();
+  } else {
+    id = uint32_t(textures_.size());
+    textures_.emplace_back();
+  }
+
+  Texture &texture = textures_[id];
+  texture.info.name = std::move(desc.name);
+  texture.info.owner = std::move(desc.owner);
+  texture.info.category = desc.category;
+  texture.info.byteSize = desc.byteSize;
+  texture.info.lastUsedFrame = 0;
+  texture.info.isLoaded = true;
+  texture.unload = std::move(desc.unload);
+  texture.reload = std::move(desc.reload);
+  texture.isRegistered = true;
+  AddLoaded(texture.info);
+  return id;
+}
+
+void TextureManager::Unregister(uint32_t id) {
+  Texture &texture = textures_[id];
+  if (texture.info.isLoaded) {
+    RemoveLoaded(texture.info);
+  }
+  texture = {};
+  freeIds_.push_back(id);
+}
+
+bool TextureManager::Use(uint32_t id) {
+  Texture &texture = textures_[id];
+  texture.info.lastUsedFrame = frame_;
+  if (texture.info.isLoaded) {
+    return true;
+  }
+  const uint64_t byteSize = texture.reload();
+  if (byteSize == 0) {
+    return false;
+  }
+  texture.info.byteSize = byteSize;
+  texture.info.isLoaded = true;
+  AddLoaded(texture.info);
+  return true;
+}
+
+void TextureManager::SetByteSize(uint32_t id, uint64_t byteSize) {
+  Texture &texture = textures_[id];
+  if (texture.info.isLoaded) {
+    RemoveLoaded(texture.info);
+    texture.info.byteSize = byteSize;
+    AddLoaded(texture.info);
+  } else {
+    texture.info.byteSize = byteSize;
+  }
+}
+
+uint32_t TextureManager::Update() {
+  uint32_t evictedCount = 0;
+  if (loadedBytes_ > budgetBytes_) {
+    // 捨ててよいものを、長く使われていない順(同じなら大きい順)に並べる
+    std::vector<uint32_t> candidates;
+    for (uint32_t id = 0; id < textures_.size(); ++id) {
+      const Texture &texture = textures_[id];
+      if (texture.isRegistered && texture.info.isLoaded && texture.reload &&
+          texture.info.lastUsedFrame + minUnusedFrames_ <= frame_) {
+        candidates.push_back(id);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [&](uint32_t a, uint32_t b) {
+                const Info &infoA = textures_[a].info;
+                const Info &infoB = textures_[b].info;
+                if (infoA.lastUsedFrame != infoB.lastUsedFrame) {
+                  return infoA.lastUsedFrame < infoB.lastUsedFrame;
+                }
+                return infoA.byteSize != infoB.byteSize
+                           ? infoA.byteSize > infoB.byteSize
+                           : a < b;
+              });
+
+    for (uint32_t id : candidates) {
+      if (loadedBytes_ <= budgetBytes_) {
+        break;
+      }
+      Texture &texture = textures_[id];
+      if (texture.unload) {
+        texture.unload();
+      }
+      RemoveLoaded(texture.info);
+      texture.info.isLoaded = false;
+      ++evictedCount;
+    }
+  }
+  ++frame_;
+  return evictedCount;
+}
+
+void TextureManager::GetIds(std::vector<uint32_t> &ids) const {
+  ids.clear();
+  for (uint32_t id = 0; id < textures_.size(); ++id) {
+    if (textures_[id].isRegistered) {
+      ids.push_back(id);
+    }
+  }
+}
+
+void TextureManager::AddLoaded(const Info &info) {
+  loadedBytes_ += info.byteSize;
+  categoryBytes_[size_t(info.category)] += info.byteSize;
+  ++categoryCounts_[size_t(info.category)];
+}
+
+void TextureManager::RemoveLoaded(const Info &info) {
+  loadedBytes_ -= info.byteSize;
+  categoryBytes_[size_t(info.category)] -= info.byteSize;
+  --categoryCounts_[size_t(info.category)];
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// テクスチャの用途。メモリ使用量は用途ごとに集計する
+enum class TextureCategory : uint8_t { Model, Sprite, Ui, Generated, Count };
+
+const char *GetTextureCategoryName(TextureCategory category);
+
+// テクスチャ1枚ごとの大きさ、最後に使ったフレーム、持ち主を記録し、用途ごとに集計するクラス
+// 合計が予算を超えたら、しばらく使われていないテクスチャを丸ごと捨て、
+// 次に使うときに読み直す(レベルを切り替えても使わなくなったものが残り続けない)
+// GPUには触らず、捨てる処理と読み直す処理は登録時に渡した関数に任せる
+// メインスレッドからだけ使う
+class TextureManager {
+public:
+  static constexpr uint32_t kInvalidId = UINT32_MAX;
+
+  // 丸ごと捨てる。GPUのリソースとDDSの中身を手放す
+  using UnloadFunction = std::function<void()>;
+  // 捨てたテクスチャを読み直す。読み直した後のバイト数を返し、失敗したら0を返す
+  using ReloadFunction = std::function<uint64_t()>;
+
+  struct Desc {
+    // ファイルパスなど。表示にだけ使う
+    std::string name;
+    // 読み込んだレベルやシステムの名前。表示にだけ使う
+    std::string owner;
+    TextureCategory category = TextureCategory::Model;
+    // すべてのミップを置いたときのバイト数
+    uint64_t byteSize = 0;
+    UnloadFunction unload;
+    // 空なら捨てない(その場で作ったテクスチャなど、読み直せないもの)
+    ReloadFunction reload;
+  };
+
+  struct Info {
+    std::string name;
+    std::string owner;
+    TextureCategory category = TextureCategory::Model;
+    uint64_t byteSize = 0;
+    // 最後にUseしたフレーム。0は登録してから使っていないことを表す
+    uint64_t lastUsedFrame = 0;
+    bool isLoaded = false;
+  };
+
+  // 読み込んでいるものの合計がbudgetBytesを超えたら、
+  // minUnusedFramesフレーム以上使われていないものから捨てる
+  explicit TextureManager(uint64_t budgetBytes, uint32_t minUnusedFrames = 300)
+      : budgetBytes_(budgetBytes), minUnusedFrames_(minUnusedFrames) {}
+
+  // 読み込み済みのテクスチャを登録する
+  uint32_t Register(Desc desc);
+  // 登録だけを外す。unloadは呼ばない
+  void Unregister(uint32_t id);
+
+  // このフレームで使う。捨てていたら読み直す。読み直せなければfalse
+  bool Use(uint32_t id);
+  // ホットリロードなどで中身が変わったとき
+  void SetByteSize(uint32_t id, uint64_t byteSize);
+
+  // 予算を超えていれば、長く使われていないものから捨てる。戻り値は捨てた数
+  // そのフレームのUseをすべて呼んだ後に、1フレームに1回呼ぶ
+  uint32_t Update();
+
+  const Info &GetInfo(uint32_t id) const { return textures_[id].info; }
+  bool IsLoaded(uint32_t id) const { return textures_[id].info.isLoaded; }
+  // 登録中のテクスチャの番号を並べる(デバッグ表示用)
+  void GetIds(std::vector<uint32_t> &ids) const;
+
+  uint64_t GetLoadedBytes() const { return loadedBytes_; }
+  uint64_t GetLoadedBytes(TextureCategory category) const {
+    return categoryBytes_[size_t(category)];
+  }
+  uint32_t GetLoadedCount(TextureCategory category) const {
+    return categoryCounts_[size_t(category)];
+  }
+  uint64_t GetFrame() const { return frame_; }
+
+  uint64_t GetBudget() const { return budgetBytes_; }
+  // 下げたときは次のUpdateで予算まで捨てる
+  void SetBudget(uint64_t budgetBytes) { budgetBytes_ = budgetBytes; }
+
+private:
+  struct Texture {
+    Info info;
+    UnloadFunction unload;
+    ReloadFunction reload;
+    bool isRegistered = false;
+  };
+
+  void AddLoaded(const Info &info);
+  void RemoveLoaded(const Info &info);
+
+  uint64_t budgetBytes_ = 0;
+  uint32_t minUnusedFrames_ = 0;
+  uint64_t loadedBytes_ = 0;
+  std::array<uint64_t, size_t(TextureCategory::Count)> categoryBytes_{};
+  std::array<uint32_t, size_t(TextureCategory::Count)> categoryCounts_{};
+  std::vector<Texture> textures_;
+  std::vector<uint32_t> freeIds_;
+  // 0は使っていないことを表すので1から数える
+  uint64_t frame_ = 1;
+};
@@ -0,0 +1,210 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+
+uint32_t TextureResidency::Register(const uint64_t *mipSizes,
+                                    uint32_t mipCount, uint32_t floorMip,
+                                    uint32_t validMips) {
+  uint32_t id = 0;
+  if (!freeIds_.empty()) {
+    id = freeIds_.back();
+    freeIds_.pop_back();
+  } else {
+    id = uint32_t(textures_.size());
+    textures_.emplace_back();
+    reportedMips_.push_back(0);
+  }
+
+  Texture &texture = textures_[id];
+  texture.mipSizes.assign(mipSizes, mipSizes + mipCount);
+  texture.floorMip = std::min(floorMip, mipCount - 1);
+  texture.validMips = validMips | (1u << texture.floorMip);
+  texture.residentMip = texture.floorMip;
+  texture.requestedMip = texture.floorMip;
+  texture.requestFrame = 0;
+  texture.isRegistered = true;
+  for (uint32_t mip = texture.residentMip; mip < mipCount; ++mip) {
+    residentBytes_ += texture.mipSizes[mip];
+  }
+  reportedMips_[id] = texture.residentMip;
+  return id;
+}
+
+void TextureResidency::Unregister(uint32_t id) {
+  Texture &texture = textures_[id];
+  for (uint32_t mip = texture.residentMip; mip < texture.mipSizes.size();
+       ++mip) {
+    residentBytes_ -= texture.mipSizes[mip];
+  }
+  texture = {};
+  freeIds_.push_back(id);
+}
+
+void TextureResidency::SetResidentMip(uint32_t id, uint32_t residentMip) {
+  Texture &texture = textures_[id];
+  const uint32_t mipCount = uint32_t(texture.mipSizes.size());
+  residentBytes_ -= GetMipBytes(texture, texture.residentMip, mipCount);
+  texture.residentMip = residentMip;
+  residentBytes_ += GetMipBytes(texture, texture.residentMip, mipCount);
+  reportedMips_[id] = residentMip;
+}
+
+void TextureResidency::Request(uint32_t id, uint32_t mip, uint64_t frame) {
+  Texture &texture = textures_[id];
+  mip = std::min(mip, texture.floorMip);
+  if (texture.requestFrame != frame) {
+    texture.requestFrame = frame;
+    texture.requestedMip = mip;
+  } else {
+    texture.requestedMip = std::min(texture.requestedMip, mip);
+  }
+}
+
+void TextureResidency::Update(uint64_t frame, uint64_t maxLoadBytes,
+                              std::vector<Change> &changes) {
+  changes.clear();
+
+  // 要求より粗いものを、足りない段数の多い順に読む
+  std::vector<uint32_t> wanted;
+  for (uint32_t id = 0; id < textures_.size(); ++id) {
+    const Texture &texture = textures_[id];
+    if (texture.isRegistered && texture.requestFrame == frame &&
+        texture.requestedMip < texture.residentMip) {
+      wanted.push_back(id);
+    }
+  }
+  std::sort(wanted.begin(), wanted.end(), [&](uint32_t a, uint32_t b) {
+    const uint32_t missingA =
+        textures_[a].residentMip - textures_[a].requestedMip;
+    const uint32_t missingB =
+        textures_[b].residentMip - textures_[b].requestedMip;
+    return missingA != missingB ? missingA > missingB : a < b;
+  });
+
+  uint64_t loadedBytes = 0;
+  bool isLoadLimited = false;
+  for (uint32_t id : wanted) {
+    Texture &texture = textures_[id];
+    while (texture.residentMip > texture.requestedMip) {
+      // 一番上にできない段は飛ばし、その先の段までまとめて読む
+      const uint32_t nextMip = GetFinerMip(texture);
+      if (nextMip == UINT32_MAX) {
+        break;
+      }
+      const uint64_t size = GetMipBytes(texture, nextMip, texture.residentMip);
+      if (loadedBytes != 0 && loadedBytes + size > maxLoadBytes) {
+        isLoadLimited = true;
+        break;
+      }
+      while (residentBytes_ + size > budgetBytes_ && EvictOne(frame, id)) {
+      }
+      if (residentBytes_ + size > budgetBytes_) {
+        // 今使っているものだけで予算がいっぱい
+        break;
+      }
+      texture.residentMip = nextMip;
+      residentBytes_ += size;
+      loadedBytes += size;
+    }
+    if (isLoadLimited) {
+      break;
+    }
+  }
+  // 予算を下げたときなど
+  while (residentBytes_ > budgetBytes_ && EvictOne(frame, UINT32_MAX)) {
+  }
+
+  for (uint32_t id = 0; id < textures_.size(); ++id) {
+    const Texture &texture = textures_[id];
+    if (texture.isRegistered && texture.residentMip != reportedMips_[id]) {
+      changes.push_back({id, texture.residentMip});
+      reportedMips_[id] = texture.residentMip;
+    }
+  }
+}
+
+bool TextureResidency::EvictOne(uint64_t frame, uint32_t excludedId) {
+  uint32_t victim = UINT32_MAX;
+  for (uint32_t id = 0; id < textures_.size(); ++id) {
+    const Texture &texture = textures_[id];
+    if (!texture.isRegistered || id == excludedId ||
+        texture.residentMip >= texture.floorMip) {
+      continue;
+    }
+    // このフレームで使うミップは捨てない(要求より細かい分だけ捨ててよい)
+    if (texture.requestFrame == frame &&
+        GetCoarserMip(texture) > texture.requestedMip) {
+      continue;
+    }
+    if (victim == UINT32_MAX) {
+      victim = id;
+      continue;
+    }
+    // 長く使われていないもの、同じなら捨てて空く量が多いものを選ぶ
+    const Texture &current = textures_[victim];
+    if (texture.requestFrame != current.requestFrame
+            ? texture.requestFrame < current.requestFrame
+            : texture.mipSizes[texture.residentMip] >
+                  current.mipSizes[current.residentMip]) {
+      victim = id;
+    }
+  }
+  if (victim == UINT32_MAX) {
+    return false;
+  }
+  Texture &texture = textures_[victim];
+  const uint32_t nextMip = GetCoarserMip(texture);
+  residentBytes_ -= GetMipBytes(texture, texture.residentMip, nextMip);
+  texture.residentMip = nextMip;
+  return true;
+}
+
+uint32_t TextureResidency::GetFinerMip(const Texture &texture) {
+  for (uint32_t mip = texture.residentMip; mip > 0; --mip) {
+    if (texture.validMips & (1u << (mip - 1))) {
+      return mip - 1;
+    }
+  }
+  return UINT32_MAX;
+}
+
+uint32_t TextureResidency::GetCoarserMip(const Texture &texture) {
+  for (uint32_t mip = texture.residentMip + 1; mip < texture.floorMip;
+       ++mip) {
+    if (texture.validMips & (1u << mip)) {
+      return mip;
+    }
+  }
+  return texture.floorMip;
+}
+
+uint64_t TextureResidency::GetMipBytes(const Texture &texture, uint32_t begin,
+                                       uint32_t end) {
+  uint64_t bytes = 0;
+  for (uint32_t mip = begin; mip < end; ++mip) {
+    bytes += texture.mipSizes[mip];
+  }
+  return bytes;
+}
+
+float EstimateScreenSize(float radius, float distance, float fovY,
+                         float screenHeight) {
+  // 近すぎる(中に入っている)ときは画面いっぱい以上とみなす
+  if (distance <= radius) {
+    return screenHeight * 2.0f;
+  }
+  return radius * screenHeight / (distance * std::tan(fovY * 0.5f));
+}
+
+uint32_t SelectMipForScreenSize(uint32_t width, uint32_t height,
+                                float screenSize, uint32_t mipCount) {
+  const float size = float(std::max(width, height));
+  if (screenSize <= 0.0f) {
+    return mipCount - 1;
+  }
+  if (screenSize >= size) {
+    return 0;
+  }
+  const uint32_t mip = uint32_t(std::floor(std::log2(size / screenSize)));
+  return std::min(mip, mipCount - 1);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// テクスチャごとに、どのミップまでをメモリに置くかを決めるクラス
+// 置く量は予算に収め、足りなければ長く使われていないテクスチャの細かいミップから捨てる
+// GPUには触らず、決めた結果を返すだけなので単体で動かせる
+// ミップは0が一番細かい。residentMip以降(粗い方)がすべて置かれている状態を表す
+class TextureResidency {
+public:
+  struct Change {
+    uint32_t id;
+    uint32_t residentMip;
+  };
+
+  explicit TextureResidency(uint64_t budgetBytes) : budgetBytes_(budgetBytes) {}
+
+  // mipSizes[i]はi段目のバイト数。floorMipより粗いミップは常に置き、捨てない
+  // 最初はfloorMipから下だけが置かれた状態になる
+  // validMipsのiビット目が立っている段だけを一番上にする(BC圧縮で4の倍数でない段など
+  // を飛ばす)。floorMipは一番上にできるものとして扱う
+  uint32_t Register(const uint64_t *mipSizes, uint32_t mipCount,
+                    uint32_t floorMip, uint32_t validMips = UINT32_MAX);
+  void Unregister(uint32_t id);
+
+  // テクスチャを作り直せなかったときなどに、置いているミップを実際のものに戻す
+  void SetResidentMip(uint32_t id, uint32_t residentMip);
+
+  // このフレームで必要な一番細かいミップ。同じフレームで何度も呼ぶと細かい方を取る
+  void Request(uint32_t id, uint32_t mip, uint64_t frame);
+
+  // このフレームの要求に合わせて置くミップを決め直す。変わったものをchangesに入れる
+  // 一度に読み込む量はmaxLoadBytesまで(最低でも1段は読む)。残りは次のフレームに回す
+  void Update(uint64_t frame, uint64_t maxLoadBytes,
+              std::vector<Change> &changes);
+
+  uint32_t GetResidentMip(uint32_t id) const {
+    return textures_[id].residentMip;
+  }
+  uint32_t GetRequestedMip(uint32_t id) const {
+    return textures_[id].requestedMip;
+  }
+  uint64_t GetResidentBytes() const { return residentBytes_; }
+  uint64_t GetBudget() const { return budgetBytes_; }
+  // 下げたときは次のUpdateで予算まで捨てる
+  void SetBudget(uint64_t budgetBytes) { budgetBytes_ = budgetBytes; }
+
+private:
+  struct Texture {
+    std::vector<uint64_t> mipSizes;
+    uint32_t floorMip = 0;
+    uint32_t validMips = 0;
+    uint32_t residentMip = 0;
+    // requestFrameのフレームで要求されたミップ
+    uint32_t requestedMip = 0;
+    uint64_t requestFrame = 0;
+    bool isRegistered = false;
+  };
+
+  // residentMipより細かい/粗い段のうち、一番上にできる一番近い段
+  // なければUINT32_MAX
+  static uint32_t GetFinerMip(const Texture &texture);
+  static uint32_t GetCoarserMip(const Texture &texture);
+  // [begin, end)の段のバイト数の合計
+  static uint64_t GetMipBytes(const Texture &texture, uint32_t begin,
+                              uint32_t end);
+
+  // 捨ててよい一番古いテクスチャの細かいミップを、次に一番上にできる段まで捨てる
+  // 捨てられるものがなければfalse
+  bool EvictOne(uint64_t frame, uint32_t excludedId);
+
+  uint64_t budgetBytes_ = 0;
+  uint64_t residentBytes_ = 0;
+  std::vector<Texture> textures_;
+  std::vector<uint32_t> freeIds_;
+  // Updateの前の状態。changesを作るのに使う
+  std::vector<uint32_t> reportedMips_;
+};
+
+// 境界球の半径とカメラからの距離から、画面に映る直径をピクセルで見積もる
+// fovYは縦の視野角(ラジアン)
+float EstimateScreenSize(float radius, float distance, float fovY,
+                         float screenHeight);
+// 画面でscreenSizeピクセルに広がるテクスチャに必要なミップ
+uint32_t SelectMipForScreenSize(uint32_t width, uint32_t height,
+                                float screenSize, uint32_t mipCount);
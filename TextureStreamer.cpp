@@ -0,0 +1,348 @@
+#include "TextureStreamer.h"
+#include "TextureCooker.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+// このくらいの大きさより小さいミップは最初から置いておき、捨てない
+constexpr uint32_t kAlwaysResidentSize = 64;
+
+// magic(4バイト) + DDS_HEADER(124バイト)。DX10拡張があればさらに20バイト
+constexpr size_t kDdsHeaderSize = 4 + 124;
+constexpr size_t kDdsHeaderDx10Size = 20;
+// DDS_HEADERの中のピクセルフォーマットのFourCC
+constexpr size_t kDdsFourCcOffset = 4 + 72 + 8;
+
+uint32_t GetMipSize(uint32_t size, uint32_t mip) {
+  return std::max(size >> mip, 1u);
+}
+
+// DDSの中でミップが順に詰めて並んでいれば、その場所を返す
+// LoadFromDDSMemoryが形式を変換するもの(古い24bitのものなど)はfalseになる
+bool GetDdsMipLayouts(const FileData &file,
+                      const DirectX::TexMetadata &metadata,
+                      std::vector<std::pair<size_t, DirectX::Image>> &mips) {
+  if (file.size < kDdsHeaderSize) {
+    return false;
+  }
+  size_t offset = kDdsHeaderSize;
+  if (std::memcmp(file.data + kDdsFourCcOffset, "DX10", 4) == 0) {
+    offset += kDdsHeaderDx10Size;
+  }
+  mips.clear();
+  for (uint32_t mip = 0; mip < metadata.mipLevels; ++mip) {
+    DirectX::Image image{};
+    image.width = GetMipSize(uint32_t(metadata.width), mip);
+    image.height = GetMipSize(uint32_t(metadata.height), mip);
+    image.format = metadata.format;
+    if (FAILED(DirectX::ComputePitch(metadata.format, image.width,
+                                     image.height, image.rowPitch,
+                                     image.slicePitch))) {
+      return false;
+    }
+    mips.push_back({offset, image});
+    offset += image.slicePitch;
+  }
+  return offset == file.size;
+}
+
+// 詰めて並んでいないDDSは、一度展開して書き直す
+FileData NormalizeDds(const FileData &file) {
+  DirectX::ScratchImage image{};
+  std::shared_ptr<DirectX::Blob> blob = std::make_shared<DirectX::Blob>();
+  if (!LoadDdsTexture(file.data, file.size, image) ||
+      !EncodeCookedTexture(image, *blob)) {
+    return {};
+  }
+  FileData normalized;
+  normalized.data = static_cast<const uint8_t *>(blob->GetBufferPointer());
+  normalized.size = blob->GetBufferSize();
+  normalized.owner = std::move(blob);
+  return normalized;
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer(ID3D12Device *device, UploadRing &uploadRing,
+                                 uint64_t budgetBytes,
+                                 uint64_t maxUploadBytesPerFrame)
+    : device_(device), uploadRing_(uploadRing),
+      maxUploadBytesPerFrame_(maxUploadBytesPerFrame), residency_(budgetBytes) {
+}
+
+uint32_t TextureStreamer::Add(AssetRegistry::Handle<FileData> dds,
+                              D3D12_CPU_DESCRIPTOR_HANDLE srvHandle,
+                              ID3D12GraphicsCommandList *commandList) {
+  Texture texture;
+  if (!Load(std::move(dds), texture)) {
+    return kInvalidId;
+  }
+  texture.srvHandle = srvHandle;
+  if (!Rebuild(texture, texture.residentMip, commandList)) {
+    residency_.Unregister(texture.residencyId);
+    return kInvalidId;
+  }
+
+  uint32_t id = 0;
+  if (!freeIds_.empty()) {
+    id = freeIds_.back();
+    freeIds_.pop_back();
+  } else {
+    id = uint32_t(textures_.size());
+    textures_.emplace_back();
+  }
+  textures_[id] = std::move(texture);
+  residencyToTexture_[textures_[id].residencyId] = id;
+  return id;
+}
+
+bool TextureStreamer::Replace(uint32_t id, AssetRegistry::Handle<FileData> dds,
+                              ID3D12GraphicsCommandList *commandList) {
+  Texture texture;
+  if (!Load(std::move(dds), texture)) {
+    return false;
+  }
+  Texture &current = textures_[id];
+  texture.srvHandle = current.srvHandle;
+  // 作れなければ前のテクスチャを使い続ける
+  if (!Rebuild(texture, texture.residentMip, commandList)) {
+    residency_.Unregister(texture.residencyId);
+    return false;
+  }
+  if (IsLoaded(id)) {
+    residency_.Unregister(current.residencyId);
+  }
+  // 前のテクスチャは別の形式や大きさかもしれないので、コピーせずに捨てる
+  uploadRing_.ReleaseAfterSubmit(std::move(current.resource));
+  current = std::move(texture);
+  residencyToTexture_[current.residencyId] = id;
+  return true;
+}
+
+void TextureStreamer::Remove(uint32_t id) {
+  Texture &texture = textures_[id];
+  if (IsLoaded(id)) {
+    residency_.Unregister(texture.residencyId);
+  }
+  uploadRing_.ReleaseAfterSubmit(std::move(texture.resource));
+  texture = {};
+  freeIds_.push_back(id);
+}
+
+void TextureStreamer::Unload(uint32_t id) {
+  Texture &texture = textures_[id];
+  if (!IsLoaded(id)) {
+    return;
+  }
+  residency_.Unregister(texture.residencyId);
+  uploadRing_.ReleaseAfterSubmit(std::move(texture.resource));
+
+  // 間違って使われても読めるよう、リソースのないSRVにしておく(0が読める)
+  D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+  srvDesc.Format = texture.format;
+  srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+  srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+  srvDesc.Texture2D.MipLevels = 1;
+  device_->CreateShaderResourceView(nullptr, &srvDesc, texture.srvHandle);
+
+  const D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = texture.srvHandle;
+  texture = {};
+  texture.srvHandle = srvHandle;
+}
+
+void TextureStreamer::RequestScreenSize(uint32_t id, float screenSize) {
+  const Texture &texture = textures_[id];
+  if (!IsLoaded(id)) {
+    return;
+  }
+  const uint32_t mip = SelectMipForScreenSize(
+      texture.width, texture.height, screenSize, uint32_t(texture.mips.size()));
+  residency_.Request(texture.residencyId, mip, frame_);
+}
+
+void TextureStreamer::Update(ID3D12GraphicsCommandList *commandList) {
+  residency_.Update(frame_, maxUploadBytesPerFrame_, changes_);
+  for (const TextureResidency::Change &change : changes_) {
+    Texture &texture = textures_[residencyToTexture_[change.id]];
+    // 作れなければ今のミップのまま使い続ける(次に要求されたときにまた試す)
+    if (!Rebuild(texture, change.residentMip, commandList)) {
+      residency_.SetResidentMip(change.id, texture.residentMip);
+    }
+  }
+  ++frame_;
+}
+
+uint32_t TextureStreamer::GetResidentMip(uint32_t id) const {
+  return textures_[id].residentMip;
+}
+
+uint32_t TextureStreamer::GetMipCount(uint32_t id) const {
+  return uint32_t(textures_[id].mips.size());
+}
+
+uint64_t TextureStreamer::GetTotalBytes(uint32_t id) const {
+  uint64_t totalBytes = 0;
+  for (const MipLayout &mip : textures_[id].mips) {
+    totalBytes += mip.slicePitch;
+  }
+  return totalBytes;
+}
+
+bool TextureStreamer::Load(AssetRegistry::Handle<FileData> dds,
+                           Texture &texture) {
+  if (dds == nullptr || !dds->IsValid()) {
+    return false;
+  }
+  // ハンドルごと持っておき、AssetRegistryの共有を切らさない
+  FileData file = *dds;
+  file.owner = dds;
+
+  DirectX::TexMetadata metadata{};
+  if (FAILED(DirectX::GetMetadataFromDDSMemory(
+          file.data, file.size, DirectX::DDS_FLAGS_NONE, metadata)) ||
+      metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D ||
+      metadata.arraySize != 1 || metadata.depth != 1) {
+    std::cerr << "Texture cannot be streamed (only 2D textures are supported)"
+              << std::endl;
+    return false;
+  }
+  std::vector<std::pair<size_t, DirectX::Image>> mips;
+  if (!GetDdsMipLayouts(file, metadata, mips)) {
+    file = NormalizeDds(file);
+    if (!file.IsValid() ||
+        FAILED(DirectX::GetMetadataFromDDSMemory(
+            file.data, file.size, DirectX::DDS_FLAGS_NONE, metadata)) ||
+        !GetDdsMipLayouts(file, metadata, mips)) {
+      std::cerr << "Texture cannot be streamed (unsupported DDS layout)"
+                << std::endl;
+      return false;
+    }
+  }
+
+  texture.file = std::move(file);
+  texture.format = metadata.format;
+  texture.width = uint32_t(metadata.width);
+  texture.height = uint32_t(metadata.height);
+  texture.mips.clear();
+  std::vector<uint64_t> mipSizes;
+  for (const auto &[offset, image] : mips) {
+    texture.mips.push_back({offset, image.rowPitch, image.slicePitch});
+    mipSizes.push_back(image.slicePitch);
+  }
+
+  // 常に置いておく段。BC圧縮はテクスチャの一番上が4の倍数でないと作れないので、
+  // それより細かい段で止める
+  const uint32_t mipCount = uint32_t(mips.size());
+  uint32_t floorMip = 0;
+  while (floorMip + 1 < mipCount &&
+         std::max(GetMipSize(texture.width, floorMip),
+                  GetMipSize(texture.height, floorMip)) > kAlwaysResidentSize) {
+    ++floorMip;
+  }
+  // 途中の段も同じで、4の倍数でない段は一番上にしない(飛ばして次の段まで読む)
+  uint32_t validMips = UINT32_MAX;
+  if (DirectX::IsCompressed(texture.format)) {
+    validMips = 0;
+    for (uint32_t mip = 0; mip < mipCount; ++mip) {
+      if (GetMipSize(texture.width, mip) % 4 == 0 &&
+          GetMipSize(texture.height, mip) % 4 == 0) {
+        validMips |= 1u << mip;
+      }
+    }
+    while (floorMip > 0 && !(validMips & (1u << floorMip))) {
+      --floorMip;
+    }
+  }
+
+  texture.residencyId =
+      residency_.Register(mipSizes.data(), mipCount, floorMip, validMips);
+  texture.residentMip = residency_.GetResidentMip(texture.residencyId);
+  if (texture.residencyId >= residencyToTexture_.size()) {
+    residencyToTexture_.resize(texture.residencyId + 1, kInvalidId);
+  }
+  return true;
+}
+
+bool TextureStreamer::Rebuild(Texture &texture, uint32_t residentMip,
+                              ID3D12GraphicsCommandList *commandList) {
+  const uint32_t mipCount = uint32_t(texture.mips.size());
+
+  D3D12_RESOURCE_DESC resourceDesc{};
+  resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+  resourceDesc.Width = GetMipSize(texture.width, residentMip);
+  resourceDesc.Height = GetMipSize(texture.height, residentMip);
+  resourceDesc.DepthOrArraySize = 1;
+  resourceDesc.MipLevels = UINT16(mipCount - residentMip);
+  resourceDesc.Format = texture.format;
+  resourceDesc.SampleDesc.Count = 1;
+
+  D3D12_HEAP_PROPERTIES heapProperties{};
+  heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+  Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+  HRESULT hr = device_->CreateCommittedResource(
+      &heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+      D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&resource));
+  if (FAILED(hr)) {
+    std::cerr << "Failed to create a texture for mip " << residentMip
+              << std::endl;
+    return false;
+  }
+
+  // 前のテクスチャにない細かい段だけをDDSから転送する
+  uint32_t copyBegin = mipCount;
+  if (texture.resource != nullptr) {
+    copyBegin = std::max(residentMip, texture.residentMip);
+  }
+  if (copyBegin > residentMip) {
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+    for (uint32_t mip = residentMip; mip < copyBegin; ++mip) {
+      const MipLayout &layout = texture.mips[mip];
+      D3D12_SUBRESOURCE_DATA subresource{};
+      subresource.pData = texture.file.data + layout.offset;
+      subresource.RowPitch = LONG_PTR(layout.rowPitch);
+      subresource.SlicePitch = LONG_PTR(layout.slicePitch);
+      subresources.push_back(subresource);
+    }
+    uploadRing_.UploadTexture(commandList, resource.Get(), subresources.data(),
+                              uint32_t(subresources.size()));
+  }
+  // 残りは前のテクスチャからGPUの中でコピーする(GENERIC_READはコピー元にもなれる)
+  for (uint32_t mip = copyBegin; mip < mipCount; ++mip) {
+    D3D12_TEXTURE_COPY_LOCATION destination{};
+    destination.pResource = resource.Get();
+    destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+    destination.SubresourceIndex = mip - residentMip;
+    D3D12_TEXTURE_COPY_LOCATION source{};
+    source.pResource = texture.resource.Get();
+    source.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+    source.SubresourceIndex = mip - texture.residentMip;
+    commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+  }
+
+  D3D12_RESOURCE_BARRIER barrier{};
+  barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+  barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+  barrier.Transition.pResource = resource.Get();
+  barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+  barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+  barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+  commandList->ResourceBarrier(1, &barrier);
+
+  // 前のテクスチャはこのコマンドリストがコピー元に使うので、GPUが過ぎるまで預ける
+  uploadRing_.ReleaseAfterSubmit(std::move(texture.resource));
+  texture.resource = std::move(resource);
+  texture.residentMip = residentMip;
+
+  D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+  srvDesc.Format = texture.format;
+  srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+  srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+  srvDesc.Texture2D.MipLevels = UINT(mipCount - residentMip);
+  device_->CreateShaderResourceView(texture.resource.Get(), &srvDesc,
+                                    texture.srvHandle);
+  return true;
+}
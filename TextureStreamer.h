@@ -0,0 +1,103 @@
+#pragma once
+#include "AssetRegistry.h"
+#include "MappedFile.h"
+#include "TextureResidency.h"
+#include "UploadRing.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <dxgiformat.h>
+#include <vector>
+#include <wrl.h>
+
+// クック済みのDDSをミップ単位でGPUに置くクラス
+// 最初は小さいミップだけを転送し、画面での大きさに応じて細かいミップを足していく
+// 予算を超えたら長く使われていないテクスチャの細かいミップから捨てる
+// DDSの中身はメモリに持ったままなので、捨てたミップはいつでも転送し直せる
+// メインスレッドからだけ使う
+class TextureStreamer {
+public:
+  static constexpr uint32_t kInvalidId = UINT32_MAX;
+
+  // budgetBytesはGPUに置くミップの合計(DDSの中のサイズで数える)
+  // maxUploadBytesPerFrameを超える分の転送は次のフレームに回す
+  TextureStreamer(ID3D12Device *device, UploadRing &uploadRing,
+                  uint64_t budgetBytes,
+                  uint64_t maxUploadBytesPerFrame = 8 * 1024 * 1024);
+
+  TextureStreamer(const TextureStreamer &) = delete;
+  TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+  // 小さいミップだけのテクスチャを作ってsrvHandleにSRVを作る
+  // 2Dで配列でないDDSだけを扱う。扱えなければkInvalidIdを返す
+  uint32_t Add(AssetRegistry::Handle<FileData> dds,
+               D3D12_CPU_DESCRIPTOR_HANDLE srvHandle,
+               ID3D12GraphicsCommandList *commandList);
+  // 中身だけを差し替える(ホットリロード用)。SRVの場所はそのまま
+  bool Replace(uint32_t id, AssetRegistry::Handle<FileData> dds,
+               ID3D12GraphicsCommandList *commandList);
+  void Remove(uint32_t id);
+  // DDSの中身とテクスチャを手放し、SRVは何も指さないものにする
+  // 番号とSRVの場所は残るので、Replaceで読み直せる
+  void Unload(uint32_t id);
+  bool IsLoaded(uint32_t id) const { return textures_[id].file.IsValid(); }
+
+  // このフレームで画面にscreenSizeピクセルほどの大きさで映る
+  // 何度も呼んだときは一番大きいものに合わせる
+  void RequestScreenSize(uint32_t id, float screenSize);
+
+  // このフレームの要求に合わせてミップを足したり捨てたりする
+  // テクスチャを作り直すので、GPUが前のフレームを使い終わった後、描画の前に呼ぶ
+  void Update(ID3D12GraphicsCommandList *commandList);
+
+  uint32_t GetResidentMip(uint32_t id) const;
+  uint32_t GetMipCount(uint32_t id) const;
+  uint32_t GetWidth(uint32_t id) const { return textures_[id].width; }
+  uint32_t GetHeight(uint32_t id) const { return textures_[id].height; }
+  // すべてのミップを置いたときのバイト数(DDSの中のサイズで数える)
+  uint64_t GetTotalBytes(uint32_t id) const;
+
+  uint64_t GetResidentBytes() const { return residency_.GetResidentBytes(); }
+  uint64_t GetBudget() const { return residency_.GetBudget(); }
+  void SetBudget(uint64_t budgetBytes) { residency_.SetBudget(budgetBytes); }
+
+private:
+  // DDSの中での1段のミップの場所
+  struct MipLayout {
+    size_t offset;
+    size_t rowPitch;
+    size_t slicePitch;
+  };
+
+  struct Texture {
+    FileData file;
+    std::vector<MipLayout> mips;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t residencyId = 0;
+    // resourceの一番上が何段目のミップか
+    uint32_t residentMip = 0;
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+    D3D12_CPU_DESCRIPTOR_HANDLE srvHandle{};
+  };
+
+  // DDSを読んでtextureの中身を埋め、residencyに登録する
+  bool Load(AssetRegistry::Handle<FileData> dds, Texture &texture);
+  // residentMipから下のミップだけを持つテクスチャを作り直してSRVも作り直す
+  // 前のテクスチャにあるミップはGPUの中でコピーし、足りない分だけ転送する
+  // 作れなければfalseを返し、前のテクスチャとSRVはそのまま残す
+  bool Rebuild(Texture &texture, uint32_t residentMip,
+               ID3D12GraphicsCommandList *commandList);
+
+  Microsoft::WRL::ComPtr<ID3D12Device> device_;
+  UploadRing &uploadRing_;
+  uint64_t maxUploadBytesPerFrame_;
+  TextureResidency residency_;
+  // residencyの番号からこちらの番号を引く
+  std::vector<uint32_t> residencyToTexture_;
+  std::vector<Texture> textures_;
+  std::vector<uint32_t> freeIds_;
+  std::vector<TextureResidency::Change> changes_;
+  // 0は要求がないことを表すので1から数える
+  uint64_t frame_ = 1;
+};
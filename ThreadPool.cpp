@@ -0,0 +1,127 @@
+#include "ThreadPool.h"
+#ifdef _WIN32
+#include <Windows.h>
+#include <objbase.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = 1;
+  }
+  threads_.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; ++i) {
+    threads_.emplace_back(&ThreadPool::WorkerMain, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  jobCondition_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+  }
+  jobCondition_.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idleCondition_.wait(lock,
+                      [this] { return jobs_.empty() && runningJobCount_ == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count,
+                             const std::function<void(uint32_t)> &body) {
+  if (count <= 1) {
+    if (count == 1) {
+      body(0);
+    }
+    return;
+  }
+
+  // 手伝うジョブは呼び出しから戻った後に始まることもあるので、
+  // 共有する状態はshared_ptrで持ち、bodyには番号を取れたときだけ触る
+  struct State {
+    const std::function<void(uint32_t)> *body = nullptr;
+    uint32_t count = 0;
+    std::atomic<uint32_t> next{0};
+    std::atomic<uint32_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+  };
+  auto state = std::make_shared<State>();
+  state->body = &body;
+  state->count = count;
+
+  auto run = [state]() {
+    for (;;) {
+      const uint32_t index = state->next.fetch_add(1);
+      if (index >= state->count) {
+        return;
+      }
+      (*state->body)(index);
+      if (state->finished.fetch_add(1) + 1 == state->count) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->condition.notify_all();
+      }
+    }
+  };
+
+  const uint32_t helperCount = std::min(count - 1, GetThreadCount());
+  for (uint32_t i = 0; i < helperCount; ++i) {
+    Submit(run);
+  }
+  run();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->condition.wait(lock,
+                        [&] { return state->finished.load() == count; });
+}
+
+void ThreadPool::WorkerMain() {
+#ifdef _WIN32
+  // WICなどCOMを使うジョブがあるのでワーカーごとに初期化しておく
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      jobCondition_.wait(lock, [this] { return isStopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        // 停止要求が来ていて残りのジョブもない
+        break;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      ++runningJobCount_;
+    }
+
+    job();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --runningJobCount_;
+      if (jobs_.empty() && runningJobCount_ == 0) {
+        idleCondition_.notify_all();
+      }
+    }
+  }
+
+#ifdef _WIN32
+  CoUninitialize();
+#endif
+}
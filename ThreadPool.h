@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数のワーカースレッドでジョブを処理するクラス
+class ThreadPool {
+public:
+  explicit ThreadPool(uint32_t threadCount);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // ジョブを積む。どのワーカーで実行されるかは決まっていない
+  void Submit(std::function<void()> job);
+
+  // 積んだジョブがすべて終わるまで待つ
+  void WaitIdle();
+
+  // body(0)からbody(count - 1)までをワーカーと呼び出し元で分けて実行し、
+  // すべて終わるまで待つ。呼び出し元も処理に加わるので、
+  // ワーカーのジョブの中から呼んでも空きを待って止まることはない
+  void ParallelFor(uint32_t count, const std::function<void(uint32_t)> &body);
+
+  uint32_t GetThreadCount() const {
+    return static_cast<uint32_t>(threads_.size());
+  }
+
+private:
+  void WorkerMain();
+
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable jobCondition_;
+  std::condition_variable idleCondition_;
+  uint32_t runningJobCount_ = 0;
+  bool isStopping_ = false;
+};
@@ -0,0 +1,123 @@
+#include "UploadRing.h"
+#include "externals/DirectXTex/d3dx12.h"
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+Microsoft::WRL::ComPtr<ID3D12Resource> CreateUploadBuffer(ID3D12Device *device,
+                                                          uint64_t size) {
+  D3D12_HEAP_PROPERTIES heapProperties{};
+  heapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+  D3D12_RESOURCE_DESC resourceDesc{};
+  resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+  resourceDesc.Width = size;
+  resourceDesc.Height = 1;
+  resourceDesc.DepthOrArraySize = 1;
+  resourceDesc.MipLevels = 1;
+  resourceDesc.SampleDesc.Count = 1;
+  resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+  Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+  HRESULT hr = device->CreateCommittedResource(
+      &heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+      D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer));
+  assert(SUCCEEDED(hr));
+  return buffer;
+}
+
+} // namespace
+
+UploadRing::UploadRing(ID3D12Device *device, uint64_t capacity)
+    : device_(device), allocator_(capacity) {
+  buffer_ = CreateUploadBuffer(device, capacity);
+  // Uploadヒープは書き込むだけなので、開きっぱなしにしておく
+  HRESULT hr =
+      buffer_->Map(0, nullptr, reinterpret_cast<void **>(&mappedData_));
+  assert(SUCCEEDED(hr));
+}
+
+UploadRing::~UploadRing() { buffer_->Unmap(0, nullptr); }
+
+UploadRing::Allocation UploadRing::Allocate(uint64_t size,
+                                            uint64_t alignment) {
+  const uint64_t offset = allocator_.Allocate(size, alignment);
+  if (offset == RingAllocator::kInvalidOffset) {
+    return {};
+  }
+  Allocation allocation;
+  allocation.cpuAddress = mappedData_ + offset;
+  allocation.gpuAddress = buffer_->GetGPUVirtualAddress() + offset;
+  allocation.resource = buffer_.Get();
+  allocation.offset = offset;
+  return allocation;
+}
+
+void UploadRing::UploadTexture(ID3D12GraphicsCommandList *commandList,
+                               ID3D12Resource *texture,
+                               const D3D12_SUBRESOURCE_DATA *subresources,
+                               uint32_t subresourceCount) {
+  const uint64_t size =
+      GetRequiredIntermediateSize(texture, 0, subresourceCount);
+  const Allocation allocation =
+      Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+  if (allocation.IsValid()) {
+    UpdateSubresources(commandList, texture, allocation.resource,
+                       allocation.offset, 0, subresourceCount, subresources);
+    return;
+  }
+
+  UpdateSubresources(commandList, texture, CreateFallbackBuffer(size), 0, 0,
+                     subresourceCount, subresources);
+}
+
+void UploadRing::UploadBuffer(ID3D12GraphicsCommandList *commandList,
+                              ID3D12Resource *destination,
+                              uint64_t destinationOffset, const void *data,
+                              uint64_t size) {
+  const Allocation allocation = Allocate(size, 4);
+  ID3D12Resource *source = allocation.resource;
+  uint64_t sourceOffset = allocation.offset;
+  if (allocation.IsValid()) {
+    std::memcpy(allocation.cpuAddress, data, size);
+  } else {
+    source = CreateFallbackBuffer(size);
+    sourceOffset = 0;
+    void *mapped = nullptr;
+    HRESULT hr = source->Map(0, nullptr, &mapped);
+    assert(SUCCEEDED(hr));
+    std::memcpy(mapped, data, size);
+    source->Unmap(0, nullptr);
+  }
+  commandList->CopyBufferRegion(destination, destinationOffset, source,
+                                sourceOffset, size);
+}
+
+void UploadRing::ReleaseAfterSubmit(
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource) {
+  if (resource != nullptr) {
+    pendingBuffers_.push_back(std::move(resource));
+  }
+}
+
+void UploadRing::Submit(uint64_t fenceValue) {
+  allocator_.Submit(fenceValue);
+  for (Microsoft::WRL::ComPtr<ID3D12Resource> &buffer : pendingBuffers_) {
+    retainedBuffers_.push_back({fenceValue, std::move(buffer)});
+  }
+  pendingBuffers_.clear();
+}
+
+void UploadRing::Release(uint64_t completedFenceValue) {
+  allocator_.Release(completedFenceValue);
+  while (!retainedBuffers_.empty() &&
+         retainedBuffers_.front().fenceValue <= completedFenceValue) {
+    retainedBuffers_.pop_front();
+  }
+}
+
+ID3D12Resource *UploadRing::CreateFallbackBuffer(uint64_t size) {
+  pendingBuffers_.push_back(CreateUploadBuffer(device_.Get(), size));
+  return pendingBuffers_.back().Get();
+}
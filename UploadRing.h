@@ -0,0 +1,75 @@
+#pragma once
+#include "RingAllocator.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <deque>
+#include <vector>
+#include <wrl.h>
+
+// 転送用のUploadバッファを1つだけ持ち、テクスチャやバッファの転送元を切り出して使い回すクラス
+// 切り出した場所はSubmitで渡したフェンスの値をGPUが過ぎるまで使われず、Releaseで返る
+// コピーは渡したコマンドリストに積むので、同じフレームの転送は1回の実行にまとまる
+// メインスレッドからだけ使う
+class UploadRing {
+public:
+  struct Allocation {
+    uint8_t *cpuAddress = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+    ID3D12Resource *resource = nullptr;
+    uint64_t offset = 0;
+
+    bool IsValid() const { return cpuAddress != nullptr; }
+  };
+
+  UploadRing(ID3D12Device *device, uint64_t capacity);
+  ~UploadRing();
+
+  UploadRing(const UploadRing &) = delete;
+  UploadRing &operator=(const UploadRing &) = delete;
+
+  // 毎フレームの定数など、書き込んでそのまま参照するもの用
+  // 空きが足りなければ無効なAllocationを返す
+  Allocation
+  Allocate(uint64_t size,
+           uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+  // テクスチャの全サブリソースを転送するコピーを積む
+  // リングに入らない大きさなら専用のUploadバッファを作り、同じく使い終わるまで持っておく
+  void UploadTexture(ID3D12GraphicsCommandList *commandList,
+                     ID3D12Resource *texture,
+                     const D3D12_SUBRESOURCE_DATA *subresources,
+                     uint32_t subresourceCount);
+  void UploadBuffer(ID3D12GraphicsCommandList *commandList,
+                    ID3D12Resource *destination, uint64_t destinationOffset,
+                    const void *data, uint64_t size);
+
+  // 差し替えたテクスチャなど、今のコマンドリストがまだ参照しているリソースを預かる
+  // 次のSubmitの値をGPUが過ぎたら解放する
+  void ReleaseAfterSubmit(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+
+  // コマンドリストを実行してSignalした後に、その値で呼ぶ
+  void Submit(uint64_t fenceValue);
+  // GetCompletedValueの値で呼ぶ。GPUが使い終わった場所を返す
+  void Release(uint64_t completedFenceValue);
+
+  uint64_t GetCapacity() const { return allocator_.GetCapacity(); }
+  uint64_t GetUsedSize() const { return allocator_.GetUsedSize(); }
+
+private:
+  // リングに入らなかったときの専用バッファ。次のSubmitの値まで持っておく
+  ID3D12Resource *CreateFallbackBuffer(uint64_t size);
+
+  struct RetainedBuffer {
+    uint64_t fenceValue;
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+  };
+
+  Microsoft::WRL::ComPtr<ID3D12Device> device_;
+  Microsoft::WRL::ComPtr<ID3D12Resource> buffer_;
+  uint8_t *mappedData_ = nullptr;
+  RingAllocator allocator_;
+
+  // Submit前の専用バッファ(と預かったリソース)と、Submit後にGPUを待っているもの
+  std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> pendingBuffers_;
+  std::deque<RetainedBuffer> retainedBuffers_;
+};
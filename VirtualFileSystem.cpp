@@ -0,0 +1,105 @@
+#include "VirtualFileSystem.h"
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+
+VirtualFileSystem &VirtualFileSystem::GetInstance() {
+  static VirtualFileSystem instance;
+  return instance;
+}
+
+std::string VirtualFileSystem::NormalizePath(const std::string &path) {
+  std::string normalized = path;
+  for (char &c : normalized) {
+    if (c == '\\') {
+      c = '/';
+    }
+  }
+  normalized =
+      std::filesystem::path(normalized).lexically_normal().generic_string();
+  while (normalized.starts_with("./")) {
+    normalized.erase(0, 2);
+  }
+  return normalized;
+}
+
+bool VirtualFileSystem::Mount(const std::string &packPath) {
+  auto pack = std::make_unique<PackFile>();
+  if (!pack->Open(packPath)) {
+    return false;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  packs_.push_back(std::move(pack));
+  return true;
+}
+
+void VirtualFileSystem::UnmountAll() {
+  // 読み込み済みのFileDataはマップを共有しているので、外しても使える
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  packs_.clear();
+}
+
+FileData VirtualFileSystem::ReadFile(const std::string &path) const {
+  if (FileData file = ReadPackedFile(path); file.IsValid()) {
+    return file;
+  }
+
+  if (!isLooseFileFallback_) {
+    return {};
+  }
+  return ReadLooseFile(NormalizePath(path));
+}
+
+FileData VirtualFileSystem::ReadPackedFile(const std::string &path) const {
+  const std::string name = NormalizePath(path);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  for (auto it = packs_.rbegin(); it != packs_.rend(); ++it) {
+    if ((*it)->Contains(name)) {
+      return (*it)->Read(name);
+    }
+  }
+  return {};
+}
+
+bool VirtualFileSystem::Exists(const std::string &path) const {
+  const std::string name = NormalizePath(path);
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const std::unique_ptr<PackFile> &pack : packs_) {
+      if (pack->Contains(name)) {
+        return true;
+      }
+    }
+  }
+
+  std::error_code ec;
+  return isLooseFileFallback_ && std::filesystem::is_regular_file(name, ec);
+}
+
+FileData VirtualFileSystem::ReadLooseFile(const std::string &path) {
+  // 単体のファイルはエディタなどが書き換えるのでマップせずにコピーする
+  // (マップしたままだとWindowsでは保存できず、ほかでは切り詰められると落ちる)
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return {};
+  }
+
+  auto buffer = std::make_shared<std::vector<uint8_t>>();
+  std::error_code ec;
+  uint64_t fileSize = std::filesystem::file_size(path, ec);
+  if (!ec) {
+    buffer->resize(size_t(fileSize));
+  }
+  size_t readSize = std::fread(buffer->data(), 1, buffer->size(), file);
+  const bool isFailed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (isFailed) {
+    return {};
+  }
+  // 読んでいる間に短くなったときは読めた分だけにする
+  buffer->resize(readSize);
+
+  const uint8_t *data = buffer->data();
+  return {data, buffer->size(), std::move(buffer)};
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "MappedFile.h"
+#include "PackFile.h"
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// アセットの読み込み元をまとめるクラス
+// マウントしたパックファイルを新しい順に探し、なければ単体のファイルを読む
+class VirtualFileSystem {
+public:
+  static VirtualFileSystem &GetInstance();
+
+  // パックファイルを追加する。後から追加したものが優先される
+  bool Mount(const std::string &packPath);
+  void UnmountAll();
+
+  // falseにするとパックに入っているファイルしか読まない(製品版用)
+  void SetLooseFileFallback(bool isEnabled) {
+    isLooseFileFallback_ = isEnabled;
+  }
+  bool IsLooseFileFallback() const { return isLooseFileFallback_; }
+
+  // 見つからなければ無効なFileDataを返す
+  FileData ReadFile(const std::string &path) const;
+  // パックに入っているものだけを読む(単体のファイルを少しずつ読みたいとき用)
+  FileData ReadPackedFile(const std::string &path) const;
+  bool Exists(const std::string &path) const;
+
+  // "./resource\\a.obj" と "resource/a.obj" を同じ名前にする
+  static std::string NormalizePath(const std::string &path);
+
+private:
+  VirtualFileSystem() = default;
+
+  static FileData ReadLooseFile(const std::string &path);
+
+  mutable std::shared_mutex mutex_;
+  std::vector<std::unique_ptr<PackFile>> packs_;
+  bool isLooseFileFallback_ = true;
+};
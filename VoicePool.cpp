@@ -0,0 +1,232 @@
+#include "VoicePool.h"
+#ifdef _WIN32
+#include <algorithm>
+
+VoicePool::VoicePool(IXAudio2 *xAudio2, uint32_t maxVoices)
+    : xAudio2_(xAudio2), maxVoices_(std::max(maxVoices, 1u)) {}
+
+VoicePool::~VoicePool() { DestroyVoices(); }
+
+VoicePool::FormatKey VoicePool::MakeFormatKey(const SoundData &soundData) {
+  FormatKey key;
+  key.formatTag = soundData.wfex.wFormatTag;
+  key.channels = soundData.wfex.nChannels;
+  key.samplesPerSec = soundData.wfex.nSamplesPerSec;
+  key.bitsPerSample = soundData.wfex.wBitsPerSample;
+  key.channelMask = soundData.channelMask;
+  return key;
+}
+
+#pragma region 再生
+
+VoiceHandle VoicePool::Play(const SoundData &soundData, float volume,
+                            int32_t priority, bool isLooping) {
+  // ADPCMのまま持っている音はAudioMixerでしか鳴らせない
+  if (xAudio2_ == nullptr || soundData.bufferSize == 0 ||
+      soundData.adpcm.IsValid()) {
+    return {};
+  }
+
+  // 同じフレームで鳴り終わったボイスもすぐ使えるようにしておく
+  Update();
+
+  const FormatKey format = MakeFormatKey(soundData);
+  Slot *slot = AcquireSlot(format, priority);
+  if (slot == nullptr) {
+    return {};
+  }
+  if (slot->voice == nullptr && !CreateVoice(*slot, soundData)) {
+    return {};
+  }
+
+  ++slot->generation;
+
+  XAUDIO2_BUFFER buf{};
+  buf.pAudioData = soundData.pBUffer;
+  buf.AudioBytes = soundData.bufferSize;
+  buf.Flags = XAUDIO2_END_OF_STREAM;
+  buf.LoopCount = isLooping ? XAUDIO2_LOOP_INFINITE : 0;
+  buf.pContext = reinterpret_cast<void *>(uintptr_t(slot->generation));
+  if (FAILED(slot->voice->SubmitSourceBuffer(&buf))) {
+    slot->endedGeneration = slot->generation;
+    slot->state = SlotState::Idle;
+    return {};
+  }
+  slot->storages.emplace_back(slot->generation, soundData.storage);
+
+  slot->voice->SetVolume(volume);
+  slot->voice->Start();
+  slot->state = SlotState::Playing;
+  slot->priority = priority;
+  slot->startSequence = nextSequence_++;
+
+  uint32_t index = 0;
+  while (slots_[index].get() != slot) {
+    ++index;
+  }
+  return {index, slot->generation};
+}
+
+void VoicePool::Stop(VoiceHandle handle) {
+  Slot *slot = FindSlot(handle);
+  if (slot == nullptr || slot->state != SlotState::Playing) {
+    return;
+  }
+  // 止めたバッファのOnBufferEndが来たら空きに戻る
+  slot->voice->Stop();
+  slot->voice->FlushSourceBuffers();
+  slot->state = SlotState::Stopping;
+}
+
+void VoicePool::StopAll() {
+  for (uint32_t i = 0; i < slots_.size(); ++i) {
+    Stop({i, slots_[i]->generation});
+  }
+}
+
+void VoicePool::SetVolume(VoiceHandle handle, float volume) {
+  Slot *slot = FindSlot(handle);
+  if (slot != nullptr) {
+    slot->voice->SetVolume(volume);
+  }
+}
+
+bool VoicePool::IsPlaying(VoiceHandle handle) const {
+  Slot *slot = FindSlot(handle);
+  return slot != nullptr && slot->state == SlotState::Playing &&
+         slot->endedGeneration.load(std::memory_order_acquire) <
+             slot->generation;
+}
+
+uint32_t VoicePool::GetPlayingCount() const {
+  uint32_t count = 0;
+  for (const std::unique_ptr<Slot> &slot : slots_) {
+    if (slot->state == SlotState::Playing &&
+        slot->endedGeneration.load(std::memory_order_acquire) <
+            slot->generation) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+#pragma endregion
+
+#pragma region ボイスの管理
+
+void VoicePool::Update() {
+  for (const std::unique_ptr<Slot> &slot : slots_) {
+    ReleaseEndedStorages(*slot);
+    if (slot->state != SlotState::Idle &&
+        slot->endedGeneration.load(std::memory_order_acquire) >=
+            slot->generation) {
+      slot->state = SlotState::Idle;
+    }
+  }
+}
+
+void VoicePool::DestroyVoices() {
+  for (const std::unique_ptr<Slot> &slot : slots_) {
+    DestroyVoice(*slot);
+  }
+  slots_.clear();
+}
+
+VoicePool::Slot *VoicePool::FindSlot(VoiceHandle handle) const {
+  if (handle.index >= slots_.size()) {
+    return nullptr;
+  }
+  Slot *slot = slots_[handle.index].get();
+  if (slot->generation != handle.generation ||
+      slot->state == SlotState::Idle) {
+    return nullptr;
+  }
+  return slot;
+}
+
+VoicePool::Slot *VoicePool::AcquireSlot(const FormatKey &format,
+                                        int32_t priority) {
+  // 同じ形式の空いているボイスがあればそのまま使う
+  for (const std::unique_ptr<Slot> &slot : slots_) {
+    if (slot->state == SlotState::Idle && slot->voice != nullptr &&
+        slot->format == format) {
+      return slot.get();
+    }
+  }
+
+  // まだ上限まで作っていなければ新しく作る
+  if (slots_.size() < maxVoices_) {
+    slots_.push_back(std::make_unique<Slot>());
+    return slots_.back().get();
+  }
+
+  // 形式の違う空きボイスを作り直す
+  for (const std::unique_ptr<Slot> &slot : slots_) {
+    if (slot->state == SlotState::Idle) {
+      DestroyVoice(*slot);
+      return slot.get();
+    }
+  }
+
+  // 鳴っている中で優先度が一番低い(同じなら一番古い)ものを奪う
+  Slot *victim = nullptr;
+  for (const std::unique_ptr<Slot> &slot : slots_) {
+    if (slot->state != SlotState::Playing) {
+      continue;
+    }
+    if (victim == nullptr || slot->priority < victim->priority ||
+        (slot->priority == victim->priority &&
+         slot->startSequence < victim->startSequence)) {
+      victim = slot.get();
+    }
+  }
+  if (victim == nullptr || victim->priority > priority) {
+    return nullptr;
+  }
+
+  if (victim->format == format) {
+    // 止めた音の中身はOnBufferEndが来るまで持っておく
+    victim->voice->Stop();
+    victim->voice->FlushSourceBuffers();
+    victim->state = SlotState::Idle;
+  } else {
+    DestroyVoice(*victim);
+  }
+  return victim;
+}
+
+bool VoicePool::CreateVoice(Slot &slot, const SoundData &soundData) {
+  // 鳴り終わりはスロットのOnBufferEndで受け取る
+  WAVEFORMATEXTENSIBLE format = SoundGetVoiceFormat(soundData);
+  HRESULT result = xAudio2_->CreateSourceVoice(
+      &slot.voice, &format.Format, 0, XAUDIO2_DEFAULT_FREQ_RATIO, &slot);
+  if (FAILED(result)) {
+    slot.voice = nullptr;
+    return false;
+  }
+  slot.format = MakeFormatKey(soundData);
+  return true;
+}
+
+void VoicePool::DestroyVoice(Slot &slot) {
+  if (slot.voice != nullptr) {
+    // コールバックがすべて終わるまで待ってから戻る
+    slot.voice->DestroyVoice();
+    slot.voice = nullptr;
+  }
+  slot.storages.clear();
+  slot.endedGeneration = slot.generation;
+  slot.state = SlotState::Idle;
+}
+
+void VoicePool::ReleaseEndedStorages(Slot &slot) {
+  // バッファは渡した順に終わるので、前から見ればよい
+  uint32_t ended = slot.endedGeneration.load(std::memory_order_acquire);
+  while (!slot.storages.empty() && slot.storages.front().first <= ended) {
+    slot.storages.pop_front();
+  }
+}
+
+#pragma endregion
+
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+#include "Sound.h"
+#ifdef _WIN32
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// VoicePoolで再生した音を指すハンドル
+// 音が鳴り終わったり、他の音に奪われたりすると無効になる
+struct VoiceHandle {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+
+  bool IsValid() const { return index != UINT32_MAX; }
+};
+
+// ソースボイスを使い回して効果音を鳴らすクラス
+// 鳴り終わったボイスは同じ形式の音を鳴らすときに再利用する
+// 同時に鳴らせる数を超えたら、優先度の低い(同じなら古い)音を止めて使う
+class VoicePool {
+public:
+  VoicePool(IXAudio2 *xAudio2, uint32_t maxVoices = 32);
+  ~VoicePool();
+
+  VoicePool(const VoicePool &) = delete;
+  VoicePool &operator=(const VoicePool &) = delete;
+
+  // priorityが大きいほど奪われにくい。鳴らせなければ無効なハンドルを返す
+  // (ADPCMはAdpcmDecodeMode::OnLoadで展開しておくこと)
+  // 鳴っている間はsoundDataの中身を参照し続ける
+  VoiceHandle Play(const SoundData &soundData, float volume = 1.0f,
+                   int32_t priority = 0, bool isLooping = false);
+  void Stop(VoiceHandle handle);
+  void StopAll();
+  void SetVolume(VoiceHandle handle, float volume);
+  bool IsPlaying(VoiceHandle handle) const;
+
+  // 毎フレーム呼ぶ。鳴り終わったボイスを空きに戻す
+  void Update();
+
+  // XAudio2を解放する前に呼ぶ
+  void DestroyVoices();
+
+  uint32_t GetPlayingCount() const;
+  uint32_t GetVoiceCount() const { return uint32_t(slots_.size()); }
+  uint32_t GetMaxVoices() const { return maxVoices_; }
+
+private:
+  // ボイスを使い回せる形式かどうかの判定に使う
+  struct FormatKey {
+    uint16_t formatTag = 0;
+    uint16_t channels = 0;
+    uint32_t samplesPerSec = 0;
+    uint16_t bitsPerSample = 0;
+    uint32_t channelMask = 0;
+
+    bool operator==(const FormatKey &other) const = default;
+  };
+
+  enum class SlotState { Idle, Playing, Stopping };
+
+  // バッファのpContextに世代を入れておき、終わった世代を記録する
+  // コールバックはオーディオスレッドから呼ばれるので、ここでは記録だけする
+  struct Slot : public IXAudio2VoiceCallback {
+    IXAudio2SourceVoice *voice = nullptr;
+    FormatKey format;
+    SlotState state = SlotState::Idle;
+    uint32_t generation = 0;
+    int32_t priority = 0;
+    uint64_t startSequence = 0;
+    std::atomic<uint32_t> endedGeneration = 0;
+    // 再生中(止めた直後も含む)の音の中身。終わった世代から手放す
+    std::deque<std::pair<uint32_t, std::shared_ptr<const void>>> storages;
+
+    void STDMETHODCALLTYPE OnBufferEnd(void *pBufferContext) override {
+      endedGeneration.store(uint32_t(uintptr_t(pBufferContext)),
+                            std::memory_order_release);
+    }
+    void STDMETHODCALLTYPE OnVoiceProcessingPassStart(UINT32) override {}
+    void STDMETHODCALLTYPE OnVoiceProcessingPassEnd() override {}
+    void STDMETHODCALLTYPE OnStreamEnd() override {}
+    void STDMETHODCALLTYPE OnBufferStart(void *) override {}
+    void STDMETHODCALLTYPE OnLoopEnd(void *) override {}
+    void STDMETHODCALLTYPE OnVoiceError(void *, HRESULT) override {}
+  };
+
+  static FormatKey MakeFormatKey(const SoundData &soundData);
+
+  Slot *FindSlot(VoiceHandle handle) const;
+  Slot *AcquireSlot(const FormatKey &format, int32_t priority);
+  bool CreateVoice(Slot &slot, const SoundData &soundData);
+  void DestroyVoice(Slot &slot);
+  void ReleaseEndedStorages(Slot &slot);
+
+  IXAudio2 *xAudio2_ = nullptr;
+  uint32_t maxVoices_ = 0;
+  uint64_t nextSequence_ = 0;
+  // コールバックの登録先なので、アドレスが変わらないようにunique_ptrで持つ
+  std::vector<std::unique_ptr<Slot>> slots_;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #define _USE_MATH_DEFINES
 #define PI 3.14159265f
 #include <Windows.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -16,11 +18,29 @@
 #include <sstream>
 #include <string.h>
 #include <strsafe.h>
+#include <thread>
 #include <vector>
 #include <wrl.h>
 #include <xaudio2.h>
 
+#include "AssetRegistry.h"
+#include "AudioMixer.h"
+#include "AudioOutput.h"
+#include "HotReloader.h"
 #include "Math.h"
+#include "Model.h"
+#include "Sound.h"
+#include "SoundBank.h"
+#include "SoundStream.h"
+#include "SpatialAudio.h"
+#include "Texture.h"
+#include "TextureManager.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "UploadRing.h"
+#include "VirtualFileSystem.h"
+#include "VoicePool.h"
 #define DRECTINPUT_VERSION 0x0800 // DirectInput version 8.0
 #include <dinput.h>
 
@@ -71,41 +91,18 @@ typedef struct TransformationMatrix {
 typedef struct Material {
   Vector4 color;
   int32_t enableLighting;
-  float padding[3];
+  // マテリアルのテクスチャの表の何番目を使うか
+  int32_t textureIndex;
+  float padding[2];
   Matrix4x4 uvTransform;
 } Material;
 
-struct VertexData {
-  Vector4 position;
-  Vector2 texcoord;
-  Vector3 normal;
-
-  bool operator<(const VertexData &other) const {
-    if (position != other.position)
-      return position < other.position;
-    if (texcoord != other.texcoord)
-      return texcoord < other.texcoord;
-    if (normal != other.normal)
-      return normal < other.normal;
-    return false;
-  }
-};
-
 struct DirectionalLight {
   Vector4 color;     // ライトの色
   Vector3 direction; // ライトの方向
   float intensity;   // ライトの強度
 };
 
-struct MaterialData {
-  std::string textureFilePath;
-};
-
-struct ModelData {
-  std::vector<VertexData> vertices;
-  MaterialData material;
-};
-
 struct D3DResourceLeakChecker {
   ~D3DResourceLeakChecker() {
 
@@ -118,31 +115,6 @@ struct D3DResourceLeakChecker {
   }
 };
 
-#pragma region サウンド再生
-struct ChunkHeader {
-  char id[4];
-  int32_t size;
-};
-
-struct RiffHeader {
-  ChunkHeader chunk;
-  char type[4];
-};
-
-struct FormatChunk {
-  ChunkHeader chunk;
-  WAVEFORMATEX fmt;
-};
-
-struct SoundData {
-  WAVEFORMATEX wfex;
-  BYTE *pBUffer;
-  unsigned int bufferSize;
-  ;
-};
-
-#pragma endregion
-
 struct WindowData {
   HINSTANCE hInstance;
   HWND hwnd;
@@ -153,100 +125,6 @@ struct WindowData {
 
 #pragma region 関数たち
 
-#pragma region 音声
-
-#pragma region 音声データの読み込み
-
-SoundData SoundLoadWave(const char *filename) {
-
-  std::ifstream file;
-  file.open(filename, std::ios_base::binary);
-  assert(file.is_open());
-
-  RiffHeader riff;
-  file.read((char *)&riff, sizeof(riff));
-
-  if (strncmp(riff.chunk.id, "RIFF", 4) != 0) {
-    assert(0);
-  }
-
-  if (strncmp(riff.type, "WAVE", 4) != 0) {
-    assert(0);
-  }
-
-  FormatChunk format = {};
-  file.read((char *)&format, sizeof(ChunkHeader));
-
-  if (strncmp(format.chunk.id, "fmt ", 4) != 0) {
-    assert(0);
-  }
-
-  assert(format.chunk.size <= sizeof(format.fmt));
-  file.read((char *)&format.fmt, format.chunk.size);
-
-  ChunkHeader data;
-  file.read((char *)&data, sizeof(data));
-
-  if (strncmp(data.id, "JUNK", 4) == 0) {
-    file.seekg(data.size, std::ios_base::cur);
-
-    file.read((char *)&data, sizeof(data));
-  }
-
-  if (strncmp(data.id, "data", 4) != 0) {
-    assert(0);
-  }
-
-  char *pBuffer = new char[data.size];
-  file.read(pBuffer, data.size);
-
-  file.close();
-
-  SoundData soundData = {};
-
-  soundData.wfex = format.fmt;
-  soundData.pBUffer = reinterpret_cast<BYTE *>(pBuffer);
-  soundData.bufferSize = data.size;
-
-  return soundData;
-}
-
-#pragma endregion
-
-#pragma region 音声データの解放
-void SoundUnload(SoundData *soundData) {
-  delete[] soundData->pBUffer;
-
-  soundData->pBUffer = 0;
-  soundData->bufferSize = 0;
-  soundData->wfex = {};
-}
-
-#pragma endregion
-
-#pragma region サウンドの再生
-
-void SoundPlayWave(IXAudio2 *xAudio2, const SoundData &soundData) {
-  HRESULT result;
-
-  IXAudio2SourceVoice *pSourceVoice = nullptr;
-  result = xAudio2->CreateSourceVoice(&pSourceVoice, &soundData.wfex);
-  assert(SUCCEEDED(result));
-
-  XAUDIO2_BUFFER buf{};
-
-  buf.pAudioData = soundData.pBUffer;
-  buf.AudioBytes = soundData.bufferSize;
-  buf.Flags = XAUDIO2_END_OF_STREAM;
-
-  result = pSourceVoice->SubmitSourceBuffer(&buf);
-  result = pSourceVoice->Start();
-}
-
-#pragma endregion
-
-#pragma endregion
-
 #pragma region ConvertString関数
 std::wstring ConvertString(const std::string &str) {
   if (str.empty()) {
@@ -329,6 +207,71 @@ static LONG WINAPI ExportDump(EXCEPTION_POINTERS *exception) {
 #pragma endregion
 
 #pragma region CompileShader関数
+
+// #includeされたファイルもVirtualFileSystemから読むIncludeHandler
+// どこにも見つからなければDXC標準のものに任せる
+class VfsIncludeHandler : public IDxcIncludeHandler {
+public:
+  VfsIncludeHandler(
+      const Microsoft::WRL::ComPtr<IDxcUtils> &dxcUtils,
+      const Microsoft::WRL::ComPtr<IDxcIncludeHandler> &defaultHandler)
+      : dxcUtils_(dxcUtils), defaultHandler_(defaultHandler) {}
+
+  HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename,
+                                       IDxcBlob **ppIncludeSource) override {
+    FileData file =
+        VirtualFileSystem::GetInstance().ReadFile(ConvertString(pFilename));
+    if (!file.IsValid()) {
+      return defaultHandler_->LoadSource(pFilename, ppIncludeSource);
+    }
+
+    // CreateBlobは中身をコピーするので、fileはここで手放してよい
+    Microsoft::WRL::ComPtr<IDxcBlobEncoding> blob = nullptr;
+    HRESULT hr = dxcUtils_->CreateBlob(file.data, UINT32(file.size),
+                                       DXC_CP_UTF8, &blob);
+    if (FAILED(hr)) {
+      return hr;
+    }
+    *ppIncludeSource = blob.Detach();
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid,
+                                           void **ppvObject) override {
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IDxcIncludeHandler)) {
+      *ppvObject = static_cast<IDxcIncludeHandler *>(this);
+      AddRef();
+      return S_OK;
+    }
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+  ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount_; }
+  ULONG STDMETHODCALLTYPE Release() override {
+    ULONG count = --refCount_;
+    if (count == 0) {
+      delete this;
+    }
+    return count;
+  }
+
+private:
+  std::atomic<ULONG> refCount_ = 1;
+  Microsoft::WRL::ComPtr<IDxcUtils> dxcUtils_;
+  Microsoft::WRL::ComPtr<IDxcIncludeHandler> defaultHandler_;
+};
+
+Microsoft::WRL::ComPtr<IDxcIncludeHandler>
+CreateIncludeHandler(const Microsoft::WRL::ComPtr<IDxcUtils> &dxcUtils) {
+  Microsoft::WRL::ComPtr<IDxcIncludeHandler> defaultHandler = nullptr;
+  if (FAILED(dxcUtils->CreateDefaultIncludeHandler(&defaultHandler))) {
+    return nullptr;
+  }
+  Microsoft::WRL::ComPtr<IDxcIncludeHandler> includeHandler = nullptr;
+  includeHandler.Attach(new VfsIncludeHandler(dxcUtils, defaultHandler));
+  return includeHandler;
+}
+
 Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
     // CompilerするShaderファイルへのパス
     const std::wstring &filePath,
@@ -337,30 +280,37 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
     // 初期化で生成したもの3つt
     const Microsoft::WRL::ComPtr<IDxcUtils> &dxcUtils,
     const Microsoft::WRL::ComPtr<IDxcCompiler3> &dxCompiler,
-    IDxcIncludeHandler *includeHandler) {
+    IDxcIncludeHandler *includeHandler,
+    // falseならエラーで止めずにnullptrを返す(ホットリロード用)
+    bool isErrorFatal = true,
+    // "NAME=VALUE"の形のマクロ定義
+    const std::vector<std::wstring> &defines = {}) {
 
 #pragma region HLSLファイルを読み込む
 
   Log(ConvertString(std::format(L"Begin CompileShader, path:{}, profile:{}\n",
                                 filePath, profile)));
 
-  Microsoft::WRL::ComPtr<IDxcBlobEncoding> shaderSource = nullptr;
-  HRESULT hr = dxcUtils->LoadFile(filePath.c_str(), nullptr,
-                                  shaderSource.GetAddressOf());
+  // パックファイルに入っていればそこから読む
+  FileData shaderSource =
+      VirtualFileSystem::GetInstance().ReadFile(ConvertString(filePath));
 
   // 読み込めなかったら止まる
-  assert(SUCCEEDED(hr));
+  if (!shaderSource.IsValid() && !isErrorFatal) {
+    return nullptr;
+  }
+  assert(shaderSource.IsValid());
 
   // 読み込んだファイルの内容を設定する
   DxcBuffer shaderSourceBuffer;
-  shaderSourceBuffer.Ptr = shaderSource->GetBufferPointer();
-  shaderSourceBuffer.Size = shaderSource->GetBufferSize();
+  shaderSourceBuffer.Ptr = shaderSource.data;
+  shaderSourceBuffer.Size = shaderSource.size;
   shaderSourceBuffer.Encoding = DXC_CP_UTF8;
 #pragma endregion
 
 #pragma region コンパイルする
 
-  LPCWSTR arguments[] = {
+  std::vector<LPCWSTR> arguments = {
       filePath.c_str(), // コンパイル対象のファイル名
       L"-E",
       L"main", // エントリーポイントの指定
@@ -371,17 +321,25 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
       L"-Od",           // 最適化を外しておく
       L"-Zpr",          // メモリレイアウトは行優先
   };
+  for (const std::wstring &define : defines) {
+    arguments.push_back(L"-D");
+    arguments.push_back(define.c_str());
+  }
 
   // コンパイラの設定
   Microsoft::WRL::ComPtr<IDxcResult> shaderResult = nullptr;
-  hr = dxCompiler->Compile(&shaderSourceBuffer, // 読み込んだファイル
-                           arguments,           // コンパイルオプション
-                           _countof(arguments), // コンパイルオプションの数
-                           includeHandler,      // includeが含まれた数
-                           IID_PPV_ARGS(&shaderResult) // コンパイル結果
-  );
+  HRESULT hr =
+      dxCompiler->Compile(&shaderSourceBuffer,        // 読み込んだファイル
+                          arguments.data(),           // コンパイルオプション
+                          UINT32(arguments.size()),   // コンパイルオプションの数
+                          includeHandler,             // includeが含まれた数
+                          IID_PPV_ARGS(&shaderResult) // コンパイル結果
+      );
 
   // コンパイルエラーでなくdxcが起動できないなど致命的なエラーが起きたら止まる
+  if (FAILED(hr) && !isErrorFatal) {
+    return nullptr;
+  }
   assert(SUCCEEDED(hr));
 #pragma endregion
 
@@ -392,6 +350,9 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
   if (shaderError != nullptr && shaderError->GetStringLength() != 0) {
     Log(shaderError->GetStringPointer());
 
+    if (!isErrorFatal) {
+      return nullptr;
+    }
     // 警告、エラーダメゼッタイ
     assert(false);
   }
@@ -403,6 +364,9 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
   IDxcBlob *shaderBlob = nullptr;
   hr = shaderResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob),
                                nullptr);
+  if (FAILED(hr) && !isErrorFatal) {
+    return nullptr;
+  }
   assert(SUCCEEDED(hr));
 
   // 成功したらログを出す
@@ -510,84 +474,6 @@ CreateDepthStencilResource(const Microsoft::WRL::ComPtr<ID3D12Device> &device,
 
 #pragma region Texture関数
 
-DirectX::ScratchImage LoadTexture(const std::string &filePath) {
-  DirectX::ScratchImage image{};
-  std::wstring filePathW = ConvertString(filePath);
-  HRESULT hr = DirectX::LoadFromWICFile(
-      filePathW.c_str(), DirectX::WIC_FLAGS_FORCE_SRGB, nullptr, image);
-  assert(SUCCEEDED(hr));
-
-  DirectX::ScratchImage mipImages{};
-  hr = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(),
-                                image.GetMetadata(), DirectX::TEX_FILTER_SRGB,
-                                0, mipImages);
-  assert(SUCCEEDED(hr));
-
-  return mipImages;
-}
-
-Microsoft::WRL::ComPtr<ID3D12Resource>
-CreateTextureResource(const Microsoft::WRL::ComPtr<ID3D12Device> &device,
-                      const DirectX::TexMetadata &metadata) {
-
-  // meradataをもとにresourceの設定
-  D3D12_RESOURCE_DESC resourceDesc = {};
-  resourceDesc.Width = UINT(metadata.width);
-  resourceDesc.Height = UINT(metadata.height);
-  resourceDesc.MipLevels = UINT16(metadata.mipLevels);
-  resourceDesc.DepthOrArraySize = UINT16(metadata.arraySize);
-  resourceDesc.Format = metadata.format;
-  resourceDesc.SampleDesc.Count = 1;
-  resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION(metadata.dimension);
-
-  // 利用するheapの設定
-  D3D12_HEAP_PROPERTIES heapProperties{};
-
-  heapProperties.Type = D3D12_HEAP_TYPE_CUSTOM;
-  heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
-  heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
-
-  // resourceを生成
-
-  Microsoft::WRL::ComPtr<ID3D12Resource> resource = nullptr;
-  HRESULT hr = device->CreateCommittedResource(
-      &heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
-      D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&resource));
-  assert(SUCCEEDED(hr));
-
-  return resource;
-}
-
-[[nodiscard]]
-Microsoft::WRL::ComPtr<ID3D12Resource> UploadTextureData(
-    const Microsoft::WRL::ComPtr<ID3D12Resource> &texture,
-    const DirectX::ScratchImage &mipImages,
-    const Microsoft::WRL::ComPtr<ID3D12Device> &device,
-    const Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> &commandList) {
-
-  std::vector<D3D12_SUBRESOURCE_DATA> subresources;
-  DirectX::PrepareUpload(device.Get(), mipImages.GetImages(),
-                         mipImages.GetImageCount(), mipImages.GetMetadata(),
-                         subresources);
-  uint64_t intermediateSize =
-      GetRequiredIntermediateSize(texture.Get(), 0, UINT(subresources.size()));
-  Microsoft::WRL::ComPtr<ID3D12Resource> intermediateResource =
-      CreateBufferResource(device, intermediateSize);
-  UpdateSubresources(commandList.Get(), texture.Get(),
-                     intermediateResource.Get(), 0, 0,
-                     UINT(subresources.size()), subresources.data());
-
-  D3D12_RESOURCE_BARRIER barrier{};
-  barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-  barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-  barrier.Transition.pResource = texture.Get();
-  barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-  barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-  barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
-  commandList->ResourceBarrier(1, &barrier);
-  return intermediateResource;
-}
-
 D3D12_CPU_DESCRIPTOR_HANDLE
 GetCPUDescriptorHandle(ID3D12DescriptorHeap *descriptorHeap,
                        uint32_t descriptorSize, uint32_t index) {
@@ -608,120 +494,6 @@ GetGPUDscriptorHandle(ID3D12DescriptorHeap *descriptorHeap,
 
 #pragma endregion
 
-#pragma region MaterialTemplate関数
-MaterialData LoadMaterialTemplateFile(const std::string &directoryPath,
-                                      const std::string &filename) {
-  MaterialData materialData;
-  std::string line;
-  std::ifstream file(directoryPath + "/" + filename);
-
-  assert(file.is_open());
-
-  while (std::getline(file, line)) {
-    std::string identifier;
-    std::istringstream s(line);
-
-    s >> identifier;
-
-    if (identifier == "map_Kd") {
-      std::string textureFilename;
-      s >> textureFilename;
-
-      materialData.textureFilePath = directoryPath + "/" + textureFilename;
-    }
-  }
-  return materialData;
-}
-#pragma endregion
-
-#pragma region Objファイルを読む関数
-
-ModelData LoadObjFile(const std::string &directoryPath,
-                      const std::string &filename) {
-  ModelData modelData;
-  std::vector<Vector4> positions;
-  std::vector<Vector3> normals;
-  std::vector<Vector2> texcoords;
-
-  std::ifstream file(directoryPath + "/" + filename);
-  if (!file.is_open()) {
-    std::cerr << "Failed to open OBJ file: " << directoryPath + "/" + filename
-              << std::endl;
-    return {};
-  }
-
-  std::string line;
-
-  while (std::getline(file, line)) {
-    std::istringstream s(line);
-    std::string identifier;
-    s >> identifier;
-
-    if (identifier == "v") {
-      Vector4 position{};
-
-      s >> position.x >> position.y >> position.z;
-
-      position.w = 1.0f;
-      position.x *= -1.0f;
-      positions.push_back(position);
-
-    } else if (identifier == "vt") {
-      Vector2 texcoord{};
-      s >> texcoord.x >> texcoord.y;
-
-      texcoord.y = 1.0f - texcoord.y;
-      texcoords.push_back(texcoord);
-
-    } else if (identifier == "vn") {
-
-      Vector3 normal{};
-
-      s >> normal.x >> normal.y >> normal.z;
-      normal.x *= -1.0f;
-      normals.push_back(normal);
-
-    } else if (identifier == "f") {
-
-      VertexData triangle[3] = {};
-
-      for (int32_t faceVertex = 0; faceVertex < 3; ++faceVertex) {
-        std::string vdef;
-        s >> vdef;
-
-        std::istringstream vstream(vdef);
-        uint32_t elementIndices[3];
-
-        for (int32_t element = 0; element < 3; ++element) {
-          std::string index;
-          std::getline(vstream, index, '/');
-          elementIndices[element] = std::stoi(index);
-        }
-
-        Vector4 position = positions[elementIndices[0] - 1];
-        Vector2 texcoord = texcoords[elementIndices[1] - 1];
-        Vector3 normal = normals[elementIndices[2] - 1];
-
-        triangle[faceVertex] = {position, texcoord, normal};
-      }
-      modelData.vertices.push_back(triangle[2]);
-      modelData.vertices.push_back(triangle[1]);
-      modelData.vertices.push_back(triangle[0]);
-
-    } else if (identifier == "mtllib") {
-      std::string materialFilename;
-      s >> materialFilename;
-
-      modelData.material =
-          LoadMaterialTemplateFile(directoryPath, materialFilename);
-    }
-  }
-  file.close();
-  return modelData;
-}
-
-#pragma endregion
-
 #pragma endregion
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
@@ -737,6 +509,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   // 例外が発生したらダンプを出力する
   SetUnhandledExceptionFilter(ExportDump);
 
+#pragma region パックファイル
+  // resource.pakがあればアセットはそこから読み、なければ単体のファイルを読む
+  // (パックの中身が優先されるので、ホットリロードしたいときは置かない)
+  if (VirtualFileSystem::GetInstance().Mount("resource.pak")) {
+    Log("Mounted resource.pak\n");
+  }
+#pragma endregion
+
 #pragma region 前準備
 #pragma region ログ
 
@@ -918,8 +698,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> rtvDescriptorHeap =
       CreateDiscriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 2, false);
 
+  // 0番はImGuiのフォント。1番から後ろをマテリアルのテクスチャの表にし、
+  // シェーダーはマテリアルが持つ番号でテクスチャを引く(描画ごとにSRVを差し替えない)
+  const uint32_t kMaterialTextureTableStart = 1;
+  const uint32_t kMaxMaterialTextures = 1024;
   Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvDescriptorHeap =
-      CreateDiscriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 28,
+      CreateDiscriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+                           kMaterialTextureTableStart + kMaxMaterialTextures,
                            true);
 
   /// DSVの生成
@@ -990,37 +775,66 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
   assert(SUCCEEDED(hr));
 
-  IDxcIncludeHandler *includeHandler = nullptr;
-  hr = dxcUtils->CreateDefaultIncludeHandler(&includeHandler);
-  assert(SUCCEEDED(hr));
+  // #includeもVirtualFileSystemから読む
+  Microsoft::WRL::ComPtr<IDxcIncludeHandler> includeHandler =
+      CreateIncludeHandler(dxcUtils);
+  assert(includeHandler != nullptr);
 
 #pragma endregion
 
 #pragma region ルートシグネチャーを生成する
 
-  D3D12_ROOT_SIGNATURE_DESC descriptionRootSignature{};
+  // 範囲の大きさを決めないSRVの表はバージョン1.1のルートシグネチャで作る
+  D3D12_VERSIONED_ROOT_SIGNATURE_DESC descriptionRootSignature{};
+  descriptionRootSignature.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
 
-  descriptionRootSignature.Flags =
+  descriptionRootSignature.Desc_1_1.Flags =
       D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
 
 #pragma region RootParameter
 
-  D3D12_DESCRIPTOR_RANGE descriptorRange[1] = {};
+  // Tier2以上なら表の大きさを決めずに置ける。Tier1はシェーダーから見えるSRVが128個まで
+  D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+  hr = device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options,
+                                   sizeof(options));
+  const bool isUnboundedTableSupported =
+      SUCCEEDED(hr) &&
+      options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+  const uint32_t materialTextureCount =
+      isUnboundedTableSupported ? kMaxMaterialTextures : 128;
+  // Tier1ではシェーダーの表もルートシグネチャと同じ大きさに決めておく
+  // (大きさを決めない表のままだと範囲が足りずにPSOを作れない)
+  std::vector<std::wstring> pixelShaderDefines;
+  if (!isUnboundedTableSupported) {
+    pixelShaderDefines.push_back(
+        std::format(L"MATERIAL_TEXTURE_COUNT={}", materialTextureCount));
+  }
+
+  // マテリアルのテクスチャの表(t0から)
+  // TextureStreamerがミップを足すたびにSRVを作り直し、使わない場所も残るので、
+  // ディスクリプタも中身もバージョン1.0と同じく、いつ変わってもよい扱いにする
+  D3D12_DESCRIPTOR_RANGE1 descriptorRange[1] = {};
   descriptorRange[0].BaseShaderRegister = 0;
-  descriptorRange[0].NumDescriptors = 1;
+  descriptorRange[0].NumDescriptors =
+      isUnboundedTableSupported ? UINT_MAX : materialTextureCount;
   descriptorRange[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+  descriptorRange[0].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE |
+                             D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
   descriptorRange[0].OffsetInDescriptorsFromTableStart =
       D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-  D3D12_ROOT_PARAMETER rootParameters[4] = {};
+  // 定数バッファはMapしたまま書き換えるので、こちらもバージョン1.0と同じ扱いにする
+  D3D12_ROOT_PARAMETER1 rootParameters[4] = {};
 
   rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
   rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
   rootParameters[0].Descriptor.ShaderRegister = 0;
+  rootParameters[0].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE;
 
   rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
   rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
   rootParameters[1].Descriptor.ShaderRegister = 1;
+  rootParameters[1].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE;
 
   rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
   rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
@@ -1031,9 +845,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
   rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
   rootParameters[3].Descriptor.ShaderRegister = 2;
+  rootParameters[3].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE;
 
-  descriptionRootSignature.pParameters = rootParameters;
-  descriptionRootSignature.NumParameters = _countof(rootParameters);
+  descriptionRootSignature.Desc_1_1.pParameters = rootParameters;
+  descriptionRootSignature.Desc_1_1.NumParameters = _countof(rootParameters);
 
 #pragma endregion
 
@@ -1050,16 +865,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   staticSamplers[0].MaxLOD = D3D12_FLOAT32_MAX;
   staticSamplers[0].ShaderRegister = 0;
   staticSamplers[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-  descriptionRootSignature.pStaticSamplers = staticSamplers;
-  descriptionRootSignature.NumStaticSamplers = _countof(staticSamplers);
+  descriptionRootSignature.Desc_1_1.pStaticSamplers = staticSamplers;
+  descriptionRootSignature.Desc_1_1.NumStaticSamplers =
+      _countof(staticSamplers);
 
 #pragma endregion
 
   Microsoft::WRL::ComPtr<ID3DBlob> signatureBlob = nullptr;
   Microsoft::WRL::ComPtr<ID3DBlob> errorBlob = nullptr;
-  hr = D3D12SerializeRootSignature(&descriptionRootSignature,
-                                   D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob,
-                                   &errorBlob);
+  hr = D3D12SerializeVersionedRootSignature(&descriptionRootSignature,
+                                            &signatureBlob, &errorBlob);
 
   if (FAILED(hr)) {
     Log(reinterpret_cast<char *>(errorBlob->GetBufferPointer()));
@@ -1123,12 +938,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
   Microsoft::WRL::ComPtr<IDxcBlob> vertexShaderBlob =
       CompileShader(L"Object3D.VS.hlsl", L"vs_6_0", dxcUtils.Get(),
-                    dxcCompiler.Get(), includeHandler);
+                    dxcCompiler.Get(), includeHandler.Get());
   assert(vertexShaderBlob != nullptr);
 
   Microsoft::WRL::ComPtr<IDxcBlob> pixelShaderBlob =
       CompileShader(L"Object3D.PS.hlsl", L"ps_6_0", dxcUtils.Get(),
-                    dxcCompiler.Get(), includeHandler);
+                    dxcCompiler.Get(), includeHandler.Get(), true,
+                    pixelShaderDefines);
   assert(pixelShaderBlob != nullptr);
 
 #pragma endregion
@@ -1174,11 +990,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
   // int sphereVertexCount = kLatitudeDiv * kLongitudeDiv * 6;
 
-  ModelData modelData = LoadObjFile("resource", "axis.obj");
+  AssetRegistry::Handle<ModelData> modelData =
+      AcquireObjFile("resource", "axis.obj");
+  assert(modelData != nullptr);
 
   // VertexResource を生成
   Microsoft::WRL::ComPtr<ID3D12Resource> vertexResource = CreateBufferResource(
-      device, sizeof(VertexData) * modelData.vertices.size());
+      device, sizeof(VertexData) * modelData->vertices.size());
 
   // Spriteの矩形
   Microsoft::WRL::ComPtr<ID3D12Resource> vertexResourceSprite =
@@ -1189,12 +1007,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 #pragma region IndexResourceを生成する
 
   Microsoft::WRL::ComPtr<ID3D12Resource> indexResource = CreateBufferResource(
-      device, sizeof(uint32_t) * modelData.vertices.size());
+      device, sizeof(uint32_t) * modelData->vertices.size());
 
   D3D12_INDEX_BUFFER_VIEW indexBufferView{};
   indexBufferView.BufferLocation = indexResource->GetGPUVirtualAddress();
   indexBufferView.SizeInBytes =
-      UINT(sizeof(uint32_t) * modelData.vertices.size());
+      UINT(sizeof(uint32_t) * modelData->vertices.size());
   indexBufferView.Format = DXGI_FORMAT_R32_UINT;
 
   Microsoft::WRL::ComPtr<ID3D12Resource> indexResourceSprite =
@@ -1280,7 +1098,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   vertexBufferView.BufferLocation = vertexResource->GetGPUVirtualAddress();
 
   vertexBufferView.SizeInBytes =
-      UINT(sizeof(VertexData) * modelData.vertices.size());
+      UINT(sizeof(VertexData) * modelData->vertices.size());
 
   vertexBufferView.StrideInBytes = sizeof(VertexData);
 
@@ -1329,20 +1147,34 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
 #pragma region Textureの読み込み
 
-  DirectX::ScratchImage mipImages = LoadTexture("resource/uvChecker.png");
-  const DirectX::TexMetadata metadata = mipImages.GetMetadata();
-  Microsoft::WRL::ComPtr<ID3D12Resource> textureResource =
-      CreateTextureResource(device, metadata);
-  Microsoft::WRL::ComPtr<ID3D12Resource> intermadiate =
-      UploadTextureData(textureResource, mipImages, device, commandList);
-
-  DirectX::ScratchImage mipImages2 =
-      LoadTexture(modelData.material.textureFilePath);
-  const DirectX::TexMetadata &metadata2 = mipImages2.GetMetadata();
-  Microsoft::WRL::ComPtr<ID3D12Resource> textureResource2 =
-      CreateTextureResource(device, metadata2);
-  Microsoft::WRL::ComPtr<ID3D12Resource> intermadiate2 =
-      UploadTextureData(textureResource2, mipImages2, device, commandList);
+  // テクスチャやバッファの転送元。GPUが使い終わった場所から使い回す
+  // 入らない大きさのものは、その時だけ専用のバッファを作って転送する
+  const uint64_t kUploadRingSize = 32 * 1024 * 1024;
+  UploadRing uploadRing(device.Get(), kUploadRingSize);
+
+  // テクスチャは小さいミップだけを置いて始め、画面に映る大きさに合わせて細かいミップを足す
+  // 置いたミップの合計が予算を超えたら、長く使われていないものから捨てる
+  const uint64_t kTextureBudget = 64 * 1024 * 1024;
+  TextureStreamer textureStreamer(device.Get(), uploadRing, kTextureBudget);
+
+  // 読み込みとクックはワーカーで並列に行う。転送はSRVの場所が決まってから
+  AssetRegistry::Handle<FileData> textureFile;
+  AssetRegistry::Handle<FileData> textureFile2;
+  {
+    ThreadPool textureWorkers(std::thread::hardware_concurrency());
+    TextureLoader textureLoader(textureWorkers);
+    const uint32_t textureId = textureLoader.Request("resource/uvChecker.png");
+    textureLoader.Request(modelData->material.textureFilePath);
+
+    TextureLoader::Result loaded;
+    while (textureLoader.WaitPop(loaded)) {
+      if (loaded.id == textureId) {
+        textureFile = loaded.dds;
+      } else {
+        textureFile2 = loaded.dds;
+      }
+    }
+  }
 
 #pragma endregion
 
@@ -1360,48 +1192,84 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
 #pragma region SRVを生成する
 
-  D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-
-  srvDesc.Format = metadata.format;
-  srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-  srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-  srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels);
-
-  // ２枚目
-  D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc2{};
-
-  srvDesc2.Format = metadata.format;
-  srvDesc2.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-  srvDesc2.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-  srvDesc2.Texture2D.MipLevels = UINT(metadata2.mipLevels);
-
-  // SRVを作成するDescriptorHeapの場所を決める
-
-  D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU =
-      GetCPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 0);
-
-  D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU =
-      GetGPUDscriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 0);
+  // マテリアルのテクスチャの表。描画では表の先頭を1回セットするだけにする
+  const D3D12_GPU_DESCRIPTOR_HANDLE materialTextureTableGPU =
+      GetGPUDscriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV,
+                            kMaterialTextureTableStart);
+
+  // まだ置いていない番号を引いても0が読めるよう、表全体をリソースのないSRVで埋める
+  {
+    D3D12_SHADER_RESOURCE_VIEW_DESC nullSrvDesc{};
+    nullSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    nullSrvDesc.Shader4ComponentMapping =
+        D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    nullSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    nullSrvDesc.Texture2D.MipLevels = 1;
+    for (uint32_t i = 0; i < materialTextureCount; ++i) {
+      device->CreateShaderResourceView(
+          nullptr, &nullSrvDesc,
+          GetCPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV,
+                                 kMaterialTextureTableStart + i));
+    }
+  }
 
-  D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU2 =
-      GetCPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 2);
+  // テクスチャの表の何番目に置くか。マテリアルはこの番号でテクスチャを選ぶ
+  const int32_t uvCheckerTextureIndex = 0;
+  const int32_t modelTextureIndex = 1;
 
-  D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU2 =
-      GetGPUDscriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 2);
+  // スプライトはいつもuvCheckerを使う
+  materialDataSprite->textureIndex = uvCheckerTextureIndex;
 
-  textureSrvHandleCPU.ptr += device->GetDescriptorHandleIncrementSize(
-      D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU = GetCPUDescriptorHandle(
+      srvDescriptorHeap.Get(), descriptorSizeSRV,
+      kMaterialTextureTableStart + uvCheckerTextureIndex);
 
-  textureSrvHandleGPU.ptr += device->GetDescriptorHandleIncrementSize(
-      D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU2 = GetCPUDescriptorHandle(
+      srvDescriptorHeap.Get(), descriptorSizeSRV,
+      kMaterialTextureTableStart + modelTextureIndex);
 
-  // SRVを生成する
-  device->CreateShaderResourceView(textureResource.Get(), &srvDesc,
-                                   textureSrvHandleCPU);
+  // SRVはTextureStreamerが作り、置いているミップが変わるたびに作り直す
+  const uint32_t textureStreamId =
+      textureStreamer.Add(textureFile, textureSrvHandleCPU, commandList.Get());
+  assert(textureStreamId != TextureStreamer::kInvalidId);
 
-  // SRVを生成する
-  device->CreateShaderResourceView(textureResource2.Get(), &srvDesc2,
-                                   textureSrvHandleCPU2);
+  // ２枚目
+  const uint32_t textureStreamId2 = textureStreamer.Add(
+      textureFile2, textureSrvHandleCPU2, commandList.Get());
+  assert(textureStreamId2 != TextureStreamer::kInvalidId);
+
+  // DDSの中身はTextureStreamerが持つ。ここのハンドルを残すと捨てても解放されない
+  textureFile.reset();
+  textureFile2.reset();
+
+  // テクスチャ1枚ごとの大きさと最後に使ったフレームを記録し、用途ごとに集計する
+  // 合計が予算を超えたら、しばらく使っていないものを丸ごと捨てて、次に使うときに読み直す
+  const uint64_t kTextureMemoryBudget = 256 * 1024 * 1024;
+  TextureManager textureManager(kTextureMemoryBudget);
+  auto registerManagedTexture = [&](const std::string &filePath,
+                                    uint32_t streamId,
+                                    TextureCategory category) {
+    TextureManager::Desc desc;
+    desc.name = filePath;
+    desc.owner = "scene";
+    desc.category = category;
+    desc.byteSize = textureStreamer.GetTotalBytes(streamId);
+    desc.unload = [&, streamId]() { textureStreamer.Unload(streamId); };
+    desc.reload = [&, filePath, streamId]() -> uint64_t {
+      if (!textureStreamer.Replace(streamId, AcquireCookedTexture(filePath),
+                                   commandList.Get())) {
+        return 0;
+      }
+      return textureStreamer.GetTotalBytes(streamId);
+    };
+    return textureManager.Register(std::move(desc));
+  };
+  const uint32_t textureManagedId = registerManagedTexture(
+      "resource/uvChecker.png", textureStreamId, TextureCategory::Sprite);
+  // モデルのテクスチャはmtlのmap_Kdを書き換えると別のファイルに変わる
+  std::string modelTexturePath = modelData->material.textureFilePath;
+  uint32_t textureManagedId2 = registerManagedTexture(
+      modelTexturePath, textureStreamId2, TextureCategory::Model);
 
 #pragma endregion
 
@@ -1421,8 +1289,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   VertexData *vertexData = nullptr;
   vertexResource->Map(0, nullptr, reinterpret_cast<void **>(&vertexData));
 
-  std::memcpy(vertexData, modelData.vertices.data(),
-              sizeof(VertexData) * modelData.vertices.size());
+  std::memcpy(vertexData, modelData->vertices.data(),
+              sizeof(VertexData) * modelData->vertices.size());
 
   //  vertexResource->Unmap(0, nullptr);
 
@@ -1474,8 +1342,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
   uint32_t *indexData = nullptr;
   indexResource->Map(0, nullptr, reinterpret_cast<void **>(&indexData));
-  std::memcpy(indexData, modelData.vertices.data(),
-              sizeof(uint32_t) * modelData.vertices.size());
+  std::memcpy(indexData, modelData->vertices.data(),
+              sizeof(uint32_t) * modelData->vertices.size());
 
 #pragma region 画像データの頂点データ
   VertexData *vertexDataSprite = nullptr;
@@ -1521,10 +1389,175 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
 #pragma endregion
 
+#pragma region ホットリロード
+
+  // 読み込みはワーカースレッドで行い、差し替えはフレームの頭で行う
+  // (前のフレームの終わりでGPUを待っているので、古いリソースを捨てても安全)
+  HotReloader hotReloader;
+
+  // テクスチャ。currentFilePathを渡したものは、そのファイルを使っている間だけ差し替える
+  // (mtlで別のファイルに変わった後も古いファイルの監視は残るため)
+  auto registerTextureReload = [&](const std::string &filePath,
+                                   uint32_t streamId,
+                                   const uint32_t &managedId,
+                                   const std::string *currentFilePath =
+                                       nullptr) {
+    hotReloader.Register(filePath, [&, filePath, streamId, currentFilePath]()
+                                       -> HotReloader::ApplyFunction {
+      AssetRegistry::GetInstance().Invalidate(AssetType::Texture, filePath);
+      AssetRegistry::Handle<FileData> dds = AcquireCookedTexture(filePath);
+      if (dds == nullptr) {
+        return nullptr;
+      }
+      return [&, filePath, streamId, currentFilePath, dds]() {
+        if (currentFilePath != nullptr && *currentFilePath != filePath) {
+          return;
+        }
+        // 捨てているものは、次に使うときに新しいファイルから読み直される
+        if (!textureManager.IsLoaded(managedId)) {
+          return;
+        }
+        if (textureStreamer.Replace(streamId, dds, commandList.Get())) {
+          textureManager.SetByteSize(managedId,
+                                     textureStreamer.GetTotalBytes(streamId));
+          Log(std::format("HotReload : {}\n", filePath));
+        }
+      };
+    });
+  };
+  registerTextureReload("resource/uvChecker.png", textureStreamId,
+                        textureManagedId);
+  // 一度監視したファイルは、別のファイルに変わった後で戻ってきても登録し直さない
+  std::vector<std::string> watchedModelTexturePaths = {modelTexturePath};
+  registerTextureReload(modelTexturePath, textureStreamId2, textureManagedId2,
+                        &modelTexturePath);
+
+  // モデル
+  HotReloader::ReloadFunction reloadModel = [&]() -> HotReloader::ApplyFunction {
+    // 書きかけのファイルなどで読めなければ古いモデルのまま動かし続ける
+    // (古いハンドルは差し替えまで有効)
+    std::string error;
+    AssetRegistry::Handle<ModelData> newModelData =
+        ReloadObjFile("resource", "axis.obj", &error);
+    if (newModelData == nullptr) {
+      Log(std::format("HotReload failed : {}\n", error));
+      return nullptr;
+    }
+    // 今のテクスチャのパスはメインスレッドでしか触らないので、ここでは比べずに読んでおく
+    // 同じファイルならAssetRegistryが持っているものが返るだけ
+    AssetRegistry::Handle<FileData> newTextureFile;
+    if (!newModelData->material.textureFilePath.empty()) {
+      newTextureFile =
+          AcquireCookedTexture(newModelData->material.textureFilePath);
+      if (newTextureFile == nullptr) {
+        Log(std::format("HotReload failed : cannot load {}\n",
+                        newModelData->material.textureFilePath));
+      }
+    }
+    return [&, newModelData, newTextureFile]() {
+      const std::string &newTexturePath =
+          newModelData->material.textureFilePath;
+      if (newTexturePath != modelTexturePath && newTextureFile != nullptr &&
+          textureStreamer.Replace(textureStreamId2, newTextureFile,
+                                  commandList.Get())) {
+        // 読み直すときに新しいファイルを読むよう、管理の登録を作り直す
+        textureManager.Unregister(textureManagedId2);
+        modelTexturePath = newTexturePath;
+        textureManagedId2 = registerManagedTexture(
+            modelTexturePath, textureStreamId2, TextureCategory::Model);
+        if (std::find(watchedModelTexturePaths.begin(),
+                      watchedModelTexturePaths.end(),
+                      modelTexturePath) == watchedModelTexturePaths.end()) {
+          watchedModelTexturePaths.push_back(modelTexturePath);
+          registerTextureReload(modelTexturePath, textureStreamId2,
+                                textureManagedId2, &modelTexturePath);
+        }
+        Log(std::format("HotReload : {}\n", modelTexturePath));
+      }
+      modelData = newModelData;
+      vertexResource = CreateBufferResource(
+          device, sizeof(VertexData) * modelData->vertices.size());
+      vertexResource->Map(0, nullptr, reinterpret_cast<void **>(&vertexData));
+      std::memcpy(vertexData, modelData->vertices.data(),
+                  sizeof(VertexData) * modelData->vertices.size());
+      vertexBufferView.BufferLocation = vertexResource->GetGPUVirtualAddress();
+      vertexBufferView.SizeInBytes =
+          UINT(sizeof(VertexData) * modelData->vertices.size());
+      Log("HotReload : resource/axis.obj\n");
+    };
+  };
+  hotReloader.Register("resource/axis.obj", reloadModel);
+  hotReloader.Register("resource/axis.mtl", reloadModel);
+
+  // シェーダー。DXCのオブジェクトはスレッドをまたいで使わないよう毎回作る
+  HotReloader::ReloadFunction reloadShaders =
+      [&]() -> HotReloader::ApplyFunction {
+    Microsoft::WRL::ComPtr<IDxcUtils> reloadUtils = nullptr;
+    Microsoft::WRL::ComPtr<IDxcCompiler3> reloadCompiler = nullptr;
+    if (FAILED(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&reloadUtils))) ||
+        FAILED(DxcCreateInstance(CLSID_DxcCompiler,
+                                 IID_PPV_ARGS(&reloadCompiler)))) {
+      return nullptr;
+    }
+    Microsoft::WRL::ComPtr<IDxcIncludeHandler> reloadIncludeHandler =
+        CreateIncludeHandler(reloadUtils);
+    if (reloadIncludeHandler == nullptr) {
+      return nullptr;
+    }
+
+    // コンパイルエラーのときは古いシェーダーのまま動かし続ける
+    Microsoft::WRL::ComPtr<IDxcBlob> newVertexShaderBlob =
+        CompileShader(L"Object3D.VS.hlsl", L"vs_6_0", reloadUtils,
+                      reloadCompiler, reloadIncludeHandler.Get(), false);
+    Microsoft::WRL::ComPtr<IDxcBlob> newPixelShaderBlob =
+        CompileShader(L"Object3D.PS.hlsl", L"ps_6_0", reloadUtils,
+                      reloadCompiler, reloadIncludeHandler.Get(), false,
+                      pixelShaderDefines);
+    if (newVertexShaderBlob == nullptr || newPixelShaderBlob == nullptr) {
+      return nullptr;
+    }
+
+    return [&, newVertexShaderBlob, newPixelShaderBlob]() {
+      D3D12_GRAPHICS_PIPELINE_STATE_DESC newDesc = graphicsPipelineStateDesc;
+      newDesc.VS = {newVertexShaderBlob->GetBufferPointer(),
+                    newVertexShaderBlob->GetBufferSize()};
+      newDesc.PS = {newPixelShaderBlob->GetBufferPointer(),
+                    newPixelShaderBlob->GetBufferSize()};
+      Microsoft::WRL::ComPtr<ID3D12PipelineState> newPipelineState = nullptr;
+      if (FAILED(device->CreateGraphicsPipelineState(
+              &newDesc, IID_PPV_ARGS(&newPipelineState)))) {
+        return;
+      }
+      graphicsPipelineState = newPipelineState;
+      vertexShaderBlob = newVertexShaderBlob;
+      pixelShaderBlob = newPixelShaderBlob;
+      Log("HotReload : shaders\n");
+    };
+  };
+  hotReloader.Register("Object3d.VS.hlsl", reloadShaders);
+  hotReloader.Register("Object3d.PS.hlsl", reloadShaders);
+  hotReloader.Register("Object3d.hlsli", reloadShaders);
+
+  hotReloader.Start({"resource", "Object3d.VS.hlsl", "Object3d.PS.hlsl",
+                     "Object3d.hlsli"});
+
+#pragma endregion
+
 #pragma region XAudio2の初期化
   HRESULT result = XAudio2Create(&xAudio2, 0, XAUDIO2_DEFAULT_PROCESSOR);
   result = xAudio2->CreateMasteringVoice(&masterVoice);
   assert(SUCCEEDED(result));
+
+  // 効果音はボイスを使い回して鳴らす
+  VoicePool voicePool(xAudio2.Get());
+
+  // 位置を持つ音はミキサーで混ぜ、1つのソースボイスに流す
+  AudioMixer audioMixer;
+  XAudio2AudioOutput audioOutput(xAudio2.Get());
+  if (!audioOutput.Start(audioMixer)) {
+    Log("Failed to start the audio mixer\n");
+  }
+  SpatialAudio spatialAudio(audioMixer.GetSimdLevel());
 #pragma endregion
 
 #pragma region DirectInputの初期化
@@ -1571,8 +1604,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   Transform uvTransformSprite{
       {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
 
+  // 縦の視野角(ラジアン)。描画とテクスチャのミップの見積もりで同じものを使う
+  const float kFovY = 0.45f;
   Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(
-      0.45f, float(kCliantWidth) / float(kCliantHeight), 0.1f, 100.0f);
+      kFovY, float(kCliantWidth) / float(kCliantHeight), 0.1f, 100.0f);
 
 #pragma region ImGuiの初期化
 
@@ -1594,9 +1629,30 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 
 #pragma endregion
 
-  SoundData soundData = SoundLoadWave("resource/You_and_Me.wav");
+  // BGMは全体を読み込まず、再生しながら少しずつ読む
+  SoundStream bgm;
+  bgm.Open("resource/You_and_Me.wav", true);
+  AssetRegistry::Handle<SoundData> chimeSound =
+      AcquireSoundWave("resource/chimes.wav");
   bool hasPlayed = false;
 
+  // モデルの位置から鳴る音
+  // AssetTool soundbankで作ったバンクがあれば、そこからコピーせずに鳴らす
+  SoundBank soundBank;
+  SoundData modelSound{};
+  if (soundBank.Open("resource/sounds.sbnk")) {
+    modelSound = soundBank.GetSound("chimes");
+  }
+  if (modelSound.bufferSize == 0 && chimeSound) {
+    modelSound = *chimeSound;
+  }
+  AudioEmitterDesc modelEmitterDesc;
+  modelEmitterDesc.maxDistance = 50.0f;
+  const AudioEmitterHandle modelEmitter =
+      spatialAudio.CreateEmitter(transform.translate, modelEmitterDesc);
+  std::chrono::steady_clock::time_point previousFrameTime =
+      std::chrono::steady_clock::now();
+
 #pragma endregion
 
   MSG msg{};
@@ -1609,8 +1665,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
     } else {
       // ゲームの処理
 
+      // 前のフレームのGPU処理は終わっているので、ここでアセットを差し替える
+      hotReloader.ApplyPendingReloads();
+
+      voicePool.Update();
+      audioMixer.Update();
+
       //if (!hasPlayed) {
-      //  SoundPlayWave(xAudio2.Get(), soundData);
+      //  bgm.Play(xAudio2.Get());
       //  hasPlayed = true;
       //}
 
@@ -1683,6 +1745,74 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
         ImGui::SliderAngle("UVRotate", &uvTransformSprite.rotate.z);
       }
 
+      // === Assets ===
+      if (ImGui::CollapsingHeader("Assets")) {
+        const AssetRegistry &assetRegistry = AssetRegistry::GetInstance();
+        const std::pair<const char *, AssetType> assetTypes[] = {
+            {"Model", AssetType::Model},
+            {"Texture", AssetType::Texture},
+            {"Sound", AssetType::Sound}};
+        for (const auto &[name, type] : assetTypes) {
+          ImGui::Text("%-8s %3zu  %8.2f MB", name,
+                      assetRegistry.GetLoadedCount(type),
+                      assetRegistry.GetMemoryUsage(type) / 1048576.0);
+        }
+        ImGui::Text("Streaming %8.2f / %8.2f MB",
+                    textureStreamer.GetResidentBytes() / 1048576.0,
+                    textureStreamer.GetBudget() / 1048576.0);
+        int textureBudgetMB = int(textureStreamer.GetBudget() / 1048576);
+        if (ImGui::SliderInt("Texture Budget (MB)", &textureBudgetMB, 1, 512)) {
+          textureStreamer.SetBudget(uint64_t(textureBudgetMB) * 1048576);
+        }
+        ImGui::Text("Mip %u / %u",
+                    textureStreamer.GetResidentMip(textureStreamId),
+                    textureStreamer.GetMipCount(textureStreamId));
+
+        for (uint32_t i = 0; i < uint32_t(TextureCategory::Count); ++i) {
+          const TextureCategory category = TextureCategory(i);
+          ImGui::Text("%-9s %3u  %8.2f MB", GetTextureCategoryName(category),
+                      textureManager.GetLoadedCount(category),
+                      textureManager.GetLoadedBytes(category) / 1048576.0);
+        }
+        ImGui::Text("Textures  %8.2f / %8.2f MB",
+                    textureManager.GetLoadedBytes() / 1048576.0,
+                    textureManager.GetBudget() / 1048576.0);
+        int textureMemoryMB = int(textureManager.GetBudget() / 1048576);
+        if (ImGui::SliderInt("Texture Memory (MB)", &textureMemoryMB, 1,
+                             1024)) {
+          textureManager.SetBudget(uint64_t(textureMemoryMB) * 1048576);
+        }
+        if (ImGui::TreeNode("Texture List")) {
+          std::vector<uint32_t> managedIds;
+          textureManager.GetIds(managedIds);
+          for (uint32_t managedId : managedIds) {
+            const TextureManager::Info &info =
+                textureManager.GetInfo(managedId);
+            ImGui::Text("%s  %s  %.2f MB  frame %llu  %s", info.name.c_str(),
+                        info.owner.c_str(), info.byteSize / 1048576.0,
+                        static_cast<unsigned long long>(info.lastUsedFrame),
+                        info.isLoaded ? "loaded" : "evicted");
+          }
+          ImGui::TreePop();
+        }
+      }
+
+      // === Sound ===
+      if (ImGui::CollapsingHeader("Sound")) {
+        if (ImGui::Button("Play SE") && chimeSound) {
+          voicePool.Play(*chimeSound);
+        }
+        // 音量・パン・ピッチは毎フレームSpatialAudioが決める
+        if (ImGui::Button("Play SE at model") && modelSound.bufferSize != 0) {
+          spatialAudio.AttachVoice(modelEmitter, audioMixer.Play(modelSound));
+        }
+        ImGui::Text("Mixer voices %u / %u",
+                    audioMixer.GetActiveVoiceCount(),
+                    audioMixer.GetMaxVoices());
+        ImGui::Text("Voices %u / %u (playing %u)", voicePool.GetVoiceCount(),
+                    voicePool.GetMaxVoices(), voicePool.GetPlayingCount());
+      }
+
       ImGui::End();
       ImGui::Render();
 
@@ -1722,13 +1852,58 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
                            cameraTransform.translate);
       Matrix4x4 viewMatrix = Inverse(cameraMatrix);
       Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(
-          0.45f, float(kCliantWidth) / float(kCliantHeight), 0.1f, 100.0f);
+          kFovY, float(kCliantWidth) / float(kCliantHeight), 0.1f, 100.0f);
       Matrix4x4 worldViewProjectionMatrix =
           Multiply(worldMatrix, Multiply(viewMatrix, projectionMatrix));
 
       //     transform.rotate.y += 0.01f;
       *wvpData = {worldViewProjectionMatrix, worldMatrix};
 
+#pragma endregion
+
+#pragma region 位置を持つ音の更新
+
+      // カメラを聞き手、モデルを音源にしてミキサーのボイスに反映する
+      const std::chrono::steady_clock::time_point frameTime =
+          std::chrono::steady_clock::now();
+      const float frameSeconds =
+          std::chrono::duration<float>(frameTime - previousFrameTime).count();
+      previousFrameTime = frameTime;
+      spatialAudio.SetEmitterPosition(modelEmitter, transform.translate);
+      spatialAudio.Update(MakeAudioListener(cameraTransform), frameSeconds,
+                          audioMixer);
+
+#pragma endregion
+
+#pragma region テクスチャのミップを決める
+
+      // このフレームで描くテクスチャ。捨てていたらここで読み直す
+      textureManager.Use(textureManagedId);
+      textureManager.Use(useMonsterBall ? textureManagedId2
+                                        : textureManagedId);
+
+      // モデルの境界球が画面に映る大きさから、必要なミップを要求する
+      const float modelScale =
+          std::max({transform.scale.x, transform.scale.y, transform.scale.z});
+      const float toCameraX =
+          cameraTransform.translate.x - transform.translate.x;
+      const float toCameraY =
+          cameraTransform.translate.y - transform.translate.y;
+      const float toCameraZ =
+          cameraTransform.translate.z - transform.translate.z;
+      const float cameraDistance =
+          std::sqrt(toCameraX * toCameraX + toCameraY * toCameraY +
+                    toCameraZ * toCameraZ);
+      textureStreamer.RequestScreenSize(
+          useMonsterBall ? textureStreamId2 : textureStreamId,
+          EstimateScreenSize(modelData->boundingRadius * modelScale,
+                             cameraDistance, kFovY, float(kCliantHeight)));
+
+      // 足りないミップの転送と、予算を超えた分の作り直しをコマンドリストに積む
+      textureStreamer.Update(commandList.Get());
+      // 予算を超えていれば、しばらく使っていないテクスチャを丸ごと捨てる
+      textureManager.Update();
+
 #pragma endregion
 
       keyboard->Acquire();
@@ -1789,11 +1964,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
       commandList.Get()->SetGraphicsRootSignature(rootSignature.Get());
       commandList.Get()->SetPipelineState(graphicsPipelineState.Get());
 
-      // 三角形の色を変える
+      // 三角形の色とテクスチャを変える
       materialResource->Map(0, nullptr, reinterpret_cast<void **>(&material));
       material->color = triangleColor;
+      // Tier1の表はmaterialTextureCountまでなので、その外を引かないようにする
+      material->textureIndex = std::clamp<int32_t>(
+          useMonsterBall ? modelTextureIndex : uvCheckerTextureIndex, 0,
+          int32_t(materialTextureCount) - 1);
       materialResource->Unmap(0, nullptr);
 
+      // テクスチャはマテリアルの番号で表から引くので、表は描画ごとに差し替えない
+      commandList.Get()->SetGraphicsRootDescriptorTable(
+          2, materialTextureTableGPU);
+
       // 球の描画：Material, WVP, Light を正しくセット
       commandList.Get()->IASetVertexBuffers(0, 1, &vertexBufferView);
       commandList.Get()->IASetIndexBuffer(&indexBufferView);
@@ -1805,11 +1988,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
           1, wvpResource->GetGPUVirtualAddress());
       commandList.Get()->SetGraphicsRootConstantBufferView(
           3, directionalLightResource->GetGPUVirtualAddress());
-      commandList.Get()->SetGraphicsRootDescriptorTable(
-          2, useMonsterBall ? textureSrvHandleGPU2 : textureSrvHandleGPU);
       //     uint32_t indexCount = kSubdivision * kSubdivision * 6;
 
-      commandList.Get()->DrawInstanced(UINT(modelData.vertices.size()), 1, 0,
+      commandList.Get()->DrawInstanced(UINT(modelData->vertices.size()), 1, 0,
                                        0);
 
       commandList.Get()->IASetVertexBuffers(0, 1, &vertexBufferViewSprite);
@@ -1821,8 +2002,6 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
           0, materialResourceSprite->GetGPUVirtualAddress());
       commandList.Get()->SetGraphicsRootConstantBufferView(
           1, transformationMatrixResourceSprite->GetGPUVirtualAddress());
-      commandList.Get()->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
-
 
       //  commandList->DrawIndexedInstanced(6, 1, 0, 0, 0);
 
@@ -1864,6 +2043,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
         // イベントを待つ
         WaitForSingleObject(fenceEvent, INFINITE);
       }
+      // このフレームで積んだ転送が終わったら、その転送元を使い回せる
+      uploadRing.Submit(fenceValue);
+      uploadRing.Release(fence->GetCompletedValue());
 #pragma endregion
       hr = commandAllocator->Reset();
       assert(SUCCEEDED(hr));
@@ -1880,6 +2062,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
   ImGui::DestroyContext();
 #pragma endregion
 
+  hotReloader.Stop();
+
   Log("unkillable demon king\n");
 
 #pragma region エラー放置しない処理
@@ -1910,8 +2094,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
 #endif
 #pragma endregion
 
+  // ボイスはXAudio2より先に破棄する
+  audioOutput.Stop();
+  bgm.Stop();
+  voicePool.DestroyVoices();
   xAudio2.Reset();
-  SoundUnload(&soundData);
 
   CloseHandle(fenceEvent);
   CloseWindow(hwnd);
@@ -0,0 +1,197 @@
+#include "../../Adpcm.h"
+#include "../../MappedFile.h"
+#include "../../PcmConvert.h"
+#include "../../RiffReader.h"
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct AdpcmSettings {
+  std::string input;
+  std::string output;
+  // 1チャンネルあたりのブロックのバイト数。ヘッダ4バイト+8サンプルずつ
+  uint32_t blockBytes = 512;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool adpcm --input <file.wav|dir> --output <file.wav|dir>\n"
+      "      [--block-bytes N]\n"
+      "\n"
+      "  Encodes PCM/float WAV files as 4-bit IMA ADPCM (about 4:1 against\n"
+      "  16-bit PCM). --block-bytes is the block size per channel (default\n"
+      "  512, a multiple of 4). With a directory, every .wav below it is\n"
+      "  written to the same relative path under --output; files that are\n"
+      "  already ADPCM are copied as they are.\n");
+}
+
+void WriteU16(std::FILE *file, uint16_t value) {
+  const uint8_t bytes[2] = {uint8_t(value), uint8_t(value >> 8)};
+  std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+void WriteU32(std::FILE *file, uint32_t value) {
+  const uint8_t bytes[4] = {uint8_t(value), uint8_t(value >> 8),
+                            uint8_t(value >> 16), uint8_t(value >> 24)};
+  std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+// fmtにはwSamplesPerBlockを、factには本当のフレーム数を書く
+bool WriteImaWave(const std::string &path, const AdpcmFormat &format,
+                  uint32_t sampleRate, const std::vector<uint8_t> &data) {
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  const uint32_t fmtSize = 20;
+  const uint32_t dataSize = uint32_t(data.size());
+  const uint32_t blocks = dataSize / format.blockAlign;
+  std::fwrite("RIFF", 1, 4, file);
+  WriteU32(file, 4 + 8 + fmtSize + 8 + 4 + 8 + dataSize + (dataSize & 1));
+  std::fwrite("WAVE", 1, 4, file);
+  std::fwrite("fmt ", 1, 4, file);
+  WriteU32(file, fmtSize);
+  WriteU16(file, kWaveFormatImaAdpcm);
+  WriteU16(file, format.channels);
+  WriteU32(file, sampleRate);
+  WriteU32(file, uint32_t(uint64_t(sampleRate) * format.blockAlign /
+                          format.samplesPerBlock));
+  WriteU16(file, uint16_t(format.blockAlign));
+  WriteU16(file, 4);
+  WriteU16(file, 2);
+  WriteU16(file, uint16_t(format.samplesPerBlock));
+  std::fwrite("fact", 1, 4, file);
+  WriteU32(file, 4);
+  WriteU32(file, std::min(format.frameCount, blocks * format.samplesPerBlock));
+  std::fwrite("data", 1, 4, file);
+  WriteU32(file, dataSize);
+  std::fwrite(data.data(), 1, data.size(), file);
+  if (dataSize & 1) {
+    std::fputc(0, file);
+  }
+  return std::fclose(file) == 0;
+}
+
+// 元の音と展開し直した音の差からSN比(dB)を求める
+double MeasureSnr(const std::vector<int16_t> &original,
+                  const std::vector<int16_t> &decoded) {
+  double signal = 0.0;
+  double noise = 0.0;
+  for (size_t i = 0; i < original.size() && i < decoded.size(); ++i) {
+    const double difference = double(decoded[i]) - original[i];
+    signal += double(original[i]) * original[i];
+    noise += difference * difference;
+  }
+  return noise > 0.0 ? 10.0 * std::log10(signal / noise) : 999.0;
+}
+
+bool EncodeFile(const std::filesystem::path &inputPath,
+                const std::filesystem::path &outputPath,
+                const AdpcmSettings &settings) {
+  MappedFile mappedFile;
+  WaveFile wave;
+  std::string error;
+  if (!mappedFile.Open(inputPath.string()) ||
+      !ParseWave(mappedFile.GetData(), mappedFile.GetSize(), wave, &error)) {
+    std::printf("%s: failed to load (%s)\n", inputPath.string().c_str(),
+                error.empty() ? "cannot open" : error.c_str());
+    return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(outputPath.parent_path(), ec);
+  if (IsAdpcmFormatTag(wave.format.formatTag)) {
+    std::filesystem::copy_file(
+        inputPath, outputPath,
+        std::filesystem::copy_options::overwrite_existing, ec);
+    std::printf("%s: already ADPCM, copied\n", inputPath.string().c_str());
+    return !ec;
+  }
+
+  PcmFormat pcmFormat = PcmFormat::Int16;
+  if (!GetPcmFormat(wave.format.formatTag, wave.format.bitsPerSample,
+                    pcmFormat)) {
+    std::printf("%s: unsupported sample format (0x%04x, %u bit)\n",
+                inputPath.string().c_str(), wave.format.formatTag,
+                wave.format.bitsPerSample);
+    return false;
+  }
+
+  // 16bitにそろえてから圧縮する
+  const uint16_t channels = wave.format.channels;
+  const uint32_t frameCount = wave.sampleBytes / wave.format.blockAlign;
+  if (frameCount == 0) {
+    std::printf("%s: no samples\n", inputPath.string().c_str());
+    return false;
+  }
+  std::vector<float> samples(size_t(frameCount) * channels);
+  ConvertPcmToFloat(pcmFormat, wave.samples, samples.data(), samples.size());
+  std::vector<int16_t> pcm(samples.size());
+  ConvertFloatToPcm(PcmFormat::Int16, samples.data(), pcm.data(),
+                    samples.size());
+
+  const uint32_t samplesPerBlock = (settings.blockBytes - 4) * 2 + 1;
+  AdpcmFormat format;
+  const std::vector<uint8_t> data = EncodeImaAdpcm(
+      pcm.data(), frameCount, channels, samplesPerBlock, format);
+  if (!WriteImaWave(outputPath.string(), format, wave.format.samplesPerSec,
+                    data)) {
+    std::printf("%s: failed to write\n", outputPath.string().c_str());
+    return false;
+  }
+
+  const std::vector<int16_t> decoded =
+      DecodeAdpcm(format, data.data(), data.size());
+  std::printf("%s: %u frames, %u -> %zu bytes (%.1f:1), SNR %.1f dB\n",
+              inputPath.string().c_str(), frameCount, wave.sampleBytes,
+              data.size(), double(wave.sampleBytes) / double(data.size()),
+              MeasureSnr(pcm, decoded));
+  return true;
+}
+
+} // namespace
+
+int AdpcmCommand(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  AdpcmSettings settings;
+  settings.input = commandLine.GetString("--input");
+  settings.output = commandLine.GetString("--output");
+  settings.blockBytes =
+      uint32_t(commandLine.GetUInt("--block-bytes", settings.blockBytes));
+
+  // wSamplesPerBlockは16ビットに収まらなければならない
+  if (settings.input.empty() || settings.output.empty() ||
+      settings.blockBytes < 8 || settings.blockBytes % 4 != 0 ||
+      settings.blockBytes > 8192) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::error_code ec;
+  if (!std::filesystem::is_directory(settings.input, ec)) {
+    return EncodeFile(settings.input, settings.output, settings) ? 0 : 1;
+  }
+
+  bool isSucceeded = true;
+  for (const auto &entry :
+       std::filesystem::recursive_directory_iterator(settings.input, ec)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".wav") {
+      continue;
+    }
+    const std::filesystem::path relative =
+        std::filesystem::relative(entry.path(), settings.input, ec);
+    isSucceeded &= EncodeFile(
+        entry.path(), std::filesystem::path(settings.output) / relative,
+        settings);
+  }
+  return isSucceeded ? 0 : 1;
+}
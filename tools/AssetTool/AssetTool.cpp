@@ -0,0 +1,53 @@
+#include "AssetTool.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct Command {
+  const char *name;
+  int (*function)(const std::vector<std::string> &args);
+  const char *description;
+};
+
+const Command kCommands[] = {
+    {"generate", GenerateCommand,
+     "generate synthetic OBJ/MTL/WAV files for benchmarks"},
+    {"pack", PackCommand, "build a pack file from loose asset files"},
+    {"resample", ResampleCommand,
+     "convert WAV files to the mixer's sample rate"},
+    {"adpcm", AdpcmCommand, "compress WAV files as IMA ADPCM"},
+    {"soundbank", SoundBankCommand,
+     "pack WAV files into one memory-mapped sound bank"},
+    {"cook", CookCommand,
+     "compress textures to BC DDS with mipmaps (PNG only outside Windows)"},
+    {"atlas", AtlasCommand,
+     "pack sprites into cooked texture atlas pages (Windows only)"},
+};
+
+void PrintUsage() {
+  std::printf("usage: AssetTool <command> [options]\n\n");
+  for (const Command &command : kCommands) {
+    std::printf("  %-10s %s\n", command.name, command.description);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::vector<std::string> args(argv + 2, argv + argc);
+  for (const Command &command : kCommands) {
+    if (std::strcmp(argv[1], command.name) == 0) {
+      return command.function(args);
+    }
+  }
+
+  std::printf("unknown command: %s\n\n", argv[1]);
+  PrintUsage();
+  return 1;
+}
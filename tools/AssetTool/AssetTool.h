@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// AssetToolのサブコマンド。argsはサブコマンド名より後ろの引数
+// 戻り値はそのままプロセスの終了コードになる
+int GenerateCommand(const std::vector<std::string> &args);
+int PackCommand(const std::vector<std::string> &args);
+int ResampleCommand(const std::vector<std::string> &args);
+int AdpcmCommand(const std::vector<std::string> &args);
+int SoundBankCommand(const std::vector<std::string> &args);
+int CookCommand(const std::vector<std::string> &args);
+int AtlasCommand(const std::vector<std::string> &args);
@@ -0,0 +1,219 @@
+#include "../../MappedFile.h"
+#include "../../TextureAtlas.h"
+#include "../../TextureCooker.h"
+#include "../../ThreadPool.h"
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+// ページのクックにDirectXTexを使うので、Windowsでだけ使える
+#ifdef _WIN32
+
+namespace {
+
+struct AtlasCommandSettings {
+  std::vector<std::string> inputs;
+  std::string output;
+  AtlasSettings atlas;
+  TextureCookSettings texture;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool atlas --output <file.atlas> --input <dir|image>\n"
+      "      [--input <dir|image> ...] [--page-size N] [--padding N]\n"
+      "      [--format none|bc1|bc3|bc5|bc7] [--linear] [--no-mips]\n"
+      "\n"
+      "  Packs every .png/.jpg/.bmp/.tif/.tga into as few pages as possible\n"
+      "  (default 2048x2048) and cooks each page to <name>_<N>.dds next to\n"
+      "  the .atlas file, which lists the pages and the pixel rectangle of\n"
+      "  each sprite. Sprites are named by their file name without the\n"
+      "  extension, so names must be unique. Each sprite is surrounded by\n"
+      "  --padding pixels (default 4) of its own edge colors so that mips\n"
+      "  do not bleed into neighbours.\n");
+}
+
+bool IsImagePath(const std::filesystem::path &path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](char c) { return char(std::tolower(uint8_t(c))); });
+  return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+         extension == ".bmp" || extension == ".tif" || extension == ".tiff" ||
+         extension == ".tga" || extension == ".hdr";
+}
+
+bool CollectFiles(const AtlasCommandSettings &settings,
+                  std::set<std::filesystem::path> &files) {
+  std::error_code ec;
+  for (const std::string &input : settings.inputs) {
+    if (std::filesystem::is_directory(input, ec)) {
+      for (const auto &entry :
+           std::filesystem::recursive_directory_iterator(input, ec)) {
+        if (entry.is_regular_file(ec) && IsImagePath(entry.path())) {
+          files.insert(entry.path());
+        }
+      }
+    } else if (std::filesystem::is_regular_file(input, ec)) {
+      files.insert(input);
+    } else {
+      std::printf("not found: %s\n", input.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool WriteTextFile(const std::filesystem::path &path, const std::string &text) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(text.data(), std::streamsize(text.size()));
+  return bool(file);
+}
+
+} // namespace
+
+int AtlasCommand(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  AtlasCommandSettings settings;
+  settings.inputs = commandLine.GetStrings("--input");
+  settings.output = commandLine.GetString("--output");
+  const uint32_t pageSize = uint32_t(commandLine.GetUInt("--page-size", 2048));
+  settings.atlas.pageWidth = pageSize;
+  settings.atlas.pageHeight = pageSize;
+  settings.atlas.padding =
+      uint32_t(commandLine.GetUInt("--padding", settings.atlas.padding));
+  const std::string format = commandLine.GetString(
+      "--format", GetTextureCompressionName(settings.texture.compression));
+  settings.texture.isSrgb = !commandLine.HasFlag("--linear");
+  settings.texture.isMipMapped = !commandLine.HasFlag("--no-mips");
+
+  if (settings.inputs.empty() || settings.output.empty() || pageSize == 0 ||
+      !ParseTextureCompression(format, settings.texture.compression)) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::set<std::filesystem::path> files;
+  if (!CollectFiles(settings, files)) {
+    return 1;
+  }
+  if (files.empty()) {
+    std::printf("no image files found\n");
+    return 1;
+  }
+
+  // WICでデコードするのに必要
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+  ThreadPool pool(std::thread::hardware_concurrency());
+
+  AtlasManifest manifest;
+  std::vector<DirectX::ScratchImage> decoded;
+  std::vector<Rgba8Image> images;
+  std::set<std::string> names;
+  bool isSucceeded = true;
+  for (const std::filesystem::path &path : files) {
+    const std::string name = path.stem().string();
+    if (!names.insert(name).second) {
+      std::printf("%s: duplicate sprite name '%s'\n", path.string().c_str(),
+                  name.c_str());
+      isSucceeded = false;
+      continue;
+    }
+    MappedFile file;
+    DirectX::ScratchImage image;
+    std::string error;
+    if (!file.Open(path.string())) {
+      std::printf("%s: cannot open\n", path.string().c_str());
+      isSucceeded = false;
+      continue;
+    }
+    if (!DecodeRgba8Texture(file.GetData(), file.GetSize(),
+                            settings.texture.isSrgb, image, &error)) {
+      std::printf("%s: %s\n", path.string().c_str(), error.c_str());
+      isSucceeded = false;
+      continue;
+    }
+    const DirectX::Image *pixels = image.GetImage(0, 0, 0);
+    images.push_back({pixels->pixels, uint32_t(pixels->width),
+                      uint32_t(pixels->height), pixels->rowPitch});
+    decoded.push_back(std::move(image));
+    manifest.sprites.push_back({name, {}});
+  }
+
+  std::vector<AtlasPage> pages;
+  std::vector<AtlasRegion> regions;
+  std::string error;
+  if (isSucceeded &&
+      !PackAtlas(images.data(), uint32_t(images.size()), settings.atlas,
+                 pages, regions, &error)) {
+    std::printf("%s\n", error.c_str());
+    isSucceeded = false;
+  }
+
+  const std::filesystem::path outputPath(settings.output);
+  const std::string stem = outputPath.stem().string();
+  uint64_t pixelCount = 0;
+  uint64_t usedPixelCount = 0;
+  for (uint32_t i = 0; isSucceeded && i < pages.size(); ++i) {
+    const std::string fileName = stem + "_" + std::to_string(i) + ".dds";
+    const std::filesystem::path pagePath =
+        outputPath.parent_path() / fileName;
+    DirectX::ScratchImage cooked;
+    if (!CookRgba8Texture(pages[i].GetImage(), settings.texture, cooked,
+                          &error, &pool) ||
+        !SaveCookedTexture(cooked, pagePath.string(), &error)) {
+      std::printf("%s: %s\n", pagePath.string().c_str(), error.c_str());
+      isSucceeded = false;
+      break;
+    }
+    uint32_t spriteCount = 0;
+    for (const AtlasRegion &region : regions) {
+      if (region.page == i) {
+        ++spriteCount;
+        usedPixelCount += uint64_t(region.width) * region.height;
+      }
+    }
+    pixelCount += uint64_t(pages[i].width) * pages[i].height;
+    std::printf("%s: %ux%u, %u sprites\n", pagePath.string().c_str(),
+                pages[i].width, pages[i].height, spriteCount);
+    manifest.pages.push_back({fileName, pages[i].width, pages[i].height});
+  }
+  CoUninitialize();
+
+  if (!isSucceeded) {
+    return 1;
+  }
+  for (size_t i = 0; i < regions.size(); ++i) {
+    manifest.sprites[i].region = regions[i];
+  }
+  if (!WriteTextFile(outputPath, FormatAtlasManifest(manifest))) {
+    std::printf("%s: cannot write\n", settings.output.c_str());
+    return 1;
+  }
+  std::printf("%zu sprites in %zu pages, %.1f%% of the page area used -> %s\n",
+              regions.size(), pages.size(),
+              100.0 * double(usedPixelCount) / double(pixelCount),
+              settings.output.c_str());
+  return 0;
+}
+
+#else
+
+int AtlasCommand(const std::vector<std::string> &) {
+  std::printf("atlas needs DirectXTex and is only available on Windows\n");
+  return 1;
+}
+
+#endif
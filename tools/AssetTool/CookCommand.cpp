@@ -0,0 +1,262 @@
+#include "../../MappedFile.h"
+#include "../../TextureCooker.h"
+#include "../../ThreadPool.h"
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace {
+
+struct CookSettings {
+  std::vector<std::string> inputs;
+  // 空ならキャッシュに書く。入力が1つのときだけ指定できる
+  std::string output;
+  std::string cacheDirectory = kTextureCacheDirectory;
+  TextureCookSettings texture;
+  bool isForced = false;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool cook --input <dir|image> [--input <dir|image> ...]\n"
+      "      [--cache <dir>] [--format none|bc1|bc3|bc5|bc7] [--linear]\n"
+      "      [--no-mips] [--mip-filter box|kaiser] [--alpha-coverage R]\n"
+      "      [--fast-bc] [--bc-quality fast|normal|high] [--force]\n"
+      "  AssetTool cook --input <image> --output <file.dds> [options]\n"
+      "\n"
+      "  Generates mipmaps and block-compresses every .png/.jpg/.bmp/.tif/\n"
+      "  .tga/.hdr into the texture cache (default %s), keyed by a hash of\n"
+      "  the source file and the settings, exactly as the game does on first\n"
+      "  load.\n"
+      "  Cached entries are skipped unless --force is given. With --output\n"
+      "  a single image is written to that DDS file instead; the game loads\n"
+      "  .dds paths directly. The default format is bc7 in sRGB; use\n"
+      "  --linear for normal maps and masks (bc5 is always linear).\n"
+      "  Mips use a Kaiser filter by default. For alpha-tested cutouts pass\n"
+      "  the alpha test threshold (e.g. 0.5) as --alpha-coverage so that\n"
+      "  the mips keep the same share of visible pixels.\n"
+      "  --fast-bc compresses bc1/bc3/bc7 with the built-in fast encoder\n"
+      "  (bc7 uses mode 6 only) at --bc-quality (default normal) instead\n"
+      "  of DirectXTex.\n"
+      "  Outside Windows DirectXTex is not available: only .png can be\n"
+      "  cooked, bc1/bc3/bc7 always use the fast encoder and bc5 cannot be\n"
+      "  written.\n",
+      kTextureCacheDirectory);
+}
+
+bool IsImagePath(const std::filesystem::path &path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](char c) { return char(std::tolower(uint8_t(c))); });
+  return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+         extension == ".bmp" || extension == ".tif" || extension == ".tiff" ||
+         extension == ".tga" || extension == ".hdr";
+}
+
+bool CollectFiles(const CookSettings &settings,
+                  std::set<std::filesystem::path> &files) {
+  std::error_code ec;
+  for (const std::string &input : settings.inputs) {
+    if (std::filesystem::is_directory(input, ec)) {
+      for (const auto &entry :
+           std::filesystem::recursive_directory_iterator(input, ec)) {
+        if (entry.is_regular_file(ec) && IsImagePath(entry.path())) {
+          files.insert(entry.path());
+        }
+      }
+    } else if (std::filesystem::is_regular_file(input, ec)) {
+      files.insert(input);
+    } else {
+      std::printf("not found: %s\n", input.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// RGBA8のままミップを付けたときの大きさ。圧縮率の表示に使う
+size_t GetUncompressedSize(size_t width, size_t height, size_t mipLevels,
+                           size_t arraySize = 1) {
+  size_t size = 0;
+  for (size_t mip = 0; mip < mipLevels; ++mip) {
+    size += width * height * 4;
+    width = std::max<size_t>(width / 2, 1);
+    height = std::max<size_t>(height / 2, 1);
+  }
+  return size * arraySize;
+}
+
+struct CookStats {
+  uint32_t cookedCount = 0;
+  uint32_t skippedCount = 0;
+  uint64_t sourceSize = 0;
+  uint64_t uncompressedSize = 0;
+  uint64_t cookedSize = 0;
+};
+
+bool CookFile(const std::filesystem::path &path, const CookSettings &settings,
+              ThreadPool &pool, CookStats &stats) {
+  MappedFile file;
+  if (!file.Open(path.string())) {
+    std::printf("%s: cannot open\n", path.string().c_str());
+    return false;
+  }
+  const std::string outputPath =
+      !settings.output.empty()
+          ? settings.output
+          : GetCookedTexturePath(settings.cacheDirectory,
+                                 ComputeTextureCookKey(file.GetData(),
+                                                       file.GetSize(),
+                                                       settings.texture));
+  std::error_code ec;
+  if (!settings.isForced && settings.output.empty() &&
+      std::filesystem::exists(outputPath, ec)) {
+    std::printf("%s: cached (%s)\n", path.string().c_str(),
+                outputPath.c_str());
+    ++stats.skippedCount;
+    return true;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::string error;
+#ifdef _WIN32
+  DirectX::ScratchImage image;
+  if (!CookTexture(file.GetData(), file.GetSize(), settings.texture, image,
+                   &error, &pool) ||
+      !SaveCookedTexture(image, outputPath, &error)) {
+    std::printf("%s: %s\n", path.string().c_str(), error.c_str());
+    return false;
+  }
+  const DirectX::TexMetadata &metadata = image.GetMetadata();
+  const size_t width = metadata.width;
+  const size_t height = metadata.height;
+  const size_t mipLevels = metadata.mipLevels;
+  const size_t uncompressedSize = GetUncompressedSize(
+      width, height, mipLevels, metadata.arraySize);
+  const size_t cookedSize = image.GetPixelsSize();
+#else
+  // DirectXTexがないので、PNGだけを自前の処理でクックする
+  CookedImage image;
+  std::vector<uint8_t> dds;
+  if (!CookPngTexture(file.GetData(), file.GetSize(), settings.texture, image,
+                      &error, &pool) ||
+      !EncodeCookedImage(image, dds, &error) ||
+      !WriteCookedTexture(dds.data(), dds.size(), outputPath, &error)) {
+    std::printf("%s: %s\n", path.string().c_str(), error.c_str());
+    return false;
+  }
+  const size_t width = image.GetWidth();
+  const size_t height = image.GetHeight();
+  const size_t mipLevels = image.levels.size();
+  const size_t uncompressedSize =
+      GetUncompressedSize(width, height, mipLevels);
+  const size_t cookedSize = image.pixels.size();
+#endif
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  std::printf("%s: %zux%zu, %zu mips, %s, %.1f KB -> %.1f KB (%.1fx) in "
+              "%.0f ms -> %s\n",
+              path.string().c_str(), width, height, mipLevels,
+              GetTextureCompressionName(settings.texture.compression),
+              uncompressedSize / 1024.0, cookedSize / 1024.0,
+              double(uncompressedSize) / double(cookedSize), seconds * 1000.0,
+              outputPath.c_str());
+  ++stats.cookedCount;
+  stats.sourceSize += file.GetSize();
+  stats.uncompressedSize += uncompressedSize;
+  stats.cookedSize += cookedSize;
+  return true;
+}
+
+} // namespace
+
+int CookCommand(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  CookSettings settings;
+  settings.inputs = commandLine.GetStrings("--input");
+  settings.output = commandLine.GetString("--output");
+  settings.cacheDirectory =
+      commandLine.GetString("--cache", settings.cacheDirectory);
+  const std::string format = commandLine.GetString(
+      "--format", GetTextureCompressionName(settings.texture.compression));
+  settings.texture.isSrgb = !commandLine.HasFlag("--linear");
+  settings.texture.isMipMapped = !commandLine.HasFlag("--no-mips");
+  const std::string mipFilter = commandLine.GetString(
+      "--mip-filter", GetMipFilterName(settings.texture.mipFilter));
+  settings.texture.alphaCoverageReference =
+      float(commandLine.GetDouble("--alpha-coverage", 0.0));
+#ifdef _WIN32
+  settings.texture.isFastCompression = commandLine.HasFlag("--fast-bc");
+#else
+  // DirectXTexの圧縮が使えないので、いつも自前の速い圧縮を使う
+  settings.texture.isFastCompression = true;
+#endif
+  const std::string bcQuality = commandLine.GetString(
+      "--bc-quality",
+      GetBcQualityName(settings.texture.fastCompressionQuality));
+  settings.isForced = commandLine.HasFlag("--force");
+
+  if (settings.inputs.empty() ||
+      !ParseTextureCompression(format, settings.texture.compression) ||
+      !ParseMipFilter(mipFilter, settings.texture.mipFilter) ||
+      !ParseBcQuality(bcQuality, settings.texture.fastCompressionQuality) ||
+      settings.texture.alphaCoverageReference < 0.0f ||
+      settings.texture.alphaCoverageReference >= 1.0f) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::set<std::filesystem::path> files;
+  if (!CollectFiles(settings, files)) {
+    return 1;
+  }
+  if (files.empty()) {
+    std::printf("no image files found\n");
+    return 1;
+  }
+  if (!settings.output.empty() && files.size() != 1) {
+    std::printf("--output needs exactly one input image\n");
+    return 1;
+  }
+
+#ifdef _WIN32
+  // WICでデコードするのに必要(Windows以外ではPNGとTGAとHDRを自前で読む)
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+  // ミップ生成を手伝わせる(BC圧縮はDirectXTexの中で並列になる)
+  ThreadPool pool(std::thread::hardware_concurrency());
+  CookStats stats;
+  bool isSucceeded = true;
+  for (const std::filesystem::path &path : files) {
+    isSucceeded = CookFile(path, settings, pool, stats) && isSucceeded;
+  }
+#ifdef _WIN32
+  CoUninitialize();
+#endif
+
+  std::printf("%u cooked, %u cached", stats.cookedCount, stats.skippedCount);
+  if (stats.cookedCount != 0) {
+    std::printf(", %.2f MB source, %.2f MB RGBA8 -> %.2f MB %s",
+                stats.sourceSize / 1048576.0,
+                stats.uncompressedSize / 1048576.0,
+                stats.cookedSize / 1048576.0,
+                GetTextureCompressionName(settings.texture.compression));
+  }
+  std::printf("\n");
+  return isSucceeded ? 0 : 1;
+}
@@ -0,0 +1,780 @@
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+const float kPi = 3.14159265f;
+
+#pragma region 乱数
+
+// 同じシードなら同じファイルになるよう、乱数は自前で持つ(splitmix64)
+class Random {
+public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  // [0, 1)
+  float NextFloat() { return float(Next() >> 40) / float(1 << 24); }
+
+  // [min, max]
+  uint32_t NextRange(uint32_t min, uint32_t max) {
+    return min + uint32_t(Next() % (uint64_t(max) - min + 1));
+  }
+
+private:
+  uint64_t state_;
+};
+
+#pragma endregion
+
+#pragma region 書き込み
+
+// 数GB以上のファイルも書けるよう、固定長のバッファに溜めてから書き出す
+class FileWriter {
+public:
+  explicit FileWriter(const std::string &path)
+      : buffer_(std::make_unique<char[]>(kBufferSize)) {
+    file_ = std::fopen(path.c_str(), "wb");
+  }
+  ~FileWriter() { Close(); }
+
+  bool IsOpen() const { return file_ != nullptr; }
+  uint64_t GetBytesWritten() const { return bytesWritten_ + used_; }
+
+  void Write(const void *data, size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+      size_t copySize = std::min(size, kBufferSize - used_);
+      std::memcpy(buffer_.get() + used_, bytes, copySize);
+      used_ += copySize;
+      bytes += copySize;
+      size -= copySize;
+      if (used_ == kBufferSize) {
+        Flush();
+      }
+    }
+  }
+
+  void Write(std::string_view text) { Write(text.data(), text.size()); }
+
+  void WriteUInt(uint64_t value) {
+    char text[24];
+    auto result = std::to_chars(text, text + sizeof(text), value);
+    Write(text, result.ptr - text);
+  }
+
+  void WriteFloat(float value) {
+    char text[48];
+    auto result = std::to_chars(text, text + sizeof(text), value,
+                                std::chars_format::fixed, 6);
+    Write(text, result.ptr - text);
+  }
+
+  template <typename T> void WriteValue(const T &value) {
+    Write(&value, sizeof(T));
+  }
+
+  void Close() {
+    if (file_ == nullptr) {
+      return;
+    }
+    Flush();
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+
+private:
+  void Flush() {
+    std::fwrite(buffer_.get(), 1, used_, file_);
+    bytesWritten_ += used_;
+    used_ = 0;
+  }
+
+  static constexpr size_t kBufferSize = 1 << 20;
+
+  FILE *file_ = nullptr;
+  std::unique_ptr<char[]> buffer_;
+  size_t used_ = 0;
+  uint64_t bytesWritten_ = 0;
+};
+
+#pragma endregion
+
+#pragma region OBJ
+
+struct ObjSettings {
+  uint64_t triangleCount = 100000;
+  // 1面あたりの頂点数。min != max なら面ごとにランダムに決める
+  uint32_t minPolygon = 3;
+  uint32_t maxPolygon = 3;
+  bool hasTexcoord = true;
+  bool hasNormal = true;
+  // 凹多角形(星形)にする。4頂点以上の面にだけ効く
+  bool isConcave = false;
+  uint32_t materialCount = 1;
+  uint64_t seed = 1;
+};
+
+struct ObjStats {
+  uint64_t vertexCount = 0;
+  uint64_t faceCount = 0;
+  uint64_t triangleCount = 0;
+  uint64_t bytes = 0;
+};
+
+// 地形っぽいなだらかな高さと、その法線
+float Height(float x, float z) {
+  return 2.0f * std::sin(x * 0.15f) * std::cos(z * 0.1f);
+}
+
+void WriteNormal(FileWriter &writer, float x, float z) {
+  float dx = 2.0f * 0.15f * std::cos(x * 0.15f) * std::cos(z * 0.1f);
+  float dz = -2.0f * 0.1f * std::sin(x * 0.15f) * std::sin(z * 0.1f);
+  float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+  writer.Write("vn ");
+  writer.WriteFloat(-dx / length);
+  writer.Write(" ");
+  writer.WriteFloat(1.0f / length);
+  writer.Write(" ");
+  writer.WriteFloat(-dz / length);
+  writer.Write("\n");
+}
+
+void WriteVertex(FileWriter &writer, const ObjSettings &settings, float x,
+                 float z, float u, float v) {
+  writer.Write("v ");
+  writer.WriteFloat(x);
+  writer.Write(" ");
+  writer.WriteFloat(Height(x, z));
+  writer.Write(" ");
+  writer.WriteFloat(z);
+  writer.Write("\n");
+  if (settings.hasTexcoord) {
+    writer.Write("vt ");
+    writer.WriteFloat(u);
+    writer.Write(" ");
+    writer.WriteFloat(v);
+    writer.Write("\n");
+  }
+  if (settings.hasNormal) {
+    WriteNormal(writer, x, z);
+  }
+}
+
+// v, v/vt, v//vn, v/vt/vn のどれかで書く(頂点と属性のインデックスは同じ)
+void WriteFaceIndex(FileWriter &writer, const ObjSettings &settings,
+                    uint64_t index) {
+  writer.Write(" ");
+  writer.WriteUInt(index);
+  if (settings.hasTexcoord || settings.hasNormal) {
+    writer.Write("/");
+    if (settings.hasTexcoord) {
+      writer.WriteUInt(index);
+    }
+    if (settings.hasNormal) {
+      writer.Write("/");
+      writer.WriteUInt(index);
+    }
+  }
+}
+
+void WriteUseMaterial(FileWriter &writer, uint32_t material) {
+  writer.Write("usemtl material");
+  writer.WriteUInt(material);
+  writer.Write("\n");
+}
+
+bool GenerateMtl(const std::string &path, uint32_t materialCount) {
+  FileWriter writer(path);
+  if (!writer.IsOpen()) {
+    return false;
+  }
+  for (uint32_t i = 0; i < materialCount; ++i) {
+    writer.Write("newmtl material");
+    writer.WriteUInt(i);
+    writer.Write("\nKd 1.000000 1.000000 1.000000\nmap_Kd uvChecker.png\n\n");
+  }
+  return true;
+}
+
+// 頂点を共有する格子。三角形と四角形だけならこちらで作る
+void GenerateGrid(FileWriter &writer, const ObjSettings &settings,
+                  ObjStats &stats) {
+  uint64_t cellCount = (settings.triangleCount + 1) / 2;
+  uint64_t width = uint64_t(std::ceil(std::sqrt(double(cellCount))));
+  uint64_t height = (cellCount + width - 1) / width;
+  float spacing = 100.0f / float(width);
+
+  for (uint64_t j = 0; j <= height; ++j) {
+    for (uint64_t i = 0; i <= width; ++i) {
+      WriteVertex(writer, settings, (float(i) - width * 0.5f) * spacing,
+                  (float(j) - height * 0.5f) * spacing, float(i) / width,
+                  float(j) / height);
+    }
+  }
+  stats.vertexCount = (width + 1) * (height + 1);
+
+  uint32_t currentMaterial = UINT32_MAX;
+  for (uint64_t cell = 0; cell < cellCount; ++cell) {
+    uint32_t material = uint32_t(cell * settings.materialCount / cellCount);
+    if (material != currentMaterial) {
+      WriteUseMaterial(writer, material);
+      currentMaterial = material;
+    }
+
+    uint64_t i = cell % width;
+    uint64_t j = cell / width;
+    uint64_t a = j * (width + 1) + i + 1;
+    uint64_t b = a + 1;
+    uint64_t c = b + width + 1;
+    uint64_t d = a + width + 1;
+
+    if (settings.maxPolygon == 4) {
+      writer.Write("f");
+      for (uint64_t index : {a, b, c, d}) {
+        WriteFaceIndex(writer, settings, index);
+      }
+      writer.Write("\n");
+      stats.faceCount += 1;
+    } else {
+      writer.Write("f");
+      for (uint64_t index : {a, b, c}) {
+        WriteFaceIndex(writer, settings, index);
+      }
+      writer.Write("\nf");
+      for (uint64_t index : {a, c, d}) {
+        WriteFaceIndex(writer, settings, index);
+      }
+      writer.Write("\n");
+      stats.faceCount += 2;
+    }
+  }
+  stats.triangleCount = cellCount * 2;
+}
+
+// 面ごとに頂点を持つ多角形。頂点数が混ざるときや凹多角形のときに使う
+void GeneratePolygons(FileWriter &writer, const ObjSettings &settings,
+                      ObjStats &stats) {
+  Random random(settings.seed);
+
+  double averageTriangles =
+      (settings.minPolygon + settings.maxPolygon) * 0.5 - 2.0;
+  uint64_t estimatedFaces =
+      uint64_t(double(settings.triangleCount) / averageTriangles) + 1;
+  uint64_t width = uint64_t(std::ceil(std::sqrt(double(estimatedFaces))));
+  float spacing = 100.0f / float(width);
+
+  uint32_t currentMaterial = UINT32_MAX;
+  uint64_t vertexIndex = 1;
+  for (uint64_t face = 0; stats.triangleCount < settings.triangleCount;
+       ++face) {
+    uint32_t material = uint32_t(
+        std::min(face, estimatedFaces - 1) * settings.materialCount /
+        estimatedFaces);
+    if (material != currentMaterial) {
+      WriteUseMaterial(writer, material);
+      currentMaterial = material;
+    }
+
+    uint32_t sides =
+        random.NextRange(settings.minPolygon, settings.maxPolygon);
+    float centerX = (float(face % width) - width * 0.5f + 0.5f) * spacing;
+    float centerZ = (float(face / width) - width * 0.5f + 0.5f) * spacing;
+    float radius = spacing * 0.45f;
+
+    for (uint32_t k = 0; k < sides; ++k) {
+      float angle =
+          2.0f * kPi * (float(k) + (random.NextFloat() - 0.5f) * 0.3f) / sides;
+      float r = radius;
+      if (settings.isConcave && sides >= 4 && (k % 2) == 1) {
+        r *= 0.4f;
+      }
+      float u = 0.5f + 0.5f * std::cos(angle) * (r / radius);
+      float v = 0.5f + 0.5f * std::sin(angle) * (r / radius);
+      WriteVertex(writer, settings, centerX + std::cos(angle) * r,
+                  centerZ + std::sin(angle) * r, u, v);
+    }
+
+    writer.Write("f");
+    for (uint32_t k = 0; k < sides; ++k) {
+      WriteFaceIndex(writer, settings, vertexIndex + k);
+    }
+    writer.Write("\n");
+
+    vertexIndex += sides;
+    stats.faceCount += 1;
+    stats.triangleCount += sides - 2;
+  }
+  stats.vertexCount = vertexIndex - 1;
+}
+
+bool GenerateObj(const std::string &path, const ObjSettings &settings,
+                 ObjStats &stats) {
+  std::filesystem::path objPath(path);
+  std::filesystem::path mtlPath = objPath;
+  mtlPath.replace_extension(".mtl");
+
+  if (!GenerateMtl(mtlPath.string(), settings.materialCount)) {
+    return false;
+  }
+
+  FileWriter writer(path);
+  if (!writer.IsOpen()) {
+    return false;
+  }
+  writer.Write("# generated by AssetTool\nmtllib ");
+  writer.Write(mtlPath.filename().string());
+  writer.Write("\n");
+
+  if (settings.minPolygon == settings.maxPolygon && settings.maxPolygon <= 4 &&
+      !settings.isConcave) {
+    GenerateGrid(writer, settings, stats);
+  } else {
+    GeneratePolygons(writer, settings, stats);
+  }
+
+  stats.bytes = writer.GetBytesWritten();
+  return true;
+}
+
+#pragma endregion
+
+#pragma region WAV
+
+enum class SampleFormat { Pcm8, Pcm16, Pcm24, Pcm32, Float32 };
+
+struct WavSettings {
+  double seconds = 1.0;
+  uint32_t sampleRate = 48000;
+  uint16_t channels = 2;
+  SampleFormat format = SampleFormat::Pcm16;
+  // dataの前に余計なチャンクを入れる(エディタが書き出すファイルの再現)
+  bool hasJunk = false;
+  bool hasList = false;
+  bool hasFact = false;
+  // fmtをWAVE_FORMAT_EXTENSIBLEで書く
+  bool isExtensible = false;
+  uint64_t seed = 1;
+};
+
+bool ParseSampleFormat(const std::string &name, SampleFormat &format) {
+  const struct {
+    const char *name;
+    SampleFormat format;
+  } kFormats[] = {{"pcm8", SampleFormat::Pcm8},
+                  {"pcm16", SampleFormat::Pcm16},
+                  {"pcm24", SampleFormat::Pcm24},
+                  {"pcm32", SampleFormat::Pcm32},
+                  {"float32", SampleFormat::Float32}};
+  for (const auto &entry : kFormats) {
+    if (name == entry.name) {
+      format = entry.format;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t GetBitsPerSample(SampleFormat format) {
+  switch (format) {
+  case SampleFormat::Pcm8:
+    return 8;
+  case SampleFormat::Pcm16:
+    return 16;
+  case SampleFormat::Pcm24:
+    return 24;
+  default:
+    return 32;
+  }
+}
+
+void WriteChunkHeader(FileWriter &writer, const char *id, uint32_t size) {
+  writer.Write(id, 4);
+  writer.WriteValue(size);
+}
+
+void WriteSample(FileWriter &writer, SampleFormat format, float sample) {
+  sample = std::fmax(-1.0f, std::fmin(1.0f, sample));
+  switch (format) {
+  case SampleFormat::Pcm8:
+    writer.WriteValue(uint8_t(std::lround(sample * 127.0f) + 128));
+    break;
+  case SampleFormat::Pcm16:
+    writer.WriteValue(int16_t(std::lround(sample * 32767.0f)));
+    break;
+  case SampleFormat::Pcm24: {
+    int32_t value = int32_t(std::lround(sample * 8388607.0f));
+    uint8_t bytes[3] = {uint8_t(value), uint8_t(value >> 8),
+                        uint8_t(value >> 16)};
+    writer.Write(bytes, 3);
+    break;
+  }
+  case SampleFormat::Pcm32:
+    writer.WriteValue(int32_t(std::llround(double(sample) * 2147483647.0)));
+    break;
+  case SampleFormat::Float32:
+    writer.WriteValue(sample);
+    break;
+  }
+}
+
+bool GenerateWav(const std::string &path, const WavSettings &settings,
+                 uint64_t &bytes) {
+  const uint16_t bitsPerSample = GetBitsPerSample(settings.format);
+  const uint16_t blockAlign = uint16_t(settings.channels * bitsPerSample / 8);
+  const uint64_t frameCount =
+      uint64_t(settings.seconds * double(settings.sampleRate));
+  const uint64_t dataSize = frameCount * blockAlign;
+
+  const uint16_t formatTag =
+      settings.format == SampleFormat::Float32 ? 3 : 1;
+  const uint32_t fmtSize = settings.isExtensible ? 40 : 16;
+  const char kListInfo[] = "INFOISFT\x0A\0\0\0AssetTool\0";
+  const uint32_t listSize = sizeof(kListInfo) - 1;
+
+  uint64_t riffSize = 4 + 8 + fmtSize + 8 + dataSize + (dataSize & 1);
+  if (settings.hasJunk) {
+    riffSize += 8 + 28;
+  }
+  if (settings.hasList) {
+    riffSize += 8 + listSize;
+  }
+  if (settings.hasFact) {
+    riffSize += 8 + 4;
+  }
+  if (riffSize > UINT32_MAX) {
+    std::printf("wav too large for RIFF (%llu bytes)\n",
+                (unsigned long long)riffSize);
+    return false;
+  }
+
+  FileWriter writer(path);
+  if (!writer.IsOpen()) {
+    return false;
+  }
+
+  WriteChunkHeader(writer, "RIFF", uint32_t(riffSize));
+  writer.Write("WAVE", 4);
+
+  if (settings.hasJunk) {
+    // 一部のエディタはヘッダーの拡張用にJUNKを先頭に置く
+    WriteChunkHeader(writer, "JUNK", 28);
+    const char zero[28] = {};
+    writer.Write(zero, sizeof(zero));
+  }
+
+  WriteChunkHeader(writer, "fmt ", fmtSize);
+  writer.WriteValue(uint16_t(settings.isExtensible ? 0xFFFE : formatTag));
+  writer.WriteValue(settings.channels);
+  writer.WriteValue(settings.sampleRate);
+  writer.WriteValue(uint32_t(settings.sampleRate * blockAlign));
+  writer.WriteValue(blockAlign);
+  writer.WriteValue(bitsPerSample);
+  if (settings.isExtensible) {
+    // cbSize, wValidBitsPerSample, dwChannelMask, SubFormat
+    writer.WriteValue(uint16_t(22));
+    writer.WriteValue(bitsPerSample);
+    const uint32_t kChannelMasks[] = {0x4, 0x3, 0x7, 0x33, 0x37, 0x3F};
+    writer.WriteValue(settings.channels <= 6
+                          ? kChannelMasks[settings.channels - 1]
+                          : uint32_t(0));
+    const uint8_t kGuidTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                   0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+    writer.WriteValue(formatTag);
+    writer.Write(kGuidTail, sizeof(kGuidTail));
+  }
+
+  if (settings.hasFact) {
+    WriteChunkHeader(writer, "fact", 4);
+    writer.WriteValue(uint32_t(frameCount));
+  }
+  if (settings.hasList) {
+    WriteChunkHeader(writer, "LIST", listSize);
+    writer.Write(kListInfo, listSize);
+  }
+
+  WriteChunkHeader(writer, "data", uint32_t(dataSize));
+
+  // チャンネルごとに周波数の違う正弦波に少しノイズを乗せる
+  Random random(settings.seed);
+  for (uint64_t frame = 0; frame < frameCount; ++frame) {
+    double t = double(frame) / settings.sampleRate;
+    for (uint16_t channel = 0; channel < settings.channels; ++channel) {
+      double frequency = 220.0 * (channel + 1) + 40.0 * std::sin(t * 0.5);
+      float sample = 0.5f * float(std::sin(2.0 * 3.141592653589793 *
+                                           frequency * t)) +
+                     0.05f * (random.NextFloat() * 2.0f - 1.0f);
+      WriteSample(writer, settings.format, sample);
+    }
+  }
+  if (dataSize & 1) {
+    // チャンクは2バイト境界に揃える
+    writer.WriteValue(uint8_t(0));
+  }
+
+  bytes = writer.GetBytesWritten();
+  return true;
+}
+
+#pragma endregion
+
+#pragma region コマンド
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool generate obj --output <file.obj> [--triangles N]\n"
+      "      [--polygon K | --polygon MIN-MAX] [--concave]\n"
+      "      [--no-texcoords] [--no-normals] [--materials N] [--seed N]\n"
+      "  AssetTool generate wav --output <file.wav> [--seconds S]\n"
+      "      [--rate HZ] [--channels N]\n"
+      "      [--format pcm8|pcm16|pcm24|pcm32|float32]\n"
+      "      [--junk] [--list] [--fact] [--extensible] [--seed N]\n"
+      "  AssetTool generate corpus --output <directory>\n"
+      "      [--scale small|medium|large|huge]\n");
+}
+
+// 10進の数だけからなるときに読む
+bool ParseUInt32(std::string_view text, uint32_t &value) {
+  const char *end = text.data() + text.size();
+  auto result = std::from_chars(text.data(), end, value);
+  return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+// "K" か "MIN-MAX" を読む
+bool ParsePolygonRange(std::string_view text, uint32_t &minPolygon,
+                       uint32_t &maxPolygon) {
+  size_t dash = text.find('-');
+  if (!ParseUInt32(text.substr(0, dash), minPolygon)) {
+    return false;
+  }
+  if (dash == std::string_view::npos) {
+    maxPolygon = minPolygon;
+    return true;
+  }
+  return ParseUInt32(text.substr(dash + 1), maxPolygon);
+}
+
+bool ParseObjSettings(const CommandLine &commandLine, ObjSettings &settings) {
+  settings.triangleCount =
+      commandLine.GetUInt("--triangles", settings.triangleCount);
+  const std::string polygon = commandLine.GetString("--polygon", "3");
+  if (!ParsePolygonRange(polygon, settings.minPolygon, settings.maxPolygon)) {
+    std::printf("invalid --polygon: %s\n\n", polygon.c_str());
+    PrintUsage();
+    return false;
+  }
+  settings.isConcave = commandLine.HasFlag("--concave");
+  settings.hasTexcoord = !commandLine.HasFlag("--no-texcoords");
+  settings.hasNormal = !commandLine.HasFlag("--no-normals");
+  settings.materialCount =
+      uint32_t(commandLine.GetUInt("--materials", settings.materialCount));
+  settings.seed = commandLine.GetUInt("--seed", settings.seed);
+
+  if (settings.minPolygon < 3 || settings.maxPolygon < settings.minPolygon ||
+      settings.materialCount == 0 || settings.triangleCount == 0) {
+    std::printf("invalid obj settings\n");
+    return false;
+  }
+  return true;
+}
+
+bool ParseWavSettings(const CommandLine &commandLine, WavSettings &settings) {
+  settings.seconds = commandLine.GetDouble("--seconds", settings.seconds);
+  settings.sampleRate =
+      uint32_t(commandLine.GetUInt("--rate", settings.sampleRate));
+  settings.channels =
+      uint16_t(commandLine.GetUInt("--channels", settings.channels));
+  settings.hasJunk = commandLine.HasFlag("--junk");
+  settings.hasList = commandLine.HasFlag("--list");
+  settings.hasFact = commandLine.HasFlag("--fact");
+  settings.isExtensible = commandLine.HasFlag("--extensible");
+  settings.seed = commandLine.GetUInt("--seed", settings.seed);
+
+  if (!ParseSampleFormat(commandLine.GetString("--format", "pcm16"),
+                         settings.format) ||
+      settings.channels == 0 || settings.sampleRate == 0) {
+    std::printf("invalid wav settings\n");
+    return false;
+  }
+  return true;
+}
+
+bool RunObj(const std::string &path, const ObjSettings &settings) {
+  ObjStats stats;
+  if (!GenerateObj(path, settings, stats)) {
+    std::printf("failed to write %s\n", path.c_str());
+    return false;
+  }
+  std::printf("%s: %llu triangles, %llu faces, %llu vertices, %.1f MB\n",
+              path.c_str(), (unsigned long long)stats.triangleCount,
+              (unsigned long long)stats.faceCount,
+              (unsigned long long)stats.vertexCount, stats.bytes / 1048576.0);
+  return true;
+}
+
+bool RunWav(const std::string &path, const WavSettings &settings) {
+  uint64_t bytes = 0;
+  if (!GenerateWav(path, settings, bytes)) {
+    std::printf("failed to write %s\n", path.c_str());
+    return false;
+  }
+  std::printf("%s: %.1f s, %u Hz, %u ch, %.1f MB\n", path.c_str(),
+              settings.seconds, settings.sampleRate, settings.channels,
+              bytes / 1048576.0);
+  return true;
+}
+
+// 決まった組み合わせのファイル一式を作る。scaleが大きいほど大きいファイルを含む
+int GenerateCorpus(const std::string &directory, const std::string &scaleName) {
+  const char *kScales[] = {"small", "medium", "large", "huge"};
+  int scale = -1;
+  for (int i = 0; i < 4; ++i) {
+    if (scaleName == kScales[i]) {
+      scale = i;
+    }
+  }
+  if (scale < 0) {
+    std::printf("unknown scale: %s\n", scaleName.c_str());
+    return 1;
+  }
+
+  std::filesystem::create_directories(directory);
+
+  const struct {
+    const char *name;
+    int scale;
+    uint64_t triangleCount;
+    uint32_t minPolygon;
+    uint32_t maxPolygon;
+    uint32_t materialCount;
+    bool hasTexcoord;
+    bool hasNormal;
+    bool isConcave;
+  } kObjs[] = {
+      {"tri_10k", 0, 10000, 3, 3, 1, true, true, false},
+      {"tri_100k", 0, 100000, 3, 3, 4, true, true, false},
+      {"quad_100k", 0, 100000, 4, 4, 4, true, true, false},
+      {"ngon_100k", 0, 100000, 3, 8, 4, true, true, false},
+      {"concave_100k", 0, 100000, 4, 10, 4, true, true, true},
+      {"position_only_100k", 0, 100000, 4, 4, 1, false, false, false},
+      {"tri_1m", 1, 1000000, 3, 3, 8, true, true, false},
+      {"quad_1m", 1, 1000000, 4, 4, 8, true, true, false},
+      {"ngon_1m", 1, 1000000, 3, 8, 8, true, true, false},
+      {"tri_10m", 2, 10000000, 3, 3, 16, true, true, false},
+      {"quad_10m", 2, 10000000, 4, 4, 16, true, true, false},
+      {"tri_100m", 3, 100000000, 3, 3, 16, true, true, false},
+      {"quad_300m", 3, 300000000, 4, 4, 16, true, true, false},
+  };
+
+  const struct {
+    const char *name;
+    int scale;
+    double seconds;
+    uint32_t sampleRate;
+    uint16_t channels;
+    SampleFormat format;
+  } kWavs[] = {
+      {"sfx_pcm16_mono_1s", 0, 1.0, 44100, 1, SampleFormat::Pcm16},
+      {"sfx_pcm8_mono_1s", 0, 1.0, 22050, 1, SampleFormat::Pcm8},
+      {"sfx_float32_stereo_2s", 0, 2.0, 48000, 2, SampleFormat::Float32},
+      {"music_pcm16_stereo_180s", 1, 180.0, 44100, 2, SampleFormat::Pcm16},
+      {"music_pcm24_stereo_180s", 1, 180.0, 48000, 2, SampleFormat::Pcm24},
+      {"ambience_pcm16_6ch_600s", 2, 600.0, 48000, 6, SampleFormat::Pcm16},
+      {"long_float32_stereo_3600s", 3, 3600.0, 48000, 2,
+       SampleFormat::Float32},
+  };
+
+  for (const auto &obj : kObjs) {
+    if (obj.scale > scale) {
+      continue;
+    }
+    ObjSettings settings;
+    settings.triangleCount = obj.triangleCount;
+    settings.minPolygon = obj.minPolygon;
+    settings.maxPolygon = obj.maxPolygon;
+    settings.materialCount = obj.materialCount;
+    settings.hasTexcoord = obj.hasTexcoord;
+    settings.hasNormal = obj.hasNormal;
+    settings.isConcave = obj.isConcave;
+    std::string path = (std::filesystem::path(directory) /
+                        (std::string(obj.name) + ".obj"))
+                           .string();
+    if (!RunObj(path, settings)) {
+      return 1;
+    }
+  }
+
+  for (const auto &wav : kWavs) {
+    if (wav.scale > scale) {
+      continue;
+    }
+    WavSettings settings;
+    settings.seconds = wav.seconds;
+    settings.sampleRate = wav.sampleRate;
+    settings.channels = wav.channels;
+    settings.format = wav.format;
+    std::string path = (std::filesystem::path(directory) /
+                        (std::string(wav.name) + ".wav"))
+                           .string();
+    if (!RunWav(path, settings)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#pragma endregion
+
+} // namespace
+
+int GenerateCommand(const std::vector<std::string> &args) {
+  if (args.empty()) {
+    PrintUsage();
+    return 1;
+  }
+
+  CommandLine commandLine(args);
+  std::string output = commandLine.GetString("--output");
+  if (output.empty()) {
+    PrintUsage();
+    return 1;
+  }
+
+  if (args[0] == "obj") {
+    ObjSettings settings;
+    if (!ParseObjSettings(commandLine, settings)) {
+      return 1;
+    }
+    return RunObj(output, settings) ? 0 : 1;
+  }
+  if (args[0] == "wav") {
+    WavSettings settings;
+    if (!ParseWavSettings(commandLine, settings)) {
+      return 1;
+    }
+    return RunWav(output, settings) ? 0 : 1;
+  }
+  if (args[0] == "corpus") {
+    return GenerateCorpus(output, commandLine.GetString("--scale", "small"));
+  }
+
+  PrintUsage();
+  return 1;
+}
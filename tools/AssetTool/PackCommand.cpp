@@ -0,0 +1,295 @@
+#include "../../LzCompression.h"
+#include "../../MappedFile.h"
+#include "../../PackFile.h"
+#include "../../VirtualFileSystem.h"
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct PackSettings {
+  std::vector<std::string> inputs;
+  std::string output;
+  // パック内の名前はこのディレクトリからの相対パスになる
+  std::string base = ".";
+  bool isCompressed = false;
+  uint32_t blockSize = 64 * 1024;
+  uint32_t alignment = 64;
+  bool isVerified = false;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool pack --output <file.pak> --input <dir|file>\n"
+      "      [--input <dir|file> ...] [--base <dir>] [--compress]\n"
+      "      [--block-size N] [--alignment N] [--verify]\n"
+      "\n"
+      "  Entries are named by their path relative to --base (default: the\n"
+      "  current directory), e.g. --input resource gives resource/axis.obj.\n");
+}
+
+// 名前 -> 元のファイル。同じファイルが何度指定されても一つにまとめる
+bool CollectFiles(const PackSettings &settings,
+                  std::map<std::string, std::filesystem::path> &files) {
+  std::error_code ec;
+  const std::filesystem::path output =
+      std::filesystem::weakly_canonical(settings.output, ec);
+
+  auto add = [&](const std::filesystem::path &path) {
+    if (std::filesystem::weakly_canonical(path, ec) == output) {
+      return;
+    }
+    std::filesystem::path relative =
+        std::filesystem::relative(path, settings.base, ec);
+    if (ec || relative.empty()) {
+      relative = path;
+    }
+    files[VirtualFileSystem::NormalizePath(relative.generic_string())] = path;
+  };
+
+  for (const std::string &input : settings.inputs) {
+    if (std::filesystem::is_directory(input, ec)) {
+      for (const auto &entry :
+           std::filesystem::recursive_directory_iterator(input, ec)) {
+        if (entry.is_regular_file(ec)) {
+          add(entry.path());
+        }
+      }
+    } else if (std::filesystem::is_regular_file(input, ec)) {
+      add(input);
+    } else {
+      std::printf("not found: %s\n", input.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+class PackWriter {
+public:
+  explicit PackWriter(const std::string &path) {
+    file_ = std::fopen(path.c_str(), "wb");
+  }
+  ~PackWriter() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  bool IsOpen() const { return file_ != nullptr; }
+  uint64_t GetOffset() const { return offset_; }
+
+  void Write(const void *data, size_t size) {
+    std::fwrite(data, 1, size, file_);
+    offset_ += size;
+  }
+
+  void Align(uint64_t alignment) {
+    static const uint8_t kZeros[256] = {};
+    while (offset_ % alignment != 0) {
+      Write(kZeros, size_t(std::min<uint64_t>(
+                        alignment - offset_ % alignment, sizeof(kZeros))));
+    }
+  }
+
+  // 最後にヘッダーを書き直す
+  void WriteHeader(const PackHeader &header) {
+    std::fseek(file_, 0, SEEK_SET);
+    std::fwrite(&header, 1, sizeof(header), file_);
+  }
+
+  bool Close() {
+    bool isSucceeded = std::ferror(file_) == 0;
+    isSucceeded = std::fclose(file_) == 0 && isSucceeded;
+    file_ = nullptr;
+    return isSucceeded;
+  }
+
+private:
+  FILE *file_ = nullptr;
+  uint64_t offset_ = 0;
+};
+
+// ブロックごとに圧縮する。縮まなかったブロックはそのまま入れる
+// 全体で縮まなければfalseを返し、呼び出し側は圧縮せずに格納する
+bool CompressEntry(const uint8_t *data, uint64_t size, uint32_t blockSize,
+                   std::vector<uint8_t> &stored, uint32_t &blockCount) {
+  blockCount = uint32_t((size + blockSize - 1) / blockSize);
+  stored.assign(size_t(blockCount) * sizeof(uint32_t), 0);
+
+  std::vector<uint8_t> compressed;
+  for (uint32_t i = 0; i < blockCount; ++i) {
+    const uint64_t offset = uint64_t(i) * blockSize;
+    const size_t rawSize = size_t(std::min<uint64_t>(blockSize, size - offset));
+
+    compressed.clear();
+    uint32_t storedSize = uint32_t(LzCompress(data + offset, rawSize,
+                                              compressed));
+    if (storedSize >= rawSize) {
+      storedSize = uint32_t(rawSize);
+      stored.insert(stored.end(), data + offset, data + offset + rawSize);
+    } else {
+      stored.insert(stored.end(), compressed.begin(), compressed.end());
+    }
+    std::memcpy(stored.data() + i * sizeof(uint32_t), &storedSize,
+                sizeof(storedSize));
+  }
+  return stored.size() < size;
+}
+
+bool WritePack(const PackSettings &settings,
+               const std::map<std::string, std::filesystem::path> &files) {
+  PackWriter writer(settings.output);
+  if (!writer.IsOpen()) {
+    std::printf("failed to open %s\n", settings.output.c_str());
+    return false;
+  }
+
+  PackHeader header{};
+  writer.Write(&header, sizeof(header));
+
+  std::vector<PackEntry> entries;
+  std::string names;
+  uint64_t totalSize = 0;
+  uint64_t totalStored = 0;
+  std::vector<uint8_t> stored;
+
+  for (const auto &[name, path] : files) {
+    // 空のファイルはマップできないので、サイズ0のエントリにする
+    MappedFile source;
+    std::error_code ec;
+    if (!source.Open(path.string()) &&
+        std::filesystem::file_size(path, ec) != 0) {
+      std::printf("failed to read %s\n", path.string().c_str());
+      return false;
+    }
+
+    PackEntry entry{};
+    entry.nameHash = HashPackName(name);
+    entry.nameOffset = uint32_t(names.size());
+    entry.nameLength = uint32_t(name.size());
+    entry.size = source.GetSize();
+    names += name;
+
+    writer.Align(settings.alignment);
+    entry.dataOffset = writer.GetOffset();
+
+    uint32_t blockCount = 0;
+    if (settings.isCompressed && entry.size > 0 &&
+        CompressEntry(source.GetData(), entry.size, settings.blockSize,
+                      stored, blockCount)) {
+      entry.flags |= kPackEntryCompressed;
+      entry.blockCount = blockCount;
+      entry.storedSize = stored.size();
+      writer.Write(stored.data(), stored.size());
+    } else {
+      entry.storedSize = entry.size;
+      writer.Write(source.GetData(), size_t(entry.size));
+    }
+
+    totalSize += entry.size;
+    totalStored += entry.storedSize;
+    entries.push_back(entry);
+  }
+
+  // 読み込み側はハッシュで二分探索する
+  std::sort(entries.begin(), entries.end(),
+            [](const PackEntry &a, const PackEntry &b) {
+              return a.nameHash < b.nameHash;
+            });
+
+  writer.Align(alignof(PackEntry));
+  std::memcpy(header.magic, kPackMagic, sizeof(kPackMagic));
+  header.version = kPackVersion;
+  header.entryCount = uint32_t(entries.size());
+  header.blockSize = settings.blockSize;
+  header.entryOffset = writer.GetOffset();
+  writer.Write(entries.data(), entries.size() * sizeof(PackEntry));
+  header.nameOffset = writer.GetOffset();
+  writer.Write(names.data(), names.size());
+  const uint64_t packSize = writer.GetOffset();
+  writer.WriteHeader(header);
+
+  if (!writer.Close()) {
+    std::printf("failed to write %s\n", settings.output.c_str());
+    return false;
+  }
+
+  std::printf("%s: %zu files, %.2f MB -> %.2f MB data, %.2f MB pack\n",
+              settings.output.c_str(), entries.size(), totalSize / 1048576.0,
+              totalStored / 1048576.0, packSize / 1048576.0);
+  return true;
+}
+
+// 書き出したパックを読み直し、元のファイルと同じ内容か確かめる
+bool VerifyPack(const PackSettings &settings,
+                const std::map<std::string, std::filesystem::path> &files) {
+  PackFile pack;
+  if (!pack.Open(settings.output)) {
+    std::printf("verify: failed to open %s\n", settings.output.c_str());
+    return false;
+  }
+
+  for (const auto &[name, path] : files) {
+    MappedFile source;
+    source.Open(path.string());
+    FileData data = pack.Read(name);
+    if (!data.IsValid() || data.size != source.GetSize() ||
+        (data.size > 0 &&
+         std::memcmp(data.data, source.GetData(), data.size) != 0)) {
+      std::printf("verify: mismatch %s\n", name.c_str());
+      return false;
+    }
+  }
+  std::printf("verify: %zu files OK\n", files.size());
+  return true;
+}
+
+} // namespace
+
+int PackCommand(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  PackSettings settings;
+  settings.inputs = commandLine.GetStrings("--input");
+  settings.output = commandLine.GetString("--output");
+  settings.base = commandLine.GetString("--base", settings.base);
+  settings.isCompressed = commandLine.HasFlag("--compress");
+  settings.blockSize =
+      uint32_t(commandLine.GetUInt("--block-size", settings.blockSize));
+  settings.alignment =
+      uint32_t(commandLine.GetUInt("--alignment", settings.alignment));
+  settings.isVerified = commandLine.HasFlag("--verify");
+
+  if (settings.inputs.empty() || settings.output.empty()) {
+    PrintUsage();
+    return 1;
+  }
+  // エントリの表を直接参照できるよう、8の倍数の2のべき乗に限る
+  if (settings.alignment < alignof(PackEntry) ||
+      (settings.alignment & (settings.alignment - 1)) != 0 ||
+      settings.blockSize == 0) {
+    std::printf("--alignment must be a power of two >= %zu\n",
+                alignof(PackEntry));
+    return 1;
+  }
+
+  std::map<std::string, std::filesystem::path> files;
+  if (!CollectFiles(settings, files)) {
+    return 1;
+  }
+  if (!WritePack(settings, files)) {
+    return 1;
+  }
+  if (settings.isVerified && !VerifyPack(settings, files)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,242 @@
+#include "../../MappedFile.h"
+#include "../../PcmConvert.h"
+#include "../../Resampler.h"
+#include "../../RiffReader.h"
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct ResampleSettings {
+  std::string input;
+  std::string output;
+  uint32_t sampleRate = 48000;
+  // 0なら元のチャンネル数のまま
+  uint32_t channels = 0;
+  ResamplerQuality quality = ResamplerQuality::High;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool resample --input <file.wav|dir> --output <file.wav|dir>\n"
+      "      [--rate Hz] [--channels N] [--quality low|medium|high]\n"
+      "\n"
+      "  Converts 8/16/24/32-bit PCM and 32-bit float WAV files to --rate\n"
+      "  (default 48000) so the mixer does not resample them at runtime.\n"
+      "  --channels up/down-mixes by speaker layout (e.g. 6 -> 2 folds 5.1\n"
+      "  into stereo). With a directory, every .wav below it is written to\n"
+      "  the same relative path under --output; files that need no change\n"
+      "  are copied as they are.\n");
+}
+
+bool ParseQuality(const std::string &name, ResamplerQuality &quality) {
+  for (ResamplerQuality candidate :
+       {ResamplerQuality::Low, ResamplerQuality::Medium,
+        ResamplerQuality::High}) {
+    if (name == GetResamplerQualityName(candidate)) {
+      quality = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void WriteU16(std::FILE *file, uint16_t value) {
+  const uint8_t bytes[2] = {uint8_t(value), uint8_t(value >> 8)};
+  std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+void WriteU32(std::FILE *file, uint32_t value) {
+  const uint8_t bytes[4] = {uint8_t(value), uint8_t(value >> 8),
+                            uint8_t(value >> 16), uint8_t(value >> 24)};
+  std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+// 元のファイルと同じ形式(EXTENSIBLEならチャンネル配置も)で書き出す
+bool WriteWave(const std::string &path, const WaveFormat &format,
+               const std::vector<uint8_t> &samples) {
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  const uint32_t fmtSize = format.isExtensible ? 40 : 16;
+  const uint32_t dataSize = uint32_t(samples.size());
+  std::fwrite("RIFF", 1, 4, file);
+  WriteU32(file, 4 + 8 + fmtSize + 8 + dataSize + (dataSize & 1));
+  std::fwrite("WAVE", 1, 4, file);
+  std::fwrite("fmt ", 1, 4, file);
+  WriteU32(file, fmtSize);
+  WriteU16(file, format.isExtensible ? kWaveFormatExtensible
+                                     : format.formatTag);
+  WriteU16(file, format.channels);
+  WriteU32(file, format.samplesPerSec);
+  WriteU32(file, format.samplesPerSec * format.blockAlign);
+  WriteU16(file, format.blockAlign);
+  WriteU16(file, format.bitsPerSample);
+  if (format.isExtensible) {
+    const uint8_t kGuidTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                   0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+    WriteU16(file, 22);
+    WriteU16(file, format.validBitsPerSample);
+    WriteU32(file, format.channelMask);
+    WriteU16(file, format.formatTag);
+    std::fwrite(kGuidTail, 1, sizeof(kGuidTail), file);
+  }
+  std::fwrite("data", 1, 4, file);
+  WriteU32(file, dataSize);
+  std::fwrite(samples.data(), 1, samples.size(), file);
+  if (dataSize & 1) {
+    std::fputc(0, file);
+  }
+  return std::fclose(file) == 0;
+}
+
+bool ResampleFile(const std::filesystem::path &inputPath,
+                  const std::filesystem::path &outputPath,
+                  const ResampleSettings &settings) {
+  MappedFile mappedFile;
+  WaveFile wave;
+  std::string error;
+  if (!mappedFile.Open(inputPath.string()) ||
+      !ParseWave(mappedFile.GetData(), mappedFile.GetSize(), wave, &error)) {
+    std::printf("%s: failed to load (%s)\n", inputPath.string().c_str(),
+                error.empty() ? "cannot open" : error.c_str());
+    return false;
+  }
+
+  WaveFormat format = wave.format;
+  PcmFormat pcmFormat = PcmFormat::Int16;
+  if (!GetPcmFormat(format.formatTag, format.bitsPerSample, pcmFormat) ||
+      format.channels > kMaxPcmChannels) {
+    std::printf("%s: unsupported sample format (0x%04x, %u bit, %u ch)\n",
+                inputPath.string().c_str(), format.formatTag,
+                format.bitsPerSample, format.channels);
+    return false;
+  }
+  const uint32_t channels = format.channels;
+  const uint32_t outputChannels =
+      settings.channels != 0 ? settings.channels : channels;
+
+  std::error_code ec;
+  std::filesystem::create_directories(outputPath.parent_path(), ec);
+  if (format.samplesPerSec == settings.sampleRate &&
+      outputChannels == channels) {
+    std::filesystem::copy_file(
+        inputPath, outputPath,
+        std::filesystem::copy_options::overwrite_existing, ec);
+    std::printf("%s: already %u Hz, copied\n", inputPath.string().c_str(),
+                settings.sampleRate);
+    return !ec;
+  }
+
+  // チャンネルごとのfloatに分ける
+  const uint32_t frameCount = wave.sampleBytes / format.blockAlign;
+  std::vector<float> interleaved(size_t(frameCount) * channels);
+  ConvertPcmToFloat(pcmFormat, wave.samples, interleaved.data(),
+                    interleaved.size());
+  std::vector<std::vector<float>> input(channels,
+                                        std::vector<float>(frameCount));
+  std::vector<float *> inputPointers;
+  for (std::vector<float> &samples : input) {
+    inputPointers.push_back(samples.data());
+  }
+  DeinterleaveSamples(interleaved.data(), channels, inputPointers.data(),
+                      frameCount);
+
+  // リサンプルより先にチャンネル数を変える(ダウンミックスなら処理が減る)
+  if (outputChannels != channels) {
+    const ChannelMatrix matrix =
+        BuildChannelMatrix(channels, format.channelMask, outputChannels, 0);
+    std::vector<std::vector<float>> mixed(outputChannels,
+                                          std::vector<float>(frameCount));
+    std::vector<float *> mixedPointers;
+    for (std::vector<float> &samples : mixed) {
+      mixedPointers.push_back(samples.data());
+    }
+    std::vector<const float *> sources(inputPointers.begin(),
+                                       inputPointers.end());
+    MixChannels(matrix, sources.data(), mixedPointers.data(), frameCount);
+    input = std::move(mixed);
+
+    format.channels = uint16_t(outputChannels);
+    format.blockAlign = uint16_t(outputChannels * (format.bitsPerSample / 8));
+    format.channelMask = GetDefaultChannelMask(outputChannels);
+    format.validBitsPerSample = format.bitsPerSample;
+    format.isExtensible = outputChannels > 2;
+  }
+
+  const std::vector<std::vector<float>> output =
+      format.samplesPerSec == settings.sampleRate
+          ? std::move(input)
+          : ResampleBuffer(input, format.samplesPerSec, settings.sampleRate,
+                           settings.quality);
+  const size_t outputFrames = output.empty() ? 0 : output[0].size();
+
+  std::vector<const float *> outputPointers;
+  for (const std::vector<float> &samples : output) {
+    outputPointers.push_back(samples.data());
+  }
+  interleaved.resize(outputFrames * outputChannels);
+  InterleaveSamples(outputPointers.data(), outputChannels, interleaved.data(),
+                    outputFrames);
+  std::vector<uint8_t> samples(outputFrames * format.blockAlign);
+  ConvertFloatToPcm(pcmFormat, interleaved.data(), samples.data(),
+                    interleaved.size());
+
+  format.samplesPerSec = settings.sampleRate;
+  if (!WriteWave(outputPath.string(), format, samples)) {
+    std::printf("%s: failed to write\n", outputPath.string().c_str());
+    return false;
+  }
+  std::printf("%s: %u Hz %u ch -> %u Hz %u ch (%u -> %zu frames)\n",
+              inputPath.string().c_str(), wave.format.samplesPerSec, channels,
+              settings.sampleRate, outputChannels, frameCount, outputFrames);
+  return true;
+}
+
+} // namespace
+
+int ResampleCommand(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  ResampleSettings settings;
+  settings.input = commandLine.GetString("--input");
+  settings.output = commandLine.GetString("--output");
+  settings.sampleRate =
+      uint32_t(commandLine.GetUInt("--rate", settings.sampleRate));
+  settings.channels = uint32_t(commandLine.GetUInt("--channels", 0));
+  const std::string quality = commandLine.GetString("--quality", "high");
+
+  if (settings.input.empty() || settings.output.empty() ||
+      settings.sampleRate == 0 || settings.channels > kMaxPcmChannels ||
+      !ParseQuality(quality, settings.quality)) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::error_code ec;
+  if (!std::filesystem::is_directory(settings.input, ec)) {
+    return ResampleFile(settings.input, settings.output, settings) ? 0 : 1;
+  }
+
+  bool isSucceeded = true;
+  for (const auto &entry :
+       std::filesystem::recursive_directory_iterator(settings.input, ec)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".wav") {
+      continue;
+    }
+    const std::filesystem::path relative =
+        std::filesystem::relative(entry.path(), settings.input, ec);
+    isSucceeded &= ResampleFile(
+        entry.path(), std::filesystem::path(settings.output) / relative,
+        settings);
+  }
+  return isSucceeded ? 0 : 1;
+}
@@ -0,0 +1,427 @@
+#include "../../Adpcm.h"
+#include "../../MappedFile.h"
+#include "../../PackFile.h"
+#include "../../PcmConvert.h"
+#include "../../Resampler.h"
+#include "../../RiffReader.h"
+#include "../../SoundBank.h"
+#include "../../VirtualFileSystem.h"
+#include "../CommandLine.h"
+#include "AssetTool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct SoundBankSettings {
+  std::vector<std::string> inputs;
+  std::string output;
+  // バンク内の名前はこのディレクトリからの相対パスになる
+  std::string base = ".";
+  // 0なら元のサンプルレートのまま
+  uint32_t sampleRate = 48000;
+  // 0なら元のチャンネル数のまま
+  uint32_t channels = 0;
+  bool isAdpcm = false;
+  // IMA ADPCMの1チャンネルあたりのブロックのバイト数
+  uint32_t blockBytes = 512;
+  ResamplerQuality quality = ResamplerQuality::High;
+  uint32_t alignment = 64;
+  bool isVerified = false;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage:\n"
+      "  AssetTool soundbank --output <file.bank> --input <dir|file.wav>\n"
+      "      [--input <dir|file.wav> ...] [--base <dir>] [--rate Hz]\n"
+      "      [--channels N] [--format pcm16|ima] [--block-bytes N]\n"
+      "      [--quality low|medium|high] [--alignment N] [--verify]\n"
+      "\n"
+      "  Packs every .wav into one bank that the game maps with a single\n"
+      "  open. Sounds are converted to 16-bit PCM (or IMA ADPCM with\n"
+      "  --format ima) at --rate (default 48000, 0 keeps the source rate)\n"
+      "  and named by their path relative to --base, e.g. --input resource\n"
+      "  gives resource/chimes.wav.\n");
+}
+
+bool ParseQuality(const std::string &name, ResamplerQuality &quality) {
+  for (ResamplerQuality candidate :
+       {ResamplerQuality::Low, ResamplerQuality::Medium,
+        ResamplerQuality::High}) {
+    if (name == GetResamplerQualityName(candidate)) {
+      quality = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// 名前 -> 元のファイル。同じファイルが何度指定されても一つにまとめる
+bool CollectFiles(const SoundBankSettings &settings,
+                  std::map<std::string, std::filesystem::path> &files) {
+  std::error_code ec;
+  auto add = [&](const std::filesystem::path &path) {
+    std::filesystem::path relative =
+        std::filesystem::relative(path, settings.base, ec);
+    if (ec || relative.empty()) {
+      relative = path;
+    }
+    files[VirtualFileSystem::NormalizePath(relative.generic_string())] = path;
+  };
+
+  for (const std::string &input : settings.inputs) {
+    if (std::filesystem::is_directory(input, ec)) {
+      for (const auto &entry :
+           std::filesystem::recursive_directory_iterator(input, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".wav") {
+          add(entry.path());
+        }
+      }
+    } else if (std::filesystem::is_regular_file(input, ec)) {
+      add(input);
+    } else {
+      std::printf("not found: %s\n", input.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+class BankWriter {
+public:
+  explicit BankWriter(const std::string &path) {
+    file_ = std::fopen(path.c_str(), "wb");
+  }
+  ~BankWriter() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  bool IsOpen() const { return file_ != nullptr; }
+  uint64_t GetOffset() const { return offset_; }
+
+  void Write(const void *data, size_t size) {
+    std::fwrite(data, 1, size, file_);
+    offset_ += size;
+  }
+
+  void Align(uint64_t alignment) {
+    static const uint8_t kZeros[256] = {};
+    while (offset_ % alignment != 0) {
+      Write(kZeros, size_t(std::min<uint64_t>(
+                        alignment - offset_ % alignment, sizeof(kZeros))));
+    }
+  }
+
+  // 最後にヘッダーを書き直す
+  void WriteHeader(const SoundBankHeader &header) {
+    std::fseek(file_, 0, SEEK_SET);
+    std::fwrite(&header, 1, sizeof(header), file_);
+  }
+
+  bool Close() {
+    bool isSucceeded = std::ferror(file_) == 0;
+    isSucceeded = std::fclose(file_) == 0 && isSucceeded;
+    file_ = nullptr;
+    return isSucceeded;
+  }
+
+private:
+  FILE *file_ = nullptr;
+  uint64_t offset_ = 0;
+};
+
+// WAVを読んでチャンネルごとのfloatにする。ADPCMは一度16bitに展開する
+bool LoadPlanar(const std::filesystem::path &path, WaveFormat &format,
+                std::vector<std::vector<float>> &planes) {
+  MappedFile mappedFile;
+  WaveFile wave;
+  std::string error;
+  if (!mappedFile.Open(path.string()) ||
+      !ParseWave(mappedFile.GetData(), mappedFile.GetSize(), wave, &error)) {
+    std::printf("%s: failed to load (%s)\n", path.string().c_str(),
+                error.empty() ? "cannot open" : error.c_str());
+    return false;
+  }
+  format = wave.format;
+  if (format.channels == 0 || format.channels > kMaxPcmChannels) {
+    std::printf("%s: unsupported channel count %u\n", path.string().c_str(),
+                format.channels);
+    return false;
+  }
+
+  const uint32_t channels = format.channels;
+  std::vector<float> interleaved;
+  if (IsAdpcmFormatTag(format.formatTag)) {
+    AdpcmFormat adpcm;
+    if (!ParseAdpcmFormat(wave, adpcm, &error)) {
+      std::printf("%s: %s\n", path.string().c_str(), error.c_str());
+      return false;
+    }
+    const std::vector<int16_t> decoded =
+        DecodeAdpcm(adpcm, wave.samples, wave.sampleBytes);
+    interleaved.resize(decoded.size());
+    ConvertPcmToFloat(PcmFormat::Int16, decoded.data(), interleaved.data(),
+                      decoded.size());
+  } else {
+    PcmFormat pcmFormat = PcmFormat::Int16;
+    if (!GetPcmFormat(format.formatTag, format.bitsPerSample, pcmFormat)) {
+      std::printf("%s: unsupported sample format (0x%04x, %u bit)\n",
+                  path.string().c_str(), format.formatTag,
+                  format.bitsPerSample);
+      return false;
+    }
+    interleaved.resize(size_t(wave.sampleBytes / format.blockAlign) *
+                       channels);
+    ConvertPcmToFloat(pcmFormat, wave.samples, interleaved.data(),
+                      interleaved.size());
+  }
+
+  const size_t frameCount = interleaved.size() / channels;
+  planes.assign(channels, std::vector<float>(frameCount));
+  std::vector<float *> pointers;
+  for (std::vector<float> &plane : planes) {
+    pointers.push_back(plane.data());
+  }
+  DeinterleaveSamples(interleaved.data(), channels, pointers.data(),
+                      frameCount);
+  return true;
+}
+
+// チャンネル数とサンプルレートをそろえ、バンクに入れる形式に変換する
+bool ConvertSound(const std::filesystem::path &path,
+                  const SoundBankSettings &settings, SoundBankEntry &entry,
+                  std::vector<uint8_t> &data) {
+  WaveFormat format;
+  std::vector<std::vector<float>> planes;
+  if (!LoadPlanar(path, format, planes)) {
+    return false;
+  }
+  const uint32_t channels = format.channels;
+  const uint32_t outputChannels =
+      settings.channels != 0 ? settings.channels : channels;
+  const uint32_t outputRate =
+      settings.sampleRate != 0 ? settings.sampleRate : format.samplesPerSec;
+
+  // リサンプルより先にチャンネル数を変える(ダウンミックスなら処理が減る)
+  uint32_t channelMask = format.channelMask;
+  if (outputChannels != channels) {
+    const size_t frameCount = planes[0].size();
+    const ChannelMatrix matrix =
+        BuildChannelMatrix(channels, format.channelMask, outputChannels, 0);
+    std::vector<std::vector<float>> mixed(outputChannels,
+                                          std::vector<float>(frameCount));
+    std::vector<float *> mixedPointers;
+    for (std::vector<float> &plane : mixed) {
+      mixedPointers.push_back(plane.data());
+    }
+    std::vector<const float *> sources;
+    for (const std::vector<float> &plane : planes) {
+      sources.push_back(plane.data());
+    }
+    MixChannels(matrix, sources.data(), mixedPointers.data(), frameCount);
+    planes = std::move(mixed);
+    channelMask = 0;
+  }
+  if (format.samplesPerSec != outputRate) {
+    planes = ResampleBuffer(planes, format.samplesPerSec, outputRate,
+                            settings.quality);
+  }
+
+  const size_t frameCount = planes[0].size();
+  if (frameCount == 0 || frameCount > UINT32_MAX / kMaxPcmChannels / 4) {
+    std::printf("%s: no samples or too long\n", path.string().c_str());
+    return false;
+  }
+  std::vector<const float *> pointers;
+  for (const std::vector<float> &plane : planes) {
+    pointers.push_back(plane.data());
+  }
+  std::vector<float> interleaved(frameCount * outputChannels);
+  InterleaveSamples(pointers.data(), outputChannels, interleaved.data(),
+                    frameCount);
+  std::vector<int16_t> pcm(interleaved.size());
+  ConvertFloatToPcm(PcmFormat::Int16, interleaved.data(), pcm.data(),
+                    interleaved.size());
+
+  entry.channels = uint16_t(outputChannels);
+  entry.sampleRate = outputRate;
+  entry.channelMask = channelMask;
+  entry.frameCount = uint32_t(frameCount);
+  if (settings.isAdpcm) {
+    if (settings.blockBytes * outputChannels > UINT16_MAX) {
+      std::printf("%s: --block-bytes is too large for %u channels\n",
+                  path.string().c_str(), outputChannels);
+      return false;
+    }
+    const uint32_t samplesPerBlock = (settings.blockBytes - 4) * 2 + 1;
+    AdpcmFormat adpcm;
+    data = EncodeImaAdpcm(pcm.data(), uint32_t(frameCount),
+                          uint16_t(outputChannels), samplesPerBlock, adpcm);
+    entry.formatTag = kWaveFormatImaAdpcm;
+    entry.blockAlign = adpcm.blockAlign;
+    entry.samplesPerBlock = adpcm.samplesPerBlock;
+  } else {
+    data.resize(pcm.size() * sizeof(int16_t));
+    std::memcpy(data.data(), pcm.data(), data.size());
+    entry.formatTag = kWaveFormatPcm;
+    entry.blockAlign = outputChannels * sizeof(int16_t);
+    entry.samplesPerBlock = 1;
+  }
+  entry.dataSize = uint32_t(data.size());
+  return true;
+}
+
+bool WriteBank(const SoundBankSettings &settings,
+               const std::map<std::string, std::filesystem::path> &files) {
+  BankWriter writer(settings.output);
+  if (!writer.IsOpen()) {
+    std::printf("failed to create %s\n", settings.output.c_str());
+    return false;
+  }
+
+  SoundBankHeader header{};
+  writer.Write(&header, sizeof(header));
+
+  std::vector<SoundBankEntry> entries;
+  std::string names;
+  uint64_t sourceSize = 0;
+  uint64_t sampleSize = 0;
+  std::vector<uint8_t> data;
+
+  for (const auto &[name, path] : files) {
+    SoundBankEntry entry{};
+    if (!ConvertSound(path, settings, entry, data)) {
+      return false;
+    }
+    entry.nameHash = HashPackName(name);
+    entry.nameOffset = uint32_t(names.size());
+    entry.nameLength = uint32_t(name.size());
+    names += name;
+
+    // SIMDでそのまま読めるよう、サンプルの先頭を揃える
+    writer.Align(settings.alignment);
+    entry.dataOffset = writer.GetOffset();
+    writer.Write(data.data(), data.size());
+
+    std::error_code ec;
+    sourceSize += std::filesystem::file_size(path, ec);
+    sampleSize += data.size();
+    entries.push_back(entry);
+  }
+
+  // 読み込み側はハッシュで二分探索する
+  std::sort(entries.begin(), entries.end(),
+            [](const SoundBankEntry &a, const SoundBankEntry &b) {
+              return a.nameHash < b.nameHash;
+            });
+
+  writer.Align(alignof(SoundBankEntry));
+  std::memcpy(header.magic, kSoundBankMagic, sizeof(kSoundBankMagic));
+  header.version = kSoundBankVersion;
+  header.entryCount = uint32_t(entries.size());
+  header.alignment = settings.alignment;
+  header.entryOffset = writer.GetOffset();
+  writer.Write(entries.data(), entries.size() * sizeof(SoundBankEntry));
+  header.nameOffset = writer.GetOffset();
+  writer.Write(names.data(), names.size());
+  const uint64_t bankSize = writer.GetOffset();
+  writer.WriteHeader(header);
+
+  if (!writer.Close()) {
+    std::printf("failed to write %s\n", settings.output.c_str());
+    return false;
+  }
+
+  std::printf("%s: %zu sounds, %.2f MB wav -> %.2f MB samples, %.2f MB bank\n",
+              settings.output.c_str(), entries.size(), sourceSize / 1048576.0,
+              sampleSize / 1048576.0, bankSize / 1048576.0);
+  return true;
+}
+
+// 書き出したバンクを読み直し、すべての名前が引けるか確かめる
+bool VerifyBank(const SoundBankSettings &settings,
+                const std::map<std::string, std::filesystem::path> &files) {
+  SoundBank bank;
+  if (!bank.Open(settings.output)) {
+    std::printf("verify: failed to open %s\n", settings.output.c_str());
+    return false;
+  }
+
+  for (const auto &[name, path] : files) {
+    const SoundData sound = bank.GetSound(name);
+    if (sound.bufferSize == 0 || sound.storage == nullptr) {
+      std::printf("verify: missing %s\n", name.c_str());
+      return false;
+    }
+  }
+  std::printf("verify: %u sounds OK\n", bank.GetSoundCount());
+  return true;
+}
+
+} // namespace
+
+int SoundBankCommand(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  SoundBankSettings settings;
+  settings.inputs = commandLine.GetStrings("--input");
+  settings.output = commandLine.GetString("--output");
+  settings.base = commandLine.GetString("--base", settings.base);
+  settings.sampleRate =
+      uint32_t(commandLine.GetUInt("--rate", settings.sampleRate));
+  settings.channels = uint32_t(commandLine.GetUInt("--channels", 0));
+  const std::string format = commandLine.GetString("--format", "pcm16");
+  settings.isAdpcm = format == "ima";
+  settings.blockBytes =
+      uint32_t(commandLine.GetUInt("--block-bytes", settings.blockBytes));
+  const std::string quality = commandLine.GetString("--quality", "high");
+  settings.alignment =
+      uint32_t(commandLine.GetUInt("--alignment", settings.alignment));
+  settings.isVerified = commandLine.HasFlag("--verify");
+
+  if (settings.inputs.empty() || settings.output.empty() ||
+      settings.channels > kMaxPcmChannels ||
+      (format != "pcm16" && format != "ima") ||
+      !ParseQuality(quality, settings.quality)) {
+    PrintUsage();
+    return 1;
+  }
+  // ブロックはnBlockAlign(16bit)に収まらなければならない
+  if (settings.isAdpcm &&
+      (settings.blockBytes < 8 || settings.blockBytes % 4 != 0 ||
+       settings.blockBytes > 8192)) {
+    std::printf("--block-bytes must be a multiple of 4 in [8, 8192]\n");
+    return 1;
+  }
+  // エントリの表を直接参照できるよう、8の倍数の2のべき乗に限る
+  if (settings.alignment < alignof(SoundBankEntry) ||
+      (settings.alignment & (settings.alignment - 1)) != 0) {
+    std::printf("--alignment must be a power of two >= %zu\n",
+                alignof(SoundBankEntry));
+    return 1;
+  }
+
+  std::map<std::string, std::filesystem::path> files;
+  if (!CollectFiles(settings, files)) {
+    return 1;
+  }
+  if (files.empty()) {
+    std::printf("no .wav files found\n");
+    return 1;
+  }
+  if (!WriteBank(settings, files)) {
+    return 1;
+  }
+  if (settings.isVerified && !VerifyBank(settings, files)) {
+    return 1;
+  }
+  return 0;
+}
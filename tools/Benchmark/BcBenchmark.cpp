@@ -0,0 +1,214 @@
+#include "../../BcEncoder.h"
+#include "../../ThreadPool.h"
+#include "../../externals/DirectXTex/DirectXTex.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *GetBcFormatName(BcFormat format) {
+  switch (format) {
+  case BcFormat::Bc1:
+    return "bc1";
+  case BcFormat::Bc3:
+    return "bc3";
+  default:
+    return "bc7";
+  }
+}
+
+DXGI_FORMAT GetDxgiFormat(BcFormat format) {
+  switch (format) {
+  case BcFormat::Bc1:
+    return DXGI_FORMAT_BC1_UNORM;
+  case BcFormat::Bc3:
+    return DXGI_FORMAT_BC3_UNORM;
+  default:
+    return DXGI_FORMAT_BC7_UNORM;
+  }
+}
+
+// 滑らかなグラデーションに細かい縞と色の斑点、なだらかに抜けるアルファを重ねる
+// 縞や斑点は端点の選び方の差が画質の数字に出るようにするため
+void FillSourceImage(std::vector<uint8_t> &pixels, uint32_t width,
+                     uint32_t height) {
+  pixels.resize(size_t(width) * height * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      const float u = float(x) / float(width);
+      const float v = float(y) / float(height);
+      const float stripe = ((x / 3 + y / 5) & 1) ? 0.2f : 0.0f;
+      const float spot = ((x * 7 + y * 13) % 29 == 0) ? 0.5f : 0.0f;
+      const float du = u - 0.5f;
+      const float dv = v - 0.5f;
+      const float values[4] = {
+          std::min(u + stripe, 1.0f), std::min(v + spot, 1.0f),
+          0.5f + 0.5f * std::sin(float(x ^ y) * 0.1f),
+          std::clamp(1.5f - 4.0f * std::sqrt(du * du + dv * dv), 0.0f, 1.0f)};
+      uint8_t *pixel = pixels.data() + (size_t(y) * width + x) * 4;
+      for (uint32_t c = 0; c < 4; ++c) {
+        pixel[c] = uint8_t(values[c] * 255.0f + 0.5f);
+      }
+    }
+  }
+}
+
+// 圧縮したブロックをDirectXTexで展開し、元の画像とのPSNRを色とアルファで別に出す
+bool ComputePsnr(const DirectX::Image &source, const DirectX::Image &blocks,
+                 double &colorPsnr, double &alphaPsnr) {
+  DirectX::ScratchImage decoded;
+  if (FAILED(DirectX::Decompress(blocks, DXGI_FORMAT_R8G8B8A8_UNORM,
+                                 decoded))) {
+    return false;
+  }
+  const DirectX::Image *result = decoded.GetImage(0, 0, 0);
+  double colorError = 0.0;
+  double alphaError = 0.0;
+  for (size_t y = 0; y < source.height; ++y) {
+    const uint8_t *a = source.pixels + source.rowPitch * y;
+    const uint8_t *b = result->pixels + result->rowPitch * y;
+    for (size_t x = 0; x < source.width * 4; ++x) {
+      const double difference = double(a[x]) - double(b[x]);
+      ((x & 3) == 3 ? alphaError : colorError) += difference * difference;
+    }
+  }
+  const double pixels = double(source.width) * double(source.height);
+  const auto toPsnr = [](double meanSquaredError) {
+    return meanSquaredError > 0.0
+               ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError)
+               : 99.0;
+  };
+  colorPsnr = toPsnr(colorError / (pixels * 3.0));
+  alphaPsnr = toPsnr(alphaError / pixels);
+  return true;
+}
+
+} // namespace
+
+// 速いBC圧縮を形式、品質、SIMDレベルごとに測り、画質(PSNR)も出す
+// 最後に同じ形式をDirectXTexのCompressで圧縮したものと比べる
+int RunBcBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  // 4の倍数に切り上げる
+  const uint32_t width =
+      (uint32_t(commandLine.GetUInt("--width", 1024)) + 3) & ~3u;
+  const uint32_t height =
+      (uint32_t(commandLine.GetUInt("--height", 1024)) + 3) & ~3u;
+  const uint32_t repeat = uint32_t(commandLine.GetUInt("--repeat", 3));
+  const uint32_t threads = uint32_t(commandLine.GetUInt("--threads", 0));
+  const std::string simd = commandLine.GetString("--simd");
+  const bool isDirectXTexSkipped = commandLine.HasFlag("--no-directxtex");
+  if (width == 0 || height == 0 || repeat == 0) {
+    std::printf("usage: Benchmark bc [--width N] [--height N] [--repeat N]"
+                " [--threads N] [--simd scalar|sse|avx] [--no-directxtex]\n");
+    return 1;
+  }
+
+  // 0なら1スレッドで測る(SIMDの差だけを見る)
+  std::unique_ptr<ThreadPool> pool;
+  if (threads > 0) {
+    pool = std::make_unique<ThreadPool>(threads);
+  }
+
+  std::vector<uint8_t> pixels;
+  FillSourceImage(pixels, width, height);
+  const Rgba8Image image{pixels.data(), width, height, size_t(width) * 4};
+  DirectX::Image source{};
+  source.width = width;
+  source.height = height;
+  source.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  source.rowPitch = image.rowPitch;
+  source.slicePitch = image.rowPitch * height;
+  source.pixels = pixels.data();
+
+  const uint32_t blocksWide = width / 4;
+  const uint32_t blocksHigh = height / 4;
+  std::vector<uint8_t> blocks(size_t(blocksWide) * blocksHigh * 16);
+  const double megapixels = double(width) * double(height) / 1e6;
+
+  std::printf("%ux%u, %u times, %u threads\n", width, height, repeat,
+              std::max(threads, 1u));
+  std::printf("%-8s %-6s %-8s %12s %10s %10s\n", "simd", "format", "quality",
+              "Mpixels/s", "rgb dB", "alpha dB");
+  for (SimdLevel level :
+       {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+    if (level > GetSupportedSimdLevel() ||
+        (!simd.empty() && simd != GetSimdLevelName(level))) {
+      continue;
+    }
+    for (BcFormat format : {BcFormat::Bc1, BcFormat::Bc3, BcFormat::Bc7}) {
+      for (BcQuality quality :
+           {BcQuality::Fast, BcQuality::Normal, BcQuality::High}) {
+        BcEncodeSettings settings;
+        settings.format = format;
+        settings.quality = quality;
+        settings.simd = level;
+        const size_t blockRowPitch =
+            size_t(blocksWide) * GetBcBlockSize(format);
+
+        BenchmarkTimer timer;
+        for (uint32_t i = 0; i < repeat; ++i) {
+          EncodeBcImage(image, settings, blocks.data(), blockRowPitch,
+                        pool.get());
+        }
+        const double time = timer.GetSeconds();
+
+        DirectX::Image compressed{};
+        compressed.width = width;
+        compressed.height = height;
+        compressed.format = GetDxgiFormat(format);
+        compressed.rowPitch = blockRowPitch;
+        compressed.slicePitch = blockRowPitch * blocksHigh;
+        compressed.pixels = blocks.data();
+        double colorPsnr = 0.0;
+        double alphaPsnr = 0.0;
+        if (!ComputePsnr(source, compressed, colorPsnr, alphaPsnr)) {
+          std::printf("DirectXTex Decompress failed\n");
+          return 1;
+        }
+        std::printf("%-8s %-6s %-8s %12.2f %10.2f %10.2f\n",
+                    GetSimdLevelName(level), GetBcFormatName(format),
+                    GetBcQualityName(quality),
+                    time > 0.0 ? megapixels * repeat / time : 0.0, colorPsnr,
+                    alphaPsnr);
+      }
+    }
+  }
+
+  // DirectXTexのBC7は1枚で数秒から数十秒かかるので、省けるようにしておく
+  if (isDirectXTexSkipped) {
+    return 0;
+  }
+  // threadsを指定したときだけDirectXTexにも並列に圧縮させる
+  DirectX::TEX_COMPRESS_FLAGS flags = DirectX::TEX_COMPRESS_DEFAULT;
+  if (threads > 0) {
+    flags |= DirectX::TEX_COMPRESS_PARALLEL;
+  }
+  for (BcFormat format : {BcFormat::Bc1, BcFormat::Bc3, BcFormat::Bc7}) {
+    DirectX::ScratchImage reference;
+    BenchmarkTimer timer;
+    if (FAILED(DirectX::Compress(source, GetDxgiFormat(format), flags,
+                                 DirectX::TEX_THRESHOLD_DEFAULT, reference))) {
+      std::printf("DirectXTex Compress failed\n");
+      return 1;
+    }
+    const double time = timer.GetSeconds();
+    double colorPsnr = 0.0;
+    double alphaPsnr = 0.0;
+    if (!ComputePsnr(source, *reference.GetImage(0, 0, 0), colorPsnr,
+                     alphaPsnr)) {
+      std::printf("DirectXTex Decompress failed\n");
+      return 1;
+    }
+    std::printf("%-8s %-6s %-8s %12.2f %10.2f %10.2f\n", "dxtex",
+                GetBcFormatName(format), "default",
+                time > 0.0 ? megapixels / time : 0.0, colorPsnr, alphaPsnr);
+  }
+  return 0;
+}
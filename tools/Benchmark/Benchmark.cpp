@@ -0,0 +1,55 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct Suite {
+  const char *name;
+  int (*function)(const std::vector<std::string> &args);
+  const char *description;
+};
+
+const Suite kSuites[] = {
+    {"loader", RunLoaderBenchmark,
+     "LoadObjFile / LoadMaterialTemplateFile / SoundLoadWave throughput"},
+    {"mixer", RunMixerBenchmark,
+     "AudioMixer gain/pan/mix cost per voice (scalar / SSE / AVX)"},
+    {"resampler", RunResamplerBenchmark,
+     "Resampler throughput and SNR per quality tier"},
+    {"pcm", RunPcmConvertBenchmark,
+     "PCM format conversion, deinterleave and downmix (scalar / SSE / AVX)"},
+    {"spatial", RunSpatialAudioBenchmark,
+     "SpatialAudio gain/pan/doppler update per frame (scalar / SSE)"},
+    {"mip", RunMipBenchmark,
+     "Mip generation per format and filter, compared with DirectXTex"},
+    {"bc", RunBcBenchmark,
+     "Fast BC1/BC3/BC7 encoding speed and PSNR, compared with DirectXTex"},
+};
+
+void PrintUsage() {
+  std::printf("usage: Benchmark <suite> [options]\n\n");
+  for (const Suite &suite : kSuites) {
+    std::printf("  %-10s %s\n", suite.name, suite.description);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::vector<std::string> args(argv + 2, argv + argc);
+  for (const Suite &suite : kSuites) {
+    if (std::strcmp(argv[1], suite.name) == 0) {
+      return suite.function(args);
+    }
+  }
+
+  std::printf("unknown suite: %s\n\n", argv[1]);
+  PrintUsage();
+  return 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+// std::min/std::maxと衝突しないようにする
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// ベンチマークのスイート。argsはスイート名より後ろの引数
+int RunLoaderBenchmark(const std::vector<std::string> &args);
+int RunMixerBenchmark(const std::vector<std::string> &args);
+int RunResamplerBenchmark(const std::vector<std::string> &args);
+int RunPcmConvertBenchmark(const std::vector<std::string> &args);
+int RunSpatialAudioBenchmark(const std::vector<std::string> &args);
+int RunMipBenchmark(const std::vector<std::string> &args);
+int RunBcBenchmark(const std::vector<std::string> &args);
+
+#pragma region 計測用の関数
+
+// 経過時間を秒で返すタイマー
+class BenchmarkTimer {
+public:
+  BenchmarkTimer() : start_(std::chrono::steady_clock::now()) {}
+
+  double GetSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+// プロセス起動からの最大常駐メモリ(バイト)
+inline size_t GetPeakMemoryUsage() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return size_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#pragma endregion
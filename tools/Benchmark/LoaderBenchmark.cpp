@@ -0,0 +1,163 @@
+#include "../../Model.h"
+#include "../../Sound.h"
+#include "../../SoundBank.h"
+#include "../../VirtualFileSystem.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct LoadResult {
+  double seconds = 0.0;
+  // ファイルの種類ごとの補足情報(頂点数など)
+  std::string detail;
+};
+
+LoadResult LoadOnce(const std::filesystem::path &path) {
+  LoadResult result;
+  std::string directory = path.parent_path().string();
+  std::string filename = path.filename().string();
+  std::string extension = path.extension().string();
+
+  if (extension == ".obj") {
+    BenchmarkTimer timer;
+    ModelData modelData = LoadObjFile(directory, filename);
+    result.seconds = timer.GetSeconds();
+    result.detail = std::to_string(modelData.vertices.size()) + " vertices";
+  } else if (extension == ".mtl") {
+    BenchmarkTimer timer;
+    MaterialData materialData = LoadMaterialTemplateFile(directory, filename);
+    result.seconds = timer.GetSeconds();
+    result.detail = materialData.textureFilePath;
+  } else if (extension == ".wav") {
+    BenchmarkTimer timer;
+    SoundData soundData = SoundLoadWave(path.string().c_str());
+    result.seconds = timer.GetSeconds();
+    result.detail = std::to_string(soundData.wfex.nSamplesPerSec) + " Hz " +
+                    std::to_string(soundData.wfex.nChannels) + " ch";
+    SoundUnload(&soundData);
+  }
+  return result;
+}
+
+// バンクを開いて全部の音を引くまでの時間を測る
+// WAVを1つずつ読んだときの合計と比べるためのもの
+void MeasureSoundBank(const std::string &path, uint64_t iterations) {
+  double best = 0.0;
+  uint32_t count = 0;
+  uint64_t sampleBytes = 0;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    BenchmarkTimer timer;
+    SoundBank bank;
+    std::vector<SoundData> sounds;
+    if (bank.Open(path)) {
+      count = bank.GetSoundCount();
+      sampleBytes = bank.GetSampleBytes();
+      sounds.reserve(count);
+      for (uint32_t index = 0; index < count; ++index) {
+        sounds.push_back(bank.GetSound(bank.GetSoundName(index)));
+      }
+    }
+    const double seconds = timer.GetSeconds();
+    best = i == 0 ? seconds : std::min(best, seconds);
+  }
+
+  if (count == 0) {
+    std::printf("failed to open %s\n", path.c_str());
+    return;
+  }
+  std::printf("\n%s: %u sounds, %.2f MB samples, open + lookup all %.3f ms"
+              " (%.2f us/sound)\n",
+              path.c_str(), count, sampleBytes / 1048576.0, best * 1000.0,
+              best * 1e6 / count);
+}
+
+} // namespace
+
+// 指定ディレクトリのOBJ/MTL/WAVを読み込み、スループットと最大メモリを表示する
+// procPeakはそのファイルまでを読んだ時点でのプロセス全体の最大常駐メモリで、
+// ファイルごとの値ではない。ファイル単体で測るときは --file を使う
+// --pack を指定すると、パックに入っているファイルはパックから読む
+// --bank を指定すると、最後にサウンドバンクから全部引く時間も表示する
+int RunLoaderBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  std::string directory = commandLine.GetString("--directory");
+  std::string onlyFile = commandLine.GetString("--file");
+  std::string pack = commandLine.GetString("--pack");
+  std::string bank = commandLine.GetString("--bank");
+  uint64_t iterations = std::max<uint64_t>(
+      commandLine.GetUInt("--iterations", 3), 1);
+
+  if (directory.empty()) {
+    std::printf("usage: Benchmark loader --directory <dir> [--file <name>]\n"
+                "       [--iterations N] [--pack <file.pak>]"
+                " [--bank <file.bank>]\n");
+    return 1;
+  }
+  if (!pack.empty() && !VirtualFileSystem::GetInstance().Mount(pack)) {
+    std::printf("failed to mount %s\n", pack.c_str());
+    return 1;
+  }
+
+  std::vector<std::filesystem::path> paths;
+  std::error_code ec;
+  double wavSeconds = 0.0;
+  uint32_t wavCount = 0;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(directory, ec)) {
+    std::string extension = entry.path().extension().string();
+    if (extension != ".obj" && extension != ".mtl" && extension != ".wav") {
+      continue;
+    }
+    if (!onlyFile.empty() && entry.path().filename() != onlyFile) {
+      continue;
+    }
+    paths.push_back(entry.path());
+  }
+  std::sort(paths.begin(), paths.end());
+
+  if (paths.empty()) {
+    std::printf("no .obj/.mtl/.wav files in %s\n", directory.c_str());
+    return 1;
+  }
+
+  std::printf("%-32s %10s %10s %10s %10s %12s  %s\n", "file", "size(MB)",
+              "best(ms)", "mean(ms)", "MB/s", "procPeak(MB)", "detail");
+
+  for (const std::filesystem::path &path : paths) {
+    double megabytes = std::filesystem::file_size(path, ec) / 1048576.0;
+
+    double best = 0.0;
+    double total = 0.0;
+    LoadResult result;
+    for (uint64_t i = 0; i < iterations; ++i) {
+      result = LoadOnce(path);
+      best = i == 0 ? result.seconds : std::min(best, result.seconds);
+      total += result.seconds;
+    }
+    if (path.extension() == ".wav") {
+      wavSeconds += best;
+      ++wavCount;
+    }
+
+    std::printf("%-32s %10.2f %10.2f %10.2f %10.1f %12.1f  %s\n",
+                path.filename().string().c_str(), megabytes, best * 1000.0,
+                total / iterations * 1000.0,
+                best > 0.0 ? megabytes / best : 0.0,
+                GetPeakMemoryUsage() / 1048576.0, result.detail.c_str());
+  }
+
+  if (!bank.empty()) {
+    if (wavCount > 0) {
+      std::printf("\n%u loose .wav files: %.3f ms (%.2f us/sound)\n",
+                  wavCount, wavSeconds * 1000.0, wavSeconds * 1e6 / wavCount);
+    }
+    MeasureSoundBank(bank, iterations);
+  }
+  return 0;
+}
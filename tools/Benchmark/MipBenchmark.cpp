@@ -0,0 +1,249 @@
+#include "../../MipGenerator.h"
+#include "../../ThreadPool.h"
+#include "../../externals/DirectXTex/DirectXTex.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *GetMipFormatName(MipFormat format) {
+  switch (format) {
+  case MipFormat::Rgba16Float:
+    return "rgba16f";
+  case MipFormat::R8:
+    return "r8";
+  case MipFormat::Rg8:
+    return "rg8";
+  default:
+    return "rgba8";
+  }
+}
+
+uint32_t GetBytesPerPixel(MipFormat format) {
+  switch (format) {
+  case MipFormat::Rgba16Float:
+    return 8;
+  case MipFormat::R8:
+    return 1;
+  case MipFormat::Rg8:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+// 1x1までのミップを置くメモリ。levels[0]に元の画像を入れて使う
+struct MipChain {
+  std::vector<std::vector<uint8_t>> buffers;
+  std::vector<MipImage> levels;
+
+  MipChain(uint32_t width, uint32_t height, MipFormat format) {
+    const uint32_t levelCount = GetMipLevelCount(width, height);
+    buffers.resize(levelCount);
+    levels.resize(levelCount);
+    for (uint32_t i = 0; i < levelCount; ++i) {
+      MipImage &level = levels[i];
+      level.width = std::max(width >> i, 1u);
+      level.height = std::max(height >> i, 1u);
+      level.rowPitch = size_t(level.width) * GetBytesPerPixel(format);
+      buffers[i].resize(level.rowPitch * level.height);
+      level.pixels = buffers[i].data();
+    }
+  }
+};
+
+// 色のグラデーションに細かい縞と、切り抜きに見立てたアルファの円を重ねる
+// 縞はフィルターの差(ぼけ方やエイリアス)が数字に出るようにするため
+void FillSourceImage(const MipImage &image, MipFormat format) {
+  const uint32_t bytesPerPixel = GetBytesPerPixel(format);
+  for (uint32_t y = 0; y < image.height; ++y) {
+    uint8_t *row = image.pixels + image.rowPitch * y;
+    for (uint32_t x = 0; x < image.width; ++x) {
+      const float u = float(x) / float(image.width);
+      const float v = float(y) / float(image.height);
+      const float stripe = ((x / 3 + y / 5) & 1) ? 0.25f : 0.0f;
+      const float du = u - 0.5f;
+      const float dv = v - 0.5f;
+      const float values[4] = {
+          std::min(u + stripe, 1.0f), std::min(v + stripe, 1.0f),
+          0.5f + 0.5f * std::sin(float(x ^ y) * 0.1f),
+          du * du + dv * dv < 0.16f ? 1.0f : 0.0f};
+      uint8_t *pixel = row + size_t(x) * bytesPerPixel;
+      if (format == MipFormat::Rgba16Float) {
+        // 0から1.25に広げ、1を超える値(HDR)も混ぜる
+        for (uint32_t c = 0; c < 4; ++c) {
+          // 1/256刻みにそろえておけば、半精度へは仮数を削るだけで正確に直せる
+          const float value =
+              std::round((c < 3 ? values[c] * 1.25f : values[c]) * 256.0f) /
+              256.0f;
+          uint32_t bits;
+          std::memcpy(&bits, &value, sizeof(bits));
+          const uint16_t half =
+              value == 0.0f
+                  ? 0
+                  : uint16_t(((bits >> 16) & 0x8000) |
+                             ((((bits >> 23) & 0xff) - 112) << 10) |
+                             ((bits >> 13) & 0x3ff));
+          std::memcpy(pixel + c * 2, &half, sizeof(half));
+        }
+      } else {
+        for (uint32_t c = 0; c < bytesPerPixel; ++c) {
+          pixel[c] = uint8_t(values[c] * 255.0f + 0.5f);
+        }
+      }
+    }
+  }
+}
+
+// 同じ処理をrepeat回繰り返し、1秒あたりの元の画像のピクセル数(百万)を返す
+template <typename Function>
+double MeasureMpixels(size_t pixels, uint32_t repeat, Function function) {
+  BenchmarkTimer timer;
+  for (uint32_t i = 0; i < repeat; ++i) {
+    function();
+  }
+  const double time = timer.GetSeconds();
+  return time > 0.0 ? double(pixels) * repeat / time / 1e6 : 0.0;
+}
+
+// RGBA8 sRGBのボックスフィルターをDirectXTexのGenerateMipMapsと比べる
+// 速さと、全レベルでの各チャンネルの差の最大と平均を出す
+void CompareWithDirectXTex(const MipChain &chain, uint32_t repeat,
+                           double ours) {
+  const MipImage &source = chain.levels[0];
+  DirectX::Image image{};
+  image.width = source.width;
+  image.height = source.height;
+  image.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+  image.rowPitch = source.rowPitch;
+  image.slicePitch = source.rowPitch * source.height;
+  image.pixels = source.pixels;
+
+  const DirectX::TEX_FILTER_FLAGS filter =
+      DirectX::TEX_FILTER_BOX | DirectX::TEX_FILTER_SRGB;
+  DirectX::ScratchImage reference;
+  bool isFailed = false;
+  const double directXTex =
+      MeasureMpixels(size_t(source.width) * source.height, repeat, [&]() {
+        isFailed |= FAILED(DirectX::GenerateMipMaps(
+            image, filter, chain.levels.size(), reference));
+      });
+  if (isFailed) {
+    std::printf("DirectXTex GenerateMipMaps failed\n");
+    return;
+  }
+
+  int maxDifference = 0;
+  double totalDifference = 0.0;
+  size_t count = 0;
+  for (size_t i = 1; i < chain.levels.size(); ++i) {
+    const MipImage &level = chain.levels[i];
+    const DirectX::Image *expected = reference.GetImage(i, 0, 0);
+    for (uint32_t y = 0; y < level.height; ++y) {
+      const uint8_t *a = level.pixels + level.rowPitch * y;
+      const uint8_t *b = expected->pixels + expected->rowPitch * y;
+      for (uint32_t x = 0; x < level.width * 4; ++x) {
+        const int difference = std::abs(int(a[x]) - int(b[x]));
+        maxDifference = std::max(maxDifference, difference);
+        totalDifference += difference;
+        ++count;
+      }
+    }
+  }
+  std::printf("DirectXTex box sRGB %.1f Mpixels/s (ours %.1f, x%.2f),"
+              " difference max %d mean %.3f\n",
+              directXTex, ours, directXTex > 0.0 ? ours / directXTex : 0.0,
+              maxDifference, count > 0 ? totalDifference / count : 0.0);
+}
+
+} // namespace
+
+// ミップの生成を形式、フィルター、SIMDレベルごとに測る
+// 最後にRGBA8 sRGBのボックスフィルターをDirectXTexと比べる
+int RunMipBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  const uint32_t width = uint32_t(commandLine.GetUInt("--width", 2048));
+  const uint32_t height = uint32_t(commandLine.GetUInt("--height", 2048));
+  const uint32_t repeat = uint32_t(commandLine.GetUInt("--repeat", 5));
+  const uint32_t threads = uint32_t(commandLine.GetUInt("--threads", 0));
+  const std::string simd = commandLine.GetString("--simd");
+  if (width == 0 || height == 0 || repeat == 0) {
+    std::printf("usage: Benchmark mip [--width N] [--height N] [--repeat N]"
+                " [--threads N] [--simd scalar|sse|avx]\n");
+    return 1;
+  }
+
+  // 0なら1スレッドで測る(SIMDの差だけを見る)
+  std::unique_ptr<ThreadPool> pool;
+  if (threads > 0) {
+    pool = std::make_unique<ThreadPool>(threads);
+  }
+
+  const size_t pixels = size_t(width) * height;
+  std::printf("%ux%u, %u times, %u threads (Mpixels/s of level 0)\n", width,
+              height, repeat, std::max(threads, 1u));
+  std::printf("%-8s %-8s %10s %10s %10s\n", "simd", "format", "box", "kaiser",
+              "coverage");
+  for (SimdLevel level :
+       {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+    if (level > GetSupportedSimdLevel() ||
+        (!simd.empty() && simd != GetSimdLevelName(level))) {
+      continue;
+    }
+    for (MipFormat format : {MipFormat::Rgba8, MipFormat::Rgba16Float,
+                             MipFormat::R8, MipFormat::Rg8}) {
+      MipChain chain(width, height, format);
+      FillSourceImage(chain.levels[0], format);
+      MipSettings settings;
+      settings.format = format;
+      settings.isSrgb = format == MipFormat::Rgba8;
+      settings.simd = level;
+
+      double results[3] = {};
+      for (uint32_t i = 0; i < 3; ++i) {
+        settings.filter = i == 0 ? MipFilter::Box : MipFilter::Kaiser;
+        // アルファを持つ形式だけ、カバレッジの保持込みでも測る(ほかは0のまま)
+        settings.alphaCoverageReference = i == 2 ? 0.5f : 0.0f;
+        if (i == 2 && format != MipFormat::Rgba8 &&
+            format != MipFormat::Rgba16Float) {
+          continue;
+        }
+        results[i] = MeasureMpixels(pixels, repeat, [&]() {
+          GenerateMipChain(chain.levels.data(),
+                           uint32_t(chain.levels.size()), settings,
+                           pool.get());
+        });
+      }
+      std::printf("%-8s %-8s %10.1f %10.1f %10.1f\n", GetSimdLevelName(level),
+                  GetMipFormatName(format), results[0], results[1],
+                  results[2]);
+    }
+  }
+
+  MipChain chain(width, height, MipFormat::Rgba8);
+  FillSourceImage(chain.levels[0], MipFormat::Rgba8);
+  MipSettings settings;
+  settings.isSrgb = true;
+  if (!simd.empty()) {
+    for (SimdLevel level :
+         {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+      if (simd == GetSimdLevelName(level)) {
+        settings.simd = std::min(level, GetSupportedSimdLevel());
+      }
+    }
+  }
+  const double ours = MeasureMpixels(pixels, repeat, [&]() {
+    GenerateMipChain(chain.levels.data(), uint32_t(chain.levels.size()),
+                     settings, pool.get());
+  });
+  CompareWithDirectXTex(chain, repeat, ours);
+  return 0;
+}
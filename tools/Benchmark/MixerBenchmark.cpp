@@ -0,0 +1,203 @@
+#include "../../Adpcm.h"
+#include "../../AudioMixer.h"
+#include "../../AudioOutput.h"
+#include "../../RiffReader.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <vector>
+
+namespace {
+
+// サイン波の音を作る。毎回同じ結果になるようファイルは使わない
+SoundData MakeSineWave(uint32_t sampleRate, uint16_t channels, bool isFloat,
+                       float frequency, float seconds) {
+  const uint32_t frameCount = uint32_t(sampleRate * seconds);
+  const uint16_t bitsPerSample = isFloat ? 32 : 16;
+  const uint32_t frameBytes = channels * bitsPerSample / 8;
+  auto buffer = std::make_shared<std::vector<uint8_t>>(
+      size_t(frameCount) * frameBytes);
+
+  for (uint32_t i = 0; i < frameCount; ++i) {
+    const float phase =
+        2.0f * std::numbers::pi_v<float> * frequency * i / sampleRate;
+    for (uint16_t channel = 0; channel < channels; ++channel) {
+      // 右チャンネルは少し位相をずらす
+      const float value = 0.5f * std::sin(phase + channel * 0.5f);
+      uint8_t *p = buffer->data() + size_t(i) * frameBytes +
+                   channel * (bitsPerSample / 8);
+      if (isFloat) {
+        std::memcpy(p, &value, sizeof(value));
+      } else {
+        const int16_t sample = int16_t(value * 32767.0f);
+        std::memcpy(p, &sample, sizeof(sample));
+      }
+    }
+  }
+
+  SoundData soundData{};
+  soundData.wfex.wFormatTag = isFloat ? kWaveFormatIeeeFloat : kWaveFormatPcm;
+  soundData.wfex.nChannels = channels;
+  soundData.wfex.nSamplesPerSec = sampleRate;
+  soundData.wfex.wBitsPerSample = bitsPerSample;
+  soundData.wfex.nBlockAlign = uint16_t(frameBytes);
+  soundData.wfex.nAvgBytesPerSec = sampleRate * frameBytes;
+  soundData.pBUffer = buffer->data();
+  soundData.bufferSize = uint32_t(buffer->size());
+  soundData.storage = std::move(buffer);
+  return soundData;
+}
+
+// IMA ADPCMに圧縮し、AudioMixerが鳴らしながら展開する音にする
+SoundData CompressToAdpcm(const SoundData &source) {
+  PcmFormat format = PcmFormat::Int16;
+  GetPcmFormat(source.wfex.wFormatTag, source.wfex.wBitsPerSample, format);
+  const uint32_t channels = source.wfex.nChannels;
+  const size_t sampleCount = source.bufferSize / GetPcmSampleBytes(format);
+  std::vector<float> samples(sampleCount);
+  ConvertPcmToFloat(format, source.pBUffer, samples.data(), sampleCount);
+  std::vector<int16_t> pcm(sampleCount);
+  ConvertFloatToPcm(PcmFormat::Int16, samples.data(), pcm.data(),
+                    sampleCount);
+
+  SoundData soundData{};
+  auto buffer = std::make_shared<std::vector<uint8_t>>(
+      EncodeImaAdpcm(pcm.data(), uint32_t(sampleCount / channels),
+                     uint16_t(channels), 1017, soundData.adpcm));
+  soundData.wfex.wFormatTag = kWaveFormatImaAdpcm;
+  soundData.wfex.nChannels = uint16_t(channels);
+  soundData.wfex.nSamplesPerSec = source.wfex.nSamplesPerSec;
+  soundData.wfex.wBitsPerSample = 4;
+  soundData.wfex.nBlockAlign = uint16_t(soundData.adpcm.blockAlign);
+  soundData.pBUffer = buffer->data();
+  soundData.bufferSize = uint32_t(buffer->size());
+  soundData.storage = std::move(buffer);
+  return soundData;
+}
+
+struct MixResult {
+  double seconds = 0.0;
+  // 各レベルの結果が揃っているかを見るための値
+  double checksum = 0.0;
+};
+
+MixResult RunMix(SimdLevel level, ResamplerQuality quality,
+                 const std::vector<SoundData> &sounds, uint32_t voiceCount,
+                 uint32_t sampleRate, uint32_t frameCount,
+                 const std::string &outputPath) {
+  AudioMixer mixer(sampleRate, voiceCount, level);
+  mixer.SetResamplerQuality(quality);
+  for (uint32_t i = 0; i < voiceCount; ++i) {
+    // 全部鳴っても割れない音量にして、左右に散らす
+    const float pan =
+        voiceCount > 1 ? -1.0f + 2.0f * i / (voiceCount - 1) : 0.0f;
+    mixer.Play(sounds[i % sounds.size()], 1.0f / voiceCount, pan, true,
+               i % AudioMixer::kMaxBuses);
+  }
+
+  MixResult result;
+  if (!outputPath.empty()) {
+    WavFileAudioOutput output(outputPath);
+    if (!output.Start(mixer)) {
+      std::printf("failed to open %s\n", outputPath.c_str());
+      return result;
+    }
+    BenchmarkTimer timer;
+    output.Pump(frameCount);
+    result.seconds = timer.GetSeconds();
+    return result;
+  }
+
+  NullAudioOutput output;
+  output.Start(mixer);
+  BenchmarkTimer timer;
+  output.Pump(frameCount);
+  result.seconds = timer.GetSeconds();
+  for (float sample : output.GetLastSamples()) {
+    result.checksum += std::abs(sample);
+  }
+  return result;
+}
+
+} // namespace
+
+// 多数のボイスをループ再生させたまま、指定秒数分の音を混ぜる時間を測る
+// --simd を省略すると、使えるすべてのレベルを順に測る
+// --output を指定すると、結果をWAVファイルに書き出す(速度は参考程度)
+int RunMixerBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  const uint32_t voiceCount =
+      uint32_t(std::max<uint64_t>(commandLine.GetUInt("--voices", 256), 1));
+  const double seconds = commandLine.GetDouble("--seconds", 10.0);
+  const uint32_t sampleRate = uint32_t(
+      commandLine.GetUInt("--rate", AudioMixer::kDefaultSampleRate));
+  const std::string simd = commandLine.GetString("--simd");
+  const std::string outputPath = commandLine.GetString("--output");
+  // 半分の音を44.1kHzにして、変換しながら混ぜる分も測る
+  const bool isMixedRates = commandLine.HasFlag("--mixed-rates");
+  const std::string qualityName = commandLine.GetString("--quality", "medium");
+  // 音をADPCMのまま持ち、展開する分も測る
+  const bool isAdpcm = commandLine.HasFlag("--adpcm");
+
+  std::vector<SimdLevel> levels;
+  for (SimdLevel level :
+       {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+    if (level > GetSupportedSimdLevel()) {
+      continue;
+    }
+    if (simd.empty() || simd == GetSimdLevelName(level)) {
+      levels.push_back(level);
+    }
+  }
+  if (levels.empty() || seconds <= 0.0 || sampleRate == 0) {
+    std::printf("usage: Benchmark mixer [--voices N] [--seconds S]\n"
+                "       [--rate Hz] [--simd scalar|sse|avx]"
+                " [--output mix.wav]\n"
+                "       [--mixed-rates] [--quality low|medium|high]"
+                " [--adpcm]\n");
+    return 1;
+  }
+
+  // 形式の違う音を混ぜて、変換の分岐もすべて通るようにする
+  const uint32_t otherRate = isMixedRates ? 44100 : sampleRate;
+  std::vector<SoundData> sounds = {
+      MakeSineWave(sampleRate, 1, false, 440.0f, 1.0f),
+      MakeSineWave(otherRate, 2, false, 554.0f, 0.7f),
+      MakeSineWave(sampleRate, 1, true, 659.0f, 1.3f),
+      MakeSineWave(otherRate, 2, true, 880.0f, 0.9f)};
+  if (isAdpcm) {
+    for (SoundData &soundData : sounds) {
+      soundData = CompressToAdpcm(soundData);
+    }
+  }
+  ResamplerQuality quality = ResamplerQuality::Medium;
+  for (ResamplerQuality candidate :
+       {ResamplerQuality::Low, ResamplerQuality::Medium,
+        ResamplerQuality::High}) {
+    if (qualityName == GetResamplerQualityName(candidate)) {
+      quality = candidate;
+    }
+  }
+  const uint32_t frameCount = uint32_t(seconds * sampleRate);
+
+  std::printf("%-8s %8s %10s %10s %12s %14s %12s\n", "simd", "voices",
+              "audio(s)", "mix(ms)", "realtime(x)", "ns/voice/frame",
+              "checksum");
+  for (SimdLevel level : levels) {
+    MixResult result = RunMix(level, quality, sounds, voiceCount, sampleRate,
+                              frameCount, outputPath);
+    std::printf("%-8s %8u %10.2f %10.2f %12.1f %14.3f %12.4f\n",
+                GetSimdLevelName(level), voiceCount, seconds,
+                result.seconds * 1000.0,
+                result.seconds > 0.0 ? seconds / result.seconds : 0.0,
+                result.seconds * 1e9 / (double(frameCount) * voiceCount),
+                result.checksum);
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include "../../PcmConvert.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *GetPcmFormatName(PcmFormat format) {
+  switch (format) {
+  case PcmFormat::UInt8:
+    return "uint8";
+  case PcmFormat::Int16:
+    return "int16";
+  case PcmFormat::Int24:
+    return "int24";
+  case PcmFormat::Int32:
+    return "int32";
+  default:
+    return "float32";
+  }
+}
+
+// 同じ処理をrepeat回繰り返し、1秒あたりのサンプル数(百万)を返す
+template <typename Function>
+double MeasureMsamples(size_t samples, uint32_t repeat, Function function) {
+  BenchmarkTimer timer;
+  for (uint32_t i = 0; i < repeat; ++i) {
+    function();
+  }
+  const double time = timer.GetSeconds();
+  return time > 0.0 ? double(samples) * repeat / time / 1e6 : 0.0;
+}
+
+} // namespace
+
+// 読み込み時とミキサーで使う変換を、形式とSIMDレベルごとに測る
+// ミキサーと同じく256フレームずつ変換し、キャッシュに載った状態の速さを見る
+int RunPcmConvertBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  const uint32_t frames = uint32_t(commandLine.GetUInt("--frames", 256));
+  const uint32_t repeat = uint32_t(commandLine.GetUInt("--repeat", 20000));
+  const std::string simd = commandLine.GetString("--simd");
+  if (frames == 0 || repeat == 0) {
+    std::printf("usage: Benchmark pcm [--frames N] [--repeat N]"
+                " [--simd scalar|sse|avx]\n");
+    return 1;
+  }
+
+  // 5.1の素材を想定して用意する
+  const uint32_t channels = 6;
+  const size_t samples = size_t(frames) * channels;
+  std::vector<float> source(samples);
+  for (size_t i = 0; i < samples; ++i) {
+    source[i] = float(0.8 * std::sin(2.0 * std::numbers::pi * i / 97.0));
+  }
+  std::vector<uint8_t> pcm(samples * 4);
+  std::vector<float> converted(samples);
+  // 2チャンネルとして分けるときにも使うので、多めに取っておく
+  std::vector<std::vector<float>> planes(channels,
+                                         std::vector<float>(samples / 2));
+  std::vector<float *> planePointers;
+  for (std::vector<float> &plane : planes) {
+    planePointers.push_back(plane.data());
+  }
+  std::vector<const float *> constPlanePointers(planePointers.begin(),
+                                                planePointers.end());
+  std::vector<float> stereo[2] = {std::vector<float>(frames),
+                                  std::vector<float>(frames)};
+  float *const stereoPointers[2] = {stereo[0].data(), stereo[1].data()};
+  const ChannelMatrix downmix = BuildChannelMatrix(channels, 0, 2, 0);
+
+  std::printf("%u frames x %u ch, %u times (Msamples/s)\n", frames, channels,
+              repeat);
+  std::printf("%-8s %-8s %12s %12s\n", "simd", "format", "to float",
+              "from float");
+  for (SimdLevel level :
+       {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+    if (level > GetSupportedSimdLevel() ||
+        (!simd.empty() && simd != GetSimdLevelName(level))) {
+      continue;
+    }
+    for (PcmFormat format : {PcmFormat::UInt8, PcmFormat::Int16,
+                             PcmFormat::Int24, PcmFormat::Int32}) {
+      const double fromFloat = MeasureMsamples(samples, repeat, [&]() {
+        ConvertFloatToPcm(format, source.data(), pcm.data(), samples, level);
+      });
+      const double toFloat = MeasureMsamples(samples, repeat, [&]() {
+        ConvertPcmToFloat(format, pcm.data(), converted.data(), samples,
+                          level);
+      });
+      std::printf("%-8s %-8s %12.1f %12.1f\n", GetSimdLevelName(level),
+                  GetPcmFormatName(format), toFloat, fromFloat);
+    }
+
+    const double deinterleave = MeasureMsamples(samples, repeat, [&]() {
+      DeinterleaveSamples(source.data(), channels, planePointers.data(),
+                          frames, level);
+    });
+    const double stereoDeinterleave = MeasureMsamples(samples, repeat, [&]() {
+      DeinterleaveSamples(source.data(), 2, planePointers.data(), samples / 2,
+                          level);
+    });
+    const double mix = MeasureMsamples(samples, repeat, [&]() {
+      MixChannels(downmix, constPlanePointers.data(), stereoPointers, frames,
+                  level);
+    });
+    std::printf("%-8s deinterleave 6ch %.1f, 2ch %.1f, 5.1->2.0 %.1f\n",
+                GetSimdLevelName(level), deinterleave, stereoDeinterleave,
+                mix);
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include "../../Resampler.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<float> MakeSine(uint32_t sampleRate, double frequency,
+                            uint32_t frameCount) {
+  std::vector<float> samples(frameCount);
+  for (uint32_t i = 0; i < frameCount; ++i) {
+    samples[i] = float(
+        0.5 * std::sin(2.0 * std::numbers::pi * frequency * i / sampleRate));
+  }
+  return samples;
+}
+
+// 正弦波を変換し、理想的な正弦波との差からSN比(dB)を求める
+// 端はフィルタの遅延で欠けるので、前後を少し除いて比べる
+double MeasureSnr(ResamplerQuality quality, uint32_t inputRate,
+                  uint32_t outputRate, double frequency) {
+  const std::vector<std::vector<float>> input = {
+      MakeSine(inputRate, frequency, inputRate)};
+  const std::vector<float> output =
+      ResampleBuffer(input, inputRate, outputRate, quality)[0];
+
+  const size_t margin = 64;
+  double signal = 0.0;
+  double noise = 0.0;
+  for (size_t i = margin; i + margin < output.size(); ++i) {
+    const double expected =
+        0.5 * std::sin(2.0 * std::numbers::pi * frequency * i / outputRate);
+    signal += expected * expected;
+    noise += (output[i] - expected) * (output[i] - expected);
+  }
+  return noise > 0.0 ? 10.0 * std::log10(signal / noise) : 999.0;
+}
+
+// 256フレームずつ取り出しながら変換する時間を測る(ミキサーと同じ使い方)
+double MeasureSeconds(ResamplerQuality quality, SimdLevel level,
+                      uint32_t channels, uint32_t inputRate,
+                      uint32_t outputRate, uint32_t outputFrames) {
+  const uint32_t kChunkFrames = 256;
+  std::vector<std::vector<float>> input(
+      channels, MakeSine(inputRate, 1000.0, Resampler::kMaxInputFrames));
+  std::vector<std::vector<float>> output(channels,
+                                         std::vector<float>(kChunkFrames));
+  std::vector<const float *> inputPointers(channels);
+  std::vector<float *> outputPointers(channels);
+  for (uint32_t channel = 0; channel < channels; ++channel) {
+    inputPointers[channel] = input[channel].data();
+    outputPointers[channel] = output[channel].data();
+  }
+
+  Resampler resampler(channels, quality, level);
+  resampler.SetRatio(double(inputRate) / outputRate);
+
+  BenchmarkTimer timer;
+  uint32_t produced = 0;
+  while (produced < outputFrames) {
+    const uint32_t frames = std::min(kChunkFrames, outputFrames - produced);
+    resampler.PushInput(inputPointers.data(),
+                        resampler.GetRequiredInputFrames(frames));
+    produced += resampler.PullOutput(outputPointers.data(), frames);
+  }
+  return timer.GetSeconds();
+}
+
+} // namespace
+
+// 品質とSIMDレベルごとに、1コアで1秒あたり何サンプル変換できるかを測る
+// 合わせて1kHzと、通過域の高い側の正弦波でSN比を表示する
+int RunResamplerBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  const uint32_t inputRate = uint32_t(commandLine.GetUInt("--from", 44100));
+  const uint32_t outputRate = uint32_t(commandLine.GetUInt("--to", 48000));
+  const uint32_t channels = uint32_t(commandLine.GetUInt("--channels", 2));
+  const double seconds = commandLine.GetDouble("--seconds", 10.0);
+  const std::string qualityName = commandLine.GetString("--quality");
+  const std::string simd = commandLine.GetString("--simd");
+
+  if (inputRate == 0 || outputRate == 0 || channels == 0 || seconds <= 0.0 ||
+      double(inputRate) / outputRate > Resampler::kMaxRatio) {
+    std::printf("usage: Benchmark resampler [--from Hz] [--to Hz]"
+                " [--channels N]\n"
+                "       [--seconds S] [--quality low|medium|high]"
+                " [--simd scalar|sse|avx]\n");
+    return 1;
+  }
+
+  const uint32_t outputFrames = uint32_t(seconds * outputRate);
+  // 低い方のレートのナイキスト周波数の半分(通過域の高い側)
+  const double highFrequency = std::min(inputRate, outputRate) * 0.25;
+
+  std::printf("%u Hz -> %u Hz, %u ch, %.1f s (high = %.0f Hz)\n", inputRate,
+              outputRate, channels, seconds, highFrequency);
+  std::printf("%-8s %-8s %10s %12s %12s %12s %12s\n", "quality", "simd",
+              "time(ms)", "Msamples/s", "realtime(x)", "SNR 1k(dB)",
+              "SNR high(dB)");
+  for (ResamplerQuality quality :
+       {ResamplerQuality::Low, ResamplerQuality::Medium,
+        ResamplerQuality::High}) {
+    if (!qualityName.empty() &&
+        qualityName != GetResamplerQualityName(quality)) {
+      continue;
+    }
+    const double snrLow = MeasureSnr(quality, inputRate, outputRate, 1000.0);
+    const double snrHigh =
+        MeasureSnr(quality, inputRate, outputRate, highFrequency);
+
+    for (SimdLevel level :
+         {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+      if (level > GetSupportedSimdLevel() ||
+          (!simd.empty() && simd != GetSimdLevelName(level))) {
+        continue;
+      }
+      const double time = MeasureSeconds(quality, level, channels, inputRate,
+                                         outputRate, outputFrames);
+      std::printf("%-8s %-8s %10.2f %12.1f %12.1f %12.1f %12.1f\n",
+                  GetResamplerQualityName(quality), GetSimdLevelName(level),
+                  time * 1000.0,
+                  time > 0.0 ? double(outputFrames) * channels / time / 1e6
+                             : 0.0,
+                  time > 0.0 ? seconds / time : 0.0, snrLow, snrHigh);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include "../../RiffReader.h"
+#include "../../SpatialAudio.h"
+#include "../CommandLine.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SpatialResult {
+  // 1回のUpdateにかかった時間(マイクロ秒)
+  double computeMicroseconds = 0.0;
+  double updateMicroseconds = 0.0;
+  // 各レベルの結果が揃っているかを見るための値
+  double checksum = 0.0;
+};
+
+SpatialResult RunSpatial(SimdLevel level, uint32_t emitterCount,
+                         uint32_t frames, const SoundData &sound) {
+  // エミッターごとにループするボイスを1つずつ結びつける
+  // ミキサーは混ぜないので、ここで測るのは計算とボイスへの書き込みだけ
+  AudioMixer mixer(AudioMixer::kDefaultSampleRate, emitterCount);
+  SpatialAudio spatial(level);
+  std::vector<AudioEmitterHandle> emitters;
+  for (uint32_t i = 0; i < emitterCount; ++i) {
+    const float angle = 2.0f * std::numbers::pi_v<float> * i / emitterCount;
+    const float radius = 2.0f + float(i % 37);
+    AudioEmitterHandle emitter = spatial.CreateEmitter(
+        {radius * std::cos(angle), float(i % 5), radius * std::sin(angle)});
+    spatial.AttachVoice(emitter, mixer.Play(sound, 1.0f, 0.0f, true));
+    emitters.push_back(emitter);
+  }
+
+  // エミッターを円の上で回し、カメラも動かしてドップラー効果を出す
+  const float deltaTime = 1.0f / 60.0f;
+  auto move = [&](uint32_t frame) {
+    for (uint32_t i = 0; i < emitterCount; ++i) {
+      const float angle =
+          2.0f * std::numbers::pi_v<float> * i / emitterCount + frame * 0.02f;
+      const float radius = 2.0f + float(i % 37);
+      spatial.SetEmitterPosition(emitters[i],
+                                 {radius * std::cos(angle), float(i % 5),
+                                  radius * std::sin(angle)});
+    }
+    Transform camera{{1.0f, 1.0f, 1.0f},
+                     {0.0f, frame * 0.01f, 0.0f},
+                     {0.0f, 1.0f, frame * 0.05f}};
+    return MakeAudioListener(camera);
+  };
+
+  SpatialResult result;
+  double computeSeconds = 0.0;
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    const AudioListener listener = move(frame);
+    BenchmarkTimer timer;
+    spatial.Compute(listener, deltaTime);
+    computeSeconds += timer.GetSeconds();
+  }
+  double updateSeconds = 0.0;
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    const AudioListener listener = move(frames + frame);
+    BenchmarkTimer timer;
+    spatial.Update(listener, deltaTime, mixer);
+    updateSeconds += timer.GetSeconds();
+  }
+  result.computeMicroseconds = computeSeconds / frames * 1e6;
+  result.updateMicroseconds = updateSeconds / frames * 1e6;
+  for (AudioEmitterHandle emitter : emitters) {
+    result.checksum += spatial.GetGain(emitter) +
+                       std::abs(spatial.GetPan(emitter)) +
+                       spatial.GetPitch(emitter);
+  }
+  return result;
+}
+
+} // namespace
+
+// 多数のエミッターの音量・パン・ピッチを毎フレーム計算する時間を測る
+// computeは計算だけ、updateはミキサーのボイスへの書き込みも含む
+int RunSpatialAudioBenchmark(const std::vector<std::string> &args) {
+  CommandLine commandLine(args);
+  const uint32_t emitterCount =
+      uint32_t(commandLine.GetUInt("--emitters", 512));
+  const uint32_t frames = uint32_t(commandLine.GetUInt("--frames", 2000));
+  const std::string simd = commandLine.GetString("--simd");
+  if (emitterCount == 0 || frames == 0) {
+    std::printf("usage: Benchmark spatial [--emitters N] [--frames N]"
+                " [--simd scalar|sse]\n");
+    return 1;
+  }
+
+  // 中身は鳴らさないので無音でよい
+  auto samples = std::make_shared<std::vector<int16_t>>(4800);
+  SoundData sound{};
+  sound.wfex.wFormatTag = kWaveFormatPcm;
+  sound.wfex.nChannels = 1;
+  sound.wfex.nSamplesPerSec = AudioMixer::kDefaultSampleRate;
+  sound.wfex.wBitsPerSample = 16;
+  sound.wfex.nBlockAlign = sizeof(int16_t);
+  sound.wfex.nAvgBytesPerSec = sound.wfex.nSamplesPerSec * sizeof(int16_t);
+  sound.pBUffer = reinterpret_cast<const BYTE *>(samples->data());
+  sound.bufferSize = unsigned(samples->size() * sizeof(int16_t));
+  sound.storage = samples;
+
+  std::printf("%-8s %10s %14s %14s %12s\n", "simd", "emitters",
+              "compute(us)", "update(us)", "checksum");
+  // SpatialAudioはAVXでもSSEで計算するので、2つだけ測る
+  for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse}) {
+    if (level > GetSupportedSimdLevel() ||
+        (!simd.empty() && simd != GetSimdLevelName(level))) {
+      continue;
+    }
+    const SpatialResult result =
+        RunSpatial(level, emitterCount, frames, sound);
+    std::printf("%-8s %10u %14.2f %14.2f %12.4f\n", GetSimdLevelName(level),
+                emitterCount, result.computeMicroseconds,
+                result.updateMicroseconds, result.checksum);
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// ツール共通のコマンドライン引数の読み取り
+// "--name value" 形式のオプションと "--flag" 形式のフラグだけを扱う
+class CommandLine {
+public:
+  CommandLine(const std::vector<std::string> &args) : args_(args) {}
+
+  bool HasFlag(const std::string &name) const {
+    for (const std::string &arg : args_) {
+      if (arg == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::string GetString(const std::string &name,
+                        const std::string &defaultValue = "") const {
+    for (size_t i = 0; i + 1 < args_.size(); ++i) {
+      if (args_[i] == name) {
+        return args_[i + 1];
+      }
+    }
+    return defaultValue;
+  }
+
+  // 同じオプションが何度も指定されたときはすべての値を返す
+  std::vector<std::string> GetStrings(const std::string &name) const {
+    std::vector<std::string> values;
+    for (size_t i = 0; i + 1 < args_.size(); ++i) {
+      if (args_[i] == name) {
+        values.push_back(args_[i + 1]);
+      }
+    }
+    return values;
+  }
+
+  uint64_t GetUInt(const std::string &name, uint64_t defaultValue) const {
+    std::string value = GetString(name);
+    return value.empty() ? defaultValue
+                         : std::strtoull(value.c_str(), nullptr, 0);
+  }
+
+  double GetDouble(const std::string &name, double defaultValue) const {
+    std::string value = GetString(name);
+    return value.empty() ? defaultValue : std::strtod(value.c_str(), nullptr);
+  }
+
+private:
+  std::vector<std::string> args_;
+};
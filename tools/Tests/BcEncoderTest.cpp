@@ -0,0 +1,473 @@
+#include "../../BcEncoder.h"
+#include "../../ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("BcEncoderTest.cpp:%d: failed: %s\n", line, expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+const BcFormat kFormats[] = {BcFormat::Bc1, BcFormat::Bc3, BcFormat::Bc7};
+const BcQuality kQualities[] = {BcQuality::Fast, BcQuality::Normal,
+                                BcQuality::High};
+
+const char *GetFormatName(BcFormat format) {
+  switch (format) {
+  case BcFormat::Bc1:
+    return "bc1";
+  case BcFormat::Bc3:
+    return "bc3";
+  default:
+    return "bc7";
+  }
+}
+
+#pragma region 画像
+
+enum class Pattern {
+  // ばらばらな色
+  Noise,
+  // なめらかな色とアルファ
+  Smooth,
+  // アルファが0か255の切り抜き
+  Cutout,
+  // 単色や2色のブロック、グレー
+  Flat,
+};
+const Pattern kPatterns[] = {Pattern::Noise, Pattern::Smooth, Pattern::Cutout,
+                             Pattern::Flat};
+
+const char *GetPatternName(Pattern pattern) {
+  switch (pattern) {
+  case Pattern::Noise:
+    return "noise";
+  case Pattern::Smooth:
+    return "smooth";
+  case Pattern::Cutout:
+    return "cutout";
+  default:
+    return "flat";
+  }
+}
+
+struct TestImage {
+  std::vector<uint8_t> pixels;
+  Rgba8Image image;
+};
+
+// 4の倍数でない大きさにして、端のブロックも通す
+// 高さはブロック18行で、プールを渡すと2つの帯に分かれる
+TestImage MakeImage(Pattern pattern, uint32_t width = 131,
+                    uint32_t height = 69) {
+  std::mt19937 rng(uint32_t(pattern) + 10);
+  TestImage result;
+  Rgba8Image &image = result.image;
+  image.width = width;
+  image.height = height;
+  image.rowPitch = size_t(width) * 4 + 8;
+  result.pixels.assign(image.rowPitch * height, 0);
+  image.pixels = result.pixels.data();
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint8_t *p = image.pixels + y * image.rowPitch + x * 4;
+      switch (pattern) {
+      case Pattern::Noise:
+        for (uint32_t c = 0; c < 4; ++c) {
+          p[c] = uint8_t(rng());
+        }
+        break;
+      case Pattern::Smooth:
+        p[0] = uint8_t(127.5 + 127.5 * std::sin(x * 0.05));
+        p[1] = uint8_t(127.5 + 127.5 * std::cos(y * 0.07));
+        p[2] = uint8_t((x + y) * 255 / (width + height));
+        p[3] = uint8_t(127.5 + 127.5 * std::sin((x + 2 * y) * 0.03));
+        break;
+      case Pattern::Cutout: {
+        const float dx = float(x) - width * 0.5f;
+        const float dy = float(y) - height * 0.5f;
+        p[0] = uint8_t(x * 255 / width);
+        p[1] = uint8_t(y * 255 / height);
+        p[2] = 90;
+        p[3] = dx * dx + dy * dy < 900.0f ? 255 : 0;
+        break;
+      }
+      case Pattern::Flat: {
+        // ブロックごとに単色、2色、グレーのどれかにする
+        std::mt19937 blockRng((y / 4) * 1000 + x / 4);
+        const uint8_t a[4] = {uint8_t(blockRng()), uint8_t(blockRng()),
+                              uint8_t(blockRng()), uint8_t(blockRng())};
+        const uint8_t b[4] = {uint8_t(blockRng()), uint8_t(blockRng()),
+                              uint8_t(blockRng()), 255};
+        const uint32_t kind = blockRng() % 3;
+        const uint8_t *color = kind == 1 && (x + y) % 2 == 1 ? b : a;
+        for (uint32_t c = 0; c < 4; ++c) {
+          p[c] = kind == 2 && c < 3 ? a[0] : color[c];
+        }
+        break;
+      }
+      }
+    }
+  }
+  return result;
+}
+
+// BC1で色だけを比べるときに、透明にされるピクセルをなくす
+TestImage MakeOpaque(TestImage image) {
+  for (uint32_t y = 0; y < image.image.height; ++y) {
+    for (uint32_t x = 0; x < image.image.width; ++x) {
+      image.pixels[y * image.image.rowPitch + x * 4 + 3] = 255;
+    }
+  }
+  image.image.pixels = image.pixels.data();
+  return image;
+}
+
+std::vector<uint8_t> Encode(const Rgba8Image &image, BcFormat format,
+                            BcQuality quality, SimdLevel level,
+                            ThreadPool *pool = nullptr) {
+  const size_t blockRowPitch =
+      size_t(image.width + 3) / 4 * GetBcBlockSize(format);
+  std::vector<uint8_t> blocks(blockRowPitch * ((image.height + 3) / 4));
+  BcEncodeSettings settings;
+  settings.format = format;
+  settings.quality = quality;
+  settings.simd = level;
+  EncodeBcImage(image, settings, blocks.data(), blockRowPitch, pool);
+  return blocks;
+}
+
+#pragma endregion
+
+#pragma region デコード
+
+void DecodeBc1Color(const uint8_t *block, bool isFourColorOnly,
+                    uint8_t *rgba) {
+  const uint32_t packed[2] = {uint32_t(block[0] | (block[1] << 8)),
+                              uint32_t(block[2] | (block[3] << 8))};
+  uint32_t colors[4][4] = {};
+  for (uint32_t i = 0; i < 2; ++i) {
+    const uint32_t r = (packed[i] >> 11) & 31;
+    const uint32_t g = (packed[i] >> 5) & 63;
+    const uint32_t b = packed[i] & 31;
+    colors[i][0] = (r << 3) | (r >> 2);
+    colors[i][1] = (g << 2) | (g >> 4);
+    colors[i][2] = (b << 3) | (b >> 2);
+    colors[i][3] = 255;
+  }
+  const bool isFourColor = isFourColorOnly || packed[0] > packed[1];
+  for (uint32_t c = 0; c < 3; ++c) {
+    if (isFourColor) {
+      colors[2][c] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+      colors[3][c] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+    } else {
+      colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+    }
+  }
+  colors[2][3] = 255;
+  colors[3][3] = isFourColor ? 255 : 0;
+  for (uint32_t i = 0; i < 16; ++i) {
+    const uint32_t index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+    for (uint32_t c = 0; c < 4; ++c) {
+      rgba[i * 4 + c] = uint8_t(colors[index][c]);
+    }
+  }
+}
+
+void DecodeBc4Alpha(const uint8_t *block, uint8_t *rgba) {
+  const uint32_t alpha0 = block[0];
+  const uint32_t alpha1 = block[1];
+  uint32_t alphas[8] = {alpha0, alpha1};
+  if (alpha0 > alpha1) {
+    for (uint32_t k = 1; k < 7; ++k) {
+      alphas[k + 1] = ((7 - k) * alpha0 + k * alpha1 + 3) / 7;
+    }
+  } else {
+    for (uint32_t k = 1; k < 5; ++k) {
+      alphas[k + 1] = ((5 - k) * alpha0 + k * alpha1 + 2) / 5;
+    }
+    alphas[6] = 0;
+    alphas[7] = 255;
+  }
+  uint64_t bits = 0;
+  for (uint32_t i = 0; i < 6; ++i) {
+    bits |= uint64_t(block[2 + i]) << (i * 8);
+  }
+  for (uint32_t i = 0; i < 16; ++i) {
+    rgba[i * 4 + 3] = uint8_t(alphas[(bits >> (i * 3)) & 7]);
+  }
+}
+
+uint32_t ReadBits(const uint8_t *block, uint32_t &position, uint32_t count) {
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < count; ++i, ++position) {
+    value |= uint32_t((block[position / 8] >> (position % 8)) & 1) << i;
+  }
+  return value;
+}
+
+// モード6だけを読む。ほかのモードならfalse
+bool DecodeBc7Mode6(const uint8_t *block, uint8_t *rgba) {
+  const uint32_t kWeights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                 34, 38, 43, 47, 51, 55, 60, 64};
+  uint32_t position = 0;
+  if (ReadBits(block, position, 7) != (1u << 6)) {
+    return false;
+  }
+  uint32_t endpoints[2][4];
+  for (uint32_t c = 0; c < 4; ++c) {
+    endpoints[0][c] = ReadBits(block, position, 7);
+    endpoints[1][c] = ReadBits(block, position, 7);
+  }
+  const uint32_t pBits[2] = {ReadBits(block, position, 1),
+                             ReadBits(block, position, 1)};
+  for (uint32_t e = 0; e < 2; ++e) {
+    for (uint32_t c = 0; c < 4; ++c) {
+      endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+    }
+  }
+  for (uint32_t i = 0; i < 16; ++i) {
+    const uint32_t weight = kWeights[ReadBits(block, position, i == 0 ? 3 : 4)];
+    for (uint32_t c = 0; c < 4; ++c) {
+      rgba[i * 4 + c] = uint8_t(
+          ((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >>
+          6);
+    }
+  }
+  return true;
+}
+
+// 画像の大きさに戻す(はみ出した分は捨てる)
+bool DecodeImage(const std::vector<uint8_t> &blocks, BcFormat format,
+                 uint32_t width, uint32_t height, std::vector<uint8_t> &rgba) {
+  const size_t blockSize = GetBcBlockSize(format);
+  const uint32_t blockColumns = (width + 3) / 4;
+  rgba.assign(size_t(width) * height * 4, 0);
+  uint8_t pixels[64];
+  for (uint32_t by = 0; by < (height + 3) / 4; ++by) {
+    for (uint32_t bx = 0; bx < blockColumns; ++bx) {
+      const uint8_t *block =
+          blocks.data() + (size_t(by) * blockColumns + bx) * blockSize;
+      switch (format) {
+      case BcFormat::Bc1:
+        DecodeBc1Color(block, false, pixels);
+        break;
+      case BcFormat::Bc3:
+        DecodeBc1Color(block + 8, true, pixels);
+        DecodeBc4Alpha(block, pixels);
+        break;
+      case BcFormat::Bc7:
+        if (!DecodeBc7Mode6(block, pixels)) {
+          return false;
+        }
+        break;
+      }
+      for (uint32_t i = 0; i < 16; ++i) {
+        const uint32_t x = bx * 4 + i % 4;
+        const uint32_t y = by * 4 + i / 4;
+        if (x < width && y < height) {
+          std::copy(pixels + i * 4, pixels + i * 4 + 4,
+                    rgba.data() + (size_t(y) * width + x) * 4);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// RGB(アルファを持つ形式ならアルファも)のPSNR
+double ComputePsnr(const Rgba8Image &image, const std::vector<uint8_t> &rgba,
+                   uint32_t channels) {
+  double squaredError = 0.0;
+  for (uint32_t y = 0; y < image.height; ++y) {
+    for (uint32_t x = 0; x < image.width; ++x) {
+      const uint8_t *a = image.pixels + y * image.rowPitch + x * 4;
+      const uint8_t *b = rgba.data() + (size_t(y) * image.width + x) * 4;
+      for (uint32_t c = 0; c < channels; ++c) {
+        const double difference = double(a[c]) - double(b[c]);
+        squaredError += difference * difference;
+      }
+    }
+  }
+  const double mse =
+      squaredError / (double(image.width) * image.height * channels);
+  return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+#pragma endregion
+
+#pragma region テスト
+
+// SSEやAVXでも、プールで分けても、スカラー版と同じブロックになる
+void TestSimdMatchesScalar() {
+  ThreadPool pool(3);
+  const SimdLevel supported = GetSupportedSimdLevel();
+  for (Pattern pattern : kPatterns) {
+    const TestImage image = MakeImage(pattern);
+    for (BcFormat format : kFormats) {
+      for (BcQuality quality : kQualities) {
+        const std::vector<uint8_t> expected =
+            Encode(image.image, format, quality, SimdLevel::Scalar);
+        for (SimdLevel level : {SimdLevel::Sse, SimdLevel::Avx}) {
+          if (level > supported) {
+            continue;
+          }
+          if (Encode(image.image, format, quality, level) != expected) {
+            std::printf("%s %s %s differs from scalar at %s\n",
+                        GetPatternName(pattern), GetFormatName(format),
+                        GetBcQualityName(quality), GetSimdLevelName(level));
+            ++failureCount;
+          }
+        }
+        if (Encode(image.image, format, quality, supported, &pool) !=
+            expected) {
+          std::printf("%s %s %s differs with a pool\n",
+                      GetPatternName(pattern), GetFormatName(format),
+                      GetBcQualityName(quality));
+          ++failureCount;
+        }
+      }
+    }
+  }
+}
+
+// 戻した画像が元に十分近い
+void TestQuality() {
+  // なめらかな画像のPSNRの下限(Fast, Normal, High)
+  const double kMinimumPsnr[3][3] = {
+      {35.0, 37.0, 37.0}, {36.0, 38.0, 38.0}, {37.0, 38.5, 38.5}};
+  for (uint32_t f = 0; f < 3; ++f) {
+    const BcFormat format = kFormats[f];
+    const TestImage smooth = format == BcFormat::Bc1
+                                 ? MakeOpaque(MakeImage(Pattern::Smooth))
+                                 : MakeImage(Pattern::Smooth);
+    const uint32_t channels = format == BcFormat::Bc1 ? 3 : 4;
+    double previousPsnr = 0.0;
+    for (uint32_t q = 0; q < 3; ++q) {
+      std::vector<uint8_t> rgba;
+      EXPECT(DecodeImage(Encode(smooth.image, format, kQualities[q],
+                                SimdLevel::Scalar),
+                         format, smooth.image.width, smooth.image.height,
+                         rgba));
+      const double psnr = ComputePsnr(smooth.image, rgba, channels);
+      if (psnr < kMinimumPsnr[f][q] || psnr + 0.05 < previousPsnr) {
+        std::printf("%s %s: PSNR %.2f dB\n", GetFormatName(format),
+                    GetBcQualityName(kQualities[q]), psnr);
+        ++failureCount;
+      }
+      previousPsnr = psnr;
+    }
+  }
+}
+
+// 単色や2色のブロックはほぼそのまま戻り、切り抜きのアルファは保たれる
+// Fastは色の範囲の箱の対角を端点にするので、2色が対角にないと戻らない
+void TestFlatAndCutout() {
+  const TestImage cutout = MakeImage(Pattern::Cutout);
+  // 565に丸める分と、間の色の丸め方の違い
+  const int32_t kTolerances[3] = {8, 8, 2};
+  for (uint32_t f = 0; f < 3; ++f) {
+    const BcFormat format = kFormats[f];
+    const TestImage flat = format == BcFormat::Bc1
+                               ? MakeOpaque(MakeImage(Pattern::Flat))
+                               : MakeImage(Pattern::Flat);
+    for (BcQuality quality : {BcQuality::Normal, BcQuality::High}) {
+      std::vector<uint8_t> rgba;
+      EXPECT(DecodeImage(Encode(flat.image, format, quality, SimdLevel::Scalar),
+                         format, flat.image.width, flat.image.height, rgba));
+      int32_t maxError = 0;
+      for (uint32_t y = 0; y < flat.image.height; ++y) {
+        for (uint32_t x = 0; x < flat.image.width; ++x) {
+          const uint8_t *a =
+              flat.image.pixels + y * flat.image.rowPitch + x * 4;
+          const uint8_t *b =
+              rgba.data() + (size_t(y) * flat.image.width + x) * 4;
+          for (uint32_t c = 0; c < 4; ++c) {
+            maxError = std::max(maxError, std::abs(int32_t(a[c]) - b[c]));
+          }
+        }
+      }
+      if (maxError > kTolerances[f]) {
+        std::printf("flat %s %s: error %d\n", GetFormatName(format),
+                    GetBcQualityName(quality), maxError);
+        ++failureCount;
+      }
+
+      EXPECT(DecodeImage(
+          Encode(cutout.image, format, quality, SimdLevel::Scalar), format,
+          cutout.image.width, cutout.image.height, rgba));
+      uint32_t alphaMismatches = 0;
+      for (uint32_t y = 0; y < cutout.image.height; ++y) {
+        for (uint32_t x = 0; x < cutout.image.width; ++x) {
+          const uint8_t a =
+              cutout.image.pixels[y * cutout.image.rowPitch + x * 4 + 3];
+          const uint8_t b = rgba[(size_t(y) * cutout.image.width + x) * 4 + 3];
+          // BC1とBC3は0と255をそのまま表せる。BC7はpビットの分だけずれてよい
+          if (format == BcFormat::Bc7 ? std::abs(a - b) > 2 : a != b) {
+            ++alphaMismatches;
+          }
+        }
+      }
+      if (alphaMismatches != 0) {
+        std::printf("cutout %s %s: %u alpha mismatches\n",
+                    GetFormatName(format), GetBcQualityName(quality),
+                    alphaMismatches);
+        ++failureCount;
+      }
+    }
+  }
+}
+
+// 1ブロックずつ圧縮しても、画像から切り出したブロックと同じになる
+void TestBlockMatchesImage() {
+  const TestImage image = MakeImage(Pattern::Noise, 8, 4);
+  uint8_t pixels[64];
+  for (uint32_t i = 0; i < 16; ++i) {
+    std::copy(image.image.pixels + (i / 4) * image.image.rowPitch +
+                  (i % 4) * 4 + 16,
+              image.image.pixels + (i / 4) * image.image.rowPitch +
+                  (i % 4) * 4 + 20,
+              pixels + i * 4);
+  }
+  for (BcFormat format : kFormats) {
+    BcEncodeSettings settings;
+    settings.format = format;
+    const std::vector<uint8_t> blocks = Encode(
+        image.image, format, settings.quality, settings.simd);
+    std::vector<uint8_t> block(GetBcBlockSize(format));
+    EncodeBcBlock(pixels, settings, block.data());
+    EXPECT(std::equal(block.begin(), block.end(),
+                      blocks.begin() + GetBcBlockSize(format)));
+  }
+}
+
+#pragma endregion
+
+} // namespace
+
+int main() {
+  TestSimdMatchesScalar();
+  TestQuality();
+  TestFlatAndCutout();
+  TestBlockMatchesImage();
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("BcEncoderTest: all passed (%s)\n",
+              GetSimdLevelName(GetSupportedSimdLevel()));
+  return 0;
+}
@@ -0,0 +1,328 @@
+#include "../../MipGenerator.h"
+#include "../../ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("MipGeneratorTest.cpp:%d: failed: %s\n", line, expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+const MipFormat kFormats[] = {MipFormat::Rgba8, MipFormat::Rgba16Float,
+                              MipFormat::R8, MipFormat::Rg8};
+
+uint32_t GetPixelBytes(MipFormat format) {
+  switch (format) {
+  case MipFormat::Rgba16Float:
+    return 8;
+  case MipFormat::R8:
+    return 1;
+  case MipFormat::Rg8:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+// レベル0に乱数を入れたミップチェーン。行の終わりにはパディングを入れる
+struct MipChain {
+  std::vector<std::vector<uint8_t>> storage;
+  std::vector<MipImage> levels;
+};
+
+MipChain MakeMipChain(MipFormat format, uint32_t width, uint32_t height,
+                      uint32_t seed) {
+  const uint32_t pixelBytes = GetPixelBytes(format);
+  MipChain chain;
+  const uint32_t levelCount = GetMipLevelCount(width, height);
+  chain.storage.resize(levelCount);
+  chain.levels.resize(levelCount);
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    MipImage &image = chain.levels[level];
+    image.width = std::max(width >> level, 1u);
+    image.height = std::max(height >> level, 1u);
+    image.rowPitch = size_t(image.width) * pixelBytes + 16;
+    chain.storage[level].assign(image.rowPitch * image.height, 0);
+    image.pixels = chain.storage[level].data();
+  }
+
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> &top = chain.storage[0];
+  if (format == MipFormat::Rgba16Float) {
+    // 0～2の半精度浮動小数点(NaNや無限大は入れない)
+    for (size_t i = 0; i + 1 < top.size(); i += 2) {
+      const uint16_t half = uint16_t(((rng() % 16) << 10) | (rng() % 1024));
+      top[i] = uint8_t(half);
+      top[i + 1] = uint8_t(half >> 8);
+    }
+  } else {
+    for (uint8_t &value : top) {
+      value = uint8_t(rng());
+    }
+  }
+  return chain;
+}
+
+// パディングも含めてすべてのレベルが同じか
+bool IsSameChain(const MipChain &a, const MipChain &b) {
+  return a.storage == b.storage;
+}
+
+struct ImageSize {
+  uint32_t width;
+  uint32_t height;
+};
+// 帯の数が多いもの、奇数の幅と高さ、1ピクセル幅
+const ImageSize kSizes[] = {{1024, 1024}, {1023, 517}, {1, 7}, {300, 1}};
+
+// プールで帯に分けて作っても、1スレッドで作ったものとビット単位で同じになる
+void TestParallelMatchesSerial() {
+  ThreadPool pool(4);
+  uint32_t seed = 1;
+  for (MipFormat format : kFormats) {
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+      for (const ImageSize &size : kSizes) {
+        MipSettings settings;
+        settings.format = format;
+        settings.filter = filter;
+        settings.isSrgb = format == MipFormat::Rgba8;
+        MipChain serial =
+            MakeMipChain(format, size.width, size.height, seed);
+        MipChain parallel =
+            MakeMipChain(format, size.width, size.height, seed);
+        ++seed;
+        GenerateMipChain(serial.levels.data(), uint32_t(serial.levels.size()),
+                         settings);
+        GenerateMipChain(parallel.levels.data(),
+                         uint32_t(parallel.levels.size()), settings, &pool);
+        if (!IsSameChain(serial, parallel)) {
+          std::printf("format %d filter %s %ux%u: parallel differs\n",
+                      int(format), GetMipFilterName(filter), size.width,
+                      size.height);
+          ++failureCount;
+        }
+      }
+    }
+  }
+
+  // アルファカバレッジの調整はレベルごとに全体を見るので、分けても変わらない
+  MipSettings settings;
+  settings.alphaCoverageReference = 0.5f;
+  MipChain serial = MakeMipChain(MipFormat::Rgba8, 513, 257, 99);
+  MipChain parallel = MakeMipChain(MipFormat::Rgba8, 513, 257, 99);
+  GenerateMipChain(serial.levels.data(), uint32_t(serial.levels.size()),
+                   settings);
+  GenerateMipChain(parallel.levels.data(), uint32_t(parallel.levels.size()),
+                   settings, &pool);
+  EXPECT(IsSameChain(serial, parallel));
+}
+
+// SSEやAVXで作っても、スカラー版とビット単位で同じになる
+void TestSimdMatchesScalar() {
+  // SIMDの本体と端数の両方を通る幅
+  const ImageSize kSimdSizes[] = {{37, 9}, {1023, 517}, {1, 7}, {300, 1}};
+  const SimdLevel supported = GetSupportedSimdLevel();
+  uint32_t seed = 1000;
+  for (MipFormat format : kFormats) {
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+      for (bool isSrgb : {false, true}) {
+        if (isSrgb && format != MipFormat::Rgba8) {
+          continue;
+        }
+        for (const ImageSize &size : kSimdSizes) {
+          MipSettings settings;
+          settings.format = format;
+          settings.filter = filter;
+          settings.isSrgb = isSrgb;
+          settings.alphaCoverageReference = isSrgb ? 0.5f : 0.0f;
+          settings.simd = SimdLevel::Scalar;
+          MipChain expected =
+              MakeMipChain(format, size.width, size.height, seed);
+          GenerateMipChain(expected.levels.data(),
+                           uint32_t(expected.levels.size()), settings);
+          for (SimdLevel level : {SimdLevel::Sse, SimdLevel::Avx}) {
+            if (level > supported) {
+              continue;
+            }
+            settings.simd = level;
+            MipChain actual =
+                MakeMipChain(format, size.width, size.height, seed);
+            GenerateMipChain(actual.levels.data(),
+                             uint32_t(actual.levels.size()), settings);
+            if (!IsSameChain(expected, actual)) {
+              std::printf("format %d filter %s%s %ux%u differs from scalar "
+                          "at %s\n",
+                          int(format), GetMipFilterName(filter),
+                          isSrgb ? " sRGB" : "", size.width, size.height,
+                          GetSimdLevelName(level));
+              ++failureCount;
+            }
+          }
+          ++seed;
+        }
+      }
+    }
+  }
+}
+
+double DecodeSrgb(double c) {
+  return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+double EncodeSrgb(double linear) {
+  return linear <= 0.0031308 ? linear * 12.92
+                             : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+}
+
+// フィルターの重み(doubleで計算し直す)。出力のiは元の2i+firstOffsetから見る
+std::vector<double> GetReferenceWeights(MipFilter filter,
+                                        int32_t &firstOffset) {
+  if (filter == MipFilter::Box) {
+    firstOffset = 0;
+    return {0.5, 0.5};
+  }
+  firstOffset = -2;
+  const auto besselI0 = [](double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (uint32_t k = 1; k < 32; ++k) {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+    }
+    return sum;
+  };
+  std::vector<double> weights(6);
+  double sum = 0.0;
+  for (uint32_t i = 0; i < 6; ++i) {
+    const double distance = double(i) - 2.5;
+    const double x = std::numbers::pi * distance * 0.5;
+    const double t = distance / 3.0;
+    weights[i] = std::sin(x) / x * besselI0(4.0 * std::sqrt(1.0 - t * t)) /
+                 besselI0(4.0);
+    sum += weights[i];
+  }
+  for (double &weight : weights) {
+    weight /= sum;
+  }
+  return weights;
+}
+
+// 8bitの形式は、doubleで計算したものと1以内の差に収まる
+void TestMatchesReference() {
+  const SimdLevel supported = GetSupportedSimdLevel();
+  uint32_t seed = 2000;
+  for (MipFormat format : {MipFormat::Rgba8, MipFormat::R8, MipFormat::Rg8}) {
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+      for (bool isSrgb : {false, true}) {
+        if (isSrgb && format != MipFormat::Rgba8) {
+          continue;
+        }
+        MipChain chain = MakeMipChain(format, 67, 45, seed++);
+        const MipImage &source = chain.levels[0];
+        const MipImage &destination = chain.levels[1];
+        const uint32_t channels = GetPixelBytes(format);
+        int32_t firstOffset = 0;
+        const std::vector<double> weights =
+            GetReferenceWeights(filter, firstOffset);
+        const auto load = [&](int64_t x, int64_t y, uint32_t c) {
+          x = std::clamp(x, int64_t(0), int64_t(source.width) - 1);
+          y = std::clamp(y, int64_t(0), int64_t(source.height) - 1);
+          const double value =
+              source.pixels[size_t(y) * source.rowPitch +
+                            size_t(x) * channels + c] /
+              255.0;
+          return isSrgb && c < 3 ? DecodeSrgb(value) : value;
+        };
+
+        MipSettings settings;
+        settings.format = format;
+        settings.filter = filter;
+        settings.isSrgb = isSrgb;
+        for (SimdLevel level :
+             {SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx}) {
+          if (level > supported) {
+            continue;
+          }
+          settings.simd = level;
+          DownsampleMip(source, destination, settings, 0, destination.height);
+          int32_t maxError = 0;
+          for (uint32_t y = 0; y < destination.height; ++y) {
+            for (uint32_t x = 0; x < destination.width; ++x) {
+              for (uint32_t c = 0; c < channels; ++c) {
+                double sum = 0.0;
+                for (size_t ky = 0; ky < weights.size(); ++ky) {
+                  for (size_t kx = 0; kx < weights.size(); ++kx) {
+                    sum += weights[ky] * weights[kx] *
+                           load(int64_t(x) * 2 + firstOffset + int64_t(kx),
+                                int64_t(y) * 2 + firstOffset + int64_t(ky),
+                                c);
+                  }
+                }
+                sum = std::clamp(sum, 0.0, 1.0);
+                const double encoded = isSrgb && c < 3 ? EncodeSrgb(sum) : sum;
+                const int32_t expected = int32_t(encoded * 255.0 + 0.5);
+                const int32_t actual =
+                    destination.pixels[size_t(y) * destination.rowPitch +
+                                       size_t(x) * channels + c];
+                maxError = std::max(maxError, std::abs(actual - expected));
+              }
+            }
+          }
+          if (maxError > 1) {
+            std::printf("format %d filter %s%s at %s: error %d\n",
+                        int(format), GetMipFilterName(filter),
+                        isSrgb ? " sRGB" : "", GetSimdLevelName(level),
+                        maxError);
+            ++failureCount;
+          }
+        }
+      }
+    }
+  }
+}
+
+// ワーカーのジョブの中からParallelForを呼んでも止まらない
+void TestNestedParallelFor() {
+  ThreadPool pool(2);
+  std::atomic<uint32_t> count = 0;
+  for (int i = 0; i < 4; ++i) {
+    pool.Submit([&] {
+      pool.ParallelFor(8, [&](uint32_t) {
+        pool.ParallelFor(8, [&](uint32_t) { ++count; });
+      });
+    });
+  }
+  pool.WaitIdle();
+  EXPECT(count == 4 * 8 * 8);
+}
+
+} // namespace
+
+int main() {
+  TestParallelMatchesSerial();
+  TestSimdMatchesScalar();
+  TestMatchesReference();
+  TestNestedParallelFor();
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("MipGeneratorTest: all passed (%s)\n",
+              GetSimdLevelName(GetSupportedSimdLevel()));
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "../../PcmConvert.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("PcmConvertTest.cpp:%d: failed: %s\n", line, expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+const PcmFormat kFormats[] = {PcmFormat::UInt8, PcmFormat::Int16,
+                              PcmFormat::Int24, PcmFormat::Int32,
+                              PcmFormat::Float32};
+
+// 範囲外やNaNを混ぜた入力。SIMDの本体と端数の両方を通るよう長めにする
+std::vector<float> MakeSource() {
+  const float kNan = std::numeric_limits<float>::quiet_NaN();
+  const float kInfinity = std::numeric_limits<float>::infinity();
+  // 6,7は範囲外、8,9はNaN、10,11は無限大
+  const float kValues[] = {0.0f,      -0.0f,      0.5f,  -0.5f, 1.0f,
+                           -1.0f,     1.5f,       -1.5f, kNan,  -kNan,
+                           kInfinity, -kInfinity, 0.25f, 1e-7f, -0.999f,
+                           0.75f,     2.0f};
+  std::vector<float> source;
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    for (float value : kValues) {
+      source.push_back(value);
+    }
+  }
+  return source;
+}
+
+std::vector<uint8_t> Convert(PcmFormat format, const std::vector<float> &src,
+                             SimdLevel level) {
+  std::vector<uint8_t> dst(src.size() * GetPcmSampleBytes(format));
+  ConvertFloatToPcm(format, src.data(), dst.data(), src.size(), level);
+  return dst;
+}
+
+template <typename T>
+T LoadSample(const std::vector<uint8_t> &data, size_t index) {
+  T value;
+  std::memcpy(&value, data.data() + index * sizeof(T), sizeof(T));
+  return value;
+}
+
+// Float32も-1～1に収め、NaNは0にする
+void TestFloat32Clamp() {
+  const std::vector<float> source = MakeSource();
+  const std::vector<uint8_t> dst =
+      Convert(PcmFormat::Float32, source, SimdLevel::Scalar);
+  for (size_t i = 0; i < source.size(); ++i) {
+    const float value = LoadSample<float>(dst, i);
+    EXPECT(value >= -1.0f && value <= 1.0f);
+    if (std::isnan(source[i])) {
+      EXPECT(value == 0.0f);
+    }
+  }
+  EXPECT(LoadSample<float>(dst, 6) == 1.0f);
+  EXPECT(LoadSample<float>(dst, 7) == -1.0f);
+  EXPECT(LoadSample<float>(dst, 2) == 0.5f);
+}
+
+// NaNは無音、範囲外は端の値になる
+void TestNanAndRange() {
+  const std::vector<float> source = MakeSource();
+  const std::vector<uint8_t> int16 =
+      Convert(PcmFormat::Int16, source, SimdLevel::Scalar);
+  EXPECT(LoadSample<int16_t>(int16, 8) == 0);
+  EXPECT(LoadSample<int16_t>(int16, 9) == 0);
+  EXPECT(LoadSample<int16_t>(int16, 6) == 32767);
+  EXPECT(LoadSample<int16_t>(int16, 7) == -32768);
+  EXPECT(LoadSample<int16_t>(int16, 10) == 32767);
+  EXPECT(LoadSample<int16_t>(int16, 11) == -32768);
+
+  const std::vector<uint8_t> uint8 =
+      Convert(PcmFormat::UInt8, source, SimdLevel::Scalar);
+  EXPECT(uint8[8] == 128);
+
+  const std::vector<uint8_t> int24 =
+      Convert(PcmFormat::Int24, source, SimdLevel::Scalar);
+  EXPECT(int24[8 * 3] == 0 && int24[8 * 3 + 1] == 0 && int24[8 * 3 + 2] == 0);
+
+  const std::vector<uint8_t> int32 =
+      Convert(PcmFormat::Int32, source, SimdLevel::Scalar);
+  EXPECT(LoadSample<int32_t>(int32, 8) == 0);
+  EXPECT(LoadSample<int32_t>(int32, 11) == INT32_MIN);
+}
+
+// どのレベルでもスカラー版とビット単位で同じになる
+void TestSimdMatchesScalar() {
+  const std::vector<float> source = MakeSource();
+  const SimdLevel supported = GetSupportedSimdLevel();
+  for (PcmFormat format : kFormats) {
+    const std::vector<uint8_t> expected =
+        Convert(format, source, SimdLevel::Scalar);
+    for (SimdLevel level : {SimdLevel::Sse, SimdLevel::Avx}) {
+      if (level > supported) {
+        continue;
+      }
+      const std::vector<uint8_t> actual = Convert(format, source, level);
+      if (actual != expected) {
+        std::printf("format %d differs from scalar at %s\n", int(format),
+                    GetSimdLevelName(level));
+        ++failureCount;
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  TestFloat32Clamp();
+  TestNanAndRange();
+  TestSimdMatchesScalar();
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("PcmConvertTest: all passed (%s)\n",
+              GetSimdLevelName(GetSupportedSimdLevel()));
+  return 0;
+}
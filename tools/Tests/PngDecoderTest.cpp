@@ -0,0 +1,781 @@
+#include "../../Inflate.h"
+#include "../../PngDecoder.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// 自前のInflateとPNGデコーダーを、zlibで圧縮した画像と突き合わせるテスト
+// 使い方: PngDecoderTest [PNGのあるディレクトリ ...] [--write <dir>]
+// ディレクトリの中のPNGは、zlibとこのファイルの素直なフィルター戻しで読んだものと比べる
+// --writeを付けると作った画像を書き出す(WindowsでPngWicTestに渡してWICと比べる)
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("PngDecoderTest.cpp:%d: failed: %s\n", line, expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+#pragma region 基準になるPNGの読み書き
+
+enum ColorType : uint8_t {
+  kGray = 0,
+  kRgb = 2,
+  kPalette = 3,
+  kGrayAlpha = 4,
+  kRgba = 6,
+};
+
+uint32_t GetChannelCount(uint8_t colorType) {
+  switch (colorType) {
+  case kGrayAlpha:
+    return 2;
+  case kRgb:
+    return 3;
+  case kRgba:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+struct Adam7Pass {
+  uint32_t x;
+  uint32_t y;
+  uint32_t stepX;
+  uint32_t stepY;
+};
+const Adam7Pass kAdam7Passes[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8},
+                                   {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2},
+                                   {0, 1, 1, 2}};
+const Adam7Pass kSinglePass = {0, 0, 1, 1};
+
+// PNGに入れる前の画像。samplesはサンプルの値(パレットなら番号)をピクセル順に並べる
+struct SourceImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint8_t depth = 8;
+  uint8_t colorType = kRgba;
+  bool isInterlaced = false;
+  std::vector<uint16_t> samples;
+  // RGBの並び
+  std::vector<uint8_t> palette;
+  std::vector<uint8_t> paletteAlpha;
+  bool hasColorKey = false;
+  uint16_t colorKey[3] = {};
+
+  const Adam7Pass *GetPasses() const {
+    return isInterlaced ? kAdam7Passes : &kSinglePass;
+  }
+  uint32_t GetPassCount() const { return isInterlaced ? 7 : 1; }
+  size_t GetRowBytes(uint32_t rowWidth) const {
+    return (size_t(rowWidth) * GetChannelCount(colorType) * depth + 7) / 8;
+  }
+  uint32_t GetFilterStride() const {
+    const uint32_t bits = GetChannelCount(colorType) * depth;
+    return bits < 8 ? 1 : bits / 8;
+  }
+};
+
+bool GetPassSize(const SourceImage &image, const Adam7Pass &pass,
+                 uint32_t &passWidth, uint32_t &passHeight) {
+  if (image.width <= pass.x || image.height <= pass.y) {
+    return false;
+  }
+  passWidth = (image.width - pass.x + pass.stepX - 1) / pass.stepX;
+  passHeight = (image.height - pass.y + pass.stepY - 1) / pass.stepY;
+  return true;
+}
+
+// DecodePngが返すはずのRGBA。行は詰めて並べ、16bitはホストのバイト順
+std::vector<uint8_t> ExpandToRgba(const SourceImage &image) {
+  const uint32_t channels = GetChannelCount(image.colorType);
+  const bool is16 = image.depth == 16;
+  const uint32_t opaque = is16 ? 0xFFFF : 0xFF;
+  // 8bit未満のグレーやRGBは0～255に広げる(パレットの番号は広げない)
+  const uint32_t scale = image.depth < 8 && image.colorType != kPalette
+                             ? 255 / ((1u << image.depth) - 1)
+                             : 1;
+  const size_t pixelCount = size_t(image.width) * image.height;
+  std::vector<uint8_t> rgba(pixelCount * (is16 ? 8 : 4));
+  for (size_t i = 0; i < pixelCount; ++i) {
+    const uint16_t *s = image.samples.data() + i * channels;
+    uint32_t value[4] = {};
+    switch (image.colorType) {
+    case kGray: {
+      const bool isKey = image.hasColorKey && s[0] == image.colorKey[0];
+      value[0] = value[1] = value[2] = s[0] * scale;
+      value[3] = isKey ? 0 : opaque;
+      break;
+    }
+    case kRgb: {
+      const bool isKey = image.hasColorKey && s[0] == image.colorKey[0] &&
+                         s[1] == image.colorKey[1] &&
+                         s[2] == image.colorKey[2];
+      value[0] = s[0];
+      value[1] = s[1];
+      value[2] = s[2];
+      value[3] = isKey ? 0 : opaque;
+      break;
+    }
+    case kGrayAlpha:
+      value[0] = value[1] = value[2] = s[0];
+      value[3] = s[1];
+      break;
+    case kRgba:
+      std::copy(s, s + 4, value);
+      break;
+    case kPalette:
+      value[0] = image.palette[s[0] * 3];
+      value[1] = image.palette[s[0] * 3 + 1];
+      value[2] = image.palette[s[0] * 3 + 2];
+      value[3] = s[0] < image.paletteAlpha.size() ? image.paletteAlpha[s[0]]
+                                                  : opaque;
+      break;
+    }
+    for (uint32_t c = 0; c < 4; ++c) {
+      if (is16) {
+        const uint16_t word = uint16_t(value[c]);
+        std::memcpy(rgba.data() + i * 8 + c * 2, &word, sizeof(word));
+      } else {
+        rgba[i * 4 + c] = uint8_t(value[c]);
+      }
+    }
+  }
+  return rgba;
+}
+
+uint8_t Predict(uint8_t filter, uint8_t a, uint8_t b, uint8_t c) {
+  switch (filter) {
+  case 1:
+    return a;
+  case 2:
+    return b;
+  case 3:
+    return uint8_t((a + b) / 2);
+  case 4: {
+    const int32_t p = a + b - c;
+    const int32_t pa = std::abs(p - a);
+    const int32_t pb = std::abs(p - b);
+    const int32_t pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+      return a;
+    }
+    return pb <= pc ? b : c;
+  }
+  default:
+    return 0;
+  }
+}
+
+// 1行分のサンプルを、フィルターの種類のバイトを付けずに詰める
+void PackRow(const SourceImage &image, const Adam7Pass &pass, uint32_t y,
+             uint32_t passWidth, std::vector<uint8_t> &row) {
+  const uint32_t channels = GetChannelCount(image.colorType);
+  row.assign(image.GetRowBytes(passWidth), 0);
+  const size_t imageY = pass.y + size_t(y) * pass.stepY;
+  for (uint32_t x = 0; x < passWidth; ++x) {
+    const size_t pixel = imageY * image.width + pass.x + size_t(x) * pass.stepX;
+    for (uint32_t c = 0; c < channels; ++c) {
+      const uint16_t sample = image.samples[pixel * channels + c];
+      const size_t index = size_t(x) * channels + c;
+      if (image.depth == 16) {
+        row[index * 2] = uint8_t(sample >> 8);
+        row[index * 2 + 1] = uint8_t(sample);
+      } else if (image.depth == 8) {
+        row[index] = uint8_t(sample);
+      } else {
+        const size_t bit = index * image.depth;
+        row[bit >> 3] |= uint8_t(sample << (8 - image.depth - (bit & 7)));
+      }
+    }
+  }
+}
+
+void UnpackRow(SourceImage &image, const Adam7Pass &pass, uint32_t y,
+               uint32_t passWidth, const uint8_t *row) {
+  const uint32_t channels = GetChannelCount(image.colorType);
+  const size_t imageY = pass.y + size_t(y) * pass.stepY;
+  for (uint32_t x = 0; x < passWidth; ++x) {
+    const size_t pixel = imageY * image.width + pass.x + size_t(x) * pass.stepX;
+    for (uint32_t c = 0; c < channels; ++c) {
+      const size_t index = size_t(x) * channels + c;
+      uint16_t sample = 0;
+      if (image.depth == 16) {
+        sample = uint16_t((row[index * 2] << 8) | row[index * 2 + 1]);
+      } else if (image.depth == 8) {
+        sample = row[index];
+      } else {
+        const size_t bit = index * image.depth;
+        sample = uint16_t((row[bit >> 3] >> (8 - image.depth - (bit & 7))) &
+                          ((1u << image.depth) - 1));
+      }
+      image.samples[pixel * channels + c] = sample;
+    }
+  }
+}
+
+// 行ごとに種類を選んでフィルターをかけた、圧縮前の画像データ
+std::vector<uint8_t> FilterImage(const SourceImage &image, std::mt19937 &rng) {
+  const uint32_t stride = image.GetFilterStride();
+  std::vector<uint8_t> raw;
+  std::vector<uint8_t> row;
+  std::vector<uint8_t> prior;
+  for (uint32_t i = 0; i < image.GetPassCount(); ++i) {
+    const Adam7Pass &pass = image.GetPasses()[i];
+    uint32_t passWidth = 0;
+    uint32_t passHeight = 0;
+    if (!GetPassSize(image, pass, passWidth, passHeight)) {
+      continue;
+    }
+    prior.assign(image.GetRowBytes(passWidth), 0);
+    for (uint32_t y = 0; y < passHeight; ++y) {
+      PackRow(image, pass, y, passWidth, row);
+      const uint8_t filter = uint8_t(rng() % 5);
+      raw.push_back(filter);
+      for (size_t x = 0; x < row.size(); ++x) {
+        const uint8_t a = x >= stride ? row[x - stride] : 0;
+        const uint8_t c = x >= stride ? prior[x - stride] : 0;
+        raw.push_back(uint8_t(row[x] - Predict(filter, a, prior[x], c)));
+      }
+      prior = row;
+    }
+  }
+  return raw;
+}
+
+// windowBitsが負ならヘッダーなし、正ならzlib形式
+std::vector<uint8_t> Compress(const std::vector<uint8_t> &data, int level,
+                              int strategy, int windowBits, int memLevel) {
+  z_stream stream{};
+  deflateInit2(&stream, level, Z_DEFLATED, windowBits, memLevel, strategy);
+  std::vector<uint8_t> compressed(deflateBound(&stream, uLong(data.size())));
+  stream.next_in = const_cast<Bytef *>(data.data());
+  stream.avail_in = uInt(data.size());
+  stream.next_out = compressed.data();
+  stream.avail_out = uInt(compressed.size());
+  deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return compressed;
+}
+
+void AppendUint32(std::vector<uint8_t> &file, uint32_t value) {
+  file.push_back(uint8_t(value >> 24));
+  file.push_back(uint8_t(value >> 16));
+  file.push_back(uint8_t(value >> 8));
+  file.push_back(uint8_t(value));
+}
+
+void AppendChunk(std::vector<uint8_t> &file, const char *type,
+                 const uint8_t *data, size_t size) {
+  AppendUint32(file, uint32_t(size));
+  const size_t typeOffset = file.size();
+  file.insert(file.end(), type, type + 4);
+  file.insert(file.end(), data, data + size);
+  AppendUint32(file, uint32_t(crc32(0, file.data() + typeOffset,
+                                    uInt(size + 4))));
+}
+
+// 圧縮したデータをidatCount個のIDATに分けて入れる
+std::vector<uint8_t> WritePng(const SourceImage &image,
+                              const std::vector<uint8_t> &compressed,
+                              uint32_t idatCount, std::mt19937 &rng) {
+  const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  std::vector<uint8_t> file(kSignature, kSignature + 8);
+
+  std::vector<uint8_t> header;
+  AppendUint32(header, image.width);
+  AppendUint32(header, image.height);
+  header.push_back(image.depth);
+  header.push_back(image.colorType);
+  header.push_back(0);
+  header.push_back(0);
+  header.push_back(image.isInterlaced ? 1 : 0);
+  AppendChunk(file, "IHDR", header.data(), header.size());
+
+  // 知らない補助チャンクは読み飛ばされる
+  const uint8_t text[] = "Comment\0generated";
+  AppendChunk(file, "tEXt", text, sizeof(text) - 1);
+
+  if (image.colorType == kPalette) {
+    AppendChunk(file, "PLTE", image.palette.data(), image.palette.size());
+    if (!image.paletteAlpha.empty()) {
+      AppendChunk(file, "tRNS", image.paletteAlpha.data(),
+                  image.paletteAlpha.size());
+    }
+  } else if (image.hasColorKey) {
+    std::vector<uint8_t> key;
+    const uint32_t count = image.colorType == kGray ? 1 : 3;
+    for (uint32_t c = 0; c < count; ++c) {
+      key.push_back(uint8_t(image.colorKey[c] >> 8));
+      key.push_back(uint8_t(image.colorKey[c]));
+    }
+    AppendChunk(file, "tRNS", key.data(), key.size());
+  }
+
+  std::vector<size_t> splits;
+  for (uint32_t i = 1; i < idatCount; ++i) {
+    splits.push_back(rng() % (compressed.size() + 1));
+  }
+  splits.push_back(compressed.size());
+  std::sort(splits.begin(), splits.end());
+  size_t begin = 0;
+  for (size_t end : splits) {
+    AppendChunk(file, "IDAT", compressed.data() + begin, end - begin);
+    begin = end;
+  }
+  AppendChunk(file, "IEND", nullptr, 0);
+  return file;
+}
+
+uint32_t ReadUint32(const uint8_t *bytes) {
+  return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) |
+         (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+// zlibで展開し、仕様どおり1バイトずつフィルターを戻して読む
+bool ReferenceDecode(const std::vector<uint8_t> &file, SourceImage &image) {
+  image = {};
+  std::vector<uint8_t> compressed;
+  size_t offset = 8;
+  while (offset + 12 <= file.size()) {
+    const uint32_t length = ReadUint32(file.data() + offset);
+    const char *type = reinterpret_cast<const char *>(file.data() + offset + 4);
+    const uint8_t *data = file.data() + offset + 8;
+    if (length > file.size() - offset - 12) {
+      return false;
+    }
+    if (std::memcmp(type, "IHDR", 4) == 0) {
+      image.width = ReadUint32(data);
+      image.height = ReadUint32(data + 4);
+      image.depth = data[8];
+      image.colorType = data[9];
+      image.isInterlaced = data[12] == 1;
+    } else if (std::memcmp(type, "PLTE", 4) == 0) {
+      image.palette.assign(data, data + length);
+    } else if (std::memcmp(type, "tRNS", 4) == 0) {
+      if (image.colorType == kPalette) {
+        image.paletteAlpha.assign(data, data + length);
+      } else {
+        image.hasColorKey = true;
+        for (uint32_t c = 0; c < length / 2 && c < 3; ++c) {
+          image.colorKey[c] = uint16_t((data[c * 2] << 8) | data[c * 2 + 1]);
+        }
+      }
+    } else if (std::memcmp(type, "IDAT", 4) == 0) {
+      compressed.insert(compressed.end(), data, data + length);
+    }
+    offset += 12 + size_t(length);
+  }
+
+  size_t rawSize = 0;
+  for (uint32_t i = 0; i < image.GetPassCount(); ++i) {
+    uint32_t passWidth = 0;
+    uint32_t passHeight = 0;
+    if (GetPassSize(image, image.GetPasses()[i], passWidth, passHeight)) {
+      rawSize += size_t(passHeight) * (1 + image.GetRowBytes(passWidth));
+    }
+  }
+  std::vector<uint8_t> raw(rawSize);
+  uLongf rawLength = uLongf(raw.size());
+  if (uncompress(raw.data(), &rawLength, compressed.data(),
+                 uLong(compressed.size())) != Z_OK ||
+      rawLength != raw.size()) {
+    return false;
+  }
+
+  image.samples.assign(size_t(image.width) * image.height *
+                           GetChannelCount(image.colorType),
+                       0);
+  const uint32_t stride = image.GetFilterStride();
+  std::vector<uint8_t> row;
+  std::vector<uint8_t> prior;
+  offset = 0;
+  for (uint32_t i = 0; i < image.GetPassCount(); ++i) {
+    const Adam7Pass &pass = image.GetPasses()[i];
+    uint32_t passWidth = 0;
+    uint32_t passHeight = 0;
+    if (!GetPassSize(image, pass, passWidth, passHeight)) {
+      continue;
+    }
+    const size_t rowBytes = image.GetRowBytes(passWidth);
+    prior.assign(rowBytes, 0);
+    row.resize(rowBytes);
+    for (uint32_t y = 0; y < passHeight; ++y) {
+      const uint8_t filter = raw[offset];
+      for (size_t x = 0; x < rowBytes; ++x) {
+        const uint8_t a = x >= stride ? row[x - stride] : 0;
+        const uint8_t c = x >= stride ? prior[x - stride] : 0;
+        row[x] =
+            uint8_t(raw[offset + 1 + x] + Predict(filter, a, prior[x], c));
+      }
+      UnpackRow(image, pass, y, passWidth, row.data());
+      prior = row;
+      offset += 1 + rowBytes;
+    }
+  }
+  return true;
+}
+
+// DecodePngで読んだものを、行の間のパディングを除いて詰める
+bool DecodeWithPadding(const std::vector<uint8_t> &file,
+                       std::vector<uint8_t> &rgba, std::string *error) {
+  PngInfo info;
+  if (!ReadPngInfo(file.data(), file.size(), info, error)) {
+    return false;
+  }
+  // rowPitchが1行の大きさと違っても正しく書けるか確かめる
+  const size_t rowBytes = info.GetRowBytes();
+  const size_t rowPitch = rowBytes + 12;
+  std::vector<uint8_t> padded(rowPitch * info.height, 0xCD);
+  if (!DecodePng(file.data(), file.size(), padded.data(), rowPitch, error)) {
+    return false;
+  }
+  rgba.clear();
+  for (uint32_t y = 0; y < info.height; ++y) {
+    const uint8_t *row = padded.data() + rowPitch * y;
+    rgba.insert(rgba.end(), row, row + rowBytes);
+    if (std::any_of(row + rowBytes, row + rowPitch,
+                    [](uint8_t value) { return value != 0xCD; })) {
+      *error = "wrote past the row";
+      return false;
+    }
+  }
+  return true;
+}
+
+#pragma endregion
+
+#pragma region 作った画像
+
+struct Format {
+  uint8_t colorType;
+  uint8_t depth;
+};
+const Format kFormats[] = {
+    {kGray, 1},      {kGray, 2},      {kGray, 4},    {kGray, 8},
+    {kGray, 16},     {kRgb, 8},       {kRgb, 16},    {kPalette, 1},
+    {kPalette, 2},   {kPalette, 4},   {kPalette, 8}, {kGrayAlpha, 8},
+    {kGrayAlpha, 16}, {kRgba, 8},     {kRgba, 16}};
+
+SourceImage MakeSourceImage(const Format &format, bool isInterlaced,
+                            uint32_t variant, std::mt19937 &rng) {
+  SourceImage image;
+  image.colorType = format.colorType;
+  image.depth = format.depth;
+  image.isInterlaced = isInterlaced;
+  // 1x1や、Adam7のパスが空になる小さいものも混ぜる
+  if (variant == 0) {
+    image.width = 1 + rng() % 3;
+    image.height = 1 + rng() % 3;
+  } else {
+    image.width = 1 + rng() % 67;
+    image.height = 1 + rng() % 41;
+  }
+
+  const uint32_t channels = GetChannelCount(image.colorType);
+  const uint32_t maxValue = (1u << image.depth) - 1;
+  uint32_t sampleLimit = maxValue;
+  if (image.colorType == kPalette) {
+    const uint32_t paletteCount = 1 + rng() % (maxValue + 1);
+    sampleLimit = paletteCount - 1;
+    for (uint32_t i = 0; i < paletteCount * 3; ++i) {
+      image.palette.push_back(uint8_t(rng()));
+    }
+    if (variant % 2 == 1) {
+      const uint32_t alphaCount = 1 + rng() % paletteCount;
+      for (uint32_t i = 0; i < alphaCount; ++i) {
+        image.paletteAlpha.push_back(uint8_t(rng()));
+      }
+    }
+  }
+
+  // 半分ほどは前のピクセルをくり返し、圧縮で一致が出るようにする
+  const size_t pixelCount = size_t(image.width) * image.height;
+  image.samples.resize(pixelCount * channels);
+  for (size_t i = 0; i < pixelCount; ++i) {
+    const bool isRepeated = i > 0 && rng() % 2 == 0;
+    for (uint32_t c = 0; c < channels; ++c) {
+      image.samples[i * channels + c] =
+          isRepeated ? image.samples[(i - 1) * channels + c]
+                     : uint16_t(rng() % (sampleLimit + 1));
+    }
+  }
+
+  if (variant % 2 == 1 &&
+      (image.colorType == kGray || image.colorType == kRgb)) {
+    // 最初のピクセルの色を透明にする
+    image.hasColorKey = true;
+    for (uint32_t c = 0; c < channels; ++c) {
+      image.colorKey[c] = image.samples[c];
+    }
+  }
+  return image;
+}
+
+struct GeneratedPng {
+  std::string name;
+  std::vector<uint8_t> file;
+  std::vector<uint8_t> expected;
+};
+
+// 形式15種類 x インターレースの有無 x 4通りで120枚作る
+std::vector<GeneratedPng> MakeGeneratedPngs() {
+  const int kStrategies[] = {Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY,
+                             Z_RLE, Z_FIXED};
+  std::mt19937 rng(12345);
+  std::vector<GeneratedPng> pngs;
+  for (const Format &format : kFormats) {
+    for (bool isInterlaced : {false, true}) {
+      for (uint32_t variant = 0; variant < 4; ++variant) {
+        const SourceImage image =
+            MakeSourceImage(format, isInterlaced, variant, rng);
+        // 0は無圧縮のブロック、ほかは固定と動的なハフマンのブロックになる
+        const int level = int(rng() % 10);
+        const int strategy = kStrategies[rng() % 5];
+        const std::vector<uint8_t> compressed =
+            Compress(FilterImage(image, rng), level, strategy, 15,
+                     1 + int(rng() % 9));
+        GeneratedPng png;
+        png.name = "type" + std::to_string(format.colorType) + "_depth" +
+                   std::to_string(format.depth) +
+                   (isInterlaced ? "_adam7" : "") + "_" +
+                   std::to_string(variant) + ".png";
+        png.file = WritePng(image, compressed, 1 + rng() % 4, rng);
+        png.expected = ExpandToRgba(image);
+        pngs.push_back(std::move(png));
+      }
+    }
+  }
+  return pngs;
+}
+
+#pragma endregion
+
+#pragma region テスト
+
+void TestGeneratedPngs(const std::vector<GeneratedPng> &pngs) {
+  for (const GeneratedPng &png : pngs) {
+    std::vector<uint8_t> decoded;
+    std::string error;
+    if (!DecodeWithPadding(png.file, decoded, &error)) {
+      std::printf("%s: %s\n", png.name.c_str(), error.c_str());
+      ++failureCount;
+      continue;
+    }
+    if (decoded != png.expected) {
+      std::printf("%s: pixels differ\n", png.name.c_str());
+      ++failureCount;
+    }
+    // 基準の読み方も正しいことを確かめておく
+    SourceImage reference;
+    if (!ReferenceDecode(png.file, reference) ||
+        ExpandToRgba(reference) != png.expected) {
+      std::printf("%s: reference decoder is wrong\n", png.name.c_str());
+      ++failureCount;
+    }
+  }
+}
+
+std::vector<std::vector<uint8_t>> MakeInflateInputs() {
+  std::mt19937 rng(777);
+  std::vector<std::vector<uint8_t>> inputs;
+  inputs.push_back({});
+  inputs.push_back({42});
+  // ばらばらなもの、くり返しの多いもの、同じ値が長く続くもの
+  for (size_t size : {1000u, 70000u}) {
+    std::vector<uint8_t> random(size);
+    for (uint8_t &value : random) {
+      value = uint8_t(rng());
+    }
+    inputs.push_back(random);
+
+    std::vector<uint8_t> text;
+    const char *const kWords[] = {"vertex ", "normal ", "texcoord ", "face ",
+                                  "\n", "0.5 ", "-1.25 "};
+    while (text.size() < size) {
+      const char *word = kWords[rng() % 7];
+      text.insert(text.end(), word, word + std::strlen(word));
+    }
+    inputs.push_back(text);
+
+    std::vector<uint8_t> runs;
+    while (runs.size() < size) {
+      runs.insert(runs.end(), 1 + rng() % 400, uint8_t(rng() % 3));
+    }
+    inputs.push_back(runs);
+  }
+  // 32KB離れた一致(窓の端)が出るもの
+  std::vector<uint8_t> far(40000);
+  for (size_t i = 0; i < far.size(); ++i) {
+    far[i] = i < 32768 ? uint8_t(rng()) : far[i - 32768];
+  }
+  inputs.push_back(far);
+  return inputs;
+}
+
+void TestInflate() {
+  const int kStrategies[] = {Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY,
+                             Z_RLE, Z_FIXED};
+  for (const std::vector<uint8_t> &input : MakeInflateInputs()) {
+    for (int level : {0, 1, 6, 9}) {
+      for (int strategy : kStrategies) {
+        std::vector<uint8_t> output(input.size() + 1);
+        const std::vector<uint8_t> raw =
+            Compress(input, level, strategy, -15, 8);
+        EXPECT(Inflate(raw.data(), raw.size(), output.data(), input.size()));
+        EXPECT(std::equal(input.begin(), input.end(), output.begin()));
+
+        const std::vector<uint8_t> zlib =
+            Compress(input, level, strategy, 15, 8);
+        std::fill(output.begin(), output.end(), 0);
+        EXPECT(
+            InflateZlib(zlib.data(), zlib.size(), output.data(), input.size()));
+        EXPECT(std::equal(input.begin(), input.end(), output.begin()));
+
+        // 大きさがちょうどでなければ失敗する
+        EXPECT(!InflateZlib(zlib.data(), zlib.size(), output.data(),
+                            input.size() + 1));
+        if (!input.empty()) {
+          EXPECT(!InflateZlib(zlib.data(), zlib.size(), output.data(),
+                              input.size() - 1));
+        }
+      }
+    }
+  }
+}
+
+// 壊したファイルを読んでも落ちない(AddressSanitizerを付けてビルドすると範囲外も分かる)
+void TestCorruption(const std::vector<GeneratedPng> &pngs) {
+  std::mt19937 rng(2024);
+  for (const GeneratedPng &png : pngs) {
+    for (int i = 0; i < 30; ++i) {
+      std::vector<uint8_t> file = png.file;
+      switch (rng() % 3) {
+      case 0:
+        file.resize(rng() % file.size());
+        break;
+      case 1:
+        for (uint32_t n = 1 + rng() % 4; n > 0; --n) {
+          file[8 + rng() % (file.size() - 8)] ^= uint8_t(1 + rng() % 255);
+        }
+        break;
+      default: {
+        // IHDRは残して、後ろだけを壊す
+        const size_t begin = 33;
+        file[begin + rng() % (file.size() - begin)] = uint8_t(rng());
+        break;
+      }
+      }
+      PngInfo info;
+      if (!ReadPngInfo(file.data(), file.size(), info) ||
+          size_t(info.width) * info.height > (1u << 20)) {
+        continue;
+      }
+      std::vector<uint8_t> rgba(info.GetRowBytes() * info.height);
+      DecodePng(file.data(), file.size(), rgba.data(), info.GetRowBytes());
+    }
+  }
+
+  // zlib形式のデータを直接壊す
+  for (const std::vector<uint8_t> &input : MakeInflateInputs()) {
+    const std::vector<uint8_t> zlib =
+        Compress(input, 6, Z_DEFAULT_STRATEGY, 15, 8);
+    std::vector<uint8_t> output(input.size());
+    for (int i = 0; i < 50; ++i) {
+      std::vector<uint8_t> broken = zlib;
+      broken[rng() % broken.size()] ^= uint8_t(1 + rng() % 255);
+      if (rng() % 4 == 0) {
+        broken.resize(rng() % broken.size());
+      }
+      InflateZlib(broken.data(), broken.size(), output.data(), output.size());
+    }
+  }
+}
+
+void TestDirectory(const std::filesystem::path &directory) {
+  std::error_code ec;
+  uint32_t count = 0;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(directory, ec)) {
+    if (entry.path().extension() != ".png") {
+      continue;
+    }
+    std::ifstream stream(entry.path(), std::ios::binary);
+    const std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)),
+                                    std::istreambuf_iterator<char>());
+    SourceImage reference;
+    std::vector<uint8_t> decoded;
+    std::string error;
+    if (!ReferenceDecode(file, reference)) {
+      std::printf("%s: zlib cannot read it\n", entry.path().string().c_str());
+      ++failureCount;
+    } else if (!DecodeWithPadding(file, decoded, &error)) {
+      std::printf("%s: %s\n", entry.path().string().c_str(), error.c_str());
+      ++failureCount;
+    } else if (decoded != ExpandToRgba(reference)) {
+      std::printf("%s: pixels differ\n", entry.path().string().c_str());
+      ++failureCount;
+    }
+    ++count;
+  }
+  if (count == 0) {
+    std::printf("%s: no PNG files\n", directory.string().c_str());
+    ++failureCount;
+  }
+}
+
+#pragma endregion
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::filesystem::path> directories;
+  std::filesystem::path writeDirectory;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+      writeDirectory = argv[++i];
+    } else {
+      directories.push_back(argv[i]);
+    }
+  }
+
+  const std::vector<GeneratedPng> pngs = MakeGeneratedPngs();
+  if (!writeDirectory.empty()) {
+    std::filesystem::create_directories(writeDirectory);
+    for (const GeneratedPng &png : pngs) {
+      std::ofstream stream(writeDirectory / png.name, std::ios::binary);
+      stream.write(reinterpret_cast<const char *>(png.file.data()),
+                   std::streamsize(png.file.size()));
+    }
+  }
+
+  TestGeneratedPngs(pngs);
+  TestInflate();
+  TestCorruption(pngs);
+  for (const std::filesystem::path &directory : directories) {
+    TestDirectory(directory);
+  }
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("PngDecoderTest: all passed (%zu generated PNGs)\n",
+              pngs.size());
+  return 0;
+}
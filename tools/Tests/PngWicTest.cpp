@@ -0,0 +1,135 @@
+#include "../../PngDecoder.h"
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// 自前のPNGデコーダーがWICと1バイトも違わない結果を返すか確かめる(Windowsだけ)
+// 使い方: PngWicTest <PNGのあるディレクトリ ...>
+// PngDecoderTest --write <dir> で書き出した画像も渡せる
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+
+int failureCount = 0;
+
+// WICでRGBA(16bitならチャンネルごとに16bit)に変換して読む
+bool DecodeWithWic(IWICImagingFactory *factory,
+                   const std::vector<uint8_t> &file, uint32_t bitsPerChannel,
+                   std::vector<uint8_t> &rgba) {
+  ComPtr<IWICStream> stream;
+  if (FAILED(factory->CreateStream(&stream)) ||
+      FAILED(stream->InitializeFromMemory(const_cast<BYTE *>(file.data()),
+                                          DWORD(file.size())))) {
+    return false;
+  }
+  ComPtr<IWICBitmapDecoder> decoder;
+  if (FAILED(factory->CreateDecoderFromStream(
+          stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder))) {
+    return false;
+  }
+  ComPtr<IWICBitmapFrameDecode> frame;
+  if (FAILED(decoder->GetFrame(0, &frame))) {
+    return false;
+  }
+  const WICPixelFormatGUID &format = bitsPerChannel == 16
+                                         ? GUID_WICPixelFormat64bppRGBA
+                                         : GUID_WICPixelFormat32bppRGBA;
+  ComPtr<IWICBitmapSource> converted;
+  if (FAILED(WICConvertBitmapSource(format, frame.Get(), &converted))) {
+    return false;
+  }
+  UINT width = 0;
+  UINT height = 0;
+  if (FAILED(converted->GetSize(&width, &height))) {
+    return false;
+  }
+  const UINT stride = width * (bitsPerChannel == 16 ? 8 : 4);
+  rgba.resize(size_t(stride) * height);
+  return SUCCEEDED(
+      converted->CopyPixels(nullptr, stride, UINT(rgba.size()), rgba.data()));
+}
+
+void TestFile(IWICImagingFactory *factory, const std::filesystem::path &path) {
+  std::ifstream stream(path, std::ios::binary);
+  const std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)),
+                                  std::istreambuf_iterator<char>());
+  PngInfo info;
+  std::string error;
+  if (!ReadPngInfo(file.data(), file.size(), info, &error)) {
+    std::printf("%s: %s\n", path.string().c_str(), error.c_str());
+    ++failureCount;
+    return;
+  }
+  std::vector<uint8_t> decoded(info.GetRowBytes() * info.height);
+  if (!DecodePng(file.data(), file.size(), decoded.data(), info.GetRowBytes(),
+                 &error)) {
+    std::printf("%s: %s\n", path.string().c_str(), error.c_str());
+    ++failureCount;
+    return;
+  }
+  std::vector<uint8_t> reference;
+  if (!DecodeWithWic(factory, file, info.bitsPerChannel, reference)) {
+    std::printf("%s: WIC cannot read it\n", path.string().c_str());
+    ++failureCount;
+    return;
+  }
+  if (decoded != reference) {
+    size_t first = 0;
+    while (first < decoded.size() && decoded[first] == reference[first]) {
+      ++first;
+    }
+    std::printf("%s: differs from WIC at byte %zu\n", path.string().c_str(),
+                first);
+    ++failureCount;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {
+    std::printf("CoInitializeEx failed\n");
+    return 1;
+  }
+  int result = 0;
+  {
+    ComPtr<IWICImagingFactory> factory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr,
+                                CLSCTX_INPROC_SERVER,
+                                IID_PPV_ARGS(&factory)))) {
+      std::printf("cannot create the WIC factory\n");
+      result = 1;
+    } else {
+      uint32_t count = 0;
+      for (int i = 1; i < argc; ++i) {
+        std::error_code ec;
+        for (const auto &entry :
+             std::filesystem::directory_iterator(argv[i], ec)) {
+          if (entry.path().extension() == ".png") {
+            TestFile(factory.Get(), entry.path());
+            ++count;
+          }
+        }
+      }
+      if (count == 0) {
+        std::printf("no PNG files\n");
+        ++failureCount;
+      }
+      if (failureCount != 0) {
+        std::printf("%d failure(s)\n", failureCount);
+        result = 1;
+      } else {
+        std::printf("PngWicTest: all passed (%u PNGs)\n", count);
+      }
+    }
+  }
+  CoUninitialize();
+  return result;
+}
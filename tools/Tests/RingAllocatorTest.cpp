@@ -0,0 +1,118 @@
+#include "../../RingAllocator.h"
+#include <cstdio>
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("RingAllocatorTest.cpp:%d: failed: %s\n", line, expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+// 末尾に入りきらないものは先頭から切り出し、捨てた末尾も使用中に数える
+void TestWrapAround() {
+  RingAllocator ring(256);
+  EXPECT(ring.Allocate(100) == 0);
+  ring.Submit(1);
+  EXPECT(ring.Allocate(100) == 100);
+  ring.Submit(2);
+  ring.Release(1);
+  EXPECT(ring.GetUsedSize() == 100);
+
+  // 200から100は入らないので、56を捨てて先頭から
+  EXPECT(ring.Allocate(100) == 0);
+  EXPECT(ring.GetUsedSize() == 256);
+  ring.Submit(3);
+
+  // 捨てた56は先頭からの100と一緒に返る
+  ring.Release(2);
+  EXPECT(ring.GetUsedSize() == 156);
+  EXPECT(ring.Allocate(50) == 100);
+  ring.Submit(4);
+  ring.Release(4);
+  EXPECT(ring.GetUsedSize() == 0);
+}
+
+// 空きがなければ失敗し、返ってくれば同じ大きさをまた切り出せる
+void TestFullRing() {
+  RingAllocator ring(256);
+  EXPECT(ring.Allocate(257) == RingAllocator::kInvalidOffset);
+  EXPECT(ring.Allocate(256) == 0);
+  EXPECT(ring.Allocate(1) == RingAllocator::kInvalidOffset);
+  ring.Submit(1);
+
+  ring.Release(0);
+  EXPECT(ring.GetUsedSize() == 256);
+  EXPECT(ring.Allocate(1) == RingAllocator::kInvalidOffset);
+
+  ring.Release(1);
+  EXPECT(ring.GetUsedSize() == 0);
+  EXPECT(ring.Allocate(256) == 0);
+
+  // 先頭側だけ返っても、末尾をまたぐ大きさは入らない
+  RingAllocator split(256);
+  EXPECT(split.Allocate(64) == 0);
+  split.Submit(1);
+  EXPECT(split.Allocate(160) == 64);
+  split.Submit(2);
+  split.Release(1);
+  EXPECT(split.Allocate(96) == RingAllocator::kInvalidOffset);
+  EXPECT(split.Allocate(32) == 224);
+  EXPECT(split.Allocate(64) == 0);
+  EXPECT(split.GetUsedSize() == 256);
+}
+
+// 印は付けた順にしか返らず、古い値での呼び出しは何もしない
+void TestReleaseOrder() {
+  RingAllocator ring(1024);
+  ring.Allocate(100);
+  ring.Submit(1);
+  ring.Allocate(200);
+  ring.Submit(2);
+  ring.Allocate(300);
+  ring.Submit(3);
+
+  ring.Release(2);
+  EXPECT(ring.GetUsedSize() == 300);
+  ring.Release(1);
+  EXPECT(ring.GetUsedSize() == 300);
+  ring.Release(10);
+  EXPECT(ring.GetUsedSize() == 0);
+
+  // 新しく割り当てていなければ印は増えない
+  ring.Allocate(100);
+  ring.Submit(11);
+  ring.Submit(12);
+  ring.Release(11);
+  EXPECT(ring.GetUsedSize() == 0);
+}
+
+void TestAlignment() {
+  RingAllocator ring(1024);
+  EXPECT(ring.Allocate(10) == 0);
+  EXPECT(ring.Allocate(16, 256) == 256);
+  EXPECT(ring.GetUsedSize() == 272);
+  // 境界を合わせると末尾に入らないときも先頭から
+  EXPECT(ring.Allocate(600, 512) == RingAllocator::kInvalidOffset);
+  EXPECT(ring.Allocate(16, 512) == 512);
+}
+
+} // namespace
+
+int main() {
+  TestWrapAround();
+  TestFullRing();
+  TestReleaseOrder();
+  TestAlignment();
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("RingAllocatorTest: all passed\n");
+  return 0;
+}
@@ -0,0 +1,276 @@
+#include "../../TextureAtlas.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("TextureAtlasTest.cpp:%d: failed: %s\n", line, expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+// 乱数で埋めた画像。行の終わりにはパディングを入れる
+struct SourceImage {
+  std::vector<uint8_t> pixels;
+  Rgba8Image image;
+};
+
+std::vector<SourceImage> MakeImages(uint32_t count, uint32_t maxSize,
+                                    uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<SourceImage> sources(count);
+  for (SourceImage &source : sources) {
+    // 細長いものや1ピクセルのものも混ぜる
+    source.image.width = 1 + rng() % maxSize;
+    source.image.height = 1 + rng() % (rng() % 4 == 0 ? 4 : maxSize);
+    source.image.rowPitch = size_t(source.image.width) * 4 + rng() % 3 * 4;
+    source.pixels.resize(source.image.rowPitch * source.image.height);
+    for (uint8_t &value : source.pixels) {
+      value = uint8_t(rng());
+    }
+    source.image.pixels = source.pixels.data();
+  }
+  return sources;
+}
+
+std::vector<Rgba8Image> GetImages(const std::vector<SourceImage> &sources) {
+  std::vector<Rgba8Image> images;
+  for (const SourceImage &source : sources) {
+    images.push_back(source.image);
+  }
+  return images;
+}
+
+uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+struct Cell {
+  uint32_t page;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+// パディングと揃えを含めた、画像が使う枠
+Cell GetCell(const AtlasRegion &region, const AtlasSettings &settings) {
+  return {region.page, region.x - settings.padding,
+          region.y - settings.padding,
+          AlignUp(region.width + settings.padding * 2, settings.alignment),
+          AlignUp(region.height + settings.padding * 2, settings.alignment)};
+}
+
+bool IsOverlapped(const Cell &a, const Cell &b) {
+  return a.page == b.page && a.x < b.x + b.width && b.x < a.x + a.width &&
+         a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// 枠の中は画像そのものか、一番近い端のピクセルを伸ばしたもの
+bool IsCellFilled(const Rgba8Image &image, const AtlasPage &page,
+                  const Cell &cell, uint32_t padding) {
+  for (uint32_t y = 0; y < cell.height; ++y) {
+    const uint32_t sourceY =
+        uint32_t(std::clamp(int64_t(y) - int64_t(padding), int64_t(0),
+                            int64_t(image.height) - 1));
+    for (uint32_t x = 0; x < cell.width; ++x) {
+      const uint32_t sourceX =
+          uint32_t(std::clamp(int64_t(x) - int64_t(padding), int64_t(0),
+                              int64_t(image.width) - 1));
+      const uint8_t *expected =
+          image.pixels + sourceY * image.rowPitch + sourceX * 4;
+      const uint8_t *actual =
+          page.pixels.data() +
+          ((size_t(cell.y) + y) * page.width + cell.x + x) * 4;
+      if (std::memcmp(expected, actual, 4) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// 500枚を何ページかに詰めて、場所、中身、揃えを確かめる
+void TestPack() {
+  const std::vector<SourceImage> sources = MakeImages(500, 120, 45);
+  const std::vector<Rgba8Image> images = GetImages(sources);
+  AtlasSettings settings;
+  settings.pageWidth = 512;
+  settings.pageHeight = 512;
+  std::vector<AtlasPage> pages;
+  std::vector<AtlasRegion> regions;
+  std::string error;
+  EXPECT(PackAtlas(images.data(), uint32_t(images.size()), settings, pages,
+                   regions, &error));
+  EXPECT(regions.size() == images.size());
+  EXPECT(pages.size() > 1);
+
+  for (const AtlasPage &page : pages) {
+    EXPECT(page.width <= settings.pageWidth);
+    EXPECT(page.height <= settings.pageHeight);
+    EXPECT(page.width % settings.alignment == 0);
+    EXPECT(page.height % settings.alignment == 0);
+    EXPECT(page.pixels.size() == size_t(page.width) * page.height * 4);
+  }
+
+  std::vector<Cell> cells;
+  for (uint32_t i = 0; i < regions.size(); ++i) {
+    const AtlasRegion &region = regions[i];
+    const Cell cell = GetCell(region, settings);
+    if (region.page >= pages.size() || region.width != images[i].width ||
+        region.height != images[i].height) {
+      std::printf("image %u: wrong region\n", i);
+      ++failureCount;
+      continue;
+    }
+    const AtlasPage &page = pages[region.page];
+    // BCのブロックが画像をまたがない
+    if (cell.x % settings.alignment != 0 || cell.y % settings.alignment != 0 ||
+        cell.x + cell.width > page.width ||
+        cell.y + cell.height > page.height) {
+      std::printf("image %u: cell is misaligned or outside the page\n", i);
+      ++failureCount;
+      continue;
+    }
+    if (!IsCellFilled(images[i], page, cell, settings.padding)) {
+      std::printf("image %u: pixels differ\n", i);
+      ++failureCount;
+    }
+    EXPECT(region.u0 == float(region.x) / float(page.width));
+    EXPECT(region.v0 == float(region.y) / float(page.height));
+    EXPECT(region.u1 == float(region.x + region.width) / float(page.width));
+    EXPECT(region.v1 == float(region.y + region.height) / float(page.height));
+    cells.push_back(cell);
+  }
+  for (size_t i = 0; i < cells.size(); ++i) {
+    for (size_t j = i + 1; j < cells.size(); ++j) {
+      if (IsOverlapped(cells[i], cells[j])) {
+        std::printf("cells %zu and %zu overlap\n", i, j);
+        ++failureCount;
+      }
+    }
+  }
+}
+
+void TestPackFailure() {
+  const std::vector<SourceImage> sources = MakeImages(3, 60, 1);
+  std::vector<Rgba8Image> images = GetImages(sources);
+  AtlasSettings settings;
+  settings.pageWidth = 64;
+  settings.pageHeight = 64;
+  std::vector<AtlasPage> pages;
+  std::vector<AtlasRegion> regions;
+  std::string error;
+
+  // パディングを足すと1ページに入らない
+  images[1].width = 60;
+  EXPECT(!PackAtlas(images.data(), uint32_t(images.size()), settings, pages,
+                    regions, &error));
+  EXPECT(error == "image 1 does not fit in a page");
+
+  images[1].width = 0;
+  EXPECT(!PackAtlas(images.data(), uint32_t(images.size()), settings, pages,
+                    regions, &error));
+  EXPECT(error == "image 1 is empty");
+}
+
+void TestUvTransform() {
+  AtlasRegion region;
+  region.u0 = 0.25f;
+  region.v0 = 0.5f;
+  region.u1 = 0.75f;
+  region.v1 = 0.625f;
+  const Matrix4x4 m = MakeAtlasUvTransform(region);
+  // 行ベクトル(u, v, 0, 1)に右から掛ける
+  const auto transform = [&](float u, float v, float &x, float &y) {
+    x = u * m.m[0][0] + v * m.m[1][0] + m.m[3][0];
+    y = u * m.m[0][1] + v * m.m[1][1] + m.m[3][1];
+  };
+  float x = 0.0f;
+  float y = 0.0f;
+  transform(0.0f, 0.0f, x, y);
+  EXPECT(x == 0.25f && y == 0.5f);
+  transform(1.0f, 1.0f, x, y);
+  EXPECT(x == 0.75f && y == 0.625f);
+}
+
+// 書き出した定義ファイルを読み直すと同じ場所とUVになる
+void TestManifestRoundTrip() {
+  const std::vector<SourceImage> sources = MakeImages(500, 120, 46);
+  const std::vector<Rgba8Image> images = GetImages(sources);
+  AtlasSettings settings;
+  settings.pageWidth = 1024;
+  settings.pageHeight = 1024;
+  std::vector<AtlasPage> pages;
+  std::vector<AtlasRegion> regions;
+  EXPECT(PackAtlas(images.data(), uint32_t(images.size()), settings, pages,
+                   regions));
+
+  AtlasManifest manifest;
+  for (uint32_t i = 0; i < pages.size(); ++i) {
+    manifest.pages.push_back({"page" + std::to_string(i) + ".dds",
+                              pages[i].width, pages[i].height});
+  }
+  for (uint32_t i = 0; i < regions.size(); ++i) {
+    // 名前には空白を含めてよい
+    manifest.sprites.push_back(
+        {"sprite " + std::to_string(i) + ".png", regions[i]});
+  }
+
+  AtlasManifest parsed;
+  std::string error;
+  EXPECT(ParseAtlasManifest(FormatAtlasManifest(manifest), parsed, &error));
+  EXPECT(parsed.pages.size() == manifest.pages.size());
+  EXPECT(parsed.sprites.size() == manifest.sprites.size());
+  for (uint32_t i = 0; i < parsed.sprites.size() && i < regions.size(); ++i) {
+    const AtlasRegion &a = parsed.sprites[i].region;
+    const AtlasRegion &b = regions[i];
+    if (parsed.sprites[i].name != manifest.sprites[i].name ||
+        a.page != b.page || a.x != b.x || a.y != b.y || a.width != b.width ||
+        a.height != b.height || a.u0 != b.u0 || a.v0 != b.v0 ||
+        a.u1 != b.u1 || a.v1 != b.v1) {
+      std::printf("sprite %u differs after the round trip\n", i);
+      ++failureCount;
+    }
+  }
+  const AtlasManifest::Sprite *sprite = parsed.Find("sprite 123.png");
+  EXPECT(sprite != nullptr && sprite->region.x == regions[123].x);
+  EXPECT(parsed.Find("missing.png") == nullptr);
+
+  // 壊れた定義ファイル
+  EXPECT(!ParseAtlasManifest("sprite 0 0 0 4 4 a\n", parsed, &error));
+  EXPECT(!ParseAtlasManifest("page a.dds 8 8\nsprite 0 6 0 4 4 a\n", parsed,
+                             &error));
+  EXPECT(error == "line 2: sprite is outside the page");
+  EXPECT(!ParseAtlasManifest("frame 1\n", parsed, &error));
+  // コメントと空行、CRLFは読み飛ばす
+  EXPECT(ParseAtlasManifest("# atlas\r\n\r\npage a.dds 8 8\r\n", parsed,
+                            &error));
+  EXPECT(parsed.pages.size() == 1 && parsed.pages[0].fileName == "a.dds");
+}
+
+} // namespace
+
+int main() {
+  TestPack();
+  TestPackFailure();
+  TestUvTransform();
+  TestManifestRoundTrip();
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("TextureAtlasTest: all passed\n");
+  return 0;
+}
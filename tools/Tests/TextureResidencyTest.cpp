@@ -0,0 +1,306 @@
+#include "../../TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failureCount = 0;
+
+void Expect(bool condition, const char *expression, int line) {
+  if (!condition) {
+    std::printf("TextureResidencyTest.cpp:%d: failed: %s\n", line,
+                expression);
+    ++failureCount;
+  }
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+// sizeピクセル四方、1ピクセル4バイトのミップのバイト数
+std::vector<uint64_t> MakeMipSizes(uint32_t size) {
+  std::vector<uint64_t> sizes;
+  for (; size > 0; size >>= 1) {
+    sizes.push_back(uint64_t(size) * size * 4);
+  }
+  return sizes;
+}
+
+uint64_t SumFrom(const std::vector<uint64_t> &sizes, uint32_t begin) {
+  uint64_t bytes = 0;
+  for (uint32_t mip = begin; mip < sizes.size(); ++mip) {
+    bytes += sizes[mip];
+  }
+  return bytes;
+}
+
+// 最初はfloorMipから下だけが置かれ、要求すると細かいミップまで読む
+void TestRegisterAndRequest() {
+  const std::vector<uint64_t> sizes = MakeMipSizes(1024);
+  TextureResidency residency(UINT64_MAX);
+  const uint32_t id =
+      residency.Register(sizes.data(), uint32_t(sizes.size()), 4);
+  EXPECT(residency.GetResidentMip(id) == 4);
+  EXPECT(residency.GetResidentBytes() == SumFrom(sizes, 4));
+
+  std::vector<TextureResidency::Change> changes;
+  residency.Request(id, 1, 1);
+  // 同じフレームでは細かい方を取る
+  residency.Request(id, 2, 1);
+  EXPECT(residency.GetRequestedMip(id) == 1);
+  residency.Update(1, UINT64_MAX, changes);
+  EXPECT(residency.GetResidentMip(id) == 1);
+  EXPECT(residency.GetResidentBytes() == SumFrom(sizes, 1));
+  EXPECT(changes.size() == 1 && changes[0].id == id &&
+         changes[0].residentMip == 1);
+
+  // 変わらなければchangesは空
+  residency.Request(id, 1, 2);
+  residency.Update(2, UINT64_MAX, changes);
+  EXPECT(changes.empty());
+
+  // floorMipより粗い要求はfloorMipに丸める
+  residency.Request(id, 9, 3);
+  EXPECT(residency.GetRequestedMip(id) == 4);
+
+  residency.Unregister(id);
+  EXPECT(residency.GetResidentBytes() == 0);
+}
+
+// 1フレームに読む量はmaxLoadBytesまでで、残りは次のフレームに回る
+void TestLoadLimit() {
+  const std::vector<uint64_t> sizes = MakeMipSizes(1024);
+  TextureResidency residency(UINT64_MAX);
+  const uint32_t id =
+      residency.Register(sizes.data(), uint32_t(sizes.size()), 4);
+  std::vector<TextureResidency::Change> changes;
+  // 最低でも1段は読むので、0でも進む
+  uint32_t expectedMip = 4;
+  for (uint64_t frame = 1; frame <= 4; ++frame) {
+    residency.Request(id, 0, frame);
+    residency.Update(frame, 0, changes);
+    --expectedMip;
+    EXPECT(residency.GetResidentMip(id) == expectedMip);
+  }
+  // 合わせて2段分なら2段進む
+  const uint32_t other =
+      residency.Register(sizes.data(), uint32_t(sizes.size()), 4);
+  residency.Request(other, 0, 5);
+  residency.Update(5, sizes[3] + sizes[2], changes);
+  EXPECT(residency.GetResidentMip(other) == 2);
+}
+
+// 予算を超えるときは、長く使われていないテクスチャの細かいミップから捨てる
+void TestLruEviction() {
+  const std::vector<uint64_t> sizes = MakeMipSizes(256);
+  const uint32_t mipCount = uint32_t(sizes.size());
+  // 全部のミップを置いたテクスチャ2枚と、floorMipから下の1枚分
+  TextureResidency residency(SumFrom(sizes, 0) * 2 + SumFrom(sizes, 2));
+  const uint32_t a = residency.Register(sizes.data(), mipCount, 2);
+  const uint32_t b = residency.Register(sizes.data(), mipCount, 2);
+  const uint32_t c = residency.Register(sizes.data(), mipCount, 2);
+  std::vector<TextureResidency::Change> changes;
+
+  residency.Request(a, 0, 1);
+  residency.Update(1, UINT64_MAX, changes);
+  residency.Request(b, 0, 2);
+  residency.Update(2, UINT64_MAX, changes);
+  EXPECT(residency.GetResidentMip(a) == 0);
+  EXPECT(residency.GetResidentMip(b) == 0);
+
+  // cを読むにはaかbを捨てる必要があり、古いaが選ばれる
+  residency.Request(b, 0, 3);
+  residency.Request(c, 0, 3);
+  residency.Update(3, UINT64_MAX, changes);
+  EXPECT(residency.GetResidentMip(c) == 0);
+  EXPECT(residency.GetResidentMip(b) == 0);
+  EXPECT(residency.GetResidentMip(a) == 2);
+  EXPECT(residency.GetResidentBytes() <= residency.GetBudget());
+
+  // このフレームで使っているものしかなければ、読むのをあきらめる
+  residency.Request(a, 0, 4);
+  residency.Request(b, 0, 4);
+  residency.Request(c, 0, 4);
+  residency.Update(4, UINT64_MAX, changes);
+  EXPECT(residency.GetResidentMip(b) == 0);
+  EXPECT(residency.GetResidentMip(c) == 0);
+  EXPECT(residency.GetResidentMip(a) == 2);
+
+  // 予算を下げると、次のUpdateでfloorMipまで捨てる
+  residency.SetBudget(0);
+  residency.Update(5, UINT64_MAX, changes);
+  EXPECT(changes.size() == 2);
+  for (uint32_t id : {a, b, c}) {
+    EXPECT(residency.GetResidentMip(id) == 2);
+  }
+  EXPECT(residency.GetResidentBytes() == SumFrom(sizes, 2) * 3);
+}
+
+// validMipsで外した段は一番上にせず、その先までまとめて読む
+void TestValidMips() {
+  const std::vector<uint64_t> sizes = MakeMipSizes(256);
+  TextureResidency residency(UINT64_MAX);
+  const uint32_t id = residency.Register(
+      sizes.data(), uint32_t(sizes.size()), 5, (1u << 0) | (1u << 2));
+  std::vector<TextureResidency::Change> changes;
+  residency.Request(id, 4, 1);
+  residency.Update(1, 0, changes);
+  EXPECT(residency.GetResidentMip(id) == 2);
+  residency.Request(id, 0, 2);
+  residency.Update(2, 0, changes);
+  EXPECT(residency.GetResidentMip(id) == 0);
+  EXPECT(residency.GetResidentBytes() == SumFrom(sizes, 0));
+}
+
+// 乱数で登録、要求、予算の変更を繰り返しても、数え方と約束が崩れない
+void TestRandomized() {
+  struct Entry {
+    std::vector<uint64_t> sizes;
+    uint32_t floorMip;
+    uint32_t validMips;
+    bool isRegistered;
+    uint32_t lastMip;
+    uint64_t requestFrame;
+    uint32_t requestedMip;
+  };
+  std::mt19937 rng(44);
+  TextureResidency residency(1 << 22);
+  std::vector<Entry> entries;
+  std::vector<TextureResidency::Change> changes;
+  for (uint64_t frame = 1; frame <= 3000; ++frame) {
+    if (rng() % 10 == 0) {
+      Entry entry;
+      entry.sizes = MakeMipSizes(1u << (rng() % 11));
+      entry.floorMip = rng() % uint32_t(entry.sizes.size());
+      entry.validMips = rng() % 3 == 0 ? uint32_t(rng()) : UINT32_MAX;
+      entry.isRegistered = true;
+      const uint32_t id =
+          residency.Register(entry.sizes.data(), uint32_t(entry.sizes.size()),
+                             entry.floorMip, entry.validMips);
+      entry.lastMip = residency.GetResidentMip(id);
+      entry.requestFrame = 0;
+      if (id >= entries.size()) {
+        entries.resize(id + 1);
+      }
+      entries[id] = entry;
+    }
+    if (!entries.empty() && rng() % 20 == 0) {
+      const uint32_t id = rng() % uint32_t(entries.size());
+      if (entries[id].isRegistered) {
+        residency.Unregister(id);
+        entries[id].isRegistered = false;
+      }
+    }
+    if (rng() % 100 == 0) {
+      residency.SetBudget(uint64_t(rng() % (1 << 23)));
+    }
+    for (uint32_t id = 0; id < entries.size(); ++id) {
+      Entry &entry = entries[id];
+      if (entry.isRegistered && rng() % 3 == 0) {
+        const uint32_t mip = rng() % uint32_t(entry.sizes.size());
+        residency.Request(id, mip, frame);
+        entry.requestedMip = entry.requestFrame == frame
+                                 ? std::min(entry.requestedMip, mip)
+                                 : mip;
+        entry.requestFrame = frame;
+      }
+    }
+    residency.Update(frame, rng() % (1 << 21), changes);
+
+    uint64_t bytes = 0;
+    bool isOverBudgetAllowed = true;
+    for (uint32_t id = 0; id < entries.size(); ++id) {
+      Entry &entry = entries[id];
+      if (!entry.isRegistered) {
+        continue;
+      }
+      const uint32_t mip = residency.GetResidentMip(id);
+      if (mip > entry.floorMip ||
+          (mip != entry.floorMip && !(entry.validMips & (1u << mip)))) {
+        std::printf("frame %llu: texture %u has mip %u\n",
+                    static_cast<unsigned long long>(frame), id, mip);
+        ++failureCount;
+      }
+      bytes += SumFrom(entry.sizes, mip);
+      // 予算を超えてよいのは、捨てられるものがないときだけ
+      // このフレームで使うものは、要求より細かい段だけ捨てられる
+      if (mip < entry.floorMip) {
+        uint32_t coarserMip = mip + 1;
+        while (coarserMip < entry.floorMip &&
+               !(entry.validMips & (1u << coarserMip))) {
+          ++coarserMip;
+        }
+        if (entry.requestFrame != frame || coarserMip <= entry.requestedMip) {
+          isOverBudgetAllowed = false;
+        }
+      }
+      bool isReported = false;
+      for (const TextureResidency::Change &change : changes) {
+        if (change.id == id) {
+          isReported = change.residentMip == mip;
+        }
+      }
+      if ((mip != entry.lastMip) != isReported) {
+        std::printf("frame %llu: change of texture %u is not reported\n",
+                    static_cast<unsigned long long>(frame), id);
+        ++failureCount;
+      }
+      entry.lastMip = mip;
+    }
+    if (bytes != residency.GetResidentBytes()) {
+      std::printf("frame %llu: resident bytes %llu, expected %llu\n",
+                  static_cast<unsigned long long>(frame),
+                  static_cast<unsigned long long>(
+                      residency.GetResidentBytes()),
+                  static_cast<unsigned long long>(bytes));
+      ++failureCount;
+      return;
+    }
+    if (bytes > residency.GetBudget() && !isOverBudgetAllowed) {
+      std::printf("frame %llu: over budget with evictable mips\n",
+                  static_cast<unsigned long long>(frame));
+      ++failureCount;
+      return;
+    }
+  }
+}
+
+void TestScreenSize() {
+  const float kFovY = 0.45f;
+  // 内側にいるときは画面いっぱい以上
+  EXPECT(EstimateScreenSize(1.0f, 0.5f, kFovY, 720.0f) == 1440.0f);
+  const float size = EstimateScreenSize(1.0f, 10.0f, kFovY, 720.0f);
+  EXPECT(std::abs(size - 720.0f / (10.0f * std::tan(kFovY * 0.5f))) < 0.01f);
+  // 遠いほど小さい
+  EXPECT(EstimateScreenSize(1.0f, 20.0f, kFovY, 720.0f) < size);
+
+  EXPECT(SelectMipForScreenSize(1024, 512, 2000.0f, 11) == 0);
+  EXPECT(SelectMipForScreenSize(1024, 512, 1024.0f, 11) == 0);
+  EXPECT(SelectMipForScreenSize(1024, 512, 600.0f, 11) == 0);
+  EXPECT(SelectMipForScreenSize(1024, 512, 512.0f, 11) == 1);
+  EXPECT(SelectMipForScreenSize(1024, 512, 100.0f, 11) == 3);
+  EXPECT(SelectMipForScreenSize(1024, 512, 0.5f, 11) == 10);
+  EXPECT(SelectMipForScreenSize(1024, 512, 0.0f, 11) == 10);
+  // ミップが足りなければ一番粗いもの
+  EXPECT(SelectMipForScreenSize(1024, 512, 1.0f, 4) == 3);
+}
+
+} // namespace
+
+int main() {
+  TestRegisterAndRequest();
+  TestLoadLimit();
+  TestLruEviction();
+  TestValidMips();
+  TestRandomized();
+  TestScreenSize();
+  if (failureCount != 0) {
+    std::printf("%d failure(s)\n", failureCount);
+    return 1;
+  }
+  std::printf("TextureResidencyTest: all passed\n");
+  return 0;
+}